@@ -23,6 +23,7 @@
 
 #include <thread> // std::thread
 #include <future> // std::future
+#include <vector>
 
 namespace CFugue
 {
@@ -32,6 +33,8 @@ namespace CFugue
 		RtMidiIn*		    m_pMidiIn;
 		RtMidiOut*	        m_pMidiOut;
         std::future<bool>   m_bgTaskResult;
+        std::vector<unsigned char> m_MsgBuffer; // Scratch buffer for the outgoing messages, reserved once
+        std::vector<RtMidiOut*> m_ExtraMidiOuts; // Devices of the output ports beyond the first (port n at n-1). NULL if not open
 	public:
 		MIDIDriverAlsa ( int queue_size );
 		virtual ~MIDIDriverAlsa();
@@ -39,12 +42,13 @@ namespace CFugue
 		void ResetMIDIOut();
 
         /// <Summary>
-        /// Creates a background thread to pump MIDI events
-        /// at the supplied timer resolution.
+        /// Registers the driver with the shared MIDIPlaybackEngine to pump MIDI events
+        /// at the supplied timer resolution. No thread is created per driver; all
+        /// the drivers in the process are pumped by the engine's background thread.
         /// Use WaitTillDone() to wait till the background processing completes.
         /// Use StopTimer() after the background processing is completed, to release resources.
         /// @param resolution_ms MIDI Timer resolution in milliseconds
-        /// @return false if background thread cannot be started
+        /// @return false if already running or if the driver cannot be registered
         /// </Summary>
 		bool StartTimer ( int resolution_ms );
 
@@ -57,8 +61,8 @@ namespace CFugue
         /// Call StopTimer() to release the resources used by the background
         /// procedure created with StartTimer(). StopTimer() Should be called
         /// <i>after</i> the background procedure is done (indicated by BGThreadStatus::COMPLETED).
-        /// If background procedure is still running while StopTimer() is called, caller gets
-        /// blocked till the background procedure completes.
+        /// If background procedure is still running while StopTimer() is called, it is
+        /// taken off the engine; caller gets blocked only till any in-progress tick completes.
         /// If no background procedure exists, returns immediately.
 		void StopTimer();
 
@@ -66,14 +70,20 @@ namespace CFugue
 		/// @return false if the given input port cannot be opened
 		bool OpenMIDIInPort ( int id );
 
-        /// Opens the MIDI output port with the given ID
+        /// Opens the MIDI output port with the given ID for the messages of the
+        /// given output port number (refer jdkmidi::MIDIMessage::GetOutPort()).
+        /// Opening the output port 0 closes all the earlier opened ones. Messages for
+        /// the output ports without an open device are dropped.
+        /// All the output ports are fed from the same timer tick, so they stay in sync.
+        /// @param id the ID of the MIDI output device to open
+        /// @param nOutPort the output port number to open the device for
         /// @return false if the given output port cannot be opened
-		bool OpenMIDIOutPort ( int id );
+		bool OpenMIDIOutPort ( int id, unsigned char nOutPort = 0 );
 
 		/// Closed any previously opened MIDI Input port
 		void CloseMIDIInPort();
 
-		/// Closed any previously opened MIDI Output port
+		/// Closes all the previously opened MIDI Output ports
 		void CloseMIDIOutPort();
 
 		enum BGThreadStatus {   RUNNING,    ///< Async procedure is running - use WaitTillDone() to wait for completion
@@ -0,0 +1,156 @@
+/*
+	This is part of CFugue, a C++ Runtime for MIDI Score Programming
+	Copyright (C) 2009 Gopalakrishna Palem
+
+	For links to further information, or to contact the author,
+	see <http://cfugue.sourceforge.net/>.
+
+    $LastChangedDate$
+    $Rev$
+    $LastChangedBy$
+*/
+
+#ifndef __BATCHRENDERER_H__7150B797_E30B_4680_9169_D10EA6FCC455__
+#define __BATCHRENDERER_H__7150B797_E30B_4680_9169_D10EA6FCC455__
+
+/** @file BatchRenderer.h
+ * \brief Declares MIDIBatchRenderer class for CFugue
+ */
+#include "MusicStringParser.h"
+#include "MidiRenderer.h"
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace CFugue
+{
+	///<Summary>
+	/// Converts a batch of Music Strings to MIDI files offline, in parallel.
+	///
+	/// Each worker thread owns a parser and renderer pair. The pairs are built once,
+	/// kept across the Run() calls and only reset between the jobs, so the per-job
+	/// cost is the parse itself. The jobs are spread over the workers upfront, and a
+	/// worker that runs out of jobs steals half of the remaining jobs of another worker,
+	/// so a few long Music Strings do not hold up the whole batch.
+	///
+	/// The workers share only read-only tables (such as the default chord definitions)
+	/// and take no locks while rendering.
+	///</Summary>
+	/// Example Usage:
+	/** <pre>
+		std::vector<CFugue::MIDIBatchRenderer::Job> vecJobs;
+		vecJobs.push_back(CFugue::MIDIBatchRenderer::Job(_T("C D E F"), "first.mid"));
+		vecJobs.push_back(CFugue::MIDIBatchRenderer::Job(_T("I[Flute] G A B"), "second.mid"));
+
+		CFugue::MIDIBatchRenderer batch;
+		std::vector<CFugue::MIDIBatchRenderer::JobResult> vecResults;
+		CFugue::MIDIBatchRenderer::Throughput stats = batch.Run(vecJobs, vecResults);
+	</pre> */
+	class MIDIBatchRenderer
+	{
+	public:
+		///<Summary>A Music String to be rendered and where its MIDI file content should go</Summary>
+		struct Job
+		{
+			MString					strMusicNotes;
+			std::string				strOutputFilePath;	///< Used when pOutBuffer and pOutStream are NULL
+			std::vector<uint8_t>*	pOutBuffer;			///< Receives the MIDI file content, if not NULL
+			std::ostream*			pOutStream;			///< Receives the MIDI file content, if not NULL
+
+			/// Saves the MIDI file content to the given file
+			Job(const MString& notes, const char* szOutputFilePath)
+				: strMusicNotes(notes), strOutputFilePath(szOutputFilePath), pOutBuffer(NULL), pOutStream(NULL) { }
+			/// Places the MIDI file content in the given buffer. The buffer should not be shared with other jobs.
+			Job(const MString& notes, std::vector<uint8_t>& outBuffer)
+				: strMusicNotes(notes), pOutBuffer(&outBuffer), pOutStream(NULL) { }
+			/// Writes the MIDI file content to the given stream. The stream should not be shared with other jobs.
+			Job(const MString& notes, std::ostream& outStream)
+				: strMusicNotes(notes), pOutBuffer(NULL), pOutStream(&outStream) { }
+		};
+
+		///<Summary>An error the parser reported (through evError) for a job</Summary>
+		struct JobError
+		{
+			long						lErrCode;	///< One of the CParser::ErrorCode values
+			std::basic_string<TCHAR>	strErrMsg;
+			std::basic_string<TCHAR>	strToken;	///< The offending token. Empty if none
+		};
+
+		///<Summary>Outcome of a job</Summary>
+		struct JobResult
+		{
+			bool					bSuccess;	///< True if the Music String was parsed and the MIDI content saved
+			std::vector<JobError>	errors;		///< Parse errors, in the order reported. Can be non-empty even upon success
+
+			JobResult() : bSuccess(false) { }
+		};
+
+		///<Summary>Aggregate figures of a Run()</Summary>
+		struct Throughput
+		{
+			size_t			nJobs;			///< Number of jobs run
+			size_t			nSucceeded;		///< Number of jobs with JobResult::bSuccess set
+			size_t			nErrors;		///< Number of parse errors reported across all the jobs
+			size_t			nStolen;		///< Number of jobs that were moved to another worker
+			unsigned int	nWorkers;		///< Number of worker threads used
+			double			dSeconds;		///< Wall clock time taken by the whole batch
+
+			Throughput() : nJobs(0), nSucceeded(0), nErrors(0), nStolen(0), nWorkers(0), dSeconds(0) { }
+
+			/// Returns the number of jobs completed per second
+			inline double JobsPerSecond() const { return dSeconds > 0 ? nJobs / dSeconds : 0; }
+		};
+
+		/// <Summary>
+		/// Creates the batch renderer.
+		/// @param nWorkers number of worker threads to use. Zero picks the number of hardware threads.
+		/// </Summary>
+		MIDIBatchRenderer(unsigned int nWorkers = 0);
+		~MIDIBatchRenderer();
+
+		/// <Summary>
+		/// Loads custom chord definitions into the parsers of all the workers.
+		/// @param pChords the chord definitions. NULL to use the in-built definitions.
+		/// The object should stay valid and unchanged as long as this batch renderer uses it.
+		/// </Summary>
+		inline void LoadChords(const Chords* pChords) { m_pChords = pChords; }
+
+		/// <Summary>
+		/// Renders the jobs and waits for all of them to complete. The calling thread
+		/// works on the jobs too. Each Music String starts with the default parser state
+		/// (default key signature, octaves and dictionary), whatever the earlier jobs defined.
+		/// Only one Run() should be in progress on an object at a time.
+		/// @param vecJobs the jobs to run
+		/// @param vecResults receives the outcome of each job, in the order of the jobs
+		/// @return the aggregate figures for the batch
+		/// </Summary>
+		Throughput Run(const std::vector<Job>& vecJobs, std::vector<JobResult>& vecResults);
+
+		/// Returns the number of worker threads the batch renderer uses
+		inline unsigned int GetWorkerCount() const { return m_nWorkers; }
+
+	private:
+		MIDIBatchRenderer(const MIDIBatchRenderer&);				// not implemented
+		MIDIBatchRenderer& operator=(const MIDIBatchRenderer&);	// not implemented
+
+		struct Worker;
+
+		/// Runs the jobs of the worker, then steals from the others till no jobs are left
+		void WorkerProc(size_t nWorker, const std::vector<Job>& vecJobs, std::vector<JobResult>& vecResults);
+
+		/// Takes the next job from the front of the worker's range. Returns false if the range is empty.
+		static bool PopJob(Worker& worker, size_t& nJob);
+
+		/// Moves half of the jobs left with some other worker to this worker's range
+		bool StealJobs(size_t nThief);
+
+		unsigned int							m_nWorkers;
+		const Chords*							m_pChords;
+		std::vector<std::unique_ptr<Worker> >	m_Workers;	// Kept across Run() calls
+	};
+
+} // namespace CFugue
+
+#endif // __BATCHRENDERER_H__7150B797_E30B_4680_9169_D10EA6FCC455__
@@ -48,10 +48,94 @@ extern "C"
     MUSICNOTELIB_API void* GetCarnaticMusicNoteReader();
 
 	/// <Summary>
-	/// Creates a MusicString Player object.
+	/// Creates a MusicString Player object that uses the default MIDI Output device
+	/// and the default Timer Resolution. Use CreateMusicStringPlayerWithOpts() to use custom values.
+	///
+	/// The player keeps its parser, renderer and MIDI output port for its lifetime, so that
+	/// the repeated calls with the same player do not pay for setting them up each time.
+	/// A player should be used by one thread at a time; different players can be used
+	/// from different threads at the same time.
+	///
+	/// Release the player with DestroyMusicStringPlayer().
+	/// @return the player handle. NULL upon failure.
 	/// </Summary>
     MUSICNOTELIB_API MStringPlayer* CreateMusicStringPlayer();
 
+	/// <Summary>
+	/// Same as CreateMusicStringPlayer() except that the player uses the given MIDI
+	/// Output device and Timer Resolution.
+	/// @param nMidiOutPortID the device ID of the MIDI output port to be used for the play
+	/// @param nTimerResMS preferred MIDI timer resolution, in MilliSeconds
+	/// @return the player handle. NULL upon failure.
+	/// </Summary>
+	MUSICNOTELIB_API MStringPlayer* CreateMusicStringPlayerWithOpts(int nMidiOutPortID, unsigned int nTimerResMS);
+
+	/// <Summary>
+	/// Stops any play in progress and releases the player created with CreateMusicStringPlayer().
+	/// Does nothing for NULL.
+	/// </Summary>
+	MUSICNOTELIB_API void DestroyMusicStringPlayer(MStringPlayer* pPlayer);
+
+	/// <Summary>
+	/// Sets the Callbacks to be used during the Parse of the Music Notes by the player.
+	/// Pass NULL for any callback that is not required.
+	/// @param pPlayer the player handle
+	/// @param traceCallbackProc the Callback to used to report Trace messages
+	/// @param errorCallbackProc the Callback to used to report Error messages
+	/// @param pUserData any user supplied data that should be sent to the Callback
+	/// </Summary>
+	MUSICNOTELIB_API void PlayerSetCallbacks(MStringPlayer* pPlayer,
+											LPFNTRACEPROC traceCallbackProc,
+											LPFNERRORPROC errorCallbackProc,
+											void* pUserData);
+
+	/// <Summary>
+	/// Parses the Music String and loads the MIDI events into the player, replacing
+	/// any earlier content, without playing them. Use PlayerSaveToBuffer() to retrieve
+	/// the MIDI file content afterwards.
+	/// @param pPlayer the player handle
+	/// @param szMusicNotes the Music string to be parsed
+	/// @return True if the notes were parsed successfully, False otherwise
+	/// </Summary>
+	MUSICNOTELIB_API bool PlayerParse(MStringPlayer* pPlayer, const TCHAR* szMusicNotes);
+
+	/// <Summary>
+	/// Starts playing the Music String asynchronously. Any play in progress on the
+	/// player is stopped first. Use PlayerWaitTillDone() to wait for the play to complete
+	/// and PlayerStop() to stop it.
+	/// @param pPlayer the player handle
+	/// @param szMusicNotes the Music string to be played on the MIDI output device
+	/// @return True if the play started successfully, False otherwise
+	/// </Summary>
+	MUSICNOTELIB_API bool PlayerPlayAsync(MStringPlayer* pPlayer, const TCHAR* szMusicNotes);
+
+	/// <Summary>
+	/// Waits (blocks) till the play started with PlayerPlayAsync() completes.
+	/// Returns immediately if no play is in progress.
+	/// </Summary>
+	MUSICNOTELIB_API void PlayerWaitTillDone(MStringPlayer* pPlayer);
+
+	/// <Summary>
+	/// Stops the play started with PlayerPlayAsync(). The MIDI output port stays
+	/// available to the next play of the player.
+	/// </Summary>
+	MUSICNOTELIB_API void PlayerStop(MStringPlayer* pPlayer);
+
+	/// <Summary>
+	/// Returns true if a play started with PlayerPlayAsync() is still in progress
+	/// </Summary>
+	MUSICNOTELIB_API bool PlayerIsPlaying(MStringPlayer* pPlayer);
+
+	/// <Summary>
+	/// Converts the content last parsed or played by the player into MIDI file content
+	/// held in memory. Release the returned buffer with FreeMidiBuffer().
+	/// @param pPlayer the player handle
+	/// @param ppBuffer receives the buffer holding the bytes of the MIDI file. NULL upon failure.
+	/// @param pnSize receives the number of bytes in the buffer
+	/// @return True if the the content was converted successfully, False otherwise
+	/// </Summary>
+	MUSICNOTELIB_API bool PlayerSaveToBuffer(MStringPlayer* pPlayer, unsigned char** ppBuffer, unsigned long* pnSize);
+
 	/// <Summary>
 	/// Plays Music string notes on the default MIDI Output device with the default Timer Resolution.
     /// Use PlayMusicStringWithOpts() to use custom values.
@@ -109,6 +193,21 @@ extern "C"
     /// </Summary>
     MUSICNOTELIB_API bool SaveAsMidiFile(const TCHAR* szMusicNotes, const char* szOutputFilePath);
 
+    /// <Summary>
+    /// Converts the given MusicString content into MIDI file content held in memory.
+    /// Nothing is written to the file system. Release the returned buffer with FreeMidiBuffer().
+    /// @param szMusicNotes Music Notes to be converted to MIDI output
+    /// @param ppBuffer receives the buffer holding the bytes of the MIDI file. NULL upon failure.
+    /// @param pnSize receives the number of bytes in the buffer
+    /// @return True if the the content was converted successfully, False otherwise
+    /// </Summary>
+    MUSICNOTELIB_API bool SaveAsMidiBuffer(const TCHAR* szMusicNotes, unsigned char** ppBuffer, unsigned long* pnSize);
+
+    /// <Summary>
+    /// Releases a buffer returned by SaveAsMidiBuffer() or PlayerSaveToBuffer(). Does nothing for NULL.
+    /// </Summary>
+    MUSICNOTELIB_API void FreeMidiBuffer(unsigned char* pBuffer);
+
     //MUSICNOTELIB_API typedef void (*ParseErrorProc)(const CFugue::CParser*, CFugue::CParser::ErrorEventHandlerArgs* pEvArgs);
     //MUSICNOTELIB_API typedef void (*ParseTraceProc)(const CFugue::CParser*, CFugue::CParser::TraceEventHandlerArgs* pEvArgs);
 
@@ -74,6 +74,26 @@ namespace CFugue
         /// @param retVal the ChordDef object that has a Chord with its name present in the szToken
 		/// @return the number of characters correctly matched. Zero, if no match found
         static unsigned int GetDefaultMatchingChord(const TCHAR* szToken, ChordDef* retVal);
+
+        /// Returns the object that holds the in-built default chord definitions.
+        /// The object is built on the first call and is never modified afterwards, so
+        /// it can be searched from any number of threads without locking. Holding on to
+        /// the returned reference saves the repeated calls the cost of the first-call check.
+        static const Chords& GetDefaultChords();
+
+        /// Retrieves the chord made of exactly the given half-step intervals above the root.
+        /// This is the reverse of ExtractMatchingChord, useful to name a group of notes.
+        /// When more than one definition has the same intervals (such as DOM7_5 and DOM7<5),
+        /// the one with the shortest name (the alphabetically first, among equals) is returned.
+        /// @param pIntervals the half-step intervals of the notes above the root, in ascending order
+        /// @param nIntervalCount the number of entries in pIntervals
+        /// @param retVal the ChordDef object that has the given intervals
+        /// @return true if a matching chord is found, false otherwise
+        bool FindChordByIntervals(const ChordDef::HALFSTEP* pIntervals, unsigned short nIntervalCount, ChordDef* retVal) const;
+
+        /// Returns a hash of the chord definitions (their names and intervals).
+        /// Chords objects having the same definitions have the same hash.
+        size_t GetHash() const;
     };
 
 } // namespace CFugue
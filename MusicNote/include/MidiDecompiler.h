@@ -0,0 +1,188 @@
+/*
+	This is part of CFugue, a C++ Runtime for MIDI Score Programming
+	Copyright (C) 2009 Gopalakrishna Palem
+
+	For links to further information, or to contact the author,
+	see <http://cfugue.sourceforge.net/>.
+
+    $LastChangedDate$
+    $Rev$
+    $LastChangedBy$
+*/
+
+#ifndef __MIDIDECOMPILER_H__68749E06_22C3_4C08_B77B_D8F08322B619__
+#define __MIDIDECOMPILER_H__68749E06_22C3_4C08_B77B_D8F08322B619__
+
+/** @file MidiDecompiler.h
+ * \brief Declares MIDIDecompiler class for CFugue
+ */
+#include "jdkmidi/fileread.h"
+#include "Chords.h"
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace CFugue
+{
+	///<Summary>
+	/// Converts Standard MIDI File content back into a MusicString.
+	///
+	/// The decompiler is a MIDIFileEvents handler, so it consumes the events as
+	/// a MIDI file reader (such as jdkmidi::MIDIFileReadMemory) decodes them and writes
+	/// the MusicString tokens to the output stream as it goes. Only the notes that are
+	/// still sounding (and the ones that started after them) are held in memory, so the
+	/// memory use does not grow with the length of the file.
+	///
+	/// Each MIDI channel becomes a Voice (V token) and each track of the file a Layer
+	/// (L token) of it. Note on/off pairs become numeric notes, such as [60]Q, with
+	/// their durations quantized to the W/H/Q/I/S/T/X/O letters (or to the /decimal
+	/// form when the letters get too long). Notes starting and ending together at the
+	/// default velocities are written as a chord, such as [48]MAJW, when their intervals
+	/// match a chord of the Chords table; otherwise as parallel notes joined with +, each
+	/// with its own velocities. Gaps become rests and a Layer that has to go back in
+	/// time gets a Time (@) token. Program changes, controllers, tempo and key
+	/// signatures become I, X, T and K tokens.
+	///
+	/// A decompiler object handles one file at a time; use DecompileFiles() to
+	/// convert a corpus in parallel, one file per worker.
+	///</Summary>
+	/// Example Usage:
+	/** <pre>
+		std::ofstream outFile("out.txt");
+		CFugue::MIDIDecompiler::DecompileFile("in.mid", outFile);
+	</pre> */
+	class MIDIDecompiler : public jdkmidi::MIDIFileEvents
+	{
+	public:
+		typedef std::basic_ostream<TCHAR> OutStream;
+
+		/// <Summary>
+		/// Creates a decompiler that writes the MusicString to the given stream.
+		/// @param outStream the stream to receive the MusicString tokens
+		/// @param pChords custom chord definitions to recognize the chords with.
+		/// NULL to use the default definitions. The object should stay valid
+		/// as long as this decompiler is in use.
+		/// </Summary>
+		MIDIDecompiler(OutStream& outStream, const Chords* pChords = NULL);
+		virtual ~MIDIDecompiler();
+
+		/// <Summary>
+		/// Sets the quantization grid for the note timings, as the number of grid
+		/// steps in a whole note. Should be a power of two, from 1 to 128. The default
+		/// is 128, the finest resolution a MusicString can express (O, a 1/128th note).
+		/// Notes shorter than a grid step still get one step.
+		/// </Summary>
+		void SetQuantization(unsigned short nStepsPerWholeNote);
+
+		/// Returns the number of quantization grid steps in a whole note
+		inline unsigned short GetQuantization() const { return m_nGridSteps; }
+
+		/// <Summary>
+		/// Decompiles a MIDI file into the given stream.
+		/// @param szMidiFilePath path of the MIDI file to be read
+		/// @param outStream the stream to receive the MusicString
+		/// @param nStepsPerWholeNote quantization grid to use. See SetQuantization()
+		/// @return True if the whole file was decompiled, False otherwise
+		/// </Summary>
+		static bool DecompileFile(const char* szMidiFilePath, OutStream& outStream, unsigned short nStepsPerWholeNote = 128);
+
+		/// <Summary>
+		/// Decompiles a set of MIDI files in parallel, each file on one worker thread.
+		/// @param vecMidiFiles paths of the MIDI files to be read
+		/// @param vecOutputFiles paths of the text files to receive the MusicStrings, one for each MIDI file
+		/// @param nWorkers number of worker threads to use. Zero picks the number of hardware threads.
+		/// @param nStepsPerWholeNote quantization grid to use. See SetQuantization()
+		/// @return the number of files decompiled successfully
+		/// </Summary>
+		static size_t DecompileFiles(const std::vector<std::string>& vecMidiFiles,
+									const std::vector<std::string>& vecOutputFiles,
+									unsigned int nWorkers = 0,
+									unsigned short nStepsPerWholeNote = 128);
+
+		// MIDIFileEvents handlers
+		virtual void mf_header(int nFormat, int nTracks, int nDivision);
+		virtual void mf_starttrack(int nTrack);
+		virtual void mf_endtrack(int nTrack);
+		virtual void mf_error(const char* szError);
+		virtual void mf_tempo(jdkmidi::MIDITickMS time, unsigned long lTempo);
+		virtual void mf_keysig(jdkmidi::MIDITickMS time, int nSharpFlats, int nMinor);
+		virtual void ChanMessage(const jdkmidi::MIDITimedMessage& msg);
+
+		/// Returns true if the reader reported an error during the decompile
+		inline bool HasErrors() const { return m_bError; }
+
+	private:
+		MIDIDecompiler(const MIDIDecompiler&);				// not implemented
+		MIDIDecompiler& operator=(const MIDIDecompiler&);	// not implemented
+
+		enum ItemType { ITEM_INSTRUMENT, ITEM_CONTROLLER, ITEM_TEMPO, ITEM_KEYSIGNATURE, ITEM_NOTE };
+
+		// A completed note or a non-note event waiting to be written
+		struct Item
+		{
+			ItemType		type;
+			unsigned long	lDuration;	// Notes only. In grid-aligned MusicString time units (128 per whole note)
+			unsigned short	nValue1;	// Note number, program, controller, tempo or key signature value
+			unsigned short	nValue2;	// Attack velocity or controller value
+			unsigned short	nValue3;	// Decay velocity
+		};
+
+		typedef std::multimap<unsigned long, Item> ItemQueue; // keyed by the start time. Equal keys keep their arrival order
+
+		// Notes and events of one channel, held till nothing can be written before them
+		struct Lane
+		{
+			ItemQueue		items;
+			unsigned long	lNoteOnTick[128];		// Start of each sounding note (in MIDI ticks)
+			unsigned short	nNoteOnVelocity[128];
+			bool			bNoteOn[128];
+			unsigned short	nNotesOn;
+		};
+
+		/// Converts the MIDI ticks to MusicString time units, aligned to the grid
+		unsigned long Quantize(unsigned long lTicks) const;
+
+		void NoteOn(Lane& lane, unsigned char nNote, unsigned char nVelocity, unsigned long lTicks);
+		void NoteOff(Lane& lane, unsigned char nNote, unsigned char nVelocity, unsigned long lTicks);
+		void AddItem(unsigned short nChannel, unsigned long lTicks, const Item& item);
+
+		/// Writes the items of the lane that start before the given time (in MusicString units)
+		void Flush(unsigned short nChannel, unsigned long lLimit);
+
+		/// Writes the items of one start time: events first, then the notes as a chord or parallel notes
+		void WriteGroup(unsigned short nChannel, unsigned long lStart, std::vector<Item>& vecItems);
+
+		/// Moves the output to the voice and layer of the channel, and to the given time on it
+		void MoveTo(unsigned short nChannel, unsigned long lTime);
+
+		/// Returns the token for the note, or for the chord on it if pChord is not NULL
+		std::basic_string<TCHAR> FormatNote(const Item& note, const ChordDef* pChord) const;
+
+		/// Returns the duration letters (or the /decimal form) for the MusicString time units
+		std::basic_string<TCHAR> FormatDuration(unsigned long lDuration) const;
+
+		void WriteToken(const std::basic_string<TCHAR>& strToken);
+
+		OutStream&		m_OutStream;
+		Chords			m_DefaultChords;
+		const Chords*	m_pChords;
+		unsigned short	m_nGridSteps;
+		bool			m_bError;
+
+		int				m_nFormat;
+		int				m_nDivision;		// MIDI ticks per quarter note
+		int				m_nTrack;			// Track being read. Its Layer is m_nTrack % 16
+		unsigned long	m_lTrackTicks;		// Time of the latest event of the track (in MIDI ticks)
+
+		Lane			m_Lanes[16];
+		unsigned long	m_lCursor[16][16];	// Current time of each Voice and Layer, as the parser would see it
+		int				m_nOutVoice;		// Voice and Layer selected last in the output. -1 if none
+		int				m_nOutLayer;
+		size_t			m_nLineTokens;		// Tokens written on the current output line
+	};
+
+} // namespace CFugue
+
+#endif // __MIDIDECOMPILER_H__68749E06_22C3_4C08_B77B_D8F08322B619__
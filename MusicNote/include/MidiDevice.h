@@ -13,9 +13,12 @@
 #ifndef __MIDI_DEVICE_H__6EE03181_DEEC_4771_A660_1597700B5773__
 #define __MIDI_DEVICE_H__6EE03181_DEEC_4771_A660_1597700B5773__
 
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "Common/EventHandler.h"
+
 namespace CFugue
 {
 	/// Returns the number of Output Midi Ports
@@ -38,6 +41,101 @@ namespace CFugue
 	/// Returns the names of all Midi Output Ports available
 	StringList GetMidiOutPortNames();
 
+	/// Returns the current index of the Midi Input Port with the given ID or name, -1 if not found.
+	/// Use the index with MIDIDriver::OpenMIDIInPort().
+	int GetMidiInPortIndex(const std::string& strPortIDOrName);
+
+	/// Returns the current index of the Midi Output Port with the given ID or name, -1 if not found.
+	/// Use the index with Player or MIDIDriver::OpenMIDIOutPort().
+	int GetMidiOutPortIndex(const std::string& strPortIDOrName);
+
+	/// <Summary>Describes a Midi Port known to the MIDIPortRegistry</Summary>
+	struct MIDIPortInfo
+	{
+		std::string strName;	///< Display name of the port (as reported by RtMidi)
+		std::string strID;		///< Identifier that stays the same for the port irrespective of the enumeration order (ALSA "client:port" address). Unique within a port list.
+
+		inline bool operator == (const MIDIPortInfo& other) const { return strName == other.strName && strID == other.strID; }
+	};
+
+	typedef std::vector<MIDIPortInfo> MIDIPortInfoList;
+
+	/// <Summary>
+	/// Backend that lists the Midi ports of the system for the MIDIPortRegistry.
+	/// Ports should be reported in the same order as RtMidi indexes them, so that
+	/// the registry indices can be used to open the ports. A port should keep its
+	/// ID for as long as it exists, however the other ports come and go.
+	/// Derive from this to serve a MIDIPortRegistry from some other backend, such
+	/// as a fake one that tests can plug ports in and out of.
+	/// </Summary>
+	class MIDIPortEnumerator
+	{
+	public:
+		virtual ~MIDIPortEnumerator() { }
+
+		/// Lists the available input and output ports in a single pass
+		virtual void EnumeratePorts(MIDIPortInfoList& inPorts, MIDIPortInfoList& outPorts) = 0;
+
+		/// Returns true if the backend has been notified of port changes since the last call.
+		/// Must not block. Backends that cannot detect changes return false.
+		virtual bool PollForChanges() { return false; }
+	};
+
+	/// <Summary>
+	/// \brief Caches the Midi port names and IDs of the system.
+	///
+	/// Ports are enumerated once and served from the cache after that. The cache is
+	/// refreshed when the backend reports a change (ALSA announce events on Linux) or
+	/// when Rescan() is called explicitly. Subscribe to evPortsChanged to know when
+	/// ports appear, disappear or get renumbered.
+	///
+	/// The Get*Port* functions above are served through the registry returned by Instance().
+	/// </Summary>
+	class MIDIPortRegistry : public OIL::CEventSource
+	{
+	public:
+		OIL::CEventT<const MIDIPortRegistry> evPortsChanged; ///< Raised when a rescan finds the port list changed
+
+		/// Creates a registry served by the given backend. Caller retains ownership of the backend.
+		explicit MIDIPortRegistry(MIDIPortEnumerator* pEnumerator);
+
+		/// Returns the process-wide registry that uses the platform backend
+		static MIDIPortRegistry& Instance();
+
+		/// Enumerates the ports again, raising evPortsChanged if the list differs from the cached one
+		void Rescan();
+
+		/// Returns the cached list of input ports, in index order
+		MIDIPortInfoList GetInPorts();
+
+		/// Returns the cached list of output ports, in index order
+		MIDIPortInfoList GetOutPorts();
+
+		/// Returns the index of the input port with the given ID (or name, failing which). -1 if not found.
+		int FindInPort(const std::string& strPortIDOrName);
+
+		/// Returns the index of the output port with the given ID (or name, failing which). -1 if not found.
+		int FindOutPort(const std::string& strPortIDOrName);
+
+		/// Returns the ID of the input port currently at the given index, empty if there is none
+		std::string GetInPortID(unsigned int nPortIndex);
+
+		/// Returns the ID of the output port currently at the given index, empty if there is none
+		std::string GetOutPortID(unsigned int nPortIndex);
+
+	private:
+		/// Rescans if never scanned before or if the backend reports changes
+		void Refresh();
+
+		static int FindPort(const MIDIPortInfoList& ports, const std::string& strPortIDOrName);
+
+		MIDIPortEnumerator*	m_pEnumerator;
+		std::mutex			m_Mutex;
+		bool				m_bScanned;
+		MIDIPortInfoList	m_InPorts;
+		MIDIPortInfoList	m_OutPorts;
+	};
+
 } // namespace CFugue
 
 #endif // __MIDI_DEVICE_H__6EE03181_DEEC_4771_A660_1597700B5773__
\ No newline at end of file
@@ -14,20 +14,31 @@
 #define __MIDIEVENTMANAGER_H__74C2A3BA_DFCF_4048_BC1D_20E9E04E809A__
 
 #include "jdkmidi/sequencer.h"
+#include "Voice.h"
 
 namespace CFugue
 {
-    /// <Summary> Takes care of MIDI Events, Tracks and Sequencing </Summary>
+    /// <Summary>
+    /// Takes care of MIDI Events, Tracks and Sequencing.
+    ///
+    /// Each Voice gets its own track. Voices beyond the 16 MIDI channels are mapped
+    /// to (port, channel) pairs: Voice n plays on channel n % 16 of port n / 16. The
+    /// tracks of the Voices on the ports other than the first start with an output
+    /// cable (MIDI port) meta-event, which the sequencer uses to route their events.
+    /// </Summary>
     class MIDIEventManager
     {
     protected:
 	    unsigned short m_nCurrentTrack;
 	    unsigned short m_nCurrentLayer;
 
-	    enum { MAX_CHANNELS = 16, MAX_LAYERS = 16 };
+	    enum { MAX_CHANNELS = 16, MAX_LAYERS = 16, MAX_VOICES = Voice::MAX_VOICES, MAX_PORTS = MAX_VOICES / MAX_CHANNELS };
 
-	    unsigned short m_CurrentLayer[MAX_CHANNELS];
-	    unsigned long m_Time[MAX_CHANNELS][MAX_LAYERS];
+	    unsigned short m_CurrentLayer[MAX_VOICES];
+	    unsigned long m_Time[MAX_VOICES][MAX_LAYERS];
+
+	    /// Returns the MIDI channel of the current track
+	    inline unsigned char GetCurrentChannel() const { return (unsigned char)(m_nCurrentTrack % MAX_CHANNELS); }
 
 	    jdkmidi::MIDIMultiTrack m_Tracks;
 
@@ -69,6 +80,15 @@ namespace CFugue
 	    inline void SetCurrentTrack(unsigned short nTrack)
 	    {
 		    m_nCurrentTrack = nTrack;
+
+		    jdkmidi::MIDITrack* pTrack = m_Tracks.GetTrack(nTrack);
+		    if(nTrack >= MAX_CHANNELS && pTrack->GetNumEvents() == 0) // First use of a Voice beyond the first port
+		    {
+			    jdkmidi::MIDITimedBigMessage msg;
+			    msg.SetTime(0);
+			    msg.SetOutputCable((unsigned char)(nTrack / MAX_CHANNELS));
+			    pTrack->PutEvent(msg);
+		    }
 	    }
 
 	    inline void SetCurrentLayer(unsigned short nLayer)
@@ -108,7 +128,7 @@ namespace CFugue
 		{
 			jdkmidi::MIDITimedBigMessage msg;
 			msg.SetTime(GetTrackTime());
-			msg.SetChannelPressure((unsigned char)m_nCurrentTrack, uPressure);
+			msg.SetChannelPressure(GetCurrentChannel(), uPressure);
 			m_Tracks.GetTrack(m_nCurrentTrack)->PutEvent(msg);
 		}
 
@@ -121,7 +141,7 @@ namespace CFugue
 		{
 			jdkmidi::MIDITimedBigMessage msg;
 			msg.SetTime(GetTrackTime());
-			msg.SetControlChange((unsigned char)m_nCurrentTrack, uControlIndex, uControlValue);
+			msg.SetControlChange(GetCurrentChannel(), uControlIndex, uControlValue);
 			m_Tracks.GetTrack(m_nCurrentTrack)->PutEvent(msg);
 		}
 
@@ -147,7 +167,7 @@ namespace CFugue
 		{
 			jdkmidi::MIDITimedBigMessage msg;
 			msg.SetTime(GetTrackTime());
-			msg.SetPitchBend((unsigned char)m_nCurrentTrack, uLowByte, uHighByte);
+			msg.SetPitchBend(GetCurrentChannel(), uLowByte, uHighByte);
 			m_Tracks.GetTrack(m_nCurrentTrack)->PutEvent(msg);
 		}
 
@@ -160,7 +180,7 @@ namespace CFugue
 		{
 			jdkmidi::MIDITimedBigMessage msg;
 			msg.SetTime(GetTrackTime());
-			msg.SetPolyPressure((unsigned char)m_nCurrentTrack, uKey, uPressure);
+			msg.SetPolyPressure(GetCurrentChannel(), uKey, uPressure);
 			m_Tracks.GetTrack(m_nCurrentTrack)->PutEvent(msg);
 		}
 
@@ -172,7 +192,7 @@ namespace CFugue
         {
             jdkmidi::MIDITimedBigMessage msg;
             msg.SetTime(GetTrackTime());
-            msg.SetProgramChange((unsigned char)m_nCurrentTrack, nInstrumentID);
+            msg.SetProgramChange(GetCurrentChannel(), nInstrumentID);
             m_Tracks.GetTrack(m_nCurrentTrack)->PutEvent(msg);
         }
 
@@ -207,7 +227,7 @@ namespace CFugue
 
 			    msg.SetTime(GetTrackTime());
 
-			    msg.SetNoteOn((unsigned char)m_nCurrentTrack, (unsigned char) noteValue, (unsigned char) attackVel);
+			    msg.SetNoteOn(GetCurrentChannel(), (unsigned char) noteValue, (unsigned char) attackVel);
     			
 			    m_Tracks.GetTrack(m_nCurrentTrack)->PutEvent(msg);
 		    }
@@ -220,7 +240,7 @@ namespace CFugue
 
 			    msg.SetTime(GetTrackTime());
     			
-			    msg.SetNoteOff((unsigned char)m_nCurrentTrack, (unsigned char)noteValue, (unsigned char)decayVel);
+			    msg.SetNoteOff(GetCurrentChannel(), (unsigned char)noteValue, (unsigned char)decayVel);
 
 			    m_Tracks.GetTrack(m_nCurrentTrack)->PutEvent(msg);
 		    }
@@ -0,0 +1,110 @@
+/*
+	This is part of CFugue, a C++ Runtime for MIDI Score Programming
+	Copyright (C) 2009 Gopalakrishna Palem
+
+	For links to further information, or to contact the author,
+	see <http://cfugue.sourceforge.net/>.
+
+    $LastChangedDate$
+    $Rev$
+    $LastChangedBy$
+*/
+
+#ifndef __MIDIPORTPOOL_H__2755F499_4E97_4862_8A03_2C006C2B9117__
+#define __MIDIPORTPOOL_H__2755F499_4E97_4862_8A03_2C006C2B9117__
+
+/** @file MidiPortPool.h
+ * \brief Declares MIDIOutPortPool class for CFugue
+ */
+#include "rtmidi/RtMidi.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace CFugue
+{
+	///<Summary>
+	/// Process-wide pool of open MIDI output ports.
+	///
+	/// Opening an RtMidiOut creates a new sequencer client, a port and a
+	/// subscription, which can take longer than a short phrase takes to play.
+	/// The pool opens each output port only once and hands out the same
+	/// RtMidiOut object to every driver that asks for it, reference counting
+	/// the users. Ports are kept open (warm) even after their last user
+	/// releases them, so that subsequent plays can start right away.
+	/// Use CloseIdlePorts() to actually close the ports that are not in use.
+	///
+	/// Locking: Acquire(), Release(), CloseIdlePorts() and GetOpenPortCount()
+	/// may be called from any thread and are serialized by the pool's mutex.
+	/// A port is only closed when no one holds it, so a port that has been
+	/// acquired stays valid until it is released.
+	///
+	/// The pool does not lock the writes to a port. MIDIDriverAlsa writes in
+	/// HardwareMsgOut(), which is called from MIDIDriver::TimeTick(), and the
+	/// ALSA drivers are ticked only by the MIDIPlaybackEngine thread. So as
+	/// long as the drivers are pumped only by the engine, every write to a
+	/// shared port comes from that one thread. Code that calls TimeTick() or
+	/// HardwareMsgOut() itself, from some other thread, must not share the
+	/// port with a driver that is playing.
+	///</Summary>
+	class MIDIOutPortPool
+	{
+	public:
+		/// Returns the process-wide pool object
+		static MIDIOutPortPool& Instance();
+
+		/// <Summary>
+		/// Returns the open output port object for the port currently at the given
+		/// index (see GetMidiOutPortName()), opening it if this is the first request
+		/// for the port. The port is pooled under its stable ID from the
+		/// MIDIPortRegistry, so an index that refers to some other device after a
+		/// rescan gets that device, not the one pooled for the index before.
+		/// Each successful Acquire() should have a matching Release().
+		/// @param nPortIndex the index of the MIDI output port to open
+		/// @return NULL if there is no such port or it cannot be opened
+		/// </Summary>
+		RtMidiOut* Acquire(int nPortIndex);
+
+		/// <Summary>
+		/// Returns the open output port object for the port with the given
+		/// MIDIPortInfo::strID, opening it if this is the first request for the port.
+		/// Each successful Acquire() should have a matching Release().
+		/// @param strPortID the stable ID of the MIDI output port to open
+		/// @return NULL if there is no such port or it cannot be opened
+		/// </Summary>
+		RtMidiOut* Acquire(const std::string& strPortID);
+
+		/// <Summary>
+		/// Releases a port object obtained with Acquire(). The port stays open
+		/// for later use even if this was its last user.
+		/// </Summary>
+		void Release(RtMidiOut* pMidiOut);
+
+		/// Closes all the pooled ports that are not in use by anyone at the moment
+		void CloseIdlePorts();
+
+		/// Returns the number of ports currently open in the pool (in use or idle)
+		size_t GetOpenPortCount() const;
+
+	private:
+		MIDIOutPortPool();
+		~MIDIOutPortPool();
+		MIDIOutPortPool(const MIDIOutPortPool&);				// not implemented
+		MIDIOutPortPool& operator=(const MIDIOutPortPool&);	// not implemented
+
+		struct PortEntry
+		{
+			RtMidiOut*		pMidiOut;
+			unsigned int	nRefCount;
+		};
+
+		typedef std::map<std::string, PortEntry> PortMap;
+
+		mutable std::mutex	m_Mutex;
+		PortMap				m_Ports;	// Open ports keyed by their stable port ID
+	};
+
+} // namespace CFugue
+
+#endif // __MIDIPORTPOOL_H__2755F499_4E97_4862_8A03_2C006C2B9117__
@@ -17,18 +17,27 @@
 #include "ParserListener.h"
 #include "MidiEventManager.h"
 #include "MidiTimer.h"
+#include "PlaybackEngine.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <stdint.h>
+#include <utility>
+#include <vector>
 
 #ifndef MIDI_MAPPER
 #define MIDI_MAPPER ((unsigned int)-1)
 #endif // MIDI_MAPPER
 
-namespace jdkmidi   { class MIDIDriverWin32; }
+namespace jdkmidi   { class MIDIDriverWin32; class MIDIMultiTrackCache; }
 namespace CFugue    { class MIDIDriverAlsa; }
 
 namespace CFugue
 {
 	///<Summary>Takes care of Rendering MIDI Output either to a file or to a MIDI out Port</Summary>
-	class MIDIRenderer : MIDIEventManager, public CParserListener
+	class MIDIRenderer : MIDIEventManager, public CParserListener, jdkmidi::MIDITick
 	{
 	    #if defined _WIN32
 		jdkmidi::MIDIDriverWin32* m_pMIDIDriver;
@@ -42,6 +51,35 @@ namespace CFugue
 
 		long m_lFirstNoteTime;	// time of first parallel note. Used for parallel notes
 
+		typedef std::vector<std::pair<unsigned short, unsigned short> > VoiceLayerList;
+
+		std::mutex				m_StreamMutex;		// Guards the tracks while they are played and rendered at the same time
+		std::condition_variable	m_cvHorizon;		// Signalled when the horizon moves
+		std::atomic<bool>		m_bStreaming;		// Tracks are still being rendered
+		bool					m_bDiscardEvents;	// Streaming is cancelled. Ignore the further events
+		unsigned long			m_lHorizon;			// Events before this time are final
+		VoiceLayerList			m_StreamLayers;		// (Voice, Layer) pairs that are yet to receive events
+
+		std::vector<int>		m_ExtraOutPorts;	// MIDI output port IDs for the Voices beyond the first 16, one per group of 16
+
+		class StreamScope;
+
+		friend class MIDIRenderCache; // Saves and restores the rendered tracks
+
+		/// <Summary>
+		/// Recomputes the horizon after an event is rendered. Nothing can get added
+		/// before the earliest time among the layers yet to receive events, or before
+		/// the last first note (a parallel note can still go back to it).
+		/// Call with m_StreamMutex held.
+		/// </Summary>
+		void UpdateHorizon();
+
+		/// <Summary>
+		/// Tick procedure of the MIDI driver. Picks up the events rendered since the
+		/// last tick before handing over to the MIDI Manager.
+		/// </Summary>
+		virtual bool TimeTick(jdkmidi::MIDITick::time_point tNow);
+
 		/// <Summary>Event handler for Channel Pressure event Raised by Parser</Summary>
 		virtual void OnChannelPressureEvent(const CParser* pParser, const ChannelPressure* pCP);
 
@@ -95,6 +133,29 @@ namespace CFugue
 		/// </Summary>
 		bool BeginPlayAsync(int nMIDIOutPortID = MIDI_MAPPER, unsigned int nTimerResolutionMS = 20);
 
+		/// <Summary>
+		/// Sets the MIDI output ports for the Voices beyond the first 16. The first entry plays
+		/// Voices 16-31, the second 32-47 and so on; Voices 0-15 play on the port given to
+		/// BeginPlayAsync(). All the ports are driven from the same sequencer clock.
+		/// The Voices of the groups without a port are not played. Takes effect from the next
+		/// BeginPlayAsync(). The saved MIDI files are not affected: they carry a MIDI port
+		/// meta-event in each track of the Voices beyond the first 16.
+		/// @param vecPortIDs the IDs of the MIDI output ports, one for each group of 16 Voices
+		/// </Summary>
+		inline void SetExtraOutPorts(const std::vector<int>& vecPortIDs) { m_ExtraOutPorts = vecPortIDs; }
+
+		/// Returns the MIDI output ports set with SetExtraOutPorts()
+		inline const std::vector<int>& GetExtraOutPorts() const { return m_ExtraOutPorts; }
+
+		/// <Summary>
+		/// Sets a processor for the MIDI messages on their way to the output ports, such as a
+		/// jdkmidi::MIDIProcessorTransform to transpose or rechannel the play. The messages the
+		/// processor rejects are not played. The rendered tracks and the saved MIDI files
+		/// are not affected. Set it before BeginPlayAsync(); the object is not owned and
+		/// should stay valid till the play is done. NULL removes any earlier set processor.
+		/// </Summary>
+		void SetOutProcessor(jdkmidi::MIDIProcessor* pProcessor);
+
 
 		/// <Summary>
 		/// Stops Rendering the MIDI output to MIDI port.
@@ -117,10 +178,81 @@ namespace CFugue
 		/// </Summary>
 		inline bool IsPlaying() const { return m_MIDIManager.IsSeqPlay(); }
 
+		/// <Summary>
+		/// Applies the real-time preferences (scheduling policy, priority, CPU affinity,
+		/// memory locking) to the thread that pumps the MIDI output. The thread is shared
+		/// by all the renderers in the process, so the preferences apply to all of them.
+		/// @return Combination of RealtimeConfig::FailureFlags for the settings that
+		/// could not be applied. Play works regardless, only without those guarantees.
+		/// </Summary>
+		unsigned int SetRealtimeConfig(const RealtimeConfig& config);
+
+		/// <Summary>
+		/// Lets the play begin before all the events are rendered. Call this before the
+		/// parsing starts, then BeginPlayAsync() once WaitForHorizon() indicates that enough
+		/// events are rendered. The parsing can continue on another thread while the play
+		/// goes on. Playback never goes past the events that are not final yet, and holds on
+		/// (instead of rushing through) in case it catches up with the parser.
+		/// Call EndStreaming() once the parsing is done.
+		/// @param pUsedLayers bit masks of the layers, per voice, that will receive events.
+		/// Use MusicStringParser::FindVoiceLayers() to get them.
+		/// </Summary>
+		void BeginStreaming(const unsigned short pUsedLayers[16]);
+
+		/// <Summary>
+		/// Indicates that all the events are rendered. The play ends normally once
+		/// it reaches the end of the tracks.
+		/// </Summary>
+		void EndStreaming();
+
+		/// <Summary>
+		/// Drops the events that arrive hereafter, so that the parser can run to
+		/// its end quickly. EndStreaming() is still required once the parser is done.
+		/// </Summary>
+		void CancelStreaming();
+
+		/// <Summary>
+		/// Blocks till all the events before the given time are rendered, or till the
+		/// streaming ends. Time is in the units of the note durations (a whole note is 128).
+		/// </Summary>
+		void WaitForHorizon(unsigned long lTime);
+
         /// <Summary>
         /// Saves the current track/sequencer content to a MIDI Output file
         /// </Summary>
 		bool SaveToFile(const char* szOutputFilePath); //TODO: Add the capatiblity to store custom MIDI Headers
+
+        /// <Summary>
+        /// Saves the current track/sequencer content as MIDI file content into the buffer.
+        /// No file is created; the buffer is replaced with the bytes of the MIDI file.
+        /// </Summary>
+		bool SaveToBuffer(std::vector<uint8_t>& outBuffer);
+
+        /// <Summary>
+        /// Writes the current track/sequencer content as MIDI file content to the stream.
+        /// The stream need not be seekable. No file is created.
+        /// </Summary>
+		bool SaveToStream(std::ostream& outStream);
+
+        /// <Summary>
+        /// Saves the current tracks to a binary cache file (see jdkmidi::MIDIMultiTrackCache),
+        /// along with their tempo map and measure index. Unlike a MIDI file, the cache
+        /// loads back without any decoding or sorting of the events.
+        /// </Summary>
+		bool SaveToCache(const char* szCacheFilePath);
+
+        /// <Summary>
+        /// Replaces the current tracks with the ones from a cache file saved with SaveToCache().
+        /// Any play in progress is stopped. Use BeginPlayAsync() to play the loaded tracks.
+        /// @return false if the file is missing, is not a valid cache or is of another version.
+        /// </Summary>
+		bool LoadFromCache(const char* szCacheFilePath);
+
+        /// <Summary>
+        /// Replaces the current tracks with the ones from an already mapped cache file.
+        /// Keeping the caches mapped saves opening the files again for every load.
+        /// </Summary>
+		bool LoadFromCache(const jdkmidi::MIDIMultiTrackCache& cache);
 	};
 
 } // namespace CFugue
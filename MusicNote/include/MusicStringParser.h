@@ -153,12 +153,15 @@ namespace CFugue
         };
 
         const Chords*	m_pChords;		// Holds the custom Chord Definitions, if any, supplied by user
+        const Chords*	m_pDefaultChords;	// The in-built Chord Definitions, looked up once
 		DICTIONARY		m_Dictionary;	// Holds the default && custom MACRO definitions for Music Strings
         KeySignature	m_KeySig;		// Holds the last seen Key Signature. Useful for computing Note value.
 
         unsigned short m_nDefNoteOctave;    // Holds the Default Octave Value to be used for Notes
         unsigned short m_nDefChordOctave;   // Holds the Default Octave Value to be used for Chords
 
+        size_t m_nDefinitionsHash;  // Hash of the definitions made by the Music Strings since ResetDefinitions()
+
 
 		/// <Summary>
 		/// Parses a single token. To Parse a string that contains multiple tokens, 
@@ -197,6 +200,7 @@ namespace CFugue
 		//const TokenClassifierDef* m_pDef;
 
 		MusicStringParser() 
+			: m_pDefaultChords(&Chords::GetDefaultChords())
 		{ 
 			ResetDefinitions();
 		}
@@ -212,6 +216,25 @@ namespace CFugue
             SetKeySignature(KeySignature());
             SetOctaveDefaults();
             m_pChords = NULL;
+            m_nDefinitionsHash = 0;
+		}
+
+		/// <Summary>
+		/// Restores the Key Signature and the default octaves for parsing a new Music String,
+		/// keeping any Chord definitions loaded with LoadChords(). The dictionary is rebuilt
+		/// only if the earlier Music Strings defined entries in it, so reusing a parser with
+		/// Reset() is much cheaper than creating a new one or calling ResetDefinitions().
+		/// </Summary>
+		void Reset()
+		{
+			if(m_nDefinitionsHash != 0)
+			{
+				m_Dictionary.clear();
+				PopulateStandardDefinitions(m_Dictionary);
+				m_nDefinitionsHash = 0;
+			}
+            SetKeySignature(KeySignature());
+            SetOctaveDefaults();
 		}
 
         /// Sets the KeySignature to be used for further Note parsing
@@ -245,6 +268,21 @@ namespace CFugue
             m_pChords = &chords;
         }
 
+        /// <Summary>
+        /// Returns a hash of the dictionary definitions made by the Music Strings
+        /// since ResetDefinitions(). The value changes whenever a Music String
+        /// defines (or redefines) a dictionary entry.
+        /// </Summary>
+        inline size_t GetDefinitionsHash() const { return m_nDefinitionsHash; }
+
+        /// <Summary>
+        /// Returns a hash of the parser state that decides how a Music String renders:
+        /// the Key Signature, the Octave defaults, the Chord definitions and the
+        /// dictionary definitions. Parsing the same Music String with the same state
+        /// raises the same events.
+        /// </Summary>
+        size_t GetRenderStateHash() const;
+
 		/// <Summary>
 		/// Parses a string that contains multiple tokens. Raises appropriate events as and when
 		/// the tokens are parsed. We consider the input string to be having multiple
@@ -290,6 +328,22 @@ namespace CFugue
          </pre> */
 		bool Parse(const TCHAR* szTokens); 
 
+		/// <Summary>
+		/// Finds the voice layers that the events of a Music String would go to, without
+		/// parsing the notes. This tells upfront which voices are yet to receive events,
+		/// which is what a listener needs to know to use the events of a voice before
+		/// the parsing of the whole string completes (for example, to start the play early).
+		///
+		/// @param szTokens The string to be scanned.
+		/// @param pUsedLayers Receives a bit mask of the used layers for each of the 16 voices.
+		/// Bit n of pUsedLayers[v] is set if the events could go to layer n of voice v.
+		///
+		/// @return False if the string has tokens that make this unknowable before parsing,
+		/// such as Time tokens (which can move back in time) or Voice and Layer tokens with
+		/// dictionary values. Content of pUsedLayers is undefined in such case.
+		/// </Summary>
+		static bool FindVoiceLayers(const TCHAR* szTokens, unsigned short pUsedLayers[16]);
+
 	private:
 		// Token Parserer Methods. Return value indicates the number of characters consumed. -1 for failure. 0 for none.
 		int ParseChannelPressureToken(TCHAR* szToken, bool* pbNonContinuableErrorOccured);
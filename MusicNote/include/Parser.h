@@ -127,7 +127,7 @@ namespace CFugue
 			PARSE_ERROR_TIME_VALUE,		        ///< Failure while converting/retrieving a Time number.
 			PARSE_ERROR_VOICE_MACRO_END,	    ///< MACRO_END missing while parsing a Voice Macro.
 			PARSE_ERROR_VOICE_VALUE,		    ///< Failure while converting/retrieving a Voice number.
-			PARSE_ERROR_VOICE_MAXLIMIT,		    ///< Specified a voice that is beyond the permitted range [0, 15]
+			PARSE_ERROR_VOICE_MAXLIMIT,		    ///< Specified a voice that is beyond the permitted range [0, 63]
 			PARSE_ERROR_NUMERIC_NOTE_END,		///< MACRO_END missing while parsing a numeric note.
 			PARSE_ERROR_NUMERIC_NOTE_VALUE,		///< Failure while converting/retrieving a numeric note number.
 			PARSE_ERROR_LETTER_NOTE,			///< Invalid Alphabet encountering while trying to read a Note Symbol
@@ -0,0 +1,171 @@
+/*
+	This is part of CFugue, a C++ Runtime for MIDI Score Programming
+	Copyright (C) 2009 Gopalakrishna Palem
+
+	For links to further information, or to contact the author,
+	see <http://cfugue.sourceforge.net/>.
+
+    $LastChangedDate$
+    $Rev$
+    $LastChangedBy$
+*/
+
+#ifndef __PLAYBACKENGINE_H__327DBC07_F118_4264_8D05_AEC5BA2A145C__
+#define __PLAYBACKENGINE_H__327DBC07_F118_4264_8D05_AEC5BA2A145C__
+
+/** @file PlaybackEngine.h
+ * \brief Declares MIDIPlaybackEngine class for CFugue
+ */
+#include "jdkmidi/tick.h"
+#include "MidiTimer.h"
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace CFugue
+{
+	///<Summary>Real-time scheduling preferences for the playback thread</Summary>
+	struct RealtimeConfig
+	{
+		enum SchedulingPolicy
+		{
+			SCHEDULE_DEFAULT,	///< Leave the thread with the default time-sharing policy
+			SCHEDULE_FIFO,		///< Run the thread with SCHED_FIFO
+			SCHEDULE_RR			///< Run the thread with SCHED_RR
+		};
+
+		/// Flags reported by MIDIPlaybackEngine::SetRealtimeConfig() for the settings that could not be applied
+		enum FailureFlags
+		{
+			FAILED_NONE			= 0,
+			FAILED_SCHEDULING	= 1,	///< Policy/priority not applied (usually for lack of CAP_SYS_NICE or RLIMIT_RTPRIO)
+			FAILED_AFFINITY		= 2,	///< CPU pinning not applied (or not supported on this platform)
+			FAILED_MEMORY_LOCK	= 4		///< Memory not locked (usually for lack of CAP_IPC_LOCK or RLIMIT_MEMLOCK)
+		};
+
+		SchedulingPolicy	policy;
+		int					nPriority;		///< Priority for the FIFO and RR policies (1 to 99 on Linux)
+		std::vector<int>	cpus;			///< CPUs the playback thread may run on. Empty means no pinning
+		bool				bLockMemory;	///< Lock the process pages in memory (mlockall) and prefault the playback thread stack
+
+		RealtimeConfig() : policy(SCHEDULE_DEFAULT), nPriority(0), bLockMemory(false) { }
+	};
+
+	///<Summary>
+	/// Process-wide timing engine that pumps MIDI events for any number of
+	/// concurrent sequences from one background thread.
+	///
+	/// Instead of each driver owning a polling thread, drivers register their
+	/// MIDITick procedure with the engine along with the timer resolution they need.
+	/// The engine keeps the next deadline of every registered procedure in a
+	/// priority queue, sleeps till the earliest deadline is due and ticks only
+	/// the procedures that are due. A procedure is dropped from the engine once
+	/// its TimeTick() returns false (no more events to pump) or once it is
+	/// explicitly unregistered.
+	///</Summary>
+	class MIDIPlaybackEngine
+	{
+	public:
+		/// Returns the process-wide engine object
+		static MIDIPlaybackEngine& Instance();
+
+		/// <Summary>
+		/// Registers a tick procedure to be pumped periodically by the engine thread.
+		/// The engine thread is started on the first registration.
+		/// @param pTickProc the procedure to be pumped (usually a MIDIDriver)
+		/// @param nResolutionMS the interval between two consecutive ticks (in MilliSeconds)
+		/// @return future that becomes ready once the procedure is done with its events (true)
+		/// or is unregistered before that (false). The returned future is invalid if the
+		/// procedure is already registered.
+		/// </Summary>
+		std::future<bool> Register(jdkmidi::MIDITick* pTickProc, unsigned int nResolutionMS);
+
+		/// <Summary>
+		/// Removes the tick procedure from the engine. If the engine thread is ticking
+		/// the procedure at the moment, caller gets blocked till that tick completes.
+		/// Once this returns, the procedure is guaranteed not to be ticked anymore.
+		/// Returns immediately if the procedure is not registered.
+		/// </Summary>
+		void Unregister(jdkmidi::MIDITick* pTickProc);
+
+		/// Returns the number of tick procedures currently registered with the engine
+		size_t GetClientCount() const;
+
+		/// <Summary>
+		/// Applies the real-time preferences to the engine thread, starting the thread
+		/// if it is not running yet. Settings that cannot be applied (for example, when the
+		/// process lacks the privileges) are skipped and the rest still take effect.
+		///
+		/// Locking the memory covers all the pages mapped at the time, which prefaults the
+		/// already allocated driver queues and rendered tracks, and all the pages mapped later on.
+		///
+		/// Once the driver queues are allocated, the pump path itself does not allocate: the
+		/// deadline queue only reuses its storage and the ALSA driver reuses its message buffer.
+		/// test/PumpAllocationTest checks this.
+		/// @param config the preferences to apply
+		/// @return Combination of RealtimeConfig::FailureFlags for the settings that could not be applied.
+		/// RealtimeConfig::FAILED_NONE if all of them were applied.
+		/// </Summary>
+		unsigned int SetRealtimeConfig(const RealtimeConfig& config);
+
+		/// Returns the real-time preferences last set with SetRealtimeConfig()
+		RealtimeConfig GetRealtimeConfig() const;
+
+	private:
+		MIDIPlaybackEngine();
+		~MIDIPlaybackEngine();
+		MIDIPlaybackEngine(const MIDIPlaybackEngine&);				// not implemented
+		MIDIPlaybackEngine& operator=(const MIDIPlaybackEngine&);	// not implemented
+
+		/// Thread procedure that services the deadlines
+		void ThreadProc();
+
+		/// Starts the engine thread with m_RealtimeConfig applied, if not running already.
+		/// Returns the RealtimeConfig::FailureFlags of the config. Call with m_Mutex held.
+		unsigned int StartThread();
+
+		/// Applies m_RealtimeConfig to the running engine thread. Call with m_Mutex held.
+		unsigned int ApplyRealtimeConfig();
+
+		struct Client
+		{
+			MidiTimer::Duration	resolution;	// Interval between two ticks
+			unsigned long		nSerial;	// Distinguishes re-registrations of the same procedure
+			std::promise<bool>	done;		// Fulfilled when the procedure leaves the engine
+		};
+
+		struct Deadline
+		{
+			MidiTimer::TimePoint	when;
+			jdkmidi::MIDITick*		pTickProc;
+			unsigned long			nSerial;
+
+			inline bool operator > (const Deadline& other) const { return when > other.when; }
+		};
+
+		typedef std::map<jdkmidi::MIDITick*, Client> ClientMap;
+		typedef std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline> > DeadlineQueue;
+
+		mutable std::mutex		m_Mutex;
+		std::condition_variable	m_cvWake;		// Signalled when the schedule changes
+		std::condition_variable	m_cvTickDone;	// Signalled after every tick
+		ClientMap				m_Clients;
+		DeadlineQueue			m_Deadlines;	// Earliest deadline on the top. May hold stale entries of unregistered procedures
+		jdkmidi::MIDITick*		m_pActive;		// Procedure being ticked right now, if any
+		unsigned long			m_nNextSerial;
+		bool					m_bShutdown;
+		bool					m_bPrefaultStack;	// Engine thread should touch its stack pages on the next wake-up
+		bool					m_bMemoryLocked;
+		RealtimeConfig			m_RealtimeConfig;
+		std::thread				m_Thread;
+	};
+
+} // namespace CFugue
+
+#endif // __PLAYBACKENGINE_H__327DBC07_F118_4264_8D05_AEC5BA2A145C__
@@ -15,6 +15,9 @@
 
 #include "MusicStringParser.h"
 #include "MidiRenderer.h"
+#include "RenderCache.h"
+
+#include <future>
 
 namespace CFugue
 {
@@ -25,6 +28,13 @@ namespace CFugue
 		MusicStringParser	m_Parser;
 		unsigned int		m_nOutPort;		// The MIDI Output port that should be used for Play
 		unsigned int		m_nTimerRes;	// The Timer Resolution in MilliSeconds
+		bool				m_bPipelinedPlay;	// Should the play begin before the parsing completes?
+		unsigned long		m_lLookahead;		// Amount of music to be rendered before the pipelined play begins
+		std::future<bool>	m_ParseResult;		// Parsing in progress for the pipelined play, if any
+		MIDIRenderCache*	m_pRenderCache;		// Cache of the rendered Music Strings, if any
+
+		/// Drops the rest of the events of any pipelined parsing in progress and waits for the parser to finish
+		void CancelPipelinedParse();
 	public:
 
 		/// Construct the Player Object using supplied Midi Output port and Timer Resolution
@@ -34,17 +44,82 @@ namespace CFugue
 
 		inline ~Player(void)
 		{
+			CancelPipelinedParse();
 		}
 
         /// Returns the associated Parser object
 		inline MusicStringParser& Parser() { return m_Parser; }
 
+		/// <Summary>
+		/// Sets the cache to look up the rendered Music Strings in, before parsing them.
+		/// A Music String played or saved with the same parser state (key signature,
+		/// default octaves, chords and dictionary) gets its tracks copied from the cache
+		/// instead of being parsed again. The same cache can be shared by any number
+		/// of players across threads. Pass NULL to stop using the cache.
+		///
+		/// The parser does not raise any events (such as the trace or error events)
+		/// for the Music Strings found in the cache. Music Strings that define
+		/// dictionary entries are never cached, since the definitions would be lost.
+		/// @param pCache the cache to use. Should stay valid as long as this player uses it.
+		/// </Summary>
+		inline void SetRenderCache(MIDIRenderCache* pCache) { m_pRenderCache = pCache; }
+
+		/// Returns the render cache in use, if any
+		inline MIDIRenderCache* GetRenderCache() const { return m_pRenderCache; }
+
 		/// Get/Set the Midi Output Port that should be used with this Player
 		inline unsigned int MidiOutPort() { return m_nOutPort; }
 
 		/// Get/Set the Timer Resolution (in MilliSeconds) that should be used with this Player
 		inline unsigned int TimerResolution() { return m_nTimerRes; }
 
+		/// <Summary>
+		/// Sets the MIDI Output ports for the Voices beyond V15. Voices V0-V15 play on MidiOutPort(),
+		/// the first entry plays V16-V31, the second V32-V47 and so on, all in sync.
+		/// Refer MIDIRenderer::SetExtraOutPorts().
+		/// @param vecPortIDs the IDs of the MIDI output ports, one for each group of 16 Voices
+		/// </Summary>
+		inline void SetExtraMidiOutPorts(const std::vector<int>& vecPortIDs) { m_Renderer.SetExtraOutPorts(vecPortIDs); }
+
+		/// <Summary>
+		/// Sets a processor for the MIDI messages on their way to the output ports, such as a
+		/// jdkmidi::MIDIProcessorTransform. Refer MIDIRenderer::SetOutProcessor().
+		/// </Summary>
+		inline void SetMidiOutProcessor(jdkmidi::MIDIProcessor* pProcessor) { m_Renderer.SetOutProcessor(pProcessor); }
+
+		/// <Summary>
+		/// Enables or disables the pipelined play. With the pipelined play, PlayAsync() parses the
+		/// Music String on a worker thread and starts the play as soon as the first lookahead
+		/// window of the music is rendered, instead of waiting for the whole string to be parsed.
+		/// The parser keeps rendering the rest while the play goes on.
+		///
+		/// Only the parse errors that occur before the play starts are reflected in the return
+		/// value of PlayAsync(). Parser events (including evTrace and evError) are raised on
+		/// the worker thread.
+		///
+		/// The play can begin early only when the voices progress together in the string. A voice
+		/// that starts only later in the string holds the play till the parser reaches it. Strings
+		/// with Time tokens, or with dictionary values for Voice and Layer tokens, are always
+		/// parsed completely before the play.
+		///
+		/// @param bEnable true to enable the pipelined play, false to disable it (default)
+		/// @param lLookahead amount of music to render before the play begins, in the units of
+		/// the note durations (a whole note is 128)
+		/// </Summary>
+		inline void SetPipelinedPlay(bool bEnable, unsigned long lLookahead = 512) { m_bPipelinedPlay = bEnable; m_lLookahead = lLookahead; }
+
+		/// Returns true if the pipelined play is enabled. Refer SetPipelinedPlay()
+		inline bool IsPipelinedPlay() const { return m_bPipelinedPlay; }
+
+		/// <Summary>
+		/// Parses the Music String and loads the generated MIDI events, replacing any
+		/// earlier content, without playing them. Uses the render cache, if one is set.
+		/// Use SaveToMidiFile() to retrieve the loaded content afterwards.
+		/// @param strMusicNotes the input Music string to be rendered
+		/// @return True if the parsing was successful, False otherwise
+		/// </Summary>
+		bool Render(const MString& strMusicNotes);
+
         /// <Summary>
         /// Plays a string of music notes. Will not return till the play is complete.
         /// To Play the Notes asynchronously, use the PlayAsync() method instead.
@@ -117,6 +192,26 @@ namespace CFugue
 		/// <Summary>Returns true if an asynchronous Play is currently in progress</Summary>
 		inline bool IsPlaying() const { return m_Renderer.IsPlaying(); }
 
+		/// <Summary>
+		/// Requests real-time treatment for the MIDI output thread, which is shared by all
+		/// the players in the process. Settings the process has no privileges for are skipped
+		/// and reported in the return value, while the play continues to work without them.
+		/// @param config the scheduling policy, priority, CPU affinity and memory locking to apply
+		/// @return Combination of RealtimeConfig::FailureFlags for the settings that could not be applied
+		/// </Summary>
+        /// Example Usage:
+        /** <pre>
+            CFugue::RealtimeConfig config;
+            config.policy = CFugue::RealtimeConfig::SCHEDULE_FIFO;
+            config.nPriority = 70;
+            config.cpus.push_back(1); // keep the MIDI output on CPU 1
+            config.bLockMemory = true;
+
+            if(player.SetRealtimeConfig(config) & CFugue::RealtimeConfig::FAILED_SCHEDULING)
+                printf("Playing without real-time priority\n");
+        </pre> */
+		inline unsigned int SetRealtimeConfig(const RealtimeConfig& config) { return m_Renderer.SetRealtimeConfig(config); }
+
 		/// <Summary>
 		/// Parses the Music String and saves the generated MIDI events to a Midi output file.
         ///
@@ -159,6 +254,26 @@ namespace CFugue
         </pre> */
 		bool SaveAsMidiFile(const MString& strMusicNotes, const char* szOutputFilePath);
 
+		/// <Summary>
+		/// Same as SaveAsMidiFile() except that the MIDI file content is placed in
+		/// the buffer instead of a file. Nothing is written to the file system.
+		/// The buffer is replaced, but keeps its capacity, so reusing the same buffer
+		/// across calls saves reallocations.
+		/// @param strMusicNotes the input Music string to be converted to MIDI output
+		/// @param outBuffer the buffer to receive the bytes of the MIDI file
+		/// @return True if content is saved successfully, False otherwise
+		/// </Summary>
+		bool SaveAsMidiFile(const MString& strMusicNotes, std::vector<uint8_t>& outBuffer);
+
+		/// <Summary>
+		/// Same as SaveAsMidiFile() except that the MIDI file content is written to
+		/// the stream instead of a file. The stream need not be seekable.
+		/// @param strMusicNotes the input Music string to be converted to MIDI output
+		/// @param outStream the stream to receive the bytes of the MIDI file
+		/// @return True if content is saved successfully, False otherwise
+		/// </Summary>
+		bool SaveAsMidiFile(const MString& strMusicNotes, std::ostream& outStream);
+
 		/// <Summary>
 		/// Saves any previously played Music Notes into a Midi output file.
         /// If Play() or PlayAsync() is not called on this object previously,
@@ -179,6 +294,18 @@ namespace CFugue
             player.SaveToMidiFile("Output.mid"); // Save the played content to MIDI Output file
         </pre> */
 		bool SaveToMidiFile(const char* szOutputFilePath);
+
+		/// <Summary>
+		/// Same as SaveToMidiFile() except that the MIDI file content is placed in
+		/// the buffer instead of a file.
+		/// </Summary>
+		bool SaveToMidiFile(std::vector<uint8_t>& outBuffer);
+
+		/// <Summary>
+		/// Same as SaveToMidiFile() except that the MIDI file content is written to
+		/// the stream instead of a file.
+		/// </Summary>
+		bool SaveToMidiFile(std::ostream& outStream);
 	};
 
 } // namespace CFugue
@@ -0,0 +1,157 @@
+/*
+	This is part of CFugue, a C++ Runtime for MIDI Score Programming
+	Copyright (C) 2009 Gopalakrishna Palem
+
+	For links to further information, or to contact the author,
+	see <http://cfugue.sourceforge.net/>.
+
+    $LastChangedDate$
+    $Rev$
+    $LastChangedBy$
+*/
+
+#ifndef __RENDERCACHE_H__69E781D6_FEAB_4B6A_82EF_C14690C55322__
+#define __RENDERCACHE_H__69E781D6_FEAB_4B6A_82EF_C14690C55322__
+
+/** @file RenderCache.h
+ * \brief Declares MIDIRenderCache class for CFugue
+ */
+#include "MusicStringParser.h"
+#include "MidiRenderer.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace CFugue
+{
+	///<Summary>
+	/// Remembers the MIDI tracks rendered for Music Strings, so that rendering the
+	/// same Music String again needs no parsing.
+	///
+	/// Entries are keyed by the Music String along with the parser state that decides
+	/// how it renders (see MusicStringParser::GetRenderStateHash()). A cached entry
+	/// also restores the Key Signature that the parser would be left with. Music Strings
+	/// that define dictionary entries are not cached, since replaying them would
+	/// leave out the definitions.
+	///
+	/// The cache holds at most the given number of bytes of rendered events, dropping
+	/// the least recently used entries to make room. It can be shared by any number of
+	/// Player objects, across threads. Use Player::SetRenderCache() to attach it.
+	///</Summary>
+	class MIDIRenderCache
+	{
+	public:
+		/// Identifies a Music String rendered with a given parser state
+		struct Key
+		{
+			std::basic_string<TCHAR>	strMusicNotes;
+			size_t						nStringHash;
+			size_t						nStateHash;			// MusicStringParser::GetRenderStateHash() before the parse
+			size_t						nDefinitionsHash;	// MusicStringParser::GetDefinitionsHash() before the parse
+
+			Key() : nStringHash(0), nStateHash(0), nDefinitionsHash(0) { }
+
+			bool operator == (const Key& other) const;
+		};
+
+		/// <Summary>
+		/// Creates an empty cache.
+		/// @param nMaxBytes the most memory the cached events may take (in bytes)
+		/// </Summary>
+		MIDIRenderCache(size_t nMaxBytes = 32 * 1024 * 1024);
+		~MIDIRenderCache();
+
+		/// Returns the key for the Music String as the given parser would render it now
+		static Key MakeKey(const MString& strMusicNotes, const MusicStringParser& parser);
+
+		/// <Summary>
+		/// Looks up the key and, if found, loads the rendered tracks into the renderer
+		/// (replacing its content) and sets the parser to the Key Signature it would
+		/// be left with after the parse. Counts a hit or a miss.
+		/// @return true if the key was found, false otherwise
+		/// </Summary>
+		bool Restore(const Key& key, MIDIRenderer& renderer, MusicStringParser& parser);
+
+		/// <Summary>
+		/// Remembers the tracks of the renderer for the key. Call after the Music String
+		/// of the key is parsed successfully. Does nothing if the parse defined dictionary
+		/// entries, if the parse was cancelled, or if the tracks do not fit in the cache.
+		/// @return true if the tracks are cached, false otherwise
+		/// </Summary>
+		bool Store(const Key& key, MIDIRenderer& renderer, const MusicStringParser& parser);
+
+		/// Drops all the entries
+		void Invalidate();
+
+		/// Drops the entries of the given Music String, for any parser state
+		/// @return the number of entries dropped
+		size_t Invalidate(const MString& strMusicNotes);
+
+		/// Sets the most memory the cached events may take (in bytes), dropping entries if need be
+		void SetMaxBytes(size_t nMaxBytes);
+
+		/// Returns the most memory the cached events may take (in bytes)
+		size_t GetMaxBytes() const;
+
+		/// Returns the memory the cached events take now (in bytes)
+		size_t GetSizeInBytes() const;
+
+		/// Returns the number of cached entries
+		size_t GetEntryCount() const;
+
+		/// Returns the number of Restore() calls that found their entry
+		unsigned long long GetHitCount() const;
+
+		/// Returns the number of Restore() calls that did not find their entry
+		unsigned long long GetMissCount() const;
+
+		/// Sets the hit and miss counts back to zero
+		void ResetCounters();
+
+	private:
+		MIDIRenderCache(const MIDIRenderCache&);				// not implemented
+		MIDIRenderCache& operator=(const MIDIRenderCache&);	// not implemented
+
+		struct TrackEvents
+		{
+			int										nTrack;
+			std::vector<jdkmidi::MIDITimedBigMessage>	events;
+		};
+
+		struct Entry
+		{
+			Key							key;
+			KeySignature				finalKeySig;	// Key Signature the parser is left with after the parse
+			int							nClksPerBeat;
+			std::vector<TrackEvents>	tracks;			// Only the tracks that have events
+			size_t						nBytes;
+		};
+
+		typedef std::shared_ptr<const Entry> EntryPtr;
+		typedef std::list<EntryPtr> EntryList;		// Most recently used first
+		typedef std::multimap<size_t, EntryList::iterator> EntryMap; // keyed by the hash of the key
+
+		static size_t HashOf(const Key& key);
+
+		/// Drops the least recently used entries till the size is within the limit. Call with m_Mutex held.
+		void Trim();
+
+		/// Drops the entry. Call with m_Mutex held.
+		void Remove(EntryMap::iterator iter);
+
+		mutable std::mutex	m_Mutex;
+		EntryList			m_Entries;
+		EntryMap			m_Index;
+		size_t				m_nMaxBytes;
+		size_t				m_nBytes;
+		unsigned long long	m_nHits;
+		unsigned long long	m_nMisses;
+	};
+
+} // namespace CFugue
+
+#endif // __RENDERCACHE_H__69E781D6_FEAB_4B6A_82EF_C14690C55322__
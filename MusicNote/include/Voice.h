@@ -22,6 +22,10 @@ namespace CFugue
     {
         unsigned char m_nTrack;
     public:
+        /// Number of Voices supported. Each group of 16 Voices plays on its own MIDI output
+        /// port: Voices 0-15 on the first port, 16-31 on the second, and so on.
+        enum { MAX_VOICES = 64 };
+
         inline Voice(unsigned char nTrackID) : m_nTrack(nTrackID) { }
         /// Returns the Voice represented by this object
         inline unsigned char GetVoice() const { return m_nTrack; }
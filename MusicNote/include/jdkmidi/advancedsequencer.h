@@ -40,6 +40,7 @@
 #include "jdkmidi/sysex.h"
 #include "jdkmidi/multitrack.h"
 #include "jdkmidi/filereadmultitrack.h"
+#include "jdkmidi/filereadparallel.h"
 #include "jdkmidi/sequencer.h"
 #include "jdkmidi/manager.h"
 #include "jdkmidi/driver.h"
@@ -76,6 +77,18 @@ namespace jdkmidi
       bool Load ( const char *fname );
       void Reset();
       
+      // the number of threads Load() decodes the track chunks with. The
+      // default of 1 decodes them on the calling thread, without starting
+      // any; 0 uses as many threads as the hardware runs concurrently.
+      void SetLoadThreads ( int n )
+      {
+        load_threads = n;
+      }
+      int GetLoadThreads() const
+      {
+        return load_threads;
+      }
+      
       void GoToMeasure ( int measure, int beat=0 );
       void GoToTime ( MIDITickMS t );
       void Play ( MIDITickMS clock_offset = MIDITickMS::zero() );
@@ -155,6 +168,7 @@ namespace jdkmidi
       
       bool file_loaded;
       bool chain_mode;
+      int load_threads;
   };
   
 }
@@ -31,6 +31,8 @@
 #include "windows.h"
 #include "mmsystem.h"
 
+#include <vector>
+
 namespace jdkmidi
 {
 
@@ -70,7 +72,10 @@ namespace jdkmidi
       
       bool StartTimer ( int resolution_ms );
       bool OpenMIDIInPort ( int id );
-      bool OpenMIDIOutPort ( int id );
+      // Opens device id for the messages of the given output port
+      // (see MIDIMessage::GetOutPort()). Opening port 0 closes the devices
+      // of all the other ports. Messages for ports without a device are dropped.
+      bool OpenMIDIOutPort ( int id, unsigned char out_port = 0 );
       
       void StopTimer();
       void CloseMIDIInPort();
@@ -81,6 +86,8 @@ namespace jdkmidi
       
     protected:
     
+      void CloseExtraMIDIOutPorts();
+      
       static void CALLBACK win32_timer (
         UINT wTimerID,
         UINT msg,
@@ -99,6 +106,7 @@ namespace jdkmidi
       
       HMIDIIN in_handle;
       HMIDIOUT out_handle;
+      std::vector<HMIDIOUT> extra_out_handles; // devices of the output ports beyond the first (port n at n-1). 0 if not open
       int timer_id;
       int timer_res;
       
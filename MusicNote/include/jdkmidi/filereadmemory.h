@@ -0,0 +1,205 @@
+/*
+ *  libjdkmidi-2004 C++ Class Library for MIDI
+ *
+ *  This file was added to this copy of libjdkmidi. It is not part of the
+ *  upstream libjdkmidi-2004 release by J.D. Koftinoff Software, Ltd.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef JDKMIDI_FILEREADMEMORY_H
+#define JDKMIDI_FILEREADMEMORY_H
+
+#include "jdkmidi/midi.h"
+#include "jdkmidi/msg.h"
+#include "jdkmidi/sysex.h"
+#include "jdkmidi/file.h"
+#include "jdkmidi/fileread.h"
+
+#include <vector>
+
+namespace jdkmidi
+{
+  class MIDIFileMemoryMap;
+  class MIDIFileReadMemory;
+  
+  //
+  // MIDIFileMemoryMap gives a read only view of a whole file in memory.
+  // The file is memory mapped where the platform allows it, and read
+  // into a buffer otherwise.
+  //
+  
+  class MIDIFileMemoryMap
+  {
+    public:
+      explicit MIDIFileMemoryMap ( const char *fname );
+      virtual ~MIDIFileMemoryMap();
+      
+      bool IsValid() const
+      {
+        return data!=0;
+      }
+      
+      const unsigned char *GetData() const
+      {
+        return data;
+      }
+      
+      unsigned long GetSize() const
+      {
+        return size;
+      }
+      
+    private:
+      const unsigned char *data;
+      unsigned long size;
+      bool mapped;
+      
+      MIDIFileMemoryMap ( const MIDIFileMemoryMap & );
+      const MIDIFileMemoryMap & operator = ( const MIDIFileMemoryMap & );
+  };
+  
+  //
+  // MIDIFileReadMemory parses a standard midi file straight from a span of
+  // bytes (such as a MIDIFileMemoryMap) instead of pulling every byte through
+  // MIDIFileReadStream::ReadChar(). Chunks, variable length numbers and running
+  // status are decoded directly from memory.
+  //
+  // The event handler gets the very same MIDIFileEvents callbacks as with
+  // MIDIFileRead, so MIDIFileReadMultiTrack and the like work with it as is.
+  // The bytes must stay valid till Parse() returns.
+  //
+  
+  class MIDIFileReadMemory : protected MIDIFile
+  {
+    public:
+    
+      MIDIFileReadMemory (
+        const unsigned char *data_,
+        unsigned long size_,
+        MIDIFileEvents *event_handler_,
+        unsigned long max_msg_len=8192
+      );
+      virtual         ~MIDIFileReadMemory();
+      
+      virtual bool    Parse();
+      
+      // reads the header and finds the track chunks without decoding any of
+      // them. returns the number of tracks, 0 on errors.
+      int  ParseHeader();
+      
+      // decodes the events of the given track chunk only, reading the header
+      // first if that was not done yet. Running status and sysex continuation
+      // never cross chunks, so any chunk may be decoded on its own.
+      bool ParseTrack ( int trk );
+      
+      // gives the offset and length within the data of the events of the
+      // given track chunk, as found by ParseHeader(). returns false if the
+      // file has no such chunk.
+      bool GetTrackChunk ( int trk, unsigned long *offset, unsigned long *length );
+      
+      // decodes the events of the track chunk at the given offset and length
+      // within the data (see GetTrackChunk()), without reading the header.
+      // The event handler gets no mf_header() call, so a handler that needs
+      // the header must be given it beforehand.
+      bool ParseTrackChunk ( int trk, unsigned long offset, unsigned long length );
+      
+      int  GetFormat()
+      {
+        return header_format;
+      }
+      int  GetNumberTracks()
+      {
+        return header_ntrks;
+      }
+      int  GetDivision()
+      {
+        return header_division;
+      }
+      
+    protected:
+    
+      // finds the header and the track chunks, and reports the header
+      // to the event handler. returns the number of tracks, 0 on errors.
+      virtual int  ReadHeader();
+      
+      // decodes the events of one track chunk
+      virtual void ReadTrack ( int trk );
+      
+      // decodes the events between begin and end as track trk
+      void ReadTrackChunk ( int trk, const unsigned char *begin, const unsigned char *end );
+      
+      virtual void    mf_error ( const char * );
+      
+      struct TrackChunk
+      {
+        const unsigned char *begin;
+        const unsigned char *end;
+      };
+      
+    protected:
+      int  no_merge;
+      MIDITickMS   cur_time;
+      int   cur_track;
+      int   abort_parse;
+      
+      unsigned char   *the_msg;
+      int  max_msg_len;
+      int    msg_index;
+      
+      std::vector<TrackChunk> track_chunks;
+      
+    private:
+      unsigned long   ReadVariableNum();
+      
+      void    MsgInit()
+      {
+        msg_index=0;
+      }
+      
+      void    MsgAdd ( int a )
+      {
+        if ( msg_index<max_msg_len )
+          the_msg[ msg_index++ ] = ( unsigned char ) a;
+      }
+      
+      // returns the next byte of the current chunk, -1 past its end
+      int   EGetC()
+      {
+        if ( cur<cur_end )
+          return *cur++;
+          
+        mf_error ( "Unexpected End Of Track" );
+        return -1;
+      }
+      
+      void FormChanMessage ( unsigned char st, unsigned char b1, unsigned char b2 );
+      
+      bool header_done;
+      int  header_format;
+      int  header_ntrks;
+      int  header_division;
+      
+      const unsigned char *data;
+      unsigned long size;
+      
+      const unsigned char *cur;      // read position in the current chunk
+      const unsigned char *cur_end;  // end of the current chunk
+      
+      MIDIFileEvents *event_handler;
+  };
+}
+
+#endif
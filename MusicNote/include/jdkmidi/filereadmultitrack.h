@@ -64,6 +64,7 @@ namespace jdkmidi
       virtual void    mf_timesig ( MIDITickMS time, int, int, int, int );
       virtual void    mf_tempo ( MIDITickMS time, unsigned long tempo );
       virtual void    mf_keysig ( MIDITickMS time, int, int );
+      virtual void    mf_outputcable ( MIDITickMS time, int );
       virtual void    mf_sqspecific ( MIDITickMS time, int, unsigned char * );
       virtual void    mf_text ( MIDITickMS time, int, int, unsigned char * );
       virtual void    mf_eot ( MIDITickMS time );
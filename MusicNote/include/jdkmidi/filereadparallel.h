@@ -0,0 +1,118 @@
+/*
+ *  libjdkmidi-2004 C++ Class Library for MIDI
+ *
+ *  This file was added to this copy of libjdkmidi. It is not part of the
+ *  upstream libjdkmidi-2004 release by J.D. Koftinoff Software, Ltd.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef JDKMIDI_FILEREADPARALLEL_H
+#define JDKMIDI_FILEREADPARALLEL_H
+
+#include "jdkmidi/multitrack.h"
+#include "jdkmidi/filereadmultitrack.h"
+#include "jdkmidi/filereadmemory.h"
+
+#include <atomic>
+#include <vector>
+
+namespace jdkmidi
+{
+  //
+  // MIDIFileReadParallel loads a standard midi file held in memory into a
+  // MIDIMultiTrack, decoding the track chunks concurrently.
+  //
+  // The header is read once to find all the track chunks. Each chunk is then
+  // decoded from its offset and length by a MIDIFileReadMemory of its own into
+  // private staging tracks, and the staging tracks are moved into the
+  // multitrack in chunk order. Once a chunk fails to decode no more chunks are
+  // started. The multitrack ends up exactly as MIDIFileReadMultiTrack would
+  // leave it after a sequential MIDIFileRead::Parse(), including when a chunk
+  // fails to decode.
+  //
+  // Starting threads costs more than decoding a small file, so a caller that
+  // loads small files should rather use MIDIFileReadMemory, or ask for a
+  // single thread, which decodes all the chunks on the calling thread.
+  //
+  
+  class MIDIFileReadParallel
+  {
+    public:
+    
+      // max_threads_ of 0 uses as many threads as the hardware runs concurrently
+      MIDIFileReadParallel (
+        const unsigned char *data_,
+        unsigned long size_,
+        MIDIMultiTrack *multitrack_,
+        int max_threads_=0
+      );
+      virtual ~MIDIFileReadParallel();
+      
+      virtual bool Parse();
+      
+      int  GetFormat()
+      {
+        return header_format;
+      }
+      int  GetNumberTracks()
+      {
+        return header_ntrks;
+      }
+      int  GetDivision()
+      {
+        return header_division;
+      }
+      
+    protected:
+    
+      struct StagingChunk
+      {
+        MIDIMultiTrack *tracks;
+        bool found;             // whether the header scan found this chunk
+        unsigned long offset;   // where the events of the chunk are in the data
+        unsigned long length;
+        bool ok;
+      };
+      
+      // decodes the chunks handed out by next_chunk till none are left
+      void DecodeChunks();
+      
+      // allocates the staging tracks that decoding the given chunk can write to
+      MIDIMultiTrack *CreateStagingTracks ( int trk );
+      
+      // moves the events of the staging tracks to the end of the multitrack's tracks
+      void MergeStagingTracks ( MIDIMultiTrack *staging );
+      
+    private:
+      const unsigned char *data;
+      unsigned long size;
+      MIDIMultiTrack *multitrack;
+      int max_threads;
+      
+      int  header_format;
+      int  header_ntrks;
+      int  header_division;
+      
+      std::vector<StagingChunk> staging_chunks;
+      std::atomic<int> next_chunk; // next chunk to be handed out to a decoding thread
+      std::atomic<bool> failed;    // set once a chunk fails to decode
+      
+      MIDIFileReadParallel ( const MIDIFileReadParallel & );
+      const MIDIFileReadParallel & operator = ( const MIDIFileReadParallel & );
+  };
+}
+
+#endif
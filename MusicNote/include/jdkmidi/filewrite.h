@@ -39,6 +39,8 @@
 #include "jdkmidi/sysex.h"
 #include "jdkmidi/file.h"
 
+#include <vector>
+
 namespace jdkmidi
 {
 
@@ -90,6 +92,26 @@ namespace jdkmidi
       
   };
   
+  //
+  // MIDIFileWriteStreamMemory writes into a byte buffer that grows as
+  // needed, so that a midi file can be produced without any file system
+  // access. The buffer is emptied when the stream is created.
+  //
+  
+  class MIDIFileWriteStreamMemory : public MIDIFileWriteStream
+  {
+    public:
+      MIDIFileWriteStreamMemory ( std::vector<unsigned char> &buf_ );
+      virtual ~MIDIFileWriteStreamMemory();
+      
+      long Seek ( long pos, int whence=SEEK_SET );
+      int WriteChar ( int c );
+      
+    protected:
+      std::vector<unsigned char> &buf;
+      unsigned long cur_pos;
+  };
+  
   class MIDIFileWrite : protected MIDIFile
   {
     public:
@@ -134,6 +156,7 @@ namespace jdkmidi
       void    WriteMetaEvent ( MIDITickMS time, unsigned char type, const unsigned char *data, long length );
       void    WriteTempo ( MIDITickMS time, long tempo );
       void    WriteKeySignature ( MIDITickMS time, char sharp_flat, char minor );
+      void    WriteOutputCable ( MIDITickMS time, unsigned char cable );
       void    WriteTimeSignature (
         MIDITickMS time,
         char numerator=4,
@@ -65,6 +65,13 @@ namespace jdkmidi
 	  void SetSeqOffset(MIDITickMS seqoff);
 	  MIDITickMS GetSeqOffset();
       
+      // to set and get the sequencer horizon. Events at or after the horizon
+      // (in sequencer clocks) are held back till the horizon moves past them,
+      // and the sequence does not auto stop while a horizon is set. Use this
+      // while the sequence is still being generated. MIDITickMS::max() clears it.
+      void SetSeqHorizon(MIDITickMS horizon);
+      MIDITickMS GetSeqHorizon() const;
+      
       
       // to manage the playback of the sequencer
       void SeqPlay();
@@ -89,12 +96,15 @@ namespace jdkmidi
 	  virtual bool TimeTickPlayMode(MIDITick::time_point sys_time_);
 	  virtual bool TimeTickStopMode(MIDITick::time_point sys_time_);
       
+      bool IsHeldAtHorizon();
+      
       MIDIDriver *driver;
       
       MIDISequencer *sequencer;
       
 	  MIDITick::time_point sys_time_offset;
 	  MIDITickMS seq_time_offset;
+	  MIDITickMS seq_horizon;
       
       volatile bool play_mode;
       volatile bool stop_mode;
@@ -249,6 +249,18 @@ namespace jdkmidi
       
       bool  IsBeatMarker() const;
       
+      bool  IsOutputCable() const;
+      
+      /// If the message is an output cable (MIDI port) meta-event, returns the port number
+      unsigned char GetOutputCable() const;
+      
+      /// Get the output port the message is to be sent to. This is not a part of the
+      /// MIDI data; the sequencer sets it from the output cable meta-events of the track.
+      unsigned char GetOutPort() const
+      {
+        return port;
+      }
+      
       ///
       /// GetTempo() returns the tempo value in 1/32 bpm
       ///
@@ -382,6 +394,14 @@ namespace jdkmidi
       
       void SetBeatMarker();
       
+      void SetOutputCable ( unsigned char cable );
+      
+      /// Set the output port the message is to be sent to. Port 0 is the default port.
+      void SetOutPort ( unsigned char p )
+      {
+        port=p;
+      }
+      
       //@}
       
     protected:
@@ -393,6 +413,7 @@ namespace jdkmidi
       unsigned char byte1;
       unsigned char byte2;
       unsigned char byte3;  ///< byte 3 is only used for meta-events and to round out the structure size to 32 bits
+      unsigned char port;   ///< output port for the message. Fits in the padding of the timed and big messages
       
   };
   
@@ -116,6 +116,7 @@ namespace jdkmidi
       int num_tracks;
       int *next_event_number;
       MIDITickMS *next_event_time;
+      int *end_event_number; // number of events a track had when the iterator went past its end
   };
   
   class MIDIMultiTrackIterator
@@ -134,6 +135,10 @@ namespace jdkmidi
       
       bool GoToNextEventOnTrack ( int track );
       
+      // picks up the events appended to the tracks after the iterator went
+      // past their end. Returns true if any track got new events.
+      bool Resume();
+      
       const MIDIMultiTrackIteratorState &GetState() const
       {
         return state;
@@ -0,0 +1,152 @@
+/*
+ *  libjdkmidi-2004 C++ Class Library for MIDI
+ *
+ *  This file was added to this copy of libjdkmidi. It is not part of the
+ *  upstream libjdkmidi-2004 release by J.D. Koftinoff Software, Ltd.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef JDKMIDI_MULTITRACKCACHE_H
+#define JDKMIDI_MULTITRACKCACHE_H
+
+#include "jdkmidi/multitrack.h"
+#include "jdkmidi/filereadmemory.h"
+
+#include <stdint.h>
+
+namespace jdkmidi
+{
+  //
+  // MIDIMultiTrackCache keeps a rendered MIDIMultiTrack in a binary file that
+  // loads without any decoding or sorting, unlike a standard midi file.
+  //
+  // The file holds, for every track, its events as an array of fixed width
+  // records already in the order of MIDITrack, followed by the tempo map and
+  // the measure index that a MIDISequencer would arrive at while playing the
+  // tracks. The file is memory mapped on open; the tempo map and the measure
+  // index are used straight from the mapped view, and Load() copies the event
+  // records into a multitrack in one pass.
+  //
+  // The format carries a version and the byte order of the machine that
+  // wrote it. A file of another version or byte order is not valid, and
+  // should be regenerated from its source.
+  //
+  
+  class MIDIMultiTrackCache
+  {
+    public:
+      enum
+      {
+        VERSION=1
+      };
+      
+      struct TempoEntry
+      {
+        uint32_t clock;       // time of the tempo change in clocks
+        uint32_t time_ms;     // time of the tempo change in milliseconds
+        uint32_t tempo32;     // new tempo in 1/32 beats per minute, as MIDIMessage::GetTempo32()
+        uint32_t reserved;
+      };
+      
+      struct MeasureEntry
+      {
+        uint32_t clock;       // start of the measure in clocks
+        uint32_t time_ms;     // start of the measure in milliseconds
+      };
+      
+      // Maps the cache file. Check IsValid() before use.
+      explicit MIDIMultiTrackCache ( const char *fname );
+      virtual ~MIDIMultiTrackCache();
+      
+      // Writes the tracks to a cache file. The tempo map and the measure
+      // index are worked out by running a MIDISequencer over the tracks.
+      static bool Write ( MIDIMultiTrack *multitrack, const char *fname );
+      
+      bool IsValid() const
+      {
+        return header!=0;
+      }
+      
+      int GetNumTracks() const;
+      int GetClksPerBeat() const;
+      int GetNumEvents ( int trk ) const;
+      
+      int GetNumTempoChanges() const;
+      const TempoEntry *GetTempoMap() const
+      {
+        return tempo_map;
+      }
+      
+      int GetNumMeasures() const;
+      const MeasureEntry *GetMeasureIndex() const
+      {
+        return measure_index;
+      }
+      
+      // Returns the measure playing at the given time in milliseconds
+      int FindMeasure ( MIDITickMS time_ms ) const;
+      
+      // Replaces the contents of the multitrack with the cached tracks.
+      // Tracks beyond the capacity of the multitrack are left out.
+      bool Load ( MIDIMultiTrack *multitrack ) const;
+      
+    protected:
+    
+      struct FileHeader
+      {
+        char magic[4];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t clks_per_beat;
+        uint32_t num_tracks;
+        uint32_t num_tempo_changes;
+        uint32_t num_measures;
+        uint32_t sysex_size;
+      };
+      
+      struct TrackEntry
+      {
+        uint32_t offset;      // file offset of the first event record
+        uint32_t num_events;
+      };
+      
+      struct EventRecord
+      {
+        uint32_t time;
+        unsigned char status;
+        unsigned char byte1;
+        unsigned char byte2;
+        unsigned char byte3;
+        uint32_t sysex;       // 1 + offset of the sysex data in the sysex area, 0 for none
+      };
+      
+      bool Validate();
+      
+      MIDIFileMemoryMap map;
+      
+      const FileHeader *header;
+      const TrackEntry *track_table;
+      const TempoEntry *tempo_map;
+      const MeasureEntry *measure_index;
+      const unsigned char *sysex_area;
+      
+    private:
+      MIDIMultiTrackCache ( const MIDIMultiTrackCache & );
+      const MIDIMultiTrackCache & operator = ( const MIDIMultiTrackCache & );
+  };
+}
+
+#endif
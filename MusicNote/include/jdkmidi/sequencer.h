@@ -234,6 +234,7 @@ namespace jdkmidi
       int timesig_numerator;  // numerator of current time signature
       int timesig_denominator; // denominator of current time signature
       int bender_value;   // last seen bender value
+      int port;      // output port from the last output cable meta-event, or 0
       char track_name[256];  // track name
       bool got_good_track_name; // true if we dont want to use generic text events for track name
       
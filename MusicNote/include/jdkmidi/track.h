@@ -135,6 +135,20 @@ namespace jdkmidi
       ///
       void ClearAndMerge ( const MIDITrack *src1, const MIDITrack *src2 );
       
+      ///
+      /// Truncate() drops the events from event_num onwards. As with Clear(), the
+      /// events are not freed.
+      /// @param event_num The number of events to keep
+      ///
+      void Truncate ( int event_num );
+      
+      ///
+      /// Swap() exchanges the events (and the allocated chunks) of this track with those of another track.
+      /// No events are copied.
+      /// @param t The reference to the MIDITrack object to swap with
+      ///
+      void Swap ( MIDITrack &t );
+      
 // bool Insert( int start_event, int num_events );
 //    bool  Delete( int start_event, int num_events);
 //    void  Sort();
@@ -151,6 +165,13 @@ namespace jdkmidi
       
       bool PutEvent ( const MIDITimedBigMessage &msg );
       bool PutEvent ( const MIDITimedMessage &msg, MIDISystemExclusive *sysex );
+      
+      ///
+      /// AppendEvent() adds the event after the last one, without looking for its
+      /// sorted position as PutEvent() does. The caller ensures that the events
+      /// arrive in the order PutEvent() would have kept them.
+      ///
+      bool AppendEvent ( const MIDITimedBigMessage &msg );
       bool SetEvent ( int event_num, const MIDITimedBigMessage &msg );
       
       bool MakeEventNoOp ( int event_num );
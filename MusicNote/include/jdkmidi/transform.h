@@ -0,0 +1,162 @@
+/*
+ *  libjdkmidi-2004 C++ Class Library for MIDI
+ *
+ *  This file was added to this copy of libjdkmidi. It is not part of the
+ *  upstream libjdkmidi-2004 release by J.D. Koftinoff Software, Ltd.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef JDKMIDI_TRANSFORM_H
+#define JDKMIDI_TRANSFORM_H
+
+#include "jdkmidi/process.h"
+#include "jdkmidi/multitrack.h"
+
+#include <atomic>
+
+namespace jdkmidi
+{
+  //
+  // MIDIProcessorTransform edits all the events of rendered tracks in one
+  // pass: it transposes the notes (clamping them to the note range), reshapes
+  // the note on velocities with a curve, moves channel messages to other
+  // channels, drops the events of chosen kinds, scales or shifts the event
+  // times and scales the tempo.
+  //
+  // The edits are compiled into lookup tables indexed by the status and the
+  // data bytes, so every event goes through the same few table loads whatever
+  // edits are set. The tracks are independent of each other and are
+  // transformed concurrently.
+  //
+  // Being a MIDIProcessor, the transform can also be set as the out processor
+  // of a MIDIDriver (see MIDIDriver::SetOutProcessor()) to apply the note,
+  // velocity, channel and filter edits to the messages on their way out. The
+  // time and tempo edits do not apply there. Set up the edits before the
+  // driver starts; they are not synchronized with the driver thread.
+  //
+  
+  class MIDIProcessorTransform : public MIDIProcessor
+  {
+    public:
+      MIDIProcessorTransform();
+      virtual ~MIDIProcessorTransform();
+      
+      // Restores the defaults, which leave the events as they are
+      void Reset();
+      
+      // Transposes the note on, note off and poly pressure messages of the
+      // channel. Notes that go out of range are clamped to 0 or 127.
+      void SetTranspose ( int chan, int semitones );
+      void SetAllTranspose ( int semitones );
+      
+      int GetTranspose ( int chan ) const
+      {
+        return transpose[chan];
+      }
+      
+      // Replaces each note on velocity v with curve[v]. Velocity 0 (a note
+      // off) is left alone and the curve values are clamped to 1..127.
+      void SetVelocityCurve ( const unsigned char curve[128] );
+      
+      // Sets a linear velocity curve of v*scale+offset
+      void SetVelocityScale ( double scale, int offset=0 );
+      
+      // Moves the channel messages of src_chan to dest_chan, or drops them
+      // for a dest_chan of -1
+      void SetRechannel ( int src_chan, int dest_chan );
+      
+      int GetRechannel ( int src_chan ) const
+      {
+        return rechan_map[src_chan];
+      }
+      
+      // Drops the events of the given status, or keeps them again. The
+      // channel of a channel message status is ignored: 0x90 drops the note
+      // ons of all the channels. Note that 0xff drops all the meta-events,
+      // the end of track included.
+      void SetStatusFilter ( unsigned char status, bool drop=true );
+      
+      // Event times become time*factor+shift (in clocks), clamped at 0.
+      // Factors of 0 and below are ignored.
+      void SetTimeStretch ( double factor );
+      void SetTimeShift ( long shift );
+      
+      double GetTimeStretch() const
+      {
+        return time_stretch;
+      }
+      
+      long GetTimeShift() const
+      {
+        return time_shift;
+      }
+      
+      // Multiplies the tempo of the tempo meta-events by the factor. Factors
+      // of 0 and below are ignored.
+      void SetTempoScale ( double factor );
+      
+      double GetTempoScale() const
+      {
+        return tempo_scale;
+      }
+      
+      // Transforms the events of the track. The dropped events are removed
+      // and the others keep their order.
+      void Apply ( MIDITrack *track ) const;
+      
+      // Transforms all the tracks of the multitrack. max_threads of 0 uses as
+      // many threads as the hardware runs concurrently.
+      void Apply ( MIDIMultiTrack *multitrack, int max_threads=0 ) const;
+      
+      // Applies the note, velocity, channel and filter edits to the message.
+      // Returns false if the message is to be dropped.
+      virtual bool Process ( MIDITimedBigMessage *msg );
+      
+    protected:
+    
+      // Applies the table edits to the message; false if it is dropped
+      bool Transform ( MIDITimedBigMessage *msg ) const;
+      
+      // Transforms the tracks handed out by next_track till none are left
+      void ApplyTracks ( MIDIMultiTrack *multitrack, std::atomic<int> *next_track ) const;
+      
+      void CompileStatusMap();
+      void CompileNoteMap ( int chan );
+      
+      enum
+      {
+        IDENTITY_ROW=16
+      };
+      
+      int transpose[16];
+      int rechan_map[16];
+      bool filter[256];
+      double time_stretch;
+      long time_shift;
+      double tempo_scale;
+      
+      // compiled tables
+      
+      bool drop_map[256];                 // true for the statuses to drop
+      unsigned char status_map[256];      // new status for each status
+      unsigned char note_row[256];        // row of note_map for the byte 1 of each status
+      unsigned char velocity_row[256];    // row of velocity_map for the byte 2 of each status
+      unsigned char note_map[17][256];    // one row per channel, then IDENTITY_ROW
+      unsigned char velocity_map[2][256]; // identity, then the curve
+  };
+}
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ *  libjdkmidi-2004 C++ Class Library for MIDI
+ *
+ *  This file was added to this copy of libjdkmidi. It is not part of the
+ *  upstream libjdkmidi-2004 release by J.D. Koftinoff Software, Ltd.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+//
+// Loads the given midi files into a MIDIMultiTrack with MIDIFileRead
+// (byte by byte from a FILE *), with MIDIFileReadMemory (from a memory
+// mapped view) and with MIDIFileReadParallel (decoding the tracks
+// concurrently), checks that all give the same tracks, and prints the
+// time each one takes.
+//
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include "jdkmidi/world.h"
+#include "jdkmidi/track.h"
+#include "jdkmidi/multitrack.h"
+#include "jdkmidi/filereadmultitrack.h"
+#include "jdkmidi/fileread.h"
+#include "jdkmidi/filereadmemory.h"
+#include "jdkmidi/filereadparallel.h"
+
+#include <chrono>
+
+using namespace jdkmidi;
+
+typedef std::chrono::steady_clock bench_clock;
+
+static long long ElapsedUs ( bench_clock::time_point start )
+{
+  return ( long long ) std::chrono::duration_cast<std::chrono::microseconds> ( bench_clock::now() - start ).count();
+}
+
+static int CountEvents ( const MIDIMultiTrack &tracks )
+{
+  int count=0;
+  
+  for ( int i=0; i<tracks.GetNumTracks(); ++i )
+    count += tracks.GetTrack ( i )->GetNumEvents();
+    
+  return count;
+}
+
+static bool SameTracks ( const MIDIMultiTrack &a, const MIDIMultiTrack &b )
+{
+  for ( int i=0; i<a.GetNumTracks(); ++i )
+  {
+    const MIDITrack *ta = a.GetTrack ( i );
+    const MIDITrack *tb = b.GetTrack ( i );
+    
+    if ( ta->GetNumEvents() != tb->GetNumEvents() )
+      return false;
+      
+    for ( int n=0; n<ta->GetNumEvents(); ++n )
+    {
+      const MIDITimedBigMessage *ma = ta->GetEvent ( n );
+      const MIDITimedBigMessage *mb = tb->GetEvent ( n );
+      
+      if ( ma->GetTime() != mb->GetTime()
+           || ma->GetStatus() != mb->GetStatus()
+           || ma->GetByte1() != mb->GetByte1()
+           || ma->GetByte2() != mb->GetByte2()
+           || ma->GetByte3() != mb->GetByte3() )
+        return false;
+    }
+  }
+  
+  return true;
+}
+
+int main ( int argc, char **argv )
+{
+  if ( argc<2 )
+  {
+    fprintf ( stderr, "usage:\n\tjdkmidi_bench_fileread FILE.mid [FILE.mid ...]\n" );
+    return -1;
+  }
+  
+  const int repeat = 20;
+  int return_code = 0;
+  
+  for ( int f=1; f<argc; ++f )
+  {
+    const char *fname = argv[f];
+    
+    long long stream_us = 0, memory_us = 0, parallel_us = 0;
+    int stream_events = 0, memory_events = 0, parallel_events = 0;
+    bool same = true;
+    
+    for ( int r=0; r<repeat; ++r )
+    {
+      MIDIMultiTrack stream_tracks;
+      MIDIMultiTrack memory_tracks;
+      MIDIMultiTrack parallel_tracks;
+      
+      bench_clock::time_point start = bench_clock::now();
+      {
+        MIDIFileReadStreamFile rs ( fname );
+        MIDIFileReadMultiTrack track_loader ( &stream_tracks );
+        MIDIFileRead reader ( &rs, &track_loader );
+        
+        if ( !reader.Parse() )
+        {
+          fprintf ( stderr, "Error reading file '%s'\n", fname );
+          return_code = -1;
+          break;
+        }
+      }
+      stream_us += ElapsedUs ( start );
+      
+      start = bench_clock::now();
+      {
+        // mapping the file is part of the cost
+        MIDIFileMemoryMap map ( fname );
+        MIDIFileReadMultiTrack track_loader ( &memory_tracks );
+        MIDIFileReadMemory reader ( map.GetData(), map.GetSize(), &track_loader );
+        
+        if ( !reader.Parse() )
+        {
+          fprintf ( stderr, "Error reading file '%s' from memory\n", fname );
+          return_code = -1;
+          break;
+        }
+      }
+      memory_us += ElapsedUs ( start );
+      
+      start = bench_clock::now();
+      {
+        MIDIFileMemoryMap map ( fname );
+        MIDIFileReadParallel reader ( map.GetData(), map.GetSize(), &parallel_tracks );
+        
+        if ( !reader.Parse() )
+        {
+          fprintf ( stderr, "Error reading file '%s' in parallel\n", fname );
+          return_code = -1;
+          break;
+        }
+      }
+      parallel_us += ElapsedUs ( start );
+      
+      stream_events = CountEvents ( stream_tracks );
+      memory_events = CountEvents ( memory_tracks );
+      parallel_events = CountEvents ( parallel_tracks );
+      same = same && SameTracks ( stream_tracks, memory_tracks ) && SameTracks ( stream_tracks, parallel_tracks );
+    }
+    
+    if ( !same )
+    {
+      fprintf ( stderr, "Tracks differ for '%s'\n", fname );
+      return_code = -1;
+    }
+    
+    fprintf ( stdout, "%s: %d events, MIDIFileRead %lld us, MIDIFileReadMemory %lld us, MIDIFileReadParallel %lld us (average of %d loads)\n",
+              fname, memory_events, stream_us / repeat, memory_us / repeat, parallel_us / repeat, repeat );
+              
+    if ( stream_events != memory_events || stream_events != parallel_events )
+      return_code = -1;
+  }
+  
+  return return_code;
+}
@@ -40,7 +40,8 @@ namespace jdkmidi
       repeat_play_mode ( false ),
       num_warp_positions ( 0 ),
       file_loaded ( false ),
-      chain_mode ( false )
+      chain_mode ( false ),
+      load_threads ( 1 )
   {
   }
   
@@ -155,9 +156,7 @@ namespace jdkmidi
       }
     }
     
-    MIDIFileReadStreamFile mfreader_stream ( realname );
-    MIDIFileReadMultiTrack track_loader ( &tracks );
-    MIDIFileRead reader ( &mfreader_stream, &track_loader );
+    MIDIFileMemoryMap mfreader_map ( realname );
     
     Stop();
     driver.AllNotesOff();
@@ -165,7 +164,21 @@ namespace jdkmidi
     tracks.Clear();
     seq.ResetAllTracks();
     
-    if ( reader.Parse() )
+    bool ok;
+    
+    if ( load_threads==1 )
+    {
+      MIDIFileReadMultiTrack track_loader ( &tracks );
+      MIDIFileReadMemory reader ( mfreader_map.GetData(), mfreader_map.GetSize(), &track_loader );
+      ok = reader.Parse();
+    }
+    else
+    {
+      MIDIFileReadParallel reader ( mfreader_map.GetData(), mfreader_map.GetSize(), &tracks, load_threads );
+      ok = reader.Parse();
+    }
+    
+    if ( ok )
     {
       file_loaded=true;
       
@@ -122,7 +122,8 @@ namespace jdkmidi
         mf_text ( time,type, leng, m );
         break;
       case MF_OUTPUT_CABLE:
-        // TO DO:
+        if ( leng>=1 )
+          mf_outputcable ( time, m[0] );
         break;
       case MF_TRACK_LOOP:
         // TO DO:
@@ -248,6 +249,13 @@ namespace jdkmidi
   
   }
   
+  void    MIDIFileEvents::mf_outputcable (
+    MIDITickMS time,
+    int a )
+  {
+  
+  }
+  
   void    MIDIFileEvents::mf_sqspecific (
     MIDITickMS time,
     int a,
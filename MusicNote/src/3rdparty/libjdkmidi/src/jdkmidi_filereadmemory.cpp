@@ -0,0 +1,546 @@
+/*
+ *  libjdkmidi-2004 C++ Class Library for MIDI
+ *
+ *  This file was added to this copy of libjdkmidi. It is not part of the
+ *  upstream libjdkmidi-2004 release by J.D. Koftinoff Software, Ltd.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "jdkmidi/world.h"
+
+#include "jdkmidi/filereadmemory.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace jdkmidi
+{
+
+
+  MIDIFileMemoryMap::MIDIFileMemoryMap ( const char *fname )
+      :
+      data ( 0 ),
+      size ( 0 ),
+      mapped ( false )
+  {
+#ifdef WIN32
+    HANDLE file = CreateFileA ( fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    
+    if ( file != INVALID_HANDLE_VALUE )
+    {
+      DWORD file_size = GetFileSize ( file, NULL );
+      
+      if ( file_size != INVALID_FILE_SIZE && file_size > 0 )
+      {
+        HANDLE mapping = CreateFileMappingA ( file, NULL, PAGE_READONLY, 0, 0, NULL );
+        
+        if ( mapping )
+        {
+          data = ( const unsigned char * ) MapViewOfFile ( mapping, FILE_MAP_READ, 0, 0, 0 );
+          size = data ? file_size : 0;
+          mapped = ( data != 0 );
+          
+          CloseHandle ( mapping ); // the view keeps the mapping alive
+        }
+      }
+      
+      CloseHandle ( file );
+    }
+    
+#else
+    int fd = open ( fname, O_RDONLY );
+    
+    if ( fd >= 0 )
+    {
+      struct stat st;
+      
+      if ( fstat ( fd, &st ) == 0 && st.st_size > 0 )
+      {
+        void *p = mmap ( 0, ( size_t ) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        
+        if ( p != MAP_FAILED )
+        {
+          // we go through the file once, front to back
+          madvise ( p, ( size_t ) st.st_size, MADV_SEQUENTIAL );
+          
+          data = ( const unsigned char * ) p;
+          size = ( unsigned long ) st.st_size;
+          mapped = true;
+        }
+      }
+      
+      close ( fd );
+    }
+    
+#endif
+    
+    if ( !mapped )
+    {
+      // could not map it (for example, a pipe) - read it in as a whole
+      
+      FILE *f = fopen ( fname, "rb" );
+      
+      if ( f )
+      {
+        std::vector<unsigned char> buf;
+        unsigned char chunk[65536];
+        size_t n;
+        
+        while ( ( n = fread ( chunk, 1, sizeof ( chunk ), f ) ) > 0 )
+          buf.insert ( buf.end(), chunk, chunk + n );
+          
+        fclose ( f );
+        
+        if ( !buf.empty() )
+        {
+          unsigned char *copy = new unsigned char[ buf.size() ];
+          memcpy ( copy, &buf[0], buf.size() );
+          
+          data = copy;
+          size = ( unsigned long ) buf.size();
+        }
+      }
+    }
+  }
+  
+  MIDIFileMemoryMap::~MIDIFileMemoryMap()
+  {
+    if ( !data )
+      return;
+      
+    if ( mapped )
+    {
+#ifdef WIN32
+      UnmapViewOfFile ( ( LPCVOID ) data );
+#else
+      munmap ( ( void * ) data, ( size_t ) size );
+#endif
+    }
+    else
+    {
+      delete [] data;
+    }
+  }
+  
+  
+  
+  
+  
+  MIDIFileReadMemory::MIDIFileReadMemory (
+    const unsigned char *data_,
+    unsigned long size_,
+    MIDIFileEvents *event_handler_,
+    unsigned long max_msg_len_
+  )
+      :
+      header_done ( false ),
+      header_format ( 0 ),
+      header_ntrks ( 0 ),
+      header_division ( 0 ),
+      data ( data_ ),
+      size ( data_ ? size_ : 0 ),
+      cur ( 0 ),
+      cur_end ( 0 ),
+      event_handler ( event_handler_ )
+  {
+    no_merge=0;
+    cur_time=MIDITickMS::zero();
+    cur_track=0;
+    abort_parse=0;
+    msg_index=0;
+    max_msg_len=max_msg_len_;
+    the_msg = new unsigned char[max_msg_len+1]; // room for the terminating NULL of text events
+  }
+  
+  MIDIFileReadMemory::~MIDIFileReadMemory()
+  {
+    delete [] the_msg;
+  }
+  
+  void MIDIFileReadMemory::mf_error ( const char *e )
+  {
+    if ( !abort_parse )
+      event_handler->mf_error ( e );
+      
+    abort_parse=true;
+  }
+  
+  bool MIDIFileReadMemory::Parse()
+  {
+    int n;
+    
+    n = ParseHeader();
+    if ( n <=0 )
+    {
+      return false;
+    }
+    for ( cur_track=0; cur_track<n; cur_track++ )
+    {
+      ReadTrack ( cur_track );
+      if ( abort_parse )
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+  
+  int MIDIFileReadMemory::ParseHeader()
+  {
+    if ( !header_done )
+    {
+      header_done = true;
+      
+      if ( ReadHeader() <=0 )
+      {
+        mf_error ( "No Tracks" );
+      }
+    }
+    
+    return abort_parse ? 0 : header_ntrks;
+  }
+  
+  bool MIDIFileReadMemory::ParseTrack ( int trk )
+  {
+    if ( ParseHeader() <=0 )
+    {
+      return false;
+    }
+    
+    cur_track = trk;
+    ReadTrack ( cur_track );
+    
+    return !abort_parse;
+  }
+  
+  bool MIDIFileReadMemory::GetTrackChunk ( int trk, unsigned long *offset, unsigned long *length )
+  {
+    if ( ParseHeader() <=0 || trk<0 || trk >= ( int ) track_chunks.size() )
+    {
+      return false;
+    }
+    
+    *offset = ( unsigned long ) ( track_chunks[trk].begin - data );
+    *length = ( unsigned long ) ( track_chunks[trk].end - track_chunks[trk].begin );
+    
+    return true;
+  }
+  
+  bool MIDIFileReadMemory::ParseTrackChunk ( int trk, unsigned long offset, unsigned long length )
+  {
+    if ( offset > size || length > size-offset )
+    {
+      mf_error ( "Unexpected Stream Error" );
+      return false;
+    }
+    
+    cur_track = trk;
+    ReadTrackChunk ( cur_track, data+offset, data+offset+length );
+    
+    return !abort_parse;
+  }
+  
+  int MIDIFileReadMemory::ReadHeader()
+  {
+    if ( size < 14 )
+    {
+      mf_error ( "Error looking for chunk type" );
+      return 0;
+    }
+    
+    const unsigned char *p = data;
+    const unsigned char *end = data + size;
+    
+    // skip any leading junk, just like MIDIFileRead does
+    
+    while ( p+4 <= end && OSTYPE ( p[0], p[1], p[2], p[3] ) !=_MThd )
+      ++p;
+      
+    if ( p+14 > end )
+    {
+      mf_error ( "Error looking for chunk type" );
+      return 0;
+    }
+    
+    unsigned long header_len = To32Bit ( p[4], p[5], p[6], p[7] );
+    
+    header_format = To16Bit ( p[8], p[9] );
+    header_ntrks = To16Bit ( p[10], p[11] );
+    header_division = To16Bit ( p[12], p[13] );
+    
+    event_handler->mf_header ( header_format, header_ntrks, header_division );
+    
+    if ( header_len > ( unsigned long ) ( end - ( p+8 ) ) )
+    {
+      mf_error ( "Unexpected Stream Error" );
+      return 0;
+    }
+    
+    p += 8 + header_len;
+    
+    // collect the track chunks. The lengths are known upfront, so we can
+    // find them all without decoding any. Chunks of unknown types are skipped.
+    
+    track_chunks.clear();
+    track_chunks.reserve ( header_ntrks );
+    
+    while ( p+8 <= end && ( int ) track_chunks.size() < header_ntrks )
+    {
+      unsigned long type = OSTYPE ( p[0], p[1], p[2], p[3] );
+      unsigned long len = To32Bit ( p[4], p[5], p[6], p[7] );
+      
+      p += 8;
+      
+      // a truncated last chunk is decoded as far as it goes
+      
+      const unsigned char *chunk_end = ( len > ( unsigned long ) ( end-p ) ) ? end : p+len;
+      
+      if ( type==_MTrk )
+      {
+        TrackChunk chunk = { p, chunk_end };
+        track_chunks.push_back ( chunk );
+      }
+      
+      p = chunk_end;
+    }
+    
+    return header_ntrks;
+  }
+  
+//
+// read a track chunk
+//
+
+  void MIDIFileReadMemory::ReadTrack ( int trk )
+  {
+    if ( trk >= ( int ) track_chunks.size() )
+    {
+      mf_error ( "Error looking for chunk type" );
+      return;
+    }
+    
+    ReadTrackChunk ( trk, track_chunks[trk].begin, track_chunks[trk].end );
+  }
+  
+  void MIDIFileReadMemory::ReadTrackChunk ( int trk, const unsigned char *begin, const unsigned char *end )
+  {
+    //
+    // This array is indexed by the high half of a status byte.  Its
+    // value is either the number of bytes needed (1 or 2) for a channel
+    // message, or 0 (meaning it's not  a channel message).
+    //
+    
+    static const char chantype[] =
+    {
+      0, 0, 0, 0, 0, 0, 0, 0,         // 0x00 through 0x70
+      2, 2, 2, 2, 1, 1, 2, 0          // 0x80 through 0xf0
+    };
+    
+    unsigned long lng;
+    int c, c1, type;
+    int sysexcontinue=0; // 1 if last message was unfinished sysex
+    int running=0;       // 1 when running status used
+    int status=0;                // (possible running) status byte
+    int needed;
+    
+    cur = begin;
+    cur_end = end;
+    cur_time=MIDITickMS::zero();
+    
+    event_handler->mf_starttrack ( trk );
+    
+    while ( cur < cur_end && !abort_parse )
+    {
+      MIDITickMS deltat = MIDITickMS ( ReadVariableNum() );
+      
+      event_handler->UpdateTime ( deltat );
+      
+      cur_time += deltat;
+      
+      c=EGetC();
+      
+      if ( c==-1 )
+        break;
+        
+      if ( sysexcontinue && c!=0xf7 )
+        mf_error ( "Error after expected continuation of SysEx" );
+        
+      if ( ( c&0x80 ) ==0 )
+      {
+        if ( status==0 )
+          mf_error ( "Unexpected Running Status" );
+        running=1;
+        needed = chantype[ ( status>>4 ) & 0xf ];
+      }
+      else
+      {
+        status=c;
+        running=0;
+        needed = chantype[ ( status>>4 ) & 0xf ];
+      }
+      
+      if ( needed )           // ie. is it a channel message?
+      {
+        if ( running )
+          c1=c;
+        else
+          c1=EGetC();
+        FormChanMessage ( ( unsigned char ) status, ( unsigned char ) c1, ( unsigned char ) ( ( needed>1 ) ? EGetC() : 0 ) );
+        continue;
+      }
+      
+      switch ( c )
+      {
+        case 0xff:              // meta-event
+          type=EGetC();
+          lng = ReadVariableNum();
+          
+          if ( lng > ( unsigned long ) ( cur_end-cur ) )
+          {
+            mf_error ( "Unexpected End Of Track" );
+            break;
+          }
+          
+          MsgInit();
+          while ( lng-- > 0 )
+            MsgAdd ( *cur++ );
+            
+          event_handler->MetaEvent ( cur_time, type, msg_index, the_msg );
+          break;
+          
+        case 0xf0:              // start of sys-ex
+          lng = ReadVariableNum();
+          
+          if ( lng > ( unsigned long ) ( cur_end-cur ) )
+          {
+            mf_error ( "Unexpected End Of Track" );
+            break;
+          }
+          
+          MsgInit();
+          MsgAdd ( 0xf0 );
+          
+          while ( lng-- > 0 )
+            MsgAdd ( c=*cur++ );
+            
+          if ( c==0xf7 || no_merge==0 )
+          {
+            // make a sysex object out of the raw sysex data
+            // the buffer is not to be deleted upon destruction of ex
+            
+            MIDISystemExclusive ex (
+              the_msg,
+              msg_index,
+              msg_index,
+              false
+            );
+            
+            // give the sysex object to our event handler
+            
+            event_handler->mf_sysex ( cur_time, ex );
+          }
+          else
+            sysexcontinue=1; // merge into next msg
+          break;
+          
+        case 0xf7:              // sysex continuation or
+          // arbitary stuff
+          lng=ReadVariableNum();
+          
+          if ( lng > ( unsigned long ) ( cur_end-cur ) )
+          {
+            mf_error ( "Unexpected End Of Track" );
+            break;
+          }
+          
+          if ( ! sysexcontinue )
+            MsgInit();
+            
+          while ( lng-- > 0 )
+            MsgAdd ( c=*cur++ );
+            
+          if ( !sysexcontinue )
+          {
+            event_handler->mf_arbitrary ( cur_time, msg_index, the_msg );
+          }
+          else if ( c== 0xf7 )
+          {
+            // make a sysex object out of the raw sysex data
+            // the buffer is not to be deleted upon destruction of ex
+            
+            MIDISystemExclusive ex (
+              the_msg,
+              msg_index,
+              msg_index,
+              false
+            );
+            event_handler->mf_sysex ( cur_time, ex );
+            sysexcontinue=0;
+          }
+          break;
+          
+        default:
+          mf_error ( "Unexpected Byte" );
+          break;
+      }
+    }
+    
+    event_handler->mf_endtrack ( trk );
+  }
+  
+  unsigned long MIDIFileReadMemory::ReadVariableNum()
+  {
+    unsigned long value=0;
+    int c;
+    
+    do
+    {
+      c=EGetC();
+      if ( c==-1 )
+      {
+        return 0;
+      }
+      value = ( value<<7 ) + ( c&0x7f );
+    }
+    while ( c&0x80 );
+    
+    return value;
+  }
+  
+  void MIDIFileReadMemory::FormChanMessage ( unsigned char st, unsigned char b1, unsigned char b2 )
+  {
+    MIDITimedMessage m;
+    
+    m.SetStatus ( st );
+    m.SetByte1 ( b1 );
+    m.SetByte2 ( b2 );
+    m.SetTime ( cur_time );
+    
+    if ( st>=0x80 && st<0xf0 )
+    {
+      event_handler->ChanMessage ( m );
+    }
+    
+  }
+  
+  
+}
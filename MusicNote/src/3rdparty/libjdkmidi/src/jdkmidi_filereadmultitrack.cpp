@@ -220,6 +220,17 @@ namespace jdkmidi
   }
   
   
+  void    MIDIFileReadMultiTrack::mf_outputcable ( MIDITickMS time, int cable )
+  {
+    MIDITimedMessage msg;
+    
+    msg.SetOutputCable ( ( unsigned char ) cable );
+    msg.SetTime ( time );
+    
+    AddEventToMultiTrack ( msg, 0, cur_track );
+  }
+  
+  
   void    MIDIFileReadMultiTrack::mf_sqspecific ( MIDITickMS time, int, unsigned char * )
   {
     // ignore any sequencer specific messages
@@ -0,0 +1,207 @@
+/*
+ *  libjdkmidi-2004 C++ Class Library for MIDI
+ *
+ *  This file was added to this copy of libjdkmidi. It is not part of the
+ *  upstream libjdkmidi-2004 release by J.D. Koftinoff Software, Ltd.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "jdkmidi/world.h"
+
+#include "jdkmidi/filereadparallel.h"
+
+#include <thread>
+
+namespace jdkmidi
+{
+
+
+  MIDIFileReadParallel::MIDIFileReadParallel (
+    const unsigned char *data_,
+    unsigned long size_,
+    MIDIMultiTrack *multitrack_,
+    int max_threads_
+  )
+      :
+      data ( data_ ),
+      size ( size_ ),
+      multitrack ( multitrack_ ),
+      max_threads ( max_threads_ ),
+      header_format ( 0 ),
+      header_ntrks ( 0 ),
+      header_division ( 0 ),
+      next_chunk ( 0 ),
+      failed ( false )
+  {
+    if ( max_threads<=0 )
+    {
+      max_threads = ( int ) std::thread::hardware_concurrency();
+      
+      if ( max_threads<=0 )
+        max_threads=1;
+    }
+  }
+  
+  MIDIFileReadParallel::~MIDIFileReadParallel()
+  {
+  }
+  
+  bool MIDIFileReadParallel::Parse()
+  {
+    // the header goes to the multitrack itself, as with the sequential loader.
+    // This is the only pass over the header: the decoding threads get the
+    // places of their chunks from it.
+    
+    MIDIFileReadMultiTrack header_loader ( multitrack );
+    MIDIFileReadMemory header_reader ( data, size, &header_loader );
+    
+    int n = header_reader.ParseHeader();
+    
+    header_format = header_reader.GetFormat();
+    header_ntrks = header_reader.GetNumberTracks();
+    header_division = header_reader.GetDivision();
+    
+    if ( n<=0 )
+    {
+      return false;
+    }
+    
+    staging_chunks.resize ( n );
+    
+    for ( int i=0; i<n; ++i )
+    {
+      StagingChunk &chunk = staging_chunks[i];
+      
+      chunk.tracks = CreateStagingTracks ( i );
+      chunk.found = header_reader.GetTrackChunk ( i, &chunk.offset, &chunk.length );
+      chunk.ok = false;
+    }
+    
+    next_chunk = 0;
+    failed = false;
+    
+    int num_threads = ( max_threads < n ) ? max_threads : n;
+    
+    std::vector<std::thread> threads;
+    
+    for ( int i=1; i<num_threads; ++i )
+      threads.push_back ( std::thread ( &MIDIFileReadParallel::DecodeChunks, this ) );
+      
+    DecodeChunks(); // this thread takes its share too
+    
+    for ( size_t i=0; i<threads.size(); ++i )
+      threads[i].join();
+      
+    // the sequential loader stops at the first chunk that fails, keeping
+    // whatever that chunk decoded till the error
+    
+    bool ok = true;
+    
+    for ( int i=0; i<n; ++i )
+    {
+      if ( ok )
+      {
+        MergeStagingTracks ( staging_chunks[i].tracks );
+        ok = staging_chunks[i].ok;
+      }
+      
+      for ( int t=0; t<staging_chunks[i].tracks->GetNumTracks(); ++t )
+        delete staging_chunks[i].tracks->GetTrack ( t );
+        
+      delete staging_chunks[i].tracks;
+    }
+    
+    staging_chunks.clear();
+    
+    return ok;
+  }
+  
+  void MIDIFileReadParallel::DecodeChunks()
+  {
+    int n = ( int ) staging_chunks.size();
+    
+    // The chunks are handed out in order, so when one fails all the chunks
+    // before it have been handed out already and the merge needs no more
+    
+    for ( int i=next_chunk++; i<n && !failed; i=next_chunk++ )
+    {
+      StagingChunk &chunk = staging_chunks[i];
+      
+      if ( chunk.found )
+      {
+        MIDIFileReadMultiTrack track_loader ( chunk.tracks );
+        track_loader.mf_header ( header_format, header_ntrks, header_division );
+        
+        MIDIFileReadMemory reader ( data, size, &track_loader );
+        chunk.ok = reader.ParseTrackChunk ( i, chunk.offset, chunk.length );
+      }
+      
+      if ( !chunk.ok )
+        failed = true;
+    }
+  }
+  
+  MIDIMultiTrack *MIDIFileReadParallel::CreateStagingTracks ( int trk )
+  {
+    // The staging tracks are not deletable; only the tracks this chunk can
+    // write to get allocated (a MIDITrack is not small, and files with many
+    // tracks are common). MIDIFileReadMultiTrack puts the events of a chunk
+    // on its own track, except that the channel messages of the first chunk,
+    // and of all the chunks in format 0, go to the track of their channel+1.
+    
+    int num_tracks = multitrack->GetNumTracks();
+    
+    MIDIMultiTrack *staging = new MIDIMultiTrack ( num_tracks, false );
+    
+    if ( trk<num_tracks && multitrack->GetTrack ( trk ) )
+      staging->SetTrack ( trk, new MIDITrack );
+      
+    if ( header_format==0 || trk==0 )
+    {
+      for ( int t=1; t<=16 && t<num_tracks; ++t )
+      {
+        if ( !staging->GetTrack ( t ) && multitrack->GetTrack ( t ) )
+          staging->SetTrack ( t, new MIDITrack );
+      }
+    }
+    
+    return staging;
+  }
+  
+  void MIDIFileReadParallel::MergeStagingTracks ( MIDIMultiTrack *staging )
+  {
+    for ( int t=0; t<staging->GetNumTracks(); ++t )
+    {
+      MIDITrack *src = staging->GetTrack ( t );
+      MIDITrack *dest = multitrack->GetTrack ( t );
+      
+      if ( !src || !dest || src->GetNumEvents()==0 )
+        continue;
+        
+      if ( dest->GetNumEvents()==0 )
+      {
+        dest->Swap ( *src ); // the common case - no copying
+      }
+      else
+      {
+        for ( int i=0; i<src->GetNumEvents(); ++i )
+          dest->PutEvent ( *src->GetEvent ( i ) );
+      }
+    }
+  }
+  
+  
+}
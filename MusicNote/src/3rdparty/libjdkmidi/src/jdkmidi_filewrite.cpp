@@ -84,6 +84,52 @@ namespace jdkmidi
   }
   
   
+  MIDIFileWriteStreamMemory::MIDIFileWriteStreamMemory ( std::vector<unsigned char> &buf_ )
+      : buf ( buf_ ), cur_pos ( 0 )
+  {
+    buf.clear();
+  }
+  
+  MIDIFileWriteStreamMemory::~MIDIFileWriteStreamMemory()
+  {
+  }
+  
+  long MIDIFileWriteStreamMemory::Seek ( long pos, int whence )
+  {
+    long base=0;
+    
+    if ( whence==SEEK_CUR )
+      base= ( long ) cur_pos;
+    else if ( whence==SEEK_END )
+      base= ( long ) buf.size();
+      
+    if ( base+pos < 0 )
+    {
+      return -1;
+    }
+    
+    // like a file, seeking past the end leaves a gap that the next write fills with zeros
+    cur_pos= ( unsigned long ) ( base+pos );
+    return 0;
+  }
+  
+  int MIDIFileWriteStreamMemory::WriteChar ( int c )
+  {
+    if ( cur_pos < buf.size() )
+    {
+      buf[cur_pos]= ( unsigned char ) c;
+    }
+    else
+    {
+      buf.resize ( cur_pos );
+      buf.push_back ( ( unsigned char ) c );
+    }
+    
+    ++cur_pos;
+    return 0;
+  }
+  
+  
   MIDIFileWrite::MIDIFileWrite ( MIDIFileWriteStream *out_stream_ )
       : out_stream ( out_stream_ )
   {
@@ -249,6 +295,11 @@ namespace jdkmidi
         WriteKeySignature ( m.GetTime(), m.GetKeySigSharpFlats(), m.GetKeySigMajorMinor() );
         return;
       }
+      if ( m.IsOutputCable() )
+      {
+        WriteOutputCable ( m.GetTime(), m.GetOutputCable() );
+        return;
+      }
       return; // all other marks are ignored.
     }
     else
@@ -318,6 +369,10 @@ namespace jdkmidi
         {
           WriteTimeSignature ( m.GetTime(), m.GetTimeSigNumerator(), m.GetTimeSigDenominator() );
         }
+        else if ( m.IsOutputCable() )
+        {
+          WriteOutputCable ( m.GetTime(), m.GetOutputCable() );
+        }
       }
       
     }
@@ -446,6 +501,19 @@ namespace jdkmidi
     running_status=0;
   }
   
+  void MIDIFileWrite::WriteOutputCable ( MIDITickMS time, unsigned char cable )
+  {
+    ENTER ( "void MIDIFileWrite::WriteOutputCable()" );
+    
+    WriteDeltaTime ( time );
+    WriteCharacter ( ( unsigned char ) 0xff );  // Meta-Event
+    WriteCharacter ( ( unsigned char ) 0x21 );  // MIDI port
+    WriteCharacter ( ( unsigned char ) 0x01 );  // length of event
+    WriteCharacter ( cable );
+    IncrementCounters ( 4 );
+    running_status=0;
+  }
+  
   void MIDIFileWrite::WriteTimeSignature (
     MIDITickMS time,
     char numerator,
@@ -38,6 +38,7 @@ namespace jdkmidi
       sequencer ( seq_ ),
       sys_time_offset ( MIDITickMS::zero() ),
       seq_time_offset ( MIDITickMS::zero() ),
+      seq_horizon ( MIDITickMS::max() ),
       play_mode ( false ),
       stop_mode ( true ),
       notifier ( n ),
@@ -113,6 +114,26 @@ namespace jdkmidi
     return seq_time_offset;
   }
   
+// to set and get the sequencer horizon
+  void MIDIManager::SetSeqHorizon(MIDITickMS horizon)
+  {
+    seq_horizon = horizon;
+  }
+  
+  MIDITickMS MIDIManager::GetSeqHorizon() const
+  {
+    return seq_horizon;
+  }
+  
+  bool MIDIManager::IsHeldAtHorizon()
+  {
+    MIDITickMS next_event_clk;
+    
+    return seq_horizon != MIDITickMS::max()
+           && sequencer->GetNextEventTime ( &next_event_clk )
+           && next_event_clk >= seq_horizon;
+  }
+  
 // to manage the playback of the sequencer
   void MIDIManager::SeqPlay()
   {
@@ -238,14 +259,16 @@ namespace jdkmidi
       && ( next_event_time-seq_time_offset ) <=sys_time_Diff
       && driver->CanOutputMessage()
       && ( --output_count ) >0
+      && !IsHeldAtHorizon()
     )
     {
       // found an event! get it!
       
       if ( sequencer->GetNextEvent ( &ev_track, &ev ) )
       {
-        // ok, tell the driver the send this message now
+        // ok, tell the driver the send this message now, on the port of its track
         
+        ev.SetOutPort ( ( unsigned char ) sequencer->GetTrackState ( ev_track )->port );
         driver->OutputMessage ( ev );
       }
     }
@@ -253,7 +276,31 @@ namespace jdkmidi
     
     
     
-    // auto stop at end of sequence
+    // if the next event is due but held back at the horizon, pause the
+    // playback clock at that event, so that it resumes from there on time
+    
+    if ( IsHeldAtHorizon()
+         && sequencer->GetNextEventTimeMs ( &next_event_time )
+         && ( next_event_time-seq_time_offset ) <sys_time_Diff
+       )
+    {
+      sys_time_offset = currentSysTime - ( next_event_time-seq_time_offset );
+      return true;
+    }
+    
+    // auto stop at end of sequence, unless more events are yet to come
+    
+    if ( seq_horizon != MIDITickMS::max() )
+    {
+      // ran out of events to play - hold the clock at the last one played
+      
+      if ( !sequencer->GetNextEventTimeMs ( &next_event_time ) )
+      {
+        sys_time_offset = currentSysTime - ( sequencer->GetCurrentTimeInMs()-seq_time_offset );
+      }
+      
+      return true;
+    }
     
     if ( !sequencer->GetNextEventTimeMs ( &next_event_time ) )
     {
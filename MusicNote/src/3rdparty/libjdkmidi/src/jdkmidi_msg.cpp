@@ -198,6 +198,7 @@ namespace jdkmidi
     byte1=0;
     byte2=0;
     byte3=0;
+    port=0;
   }
   
   
@@ -207,6 +208,7 @@ namespace jdkmidi
     byte1=m.byte1;
     byte2=m.byte2;
     byte3=m.byte3;
+    port=m.port;
   }
   
   
@@ -216,6 +218,7 @@ namespace jdkmidi
     byte1=0;
     byte2=0;
     byte3=0;
+    port=0;
   }
   
   
@@ -225,6 +228,7 @@ namespace jdkmidi
     byte1=m.byte1;
     byte2=m.byte2;
     byte3=m.byte3;
+    port=m.port;
   }
   
   
@@ -239,6 +243,7 @@ namespace jdkmidi
     byte1=m.byte1;
     byte2=m.byte2;
     byte3=m.byte3;
+    port=m.port;
     return *this;
   }
   
@@ -440,6 +445,17 @@ namespace jdkmidi
            && ( byte1==META_BEAT_MARKER );
   }
   
+  bool  MIDIMessage::IsOutputCable() const
+  {
+    return ( status==META_EVENT )
+           && ( byte1==META_OUTPUT_CABLE );
+  }
+  
+  unsigned char MIDIMessage::GetOutputCable() const
+  {
+    return byte2;
+  }
+  
   
   
   unsigned short MIDIMessage::GetTempo32() const
@@ -677,6 +693,11 @@ namespace jdkmidi
     SetMetaEvent ( META_BEAT_MARKER,0,0 );
   }
   
+  void  MIDIMessage::SetOutputCable ( unsigned char cable )
+  {
+    SetMetaEvent ( META_OUTPUT_CABLE,cable,0 );
+  }
+  
   
   
   MIDIBigMessage::MIDIBigMessage()
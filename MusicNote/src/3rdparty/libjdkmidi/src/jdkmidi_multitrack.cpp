@@ -124,6 +124,7 @@ namespace jdkmidi
     
     next_event_number = new int [num_tracks];
     next_event_time = new MIDITickMS [num_tracks];
+    end_event_number = new int [num_tracks];
     
     Reset();
     
@@ -135,12 +136,14 @@ namespace jdkmidi
     cur_event_track = m.cur_event_track;
     next_event_number = new int [num_tracks];
     next_event_time = new MIDITickMS [num_tracks];
+    end_event_number = new int [num_tracks];
     cur_time = m.cur_time;
     
     for ( int i=0; i<num_tracks; ++i )
     {
       next_event_number[i] = m.next_event_number[i];
       next_event_time[i] = m.next_event_time[i];
+      end_event_number[i] = m.end_event_number[i];
     }
     
   }
@@ -149,6 +152,7 @@ namespace jdkmidi
   {
     delete [] next_event_number;
     delete [] next_event_time;
+    delete [] end_event_number;
   }
   
   const MIDIMultiTrackIteratorState & MIDIMultiTrackIteratorState::operator = ( const MIDIMultiTrackIteratorState &m )
@@ -157,10 +161,12 @@ namespace jdkmidi
     {
       delete [] next_event_number;
       delete [] next_event_time;
+      delete [] end_event_number;
       
       num_tracks = m.num_tracks;
       next_event_number = new int [num_tracks];
       next_event_time = new MIDITickMS [num_tracks];
+      end_event_number = new int [num_tracks];
     }
     
     cur_time = m.cur_time;
@@ -170,6 +176,7 @@ namespace jdkmidi
     {
       next_event_number[i] = m.next_event_number[i];
       next_event_time[i] = m.next_event_time[i];
+      end_event_number[i] = m.end_event_number[i];
     }
     
     return *this;
@@ -183,6 +190,7 @@ namespace jdkmidi
     {
       next_event_number[i] = 0;
       next_event_time[i] = MIDITickMS::max();
+      end_event_number[i] = 0;
     }
   }
   
@@ -251,6 +259,7 @@ namespace jdkmidi
       // to signify end of track
       
       state.next_event_number[ i ] = -1;
+      state.end_event_number[ i ] = 0;
       
       // are there any events in this track?
       if ( track && track->GetNumEvents() >0 )
@@ -404,7 +413,8 @@ namespace jdkmidi
     // are we at end of track?
     if ( *event_num >= track->GetNumEvents() )
     {
-      // yes, set *event_num to -1
+      // yes, remember where we stopped and set *event_num to -1
+      state.end_event_number[ track_num ] = *event_num;
       *event_num=-1;
       return false; // at end of track
     }
@@ -423,6 +433,41 @@ namespace jdkmidi
     return true;
   }
   
+  bool MIDIMultiTrackIterator::Resume()
+  {
+    bool resumed = false;
+    
+    for ( int i=0; i<multitrack->GetNumTracks(); ++i )
+    {
+      MIDITrack *track = multitrack->GetTrack ( i );
+      
+      // only the tracks that hit their end can have new events for us
+      
+      if ( state.next_event_number[i] >= 0 || !track )
+      {
+        continue;
+      }
+      
+      int num = state.end_event_number[i];
+      
+      if ( num < track->GetNumEvents() )
+      {
+        state.next_event_number[i] = num;
+        state.next_event_time[i] = track->GetEventAddress ( num )->GetTime();
+        resumed = true;
+      }
+    }
+    
+    // the earliest event may now be on a resumed track
+    
+    if ( resumed )
+    {
+      state.FindTrackOfFirstEvent();
+    }
+    
+    return resumed;
+  }
+  
   
   
   
@@ -0,0 +1,356 @@
+/*
+ *  libjdkmidi-2004 C++ Class Library for MIDI
+ *
+ *  This file was added to this copy of libjdkmidi. It is not part of the
+ *  upstream libjdkmidi-2004 release by J.D. Koftinoff Software, Ltd.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "jdkmidi/world.h"
+
+#include "jdkmidi/multitrackcache.h"
+#include "jdkmidi/sequencer.h"
+
+#include <vector>
+
+namespace jdkmidi
+{
+  static const char cache_magic[4] = { 'J', 'M', 'T', 'C' };
+  static const uint32_t cache_byte_order = 0x01020304;
+  
+  
+  MIDIMultiTrackCache::MIDIMultiTrackCache ( const char *fname )
+      :
+      map ( fname ),
+      header ( 0 ),
+      track_table ( 0 ),
+      tempo_map ( 0 ),
+      measure_index ( 0 ),
+      sysex_area ( 0 )
+  {
+    if ( map.IsValid() && !Validate() )
+    {
+      header=0;
+    }
+  }
+  
+  MIDIMultiTrackCache::~MIDIMultiTrackCache()
+  {
+  }
+  
+  bool MIDIMultiTrackCache::Validate()
+  {
+    const unsigned char *data = map.GetData();
+    unsigned long long size = map.GetSize();
+    
+    if ( size < sizeof ( FileHeader ) )
+      return false;
+      
+    const FileHeader *h = ( const FileHeader * ) data;
+    
+    if ( memcmp ( h->magic, cache_magic, sizeof ( cache_magic ) ) !=0
+         || h->version!=VERSION
+         || h->byte_order!=cache_byte_order )
+    {
+      return false;
+    }
+    
+    // the tables follow the header, each one 4 byte aligned
+    
+    unsigned long long pos = sizeof ( FileHeader );
+    unsigned long long tracks_pos = pos;
+    pos += ( unsigned long long ) h->num_tracks * sizeof ( TrackEntry );
+    unsigned long long tempo_pos = pos;
+    pos += ( unsigned long long ) h->num_tempo_changes * sizeof ( TempoEntry );
+    unsigned long long measure_pos = pos;
+    pos += ( unsigned long long ) h->num_measures * sizeof ( MeasureEntry );
+    unsigned long long sysex_pos = pos;
+    pos += h->sysex_size;
+    
+    if ( pos > size )
+      return false;
+      
+    const TrackEntry *tracks = ( const TrackEntry * ) ( data + tracks_pos );
+    
+    for ( uint32_t i=0; i<h->num_tracks; ++i )
+    {
+      unsigned long long end = tracks[i].offset
+                               + ( unsigned long long ) tracks[i].num_events * sizeof ( EventRecord );
+                               
+      if ( tracks[i].offset < pos || ( tracks[i].offset & 3 ) !=0 || end > size )
+        return false;
+    }
+    
+    header = h;
+    track_table = tracks;
+    tempo_map = ( const TempoEntry * ) ( data + tempo_pos );
+    measure_index = ( const MeasureEntry * ) ( data + measure_pos );
+    sysex_area = data + sysex_pos;
+    
+    return true;
+  }
+  
+  int MIDIMultiTrackCache::GetNumTracks() const
+  {
+    return header ? ( int ) header->num_tracks : 0;
+  }
+  
+  int MIDIMultiTrackCache::GetClksPerBeat() const
+  {
+    return header ? ( int ) header->clks_per_beat : 0;
+  }
+  
+  int MIDIMultiTrackCache::GetNumEvents ( int trk ) const
+  {
+    if ( trk<0 || trk>=GetNumTracks() )
+      return 0;
+      
+    return ( int ) track_table[trk].num_events;
+  }
+  
+  int MIDIMultiTrackCache::GetNumTempoChanges() const
+  {
+    return header ? ( int ) header->num_tempo_changes : 0;
+  }
+  
+  int MIDIMultiTrackCache::GetNumMeasures() const
+  {
+    return header ? ( int ) header->num_measures : 0;
+  }
+  
+  int MIDIMultiTrackCache::FindMeasure ( MIDITickMS time_ms ) const
+  {
+    // the last measure starting at or before the time
+    
+    int lo=0;
+    int hi=GetNumMeasures();
+    
+    while ( lo<hi )
+    {
+      int mid = lo + ( hi-lo ) /2;
+      
+      if ( ( long long ) measure_index[mid].time_ms <= time_ms.count() )
+        lo=mid+1;
+      else
+        hi=mid;
+    }
+    
+    return lo>0 ? lo-1 : 0;
+  }
+  
+  bool MIDIMultiTrackCache::Load ( MIDIMultiTrack *multitrack ) const
+  {
+    if ( !IsValid() )
+      return false;
+      
+    multitrack->Clear();
+    multitrack->SetClksPerBeat ( ( int ) header->clks_per_beat );
+    
+    int num_tracks = GetNumTracks();
+    
+    if ( num_tracks > multitrack->GetNumTracks() )
+      num_tracks = multitrack->GetNumTracks();
+      
+    MIDITimedBigMessage msg;
+    
+    for ( int trk=0; trk<num_tracks; ++trk )
+    {
+      MIDITrack *t = multitrack->GetTrack ( trk );
+      
+      const EventRecord *rec = ( const EventRecord * ) ( map.GetData() + track_table[trk].offset );
+      const EventRecord *rec_end = rec + track_table[trk].num_events;
+      
+      for ( ; rec!=rec_end; ++rec )
+      {
+        msg.SetTime ( MIDITickMS ( rec->time ) );
+        msg.SetStatus ( rec->status );
+        msg.SetByte1 ( rec->byte1 );
+        msg.SetByte2 ( rec->byte2 );
+        msg.SetByte3 ( rec->byte3 );
+        
+        if ( rec->sysex )
+        {
+          uint32_t sysex_offset = rec->sysex - 1;
+          uint32_t sysex_len = 0;
+          
+          if ( sysex_offset + sizeof ( uint32_t ) > header->sysex_size )
+            return false;
+            
+          memcpy ( &sysex_len, sysex_area + sysex_offset, sizeof ( uint32_t ) );
+          
+          if ( sysex_len > header->sysex_size - sysex_offset - sizeof ( uint32_t ) )
+            return false;
+            
+          // refer to the mapped bytes; CopySysEx() takes its own copy
+          MIDISystemExclusive sysex (
+            ( unsigned char * ) ( sysex_area + sysex_offset + sizeof ( uint32_t ) ),
+            ( int ) sysex_len,
+            ( int ) sysex_len,
+            false
+          );
+          msg.CopySysEx ( &sysex );
+        }
+        else if ( msg.GetSysEx() )
+        {
+          msg.CopySysEx ( 0 );
+        }
+        
+        // the records are in the track order already - no need to look for the place
+        if ( !t->AppendEvent ( msg ) )
+          return false;
+      }
+    }
+    
+    return true;
+  }
+  
+  bool MIDIMultiTrackCache::Write ( MIDIMultiTrack *multitrack, const char *fname )
+  {
+    // play the tracks through a sequencer to find the tempo changes and the measures
+    
+    std::vector<TempoEntry> tempo_changes;
+    std::vector<MeasureEntry> measures;
+    
+    {
+      MIDISequencer seq ( multitrack );
+      seq.GoToZero();
+      
+      MeasureEntry first = { 0, 0 };
+      measures.push_back ( first );
+      
+      int trk;
+      MIDITimedBigMessage ev;
+      
+      while ( seq.GetNextEvent ( &trk, &ev ) )
+      {
+        const MIDISequencerState *state = seq.GetState();
+        
+        if ( ev.IsTempo() )
+        {
+          TempoEntry e = { ( uint32_t ) state->cur_clock.count(), ( uint32_t ) state->cur_time_ms.count(), ev.GetTempo32(), 0 };
+          tempo_changes.push_back ( e );
+        }
+        
+        if ( state->cur_measure >= ( int ) measures.size() )
+        {
+          MeasureEntry e = { ( uint32_t ) state->cur_clock.count(), ( uint32_t ) state->cur_time_ms.count() };
+          measures.push_back ( e );
+        }
+      }
+    }
+    
+    int num_tracks = multitrack->GetNumTracks();
+    
+    FileHeader h;
+    memset ( &h, 0, sizeof ( h ) );
+    memcpy ( h.magic, cache_magic, sizeof ( cache_magic ) );
+    h.version = VERSION;
+    h.byte_order = cache_byte_order;
+    h.clks_per_beat = ( uint32_t ) multitrack->GetClksPerBeat();
+    h.num_tracks = ( uint32_t ) num_tracks;
+    h.num_tempo_changes = ( uint32_t ) tempo_changes.size();
+    h.num_measures = ( uint32_t ) measures.size();
+    
+    // gather the sysex data; each one is its length followed by the bytes, 4 byte aligned
+    
+    std::vector<unsigned char> sysex_data;
+    std::vector<TrackEntry> tracks ( num_tracks );
+    std::vector<EventRecord> records;
+    
+    for ( int trk=0; trk<num_tracks; ++trk )
+    {
+      const MIDITrack *t = multitrack->GetTrack ( trk );
+      
+      tracks[trk].offset = ( uint32_t ) records.size(); // event index for now, file offset below
+      tracks[trk].num_events = ( uint32_t ) t->GetNumEvents();
+      
+      for ( int i=0; i<t->GetNumEvents(); ++i )
+      {
+        const MIDITimedBigMessage *ev = t->GetEventAddress ( i );
+        
+        if ( ev->GetTime().count() < 0 || ev->GetTime().count() > 0xffffffffLL )
+          return false;
+          
+        EventRecord rec;
+        rec.time = ( uint32_t ) ev->GetTime().count();
+        rec.status = ev->GetStatus();
+        rec.byte1 = ev->GetByte1();
+        rec.byte2 = ev->GetByte2();
+        rec.byte3 = ev->GetByte3();
+        rec.sysex = 0;
+        
+        const MIDISystemExclusive *sysex = ev->GetSysEx();
+        
+        if ( sysex )
+        {
+          rec.sysex = ( uint32_t ) sysex_data.size() + 1;
+          
+          uint32_t len = ( uint32_t ) sysex->GetLength();
+          const unsigned char *len_bytes = ( const unsigned char * ) &len;
+          sysex_data.insert ( sysex_data.end(), len_bytes, len_bytes + sizeof ( len ) );
+          sysex_data.insert ( sysex_data.end(), sysex->GetBuf(), sysex->GetBuf() + len );
+          sysex_data.resize ( ( sysex_data.size() + 3 ) & ~ ( size_t ) 3 );
+        }
+        
+        records.push_back ( rec );
+      }
+    }
+    
+    h.sysex_size = ( uint32_t ) sysex_data.size();
+    
+    unsigned long long records_pos = sizeof ( FileHeader )
+                                     + tracks.size() * sizeof ( TrackEntry )
+                                     + tempo_changes.size() * sizeof ( TempoEntry )
+                                     + measures.size() * sizeof ( MeasureEntry )
+                                     + sysex_data.size();
+                                     
+    if ( records_pos + records.size() * sizeof ( EventRecord ) > 0xffffffffULL )
+      return false;
+      
+    for ( int trk=0; trk<num_tracks; ++trk )
+    {
+      tracks[trk].offset = ( uint32_t ) ( records_pos + tracks[trk].offset * sizeof ( EventRecord ) );
+    }
+    
+    FILE *f = fopen ( fname, "wb" );
+    
+    if ( !f )
+      return false;
+      
+    bool ok = fwrite ( &h, sizeof ( h ), 1, f ) == 1;
+    
+    if ( ok && !tracks.empty() )
+      ok = fwrite ( &tracks[0], sizeof ( TrackEntry ), tracks.size(), f ) == tracks.size();
+      
+    if ( ok && !tempo_changes.empty() )
+      ok = fwrite ( &tempo_changes[0], sizeof ( TempoEntry ), tempo_changes.size(), f ) == tempo_changes.size();
+      
+    if ( ok )
+      ok = fwrite ( &measures[0], sizeof ( MeasureEntry ), measures.size(), f ) == measures.size();
+      
+    if ( ok && !sysex_data.empty() )
+      ok = fwrite ( &sysex_data[0], 1, sysex_data.size(), f ) == sysex_data.size();
+      
+    if ( ok && !records.empty() )
+      ok = fwrite ( &records[0], sizeof ( EventRecord ), records.size(), f ) == records.size();
+      
+    if ( fclose ( f ) !=0 )
+      ok = false;
+      
+    return ok;
+  }
+  
+}
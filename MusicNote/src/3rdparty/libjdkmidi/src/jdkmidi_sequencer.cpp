@@ -316,6 +316,7 @@ namespace jdkmidi
       timesig_numerator ( 4 ),
       timesig_denominator ( 4 ),
       bender_value ( 0 ),
+      port ( 0 ),
       got_good_track_name ( false ),
       notes_are_on ( false ),
       note_matrix()
@@ -334,6 +335,7 @@ namespace jdkmidi
     timesig_numerator=4;
     timesig_denominator=4;
     bender_value=0;
+    port=0;
     note_matrix.Clear();
   }
   
@@ -345,6 +347,7 @@ namespace jdkmidi
     timesig_numerator=4;
     timesig_denominator=4;
     bender_value=0;
+    port=0;
     *track_name=0;
     note_matrix.Clear();
     got_good_track_name=false;
@@ -422,6 +425,11 @@ namespace jdkmidi
             MIDISequencerGUIEvent::GROUP_CONDUCTOR_TEMPO
           );
         }
+        else if ( msg->IsOutputCable() ) // is it an output cable event?
+        {
+          // yes, the further events of the track go to this port
+          port = msg->GetOutputCable();
+        }
         else // is it a time signature event?
           if ( msg->GetMetaType() ==META_TIMESIG )
           {
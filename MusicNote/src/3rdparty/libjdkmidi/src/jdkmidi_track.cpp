@@ -103,6 +103,12 @@ namespace jdkmidi
     num_events = 0;
   }
   
+  void MIDITrack::Truncate ( int event_num )
+  {
+    if ( event_num>=0 && event_num<num_events )
+      num_events = event_num;
+  }
+  
   
   void MIDITrack::ClearAndMerge (
     const MIDITrack *src1,
@@ -350,6 +356,24 @@ namespace jdkmidi
   
 #endif
   
+  void MIDITrack::Swap ( MIDITrack &t )
+  {
+    for ( int i=0; i<MIDIChunksPerTrack; ++i )
+    {
+      MIDITrackChunk *c=chunk[i];
+      chunk[i]=t.chunk[i];
+      t.chunk[i]=c;
+    }
+    
+    int n=buf_size;
+    buf_size=t.buf_size;
+    t.buf_size=n;
+    
+    n=num_events;
+    num_events=t.num_events;
+    t.num_events=n;
+  }
+  
   void MIDITrack::Shrink()
   {
     int num_chunks_used = ( int ) ( ( num_events / MIDITrackChunkSize ) +1 );
@@ -483,6 +507,19 @@ namespace jdkmidi
 	return PutEvent(newMsg);
   }
   
+  bool MIDITrack::AppendEvent ( const MIDITimedBigMessage &msg )
+  {
+    if ( num_events >= buf_size )
+    {
+      if ( !Expand() )
+        return false;
+    }
+    
+    GetEventAddress ( num_events++ )->Copy ( msg );
+    
+    return true;
+  }
+  
   bool MIDITrack::GetEvent ( int event_num, MIDITimedBigMessage *msg ) const
   {
     if ( event_num >= num_events )
@@ -0,0 +1,289 @@
+/*
+ *  libjdkmidi-2004 C++ Class Library for MIDI
+ *
+ *  This file was added to this copy of libjdkmidi. It is not part of the
+ *  upstream libjdkmidi-2004 release by J.D. Koftinoff Software, Ltd.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "jdkmidi/world.h"
+
+#include "jdkmidi/transform.h"
+
+#include <math.h>
+
+#include <thread>
+#include <vector>
+
+namespace jdkmidi
+{
+
+  static unsigned char ClampToData ( long v, long lowest )
+  {
+    if ( v<lowest )
+      return ( unsigned char ) lowest;
+      
+    if ( v>127 )
+      return 127;
+      
+    return ( unsigned char ) v;
+  }
+  
+  MIDIProcessorTransform::MIDIProcessorTransform()
+  {
+    Reset();
+  }
+  
+  MIDIProcessorTransform::~MIDIProcessorTransform()
+  {
+  }
+  
+  void MIDIProcessorTransform::Reset()
+  {
+    for ( int i=0; i<16; ++i )
+    {
+      transpose[i] = 0;
+      rechan_map[i] = i;
+    }
+    
+    for ( int i=0; i<256; ++i )
+    {
+      filter[i] = false;
+      note_map[IDENTITY_ROW][i] = ( unsigned char ) i;
+      velocity_map[0][i] = ( unsigned char ) i;
+      velocity_map[1][i] = ( unsigned char ) i;
+    }
+    
+    time_stretch = 1.0;
+    time_shift = 0;
+    tempo_scale = 1.0;
+    
+    for ( int chan=0; chan<16; ++chan )
+      CompileNoteMap ( chan );
+      
+    CompileStatusMap();
+  }
+  
+  void MIDIProcessorTransform::SetTranspose ( int chan, int semitones )
+  {
+    transpose[chan] = semitones;
+    CompileNoteMap ( chan );
+  }
+  
+  void MIDIProcessorTransform::SetAllTranspose ( int semitones )
+  {
+    for ( int chan=0; chan<16; ++chan )
+      SetTranspose ( chan, semitones );
+  }
+  
+  void MIDIProcessorTransform::SetVelocityCurve ( const unsigned char curve[128] )
+  {
+    // velocity 0 makes a note on into a note off; it stays 0 and nothing else may become 0
+    
+    for ( int v=1; v<128; ++v )
+      velocity_map[1][v] = ClampToData ( curve[v], 1 );
+  }
+  
+  void MIDIProcessorTransform::SetVelocityScale ( double scale, int offset )
+  {
+    for ( int v=1; v<128; ++v )
+      velocity_map[1][v] = ClampToData ( ( long ) floor ( v*scale+offset+0.5 ), 1 );
+  }
+  
+  void MIDIProcessorTransform::SetRechannel ( int src_chan, int dest_chan )
+  {
+    rechan_map[src_chan] = dest_chan;
+    CompileStatusMap();
+  }
+  
+  void MIDIProcessorTransform::SetStatusFilter ( unsigned char status, bool drop )
+  {
+    if ( status>=0x80 && status<0xf0 )
+    {
+      for ( int chan=0; chan<16; ++chan )
+        filter[ ( status&0xf0 ) |chan] = drop;
+    }
+    else
+    {
+      filter[status] = drop;
+    }
+    
+    CompileStatusMap();
+  }
+  
+  void MIDIProcessorTransform::SetTimeStretch ( double factor )
+  {
+    if ( factor>0.0 )
+      time_stretch = factor;
+  }
+  
+  void MIDIProcessorTransform::SetTimeShift ( long shift )
+  {
+    time_shift = shift;
+  }
+  
+  void MIDIProcessorTransform::SetTempoScale ( double factor )
+  {
+    if ( factor>0.0 )
+      tempo_scale = factor;
+  }
+  
+  void MIDIProcessorTransform::CompileNoteMap ( int chan )
+  {
+    for ( int n=0; n<128; ++n )
+      note_map[chan][n] = ClampToData ( n+transpose[chan], 0 );
+      
+    for ( int n=128; n<256; ++n )
+      note_map[chan][n] = ( unsigned char ) n;
+  }
+  
+  void MIDIProcessorTransform::CompileStatusMap()
+  {
+    for ( int s=0; s<256; ++s )
+    {
+      drop_map[s] = filter[s];
+      status_map[s] = ( unsigned char ) s;
+      note_row[s] = IDENTITY_ROW;
+      velocity_row[s] = 0;
+      
+      if ( s<0x80 || s>=0xf0 )
+        continue;
+        
+      int type = s&0xf0;
+      int chan = s&0x0f;
+      
+      if ( rechan_map[chan]<0 )
+        drop_map[s] = true;
+      else
+        status_map[s] = ( unsigned char ) ( type| ( rechan_map[chan]&0x0f ) );
+        
+      // the notes take the transpose of the channel they come from
+      
+      if ( type==NOTE_ON || type==NOTE_OFF || type==POLY_PRESSURE )
+        note_row[s] = ( unsigned char ) chan;
+        
+      if ( type==NOTE_ON )
+        velocity_row[s] = 1;
+    }
+  }
+  
+  bool MIDIProcessorTransform::Transform ( MIDITimedBigMessage *msg ) const
+  {
+    unsigned char status = msg->GetStatus();
+    
+    if ( drop_map[status] )
+      return false;
+      
+    msg->SetStatus ( status_map[status] );
+    msg->SetByte1 ( note_map[ note_row[status] ][ msg->GetByte1() ] );
+    msg->SetByte2 ( velocity_map[ velocity_row[status] ][ msg->GetByte2() ] );
+    
+    return true;
+  }
+  
+  bool MIDIProcessorTransform::Process ( MIDITimedBigMessage *msg )
+  {
+    return Transform ( msg );
+  }
+  
+  void MIDIProcessorTransform::Apply ( MIDITrack *track ) const
+  {
+    bool retime = ( time_stretch!=1.0 || time_shift!=0 );
+    bool retempo = ( tempo_scale!=1.0 );
+    
+    int num_events = track->GetNumEvents();
+    int kept = 0;
+    
+    // the events of a chunk are contiguous, so walk them chunk by chunk
+    
+    for ( int first=0; first<num_events; first+=MIDITrackChunkSize )
+    {
+      MIDITimedBigMessage *ev = track->GetEventAddress ( first );
+      int count = num_events-first;
+      
+      if ( count>MIDITrackChunkSize )
+        count = MIDITrackChunkSize;
+        
+      for ( int i=0; i<count; ++i, ++ev )
+      {
+        if ( !Transform ( ev ) )
+          continue;
+          
+        if ( retime )
+        {
+          long long t = ( long long ) floor ( ev->GetTime().count() *time_stretch+0.5 ) +time_shift;
+          ev->SetTime ( MIDITickMS ( t>0 ? t : 0 ) );
+        }
+        
+        if ( retempo && ev->IsTempo() )
+        {
+          double tempo = floor ( ev->GetTempo32() *tempo_scale+0.5 );
+          ev->SetTempo32 ( ( unsigned short ) ( tempo<1.0 ? 1.0 : ( tempo>65535.0 ? 65535.0 : tempo ) ) );
+        }
+        
+        // close the gaps of the dropped events; the times only ever grow
+        // with the stretch and the shift, so the order holds
+        
+        if ( kept!=first+i )
+          track->GetEventAddress ( kept )->Copy ( *ev );
+          
+        ++kept;
+      }
+    }
+    
+    track->Truncate ( kept );
+  }
+  
+  void MIDIProcessorTransform::ApplyTracks ( MIDIMultiTrack *multitrack, std::atomic<int> *next_track ) const
+  {
+    int n = multitrack->GetNumTracks();
+    
+    for ( int i= ( *next_track ) ++; i<n; i= ( *next_track ) ++ )
+    {
+      MIDITrack *track = multitrack->GetTrack ( i );
+      
+      if ( track )
+        Apply ( track );
+    }
+  }
+  
+  void MIDIProcessorTransform::Apply ( MIDIMultiTrack *multitrack, int max_threads ) const
+  {
+    if ( max_threads<=0 )
+    {
+      max_threads = ( int ) std::thread::hardware_concurrency();
+      
+      if ( max_threads<=0 )
+        max_threads=1;
+    }
+    
+    int n = multitrack->GetNumTracks();
+    int num_threads = ( max_threads < n ) ? max_threads : n;
+    
+    std::atomic<int> next_track ( 0 );
+    
+    std::vector<std::thread> threads;
+    
+    for ( int i=1; i<num_threads; ++i )
+      threads.push_back ( std::thread ( &MIDIProcessorTransform::ApplyTracks, this, multitrack, &next_track ) );
+      
+    ApplyTracks ( multitrack, &next_track ); // this thread takes its share too
+    
+    for ( size_t i=0; i<threads.size(); ++i )
+      threads[i].join();
+  }
+  
+}
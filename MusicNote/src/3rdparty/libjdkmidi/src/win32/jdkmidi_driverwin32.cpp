@@ -101,6 +101,14 @@ namespace jdkmidi
     if ( out_open )
     {
       midiOutReset ( out_handle );
+      
+      for ( size_t i = 0; i < extra_out_handles.size(); ++i )
+      {
+        if ( extra_out_handles[i] != 0 )
+        {
+          midiOutReset ( extra_out_handles[i] );
+        }
+      }
     }
   }
   
@@ -177,26 +185,62 @@ namespace jdkmidi
     return true;
   }
   
-  bool MIDIDriverWin32::OpenMIDIOutPort ( int id )
+  bool MIDIDriverWin32::OpenMIDIOutPort ( int id, unsigned char out_port )
   {
-    if ( !out_open )
+    if ( out_port == 0 )
     {
-      int e = midiOutOpen (
-                &out_handle,
-                id,
-                0,
-                0,
-                CALLBACK_NULL
-              );
-              
-      if ( e!=0 )
+      CloseExtraMIDIOutPorts();
+      
+      if ( !out_open )
       {
-        return false;
+        int e = midiOutOpen (
+                  &out_handle,
+                  id,
+                  0,
+                  0,
+                  CALLBACK_NULL
+                );
+                
+        if ( e!=0 )
+        {
+          return false;
+        }
+        out_open=true;
       }
-      out_open=true;
+      return true;
+    }
+    
+    if ( extra_out_handles.size() < out_port )
+    {
+      extra_out_handles.resize ( out_port, 0 ); // sized upfront - the timer callback only looks up
+    }
+    
+    HMIDIOUT &handle = extra_out_handles[out_port - 1];
+    
+    if ( handle != 0 )
+    {
+      midiOutClose ( handle );
+      handle = 0;
     }
-    return true;
     
+    if ( midiOutOpen ( &handle, id, 0, 0, CALLBACK_NULL ) !=0 )
+    {
+      handle = 0;
+      return false;
+    }
+    return true;
+  }
+  
+  void MIDIDriverWin32::CloseExtraMIDIOutPorts()
+  {
+    for ( size_t i = 0; i < extra_out_handles.size(); ++i )
+    {
+      if ( extra_out_handles[i] != 0 )
+      {
+        midiOutClose ( extra_out_handles[i] );
+        extra_out_handles[i] = 0;
+      }
+    }
   }
   
   void MIDIDriverWin32::CloseMIDIInPort()
@@ -211,6 +255,8 @@ namespace jdkmidi
   
   void MIDIDriverWin32::CloseMIDIOutPort()
   {
+    CloseExtraMIDIOutPorts();
+    
     if ( out_open )
     {
       midiOutClose ( out_handle );
@@ -223,6 +269,17 @@ namespace jdkmidi
   {
     if ( out_open )
     {
+      HMIDIOUT handle = out_handle;
+      
+      if ( msg.GetOutPort() != 0 )
+      {
+        if ( msg.GetOutPort() > extra_out_handles.size() || extra_out_handles[msg.GetOutPort() - 1] == 0 )
+        {
+          return true; // no device for the port - drop the message so the other ports keep going
+        }
+        handle = extra_out_handles[msg.GetOutPort() - 1];
+      }
+      
       // dont send sysex or meta-events
       
       if ( msg.GetStatus() <0xff && msg.GetStatus() !=0xf0 )
@@ -236,7 +293,7 @@ namespace jdkmidi
           | ( ( ( DWORD ) msg.GetByte2() &0xff ) <<16 );
           
           
-        if ( midiOutShortMsg ( out_handle, winmsg ) !=0 )
+        if ( midiOutShortMsg ( handle, winmsg ) !=0 )
         {
           return false;
         }
@@ -0,0 +1,557 @@
+/*
+ * @(#)benchmark.cpp
+ *
+ * This file was added to this copy of TSE3 - the Trax Sequencer Engine
+ * version 3.00. It is not part of the upstream TSE3 release.
+ *
+ * This library is modifiable/redistributable under the terms of the GNU
+ * General Public License.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+    /***************************************************************
+     * TSE3 benchmark program
+     * ======================
+     *
+     * This program times TSE3 operations on synthetic data, so that
+     * changes in their speed can be spotted. It needs no MIDI
+     * hardware.
+     *
+     * Useage: benchmark [--phrase-events <n>] [--tracks <n>]
+     *                   [--parts <n>] [--events <n>]
+     *                   [--mutex exclusive|rw] [--readers <n>]
+     *
+     * It contains five benchmarks:
+     *
+     *   1. Bulk PhraseEdit operations on a big recorded take:
+     *      tidy, PowerQuantise, timeShift and the selection
+     *      operations.
+     *   2. Playback of a synthetic Song (of the given number of
+     *      tracks, parts per track and events per phrase) through
+     *      the Transport, with the MidiFilters, MidiMapper and Mixer
+     *      all in use. The Transport is driven on a
+     *      NullMidiScheduler in virtual time as fast as it will go.
+     *      This reports events per second, memory allocations per
+     *      event and the 99th percentile time of a Transport poll.
+     *   3. Saving the Song as TSE3Binary and loading it back. This
+     *      reports both times and checks that the loaded Song saves
+     *      the same TSE3MDL and TSE3Binary as the original; the
+     *      program fails if it doesn't.
+     *   4. Playback of the same Song in real time whilst other
+     *      threads keep reading it, as a GUI redrawing does. This
+     *      only runs when a thread safe mutex is chosen with
+     *      --mutex: 'exclusive' lets one thread at a time into
+     *      TSE3, 'rw' is the RWMutexImpl that lets readers share.
+     *      The clock runs at one Clock per millisecond with the
+     *      minimum look ahead, so a poll held up for more than
+     *      about 10 ms breaks up. This reports the breakUps, the
+     *      99th percentile and worst poll times and the number of
+     *      reads done.
+     *   5. The same again, but with the Transport's engine thread
+     *      doing the polling and the MIDI echo on, so that it also
+     *      waits for input. The clock runs at the song's tempo and
+     *      the main thread injects a MidiCommand every millisecond.
+     *      This reports the breakUps and the 99th percentile and
+     *      worst times an inject waited for the engine.
+     *
+     **************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// Used in benchmarks 4 and 5
+#include "tse3/Mutex.h"
+
+// Used in benchmark 1
+#include "tse3/PhraseEdit.h"
+#include "tse3/util/PowerQuantise.h"
+
+// Used in benchmark 2
+#include "tse3/Song.h"
+#include "tse3/Track.h"
+#include "tse3/Part.h"
+#include "tse3/Phrase.h"
+#include "tse3/MidiFilter.h"
+#include "tse3/Mixer.h"
+#include "tse3/Metronome.h"
+#include "tse3/Transport.h"
+#include "tse3/util/MidiScheduler.h"
+
+// Used in benchmark 3
+#include "tse3/TSE3Binary.h"
+#include "tse3/TSE3MDL.h"
+
+namespace
+{
+    typedef std::chrono::steady_clock Timer;
+
+    /**
+     * Count of memory allocations made by the whole program.
+     */
+    std::atomic<unsigned long> allocations(0);
+
+    /**
+     * Prints one result line: the operation, how long it took and how
+     * many events per second that is.
+     */
+    void report(const char *what, Timer::time_point start, size_t events)
+    {
+        double secs = std::chrono::duration<double>(Timer::now() - start)
+                      .count();
+        std::cout << "  " << std::left << std::setw(20) << what
+                  << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << secs*1000 << " ms"
+                  << std::setw(14) << std::setprecision(0)
+                  << (secs > 0 ? events/secs : 0) << " events/s\n";
+    }
+
+    /**
+     * A simple repeatable random number generator, so that every run
+     * works on the same data.
+     */
+    unsigned int seed = 1;
+    int random(int n)
+    {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 8) % n;
+    }
+
+    /**
+     * A thread safe MutexImpl with no notion of readers, to compare
+     * the RWMutexImpl with.
+     */
+    class ExclusiveMutexImpl : public TSE3::Impl::MutexImpl
+    {
+        public:
+            ExclusiveMutexImpl() : depth(0) {}
+            virtual void lock()   { m.lock(); ++depth; }
+            virtual void unlock() { --depth; m.unlock(); }
+            virtual bool locked() { return depth != 0; }
+        private:
+            std::recursive_mutex m;
+            std::atomic<int>     depth;
+    };
+
+    /**
+     * Reads the whole Song under one read lock, as a redraw of it
+     * would, and returns a checksum so the work is not optimised away.
+     */
+    int readSong(TSE3::Song *song, TSE3::Clock at)
+    {
+        TSE3::Impl::CritSecRead cs;
+        int sum = song->lastClock();
+        for (size_t t = 0; t < song->size(); ++t)
+        {
+            TSE3::Track *track = (*song)[t];
+            sum += track->index(at);
+            for (size_t p = 0; p < track->size(); ++p)
+            {
+                TSE3::Phrase *phrase = (*track)[p]->phrase();
+                for (size_t e = 0; e < phrase->size(); ++e)
+                {
+                    sum += (*phrase)[e].data.data2;
+                }
+            }
+        }
+        return sum;
+    }
+}
+
+void *operator new(size_t size)
+{
+    ++allocations;
+    void *p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    free(p);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t phraseEvents = 1000000;
+    size_t noTracks     = 64;
+    size_t noParts      = 16;
+    size_t noEvents     = 512;
+    size_t noReaders    = 4;
+    const char *mutex   = 0;
+    for (int n = 1; n < argc; ++n)
+    {
+        size_t *value = 0;
+        if (!strcmp(argv[n], "--phrase-events")) value = &phraseEvents;
+        if (!strcmp(argv[n], "--tracks"))        value = &noTracks;
+        if (!strcmp(argv[n], "--parts"))         value = &noParts;
+        if (!strcmp(argv[n], "--events"))        value = &noEvents;
+        if (!strcmp(argv[n], "--readers"))       value = &noReaders;
+        if (!strcmp(argv[n], "--mutex") && n+1 < argc
+            && (!strcmp(argv[n+1], "exclusive") || !strcmp(argv[n+1], "rw")))
+        {
+            mutex = argv[++n];
+            continue;
+        }
+        if (!value || n+1 == argc)
+        {
+            std::cout << "Useage: benchmark [--phrase-events <n>] "
+                      << "[--tracks <n>] [--parts <n>] [--events <n>]\n"
+                      << "                 [--mutex exclusive|rw] "
+                      << "[--readers <n>]\n";
+            return 1;
+        }
+        *value = atol(argv[++n]);
+    }
+
+    // The mutex has to be set before any other TSE3 call
+    if (mutex && !strcmp(mutex, "rw"))
+    {
+        TSE3::Impl::Mutex::setImpl(new TSE3::Impl::RWMutexImpl());
+    }
+    else if (mutex)
+    {
+        TSE3::Impl::Mutex::setImpl(new ExclusiveMutexImpl());
+    }
+
+    /**************************************************************************
+     * 1. Bulk PhraseEdit operations
+     *************************************************************************/
+
+    // Make an untidy recorded take: separate note ons and offs, some
+    // note ons with zero velocity as offs, controllers and sustain pedal
+    std::cout << "PhraseEdit with " << phraseEvents << " recorded events\n";
+    std::vector<TSE3::MidiEvent> take;
+    take.reserve(phraseEvents);
+    TSE3::Clock time = 0;
+    while (take.size() < phraseEvents)
+    {
+        time += random(TSE3::Clock::PPQN/4);
+        int channel = random(4);
+        int kind    = random(40);
+        if (kind == 0)
+        {
+            take.push_back(TSE3::MidiEvent(
+                TSE3::MidiCommand(TSE3::MidiCommand_ControlChange, channel, 0,
+                                  TSE3::MidiControl_SustainPedal, 127),
+                time));
+            take.push_back(TSE3::MidiEvent(
+                TSE3::MidiCommand(TSE3::MidiCommand_ControlChange, channel, 0,
+                                  TSE3::MidiControl_SustainPedal, 0),
+                time + random(TSE3::Clock::PPQN*4)));
+        }
+        else if (kind < 6)
+        {
+            take.push_back(TSE3::MidiEvent(
+                TSE3::MidiCommand(TSE3::MidiCommand_PitchBend, channel, 0,
+                                  0, random(128)),
+                time));
+        }
+        else
+        {
+            int note = 36 + random(48);
+            TSE3::MidiEvent on(
+                TSE3::MidiCommand(TSE3::MidiCommand_NoteOn, channel, 0,
+                                  note, 1 + random(127)),
+                time);
+            on.data.selected = random(2);
+            take.push_back(on);
+            take.push_back(TSE3::MidiEvent(
+                TSE3::MidiCommand(random(2) ? TSE3::MidiCommand_NoteOff
+                                            : TSE3::MidiCommand_NoteOn,
+                                  channel, 0, note, 0),
+                time + 1 + random(TSE3::Clock::PPQN)));
+        }
+    }
+
+    TSE3::PhraseEdit phraseEdit;
+    Timer::time_point start = Timer::now();
+    phraseEdit.record(&take[0], take.size());
+    phraseEdit.mergeRecorded();
+    report("record", start, take.size());
+
+    start = Timer::now();
+    phraseEdit.tidy();
+    report("tidy", start, take.size());
+    size_t tidied = phraseEdit.size();
+
+    TSE3::Util::PowerQuantise powerQuantise;
+    powerQuantise.setBy(80);
+    powerQuantise.setHumanise(2);
+    start = Timer::now();
+    powerQuantise.go(&phraseEdit);
+    report("PowerQuantise", start, tidied);
+
+    start = Timer::now();
+    phraseEdit.timeShift(TSE3::Clock::PPQN);
+    report("timeShift", start, tidied);
+
+    start = Timer::now();
+    phraseEdit.invertSelection();
+    phraseEdit.clearSelection();
+    phraseEdit.selectRange(0, phraseEdit.size()/2);
+    report("selection", start, tidied*3/2);
+
+    start = Timer::now();
+    phraseEdit.eraseSelection();
+    report("eraseSelection", start, tidied);
+
+    /**************************************************************************
+     * 2. Playback
+     *************************************************************************/
+
+    std::cout << "Song with " << noTracks << " tracks of " << noParts
+              << " parts, " << noEvents << " events per phrase\n";
+
+    // Each track has its own phrase, played by every part. The track and
+    // part filters all have something to do.
+    TSE3::Song        song(0);
+    const TSE3::Clock step = TSE3::Clock::PPQN/4;
+    for (size_t t = 0; t < noTracks; ++t)
+    {
+        TSE3::PhraseEdit pe;
+        for (size_t n = 0; n < noEvents; ++n)
+        {
+            TSE3::Clock time = n*step + random(step/2);
+            TSE3::MidiEvent e(
+                TSE3::MidiCommand(TSE3::MidiCommand_NoteOn, 0, 0,
+                                  36 + random(48), 1 + random(127)),
+                time, 0x40, time + 1 + random(step*2));
+            e.data.selected = (n % 3 == 0); // for benchmark 3
+            pe.insert(e);
+        }
+        TSE3::Phrase *phrase = pe.createPhrase(song.phraseList());
+
+        TSE3::Track *track = new TSE3::Track();
+        song.insert(track);
+        track->filter()->setChannel(t % 16);
+        track->filter()->setMinVelocity(8);
+        track->filter()->setVelocityScale(90);
+        TSE3::Clock length = noEvents*step;
+        for (size_t p = 0; p < noParts; ++p)
+        {
+            TSE3::Part *part = new TSE3::Part(p*length, (p+1)*length);
+            part->setPhrase(phrase);
+            part->filter()->setTranspose(int(p % 12) - 6);
+            track->insert(part);
+        }
+    }
+
+    TSE3::Metronome               metronome;
+    TSE3::Util::NullMidiScheduler scheduler;
+    TSE3::Transport               transport(&metronome, &scheduler);
+    TSE3::Mixer                   mixer(1, &transport);
+    metronome.setStatus(TSE3::Transport::Playing, false);
+    transport.midiMapper()->setMap(0, 0);
+
+    // Poll in virtual time, moving the clock on a sixteenth each poll
+    std::vector<double> pollTimes;
+    pollTimes.reserve(noParts*noEvents + 1024);
+    TSE3::Clock       now                = 0;
+    unsigned long     allocationsAtStart = allocations;
+    Timer::time_point playStart          = Timer::now();
+    transport.play(&song, 0);
+    while (transport.status() != TSE3::Transport::Resting)
+    {
+        now += TSE3::Clock::PPQN/4;
+        scheduler.setClock(now);
+        Timer::time_point pollStart = Timer::now();
+        transport.poll();
+        pollTimes.push_back(std::chrono::duration<double, std::micro>
+                            (Timer::now() - pollStart).count());
+    }
+    double secs = std::chrono::duration<double>(Timer::now() - playStart)
+                  .count();
+    unsigned long allocationsUsed = allocations - allocationsAtStart;
+    size_t        events          = scheduler.noEventsTx();
+
+    std::sort(pollTimes.begin(), pollTimes.end());
+    double p99 = pollTimes.empty()
+               ? 0 : pollTimes[(pollTimes.size()-1) * 99 / 100];
+
+    std::cout << std::setprecision(0)
+              << "  events             " << std::setw(13) << events << "\n"
+              << "  events/s           " << std::setw(13)
+              << (secs > 0 ? events/secs : 0) << "\n"
+              << std::setprecision(3)
+              << "  allocations/event  " << std::setw(13)
+              << (events ? double(allocationsUsed)/events : 0) << "\n"
+              << std::setprecision(1)
+              << "  polls              " << std::setw(13) << pollTimes.size()
+              << "\n"
+              << "  p99 poll time      " << std::setw(10) << p99 << " us\n";
+
+    /**************************************************************************
+     * 3. TSE3Binary save and load
+     *************************************************************************/
+
+    std::cout << "TSE3Binary round trip of the Song\n";
+
+    TSE3::TSE3Binary   binary;
+    std::ostringstream saved;
+    start = Timer::now();
+    binary.save(saved, &song);
+    report("save", start, noTracks*noEvents);
+    std::string image = saved.str();
+
+    start = Timer::now();
+    TSE3::Song *loaded
+        = binary.load(reinterpret_cast<const unsigned char*>(image.data()),
+                      image.size());
+    report("load", start, noTracks*noEvents);
+
+    TSE3::TSE3MDL      mdl;
+    std::ostringstream mdlBefore, mdlAfter, resaved;
+    mdl.save(mdlBefore, &song);
+    mdl.save(mdlAfter, loaded);
+    binary.save(resaved, loaded);
+    delete loaded;
+    bool roundTrip = mdlBefore.str() == mdlAfter.str()
+                     && resaved.str() == image;
+    std::cout << "  bytes              " << std::setw(13) << image.size()
+              << "\n"
+              << "  round trip         " << std::setw(13)
+              << (roundTrip ? "ok" : "FAILED") << "\n";
+    int result = roundTrip ? 0 : 1;
+
+    /**************************************************************************
+     * 4. Playback whilst other threads read the Song
+     *************************************************************************/
+
+    if (!mutex) return result;
+
+    std::cout << "Real time playback with " << noReaders
+              << " threads reading the Song, " << mutex << " mutex\n";
+
+    std::atomic<bool>          reading(true);
+    std::atomic<unsigned long> reads(0);
+    std::vector<std::thread>   readers;
+    for (size_t r = 0; r < noReaders; ++r)
+    {
+        readers.push_back(std::thread([&song, &reading, &reads, r]()
+        {
+            int sum = 0;
+            while (reading)
+            {
+                sum += readSong(&song, int(r)*TSE3::Clock::PPQN);
+                ++reads;
+            }
+            if (sum == 42) std::cout << "";
+        }));
+    }
+
+    // Poll every millisecond for three seconds of wall clock time
+    transport.setAdaptiveLookAhead(false);
+    transport.setLookAhead(0);
+    pollTimes.clear();
+    transport.play(&song, 0);
+    TSE3::Clock startClock = transport.scheduler()->clock(); // before the lead in
+    transport.poll();
+    playStart = Timer::now();
+    Timer::time_point nextPoll = playStart;
+    while (transport.status() != TSE3::Transport::Resting
+           && nextPoll - playStart < std::chrono::seconds(3))
+    {
+        nextPoll += std::chrono::milliseconds(1);
+        std::this_thread::sleep_until(nextPoll);
+        now = startClock
+            + int(std::chrono::duration_cast<std::chrono::milliseconds>
+                  (Timer::now() - playStart).count());
+        scheduler.setClock(now);
+        Timer::time_point pollStart = Timer::now();
+        transport.poll();
+        pollTimes.push_back(std::chrono::duration<double, std::micro>
+                            (Timer::now() - pollStart).count());
+    }
+    int breakUps = transport.breakUps();
+    transport.stop();
+
+    std::sort(pollTimes.begin(), pollTimes.end());
+    p99 = pollTimes.empty() ? 0 : pollTimes[(pollTimes.size()-1) * 99 / 100];
+
+    std::cout << std::setprecision(0)
+              << "  breakUps           " << std::setw(13) << breakUps << "\n"
+              << "  reads              " << std::setw(13) << reads << "\n"
+              << std::setprecision(1)
+              << "  polls              " << std::setw(13) << pollTimes.size()
+              << "\n"
+              << "  p99 poll time      " << std::setw(10) << p99 << " us\n"
+              << "  worst poll time    " << std::setw(10)
+              << (pollTimes.empty() ? 0 : pollTimes.back()) << " us\n";
+
+    /**************************************************************************
+     * 5. Engine thread playback whilst other threads read the Song
+     *************************************************************************/
+
+    std::cout << "Engine thread playback with " << noReaders
+              << " threads reading the Song, " << mutex << " mutex\n";
+
+    // The readers carry on from benchmark 4. The engine reads the clock
+    // from another thread, so it moves at the tempo the engine expects.
+    transport.setLookAhead(TSE3::Clock::PPQN);
+    transport.midiEcho()->filter()->setStatus(true);
+    reads = 0;
+    std::vector<double> injectTimes;
+    injectTimes.reserve(4096);
+    transport.startEngine();
+    transport.play(&song, 0);
+    startClock = transport.scheduler()->clock();
+    playStart  = Timer::now();
+    nextPoll   = playStart;
+    while (transport.status() != TSE3::Transport::Resting
+           && nextPoll - playStart < std::chrono::seconds(3))
+    {
+        nextPoll += std::chrono::milliseconds(1);
+        std::this_thread::sleep_until(nextPoll);
+        int ms = int(std::chrono::duration_cast<std::chrono::milliseconds>
+                     (Timer::now() - playStart).count());
+        scheduler.setClock(startClock
+                           + ms * transport.scheduler()->tempo()
+                                * TSE3::Clock::PPQN / 60000);
+        Timer::time_point injectStart = Timer::now();
+        transport.inject(TSE3::MidiCommand(TSE3::MidiCommand_ControlChange,
+                                           0, 0, 1, ms % 128));
+        injectTimes.push_back(std::chrono::duration<double, std::micro>
+                              (Timer::now() - injectStart).count());
+    }
+    breakUps = transport.breakUps();
+    transport.stop();
+    transport.stopEngine();
+
+    reading = false;
+    for (size_t r = 0; r < readers.size(); ++r) readers[r].join();
+
+    std::sort(injectTimes.begin(), injectTimes.end());
+    p99 = injectTimes.empty()
+        ? 0 : injectTimes[(injectTimes.size()-1) * 99 / 100];
+
+    std::cout << std::setprecision(0)
+              << "  breakUps           " << std::setw(13) << breakUps << "\n"
+              << "  reads              " << std::setw(13) << reads << "\n"
+              << std::setprecision(1)
+              << "  injects            " << std::setw(13)
+              << injectTimes.size() << "\n"
+              << "  p99 inject time    " << std::setw(10) << p99 << " us\n"
+              << "  worst inject time  " << std::setw(10)
+              << (injectTimes.empty() ? 0 : injectTimes.back()) << " us\n";
+
+    return result;
+}
@@ -55,6 +55,9 @@ namespace
         // MidiScheduler error codes
         "Failed to create the MIDI scheduler",
 
+        // Transport error codes
+        "Transport called whilst holding the TSE3 mutex",
+
          // Other
         "Unknown TSE3 error"
     };
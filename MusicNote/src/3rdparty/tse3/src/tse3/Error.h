@@ -68,6 +68,9 @@ namespace TSE3
         // MidiScheduler error codes,
         MidiSchedulerCreateErr,
 
+        // Transport error codes
+        TransportLockOrderErr,
+
         /**
          * An error not specified by the core TSE3 library.
          */
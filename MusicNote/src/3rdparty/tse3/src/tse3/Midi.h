@@ -50,6 +50,7 @@ namespace TSE3
          */
         Clock(int pulses = 0) : pulses(pulses)   {}
         Clock(const Clock &m) : pulses(m.pulses) {}
+        Clock &operator=(const Clock &m) { pulses = m.pulses; return *this; }
 
         /**
          * Convenience method to obtain the number of whole quarter notes.
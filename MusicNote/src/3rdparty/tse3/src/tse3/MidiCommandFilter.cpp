@@ -27,7 +27,7 @@ using namespace TSE3;
 
 bool MidiCommandFilter::filter(MidiCommand type) const
 {
-    Impl::CritSec cs;
+    Impl::CritSecRead cs;
 
     int index = type.status - MidiCommand_NoteOn;
     if (index < 0) index = 0;
@@ -18,6 +18,8 @@
 
 #include "tse3/Mutex.h"
 
+#include <algorithm>
+
 using namespace TSE3;
 
 /******************************************************************************
@@ -118,6 +120,21 @@ void MidiDataIterator::Notifier_Deleted(MidiData *)
  * MidiData class
  *****************************************************************************/
 
+namespace
+{
+    /**
+     * Orders a @ref MidiEvent against a @ref Clock for std::lower_bound.
+     */
+    struct EventBefore
+    {
+        bool operator()(const MidiEvent &e, Clock c) const
+        {
+            return e.time < c;
+        }
+    };
+}
+
+
 MidiData::MidiData(int noEvents)
 {
     data.reserve(noEvents);
@@ -131,14 +148,12 @@ MidiData::~MidiData()
 
 size_t MidiData::index(Clock c) const
 {
-    Impl::CritSec cs;
+    Impl::CritSecRead cs;
 
-    std::vector<MidiEvent>::const_iterator i = data.begin();
-    while (i != data.end() && !(c <= (*i).time))
-    {
-        ++i;
-    }
-    return (i == data.end()) ? size() : i - data.begin();
+    // The events are held in time order, so we can binary search
+    std::vector<MidiEvent>::const_iterator i
+        = std::lower_bound(data.begin(), data.end(), c, EventBefore());
+    return i - data.begin();
 }
 
 
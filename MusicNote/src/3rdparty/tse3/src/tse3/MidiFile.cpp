@@ -28,11 +28,24 @@
 #include "tse3/Error.h"
 #include "tse3/Progress.h"
 
+#include <atomic>
+#include <exception>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <queue>
+#include <vector>
 #include <math.h>
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace TSE3;
 
 namespace
@@ -124,7 +137,7 @@ namespace TSE3
              * @param pos    Position in file to read from.
              * @param length No bytes to read.
              */
-            int readFixed(unsigned char *&pos, int length);
+            int readFixed(const unsigned char *&pos, int length);
 
             /**
              * Reads a variable size value as defined by the MIDI file standard.
@@ -133,15 +146,16 @@ namespace TSE3
              *
              * @param pos Position in file to read from.
              */
-            int readVariable(unsigned char *&pos);
+            int readVariable(const unsigned char *&pos);
 
             // File information
             MidiFileImport                 *mfi;
-            unsigned char                 **mtrks;
+            size_t                          noMTrks;
+            const unsigned char           **mtrks;    // start of MTrk data
             size_t                         *mtrksize;
 
             // Playback
-            unsigned char                 **mtrkpos;
+            const unsigned char           **mtrkpos;
             Clock                          *mtrkclock;
             MidiCommand                    *mtrkcommand;
             int                            *mtrkstatus;
@@ -164,40 +178,44 @@ namespace TSE3
 
 MidiFileImportIterator::MidiFileImportIterator(MidiFileImport *mfi, Clock c,
                                                bool lastClock)
-: mfi(mfi), _source(-1)
+: mfi(mfi), noMTrks(mfi->fileNoMTrks), _source(-1)
 {
     // set up internal pointers
-    mtrks       = new unsigned char*[mfi->fileNoMTrks];
-    mtrksize    = new size_t[mfi->fileNoMTrks];
-    mtrkpos     = new unsigned char*[mfi->fileNoMTrks];
-    mtrkclock   = new Clock[mfi->fileNoMTrks];
-    mtrkcommand = new MidiCommand[mfi->fileNoMTrks];
-    mtrkstatus  = new int[mfi->fileNoMTrks];
-    mtrkchannel = new int[mfi->fileNoMTrks];
-    mtrkport    = new int[mfi->fileNoMTrks];
-
+    mtrks       = new const unsigned char*[noMTrks];
+    mtrksize    = new size_t[noMTrks];
+    mtrkpos     = new const unsigned char*[noMTrks];
+    mtrkclock   = new Clock[noMTrks];
+    mtrkcommand = new MidiCommand[noMTrks];
+    mtrkstatus  = new int[noMTrks];
+    mtrkchannel = new int[noMTrks];
+    mtrkport    = new int[noMTrks];
+
+    // Only the chunk headers are read here, the MTrks are decoded lazily
+    // as playback reaches them
+    const size_t fileSize = size_t(mfi->fileSize);
     size_t pos = mfi->fileHeaderSize;
 
     size_t mtrkNo = 0;
-    while (pos < size_t(mfi->fileSize))
+    while (pos + 8 <= fileSize)
     {
-        if (!strncmp((char *) mfi->file+pos, "MTrk", 4))
+        bool   isMTrk = !strncmp((const char *) mfi->file+pos, "MTrk", 4);
+        pos += 4;
+        size_t length = size_t(mfi->readFixed(pos, 4));
+        if (length > fileSize - pos) length = fileSize - pos;
+        if (isMTrk && mtrkNo < noMTrks)
         {
-            if (mtrkNo < mfi->fileNoMTrks)
-            {
-                mtrks[mtrkNo] = mfi->file+pos;
-                pos += 4;
-                mtrksize[mtrkNo] = mfi->readFixed(pos, 4);
-                pos += mtrksize[mtrkNo];
-            }
+            mtrks[mtrkNo]    = mfi->file+pos;
+            mtrksize[mtrkNo] = length;
             ++mtrkNo;
         }
-        else
-        {
-            pos += 4;
-            int length = mfi->readFixed(pos, 4);
-            pos += length;
-        }
+        pos += length;
+    }
+    while (mtrkNo < noMTrks)
+    {
+        // The header promised more MTrks than there are
+        mtrks[mtrkNo]    = mfi->file+fileSize;
+        mtrksize[mtrkNo] = 0;
+        ++mtrkNo;
     }
 
     if (lastClock)
@@ -213,29 +231,40 @@ MidiFileImportIterator::MidiFileImportIterator(MidiFileImport *mfi, Clock c,
 MidiFileImportIterator::~MidiFileImportIterator()
 {
     mfi = 0;
-    delete mtrks;
-    delete mtrksize;
-    delete mtrkpos;
-    delete mtrkclock;
-    delete mtrkcommand;
-    delete mtrkstatus;
-    delete mtrkchannel;
-    delete mtrkport;
+    delete [] mtrks;
+    delete [] mtrksize;
+    delete [] mtrkpos;
+    delete [] mtrkclock;
+    delete [] mtrkcommand;
+    delete [] mtrkstatus;
+    delete [] mtrkchannel;
+    delete [] mtrkport;
 }
 
 
-void MidiFileImportIterator::moveTo(Clock /*c*/)
+void MidiFileImportIterator::moveTo(Clock c)
 {
-    _more   = true;
     _source = -1;
-    for (size_t c = 0; c < mfi->fileNoMTrks; ++c)
+    if (!mfi)
     {
-        mtrkpos[c]     = mtrks[c]+8;
-        mtrkclock[c]   = 0;
-        mtrkstatus[c]  = MidiCommand_NoteOn;
-        mtrkchannel[c] = 0;
-        mtrkport[c]    = 0;
-        getNextChannelEvent(c);
+        _more = false;
+        return;
+    }
+
+    // MTrks can only be read forwards, so we skip from their start
+    for (size_t n = 0; n < noMTrks; ++n)
+    {
+        mtrkpos[n]     = mtrks[n];
+        mtrkclock[n]   = 0;
+        mtrkstatus[n]  = MidiCommand_NoteOn;
+        mtrkchannel[n] = 0;
+        mtrkport[n]    = 0;
+        getNextChannelEvent(n);
+        while (mtrkpos[n] < mtrks[n]+mtrksize[n]
+               && Clock::convert(mtrkclock[n], mfi->filePPQN) < c)
+        {
+            getNextChannelEvent(n);
+        }
     }
     getNextEvent();
 }
@@ -250,7 +279,7 @@ void MidiFileImportIterator::getNextEvent()
 
     Clock c = -1;
     _source = -1;
-    for (size_t n = 0; n < mfi->fileNoMTrks; ++n)
+    for (size_t n = 0; n < noMTrks && mfi; ++n)
     {
         if (mtrkpos[n] < mtrks[n]+mtrksize[n])
         {
@@ -387,12 +416,13 @@ void MidiFileImportIterator::importMeta(int c)
 
 void MidiFileImportIterator::Notifier_Deleted(MidiFileImport *)
 {
+    // The file data has gone with it
     mfi = 0;
     moveTo(0);
 }
 
 
-int MidiFileImportIterator::readFixed(unsigned char *&pos, int length)
+int MidiFileImportIterator::readFixed(const unsigned char *&pos, int length)
 {
     int value = 0;
     while (length-- > 0 && pos < mfi->file+mfi->fileSize)
@@ -401,7 +431,7 @@ int MidiFileImportIterator::readFixed(unsigned char *&pos, int length)
 }
 
 
-int MidiFileImportIterator::readVariable(unsigned char *&pos)
+int MidiFileImportIterator::readVariable(const unsigned char *&pos)
 {
     char c;
     int value = 0;
@@ -423,7 +453,7 @@ void MidiFileImportIterator::calculateLastClock()
     {
         moveTo(0);
         Clock lastClock = 0;
-        for (size_t n = 0; n < mfi->fileNoMTrks; ++n)
+        for (size_t n = 0; n < noMTrks; ++n)
         {
             while (mtrkpos[n] < mtrks[n]+mtrksize[n])
             {
@@ -441,88 +471,146 @@ void MidiFileImportIterator::calculateLastClock()
  *****************************************************************************/
 
 MidiFileImport::MidiFileImport(const std::string &fn, int v, std::ostream &o)
-: filename(fn), verbose(v), out(o), file(0), fileLastClock(-1)
+: filename(fn), verbose(v), out(o), file(0), fileSize(0), fileMapped(false),
+  fileLastClock(-1)
 {
-    std::ifstream in(filename.c_str(), std::ios::binary | std::ios::in);
-    if (!in.good())
+#if !defined(_WIN32)
+    // Map the file rather than copying it: the MTrks are only ever read
+    // forwards, and a file that is just played may never be read in full
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
     {
         throw MidiFileImportError("Source MIDI file will not open.");
     }
-
-    in.seekg(0, std::ios::end);
-    fileSize = in.tellg();
-    in.seekg(0, std::ios::beg);
-
-    try
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
     {
-        file = new unsigned char[fileSize];
+        void *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            file       = static_cast<const unsigned char*>(map);
+            fileSize   = st.st_size;
+            fileMapped = true;
+        }
     }
-    catch (std::bad_alloc)
+    close(fd);
+#endif
+
+    if (!fileMapped)
     {
-        throw MidiFileImportError("Out of memory loading MIDI file.");
-    }
+        std::ifstream in(filename.c_str(), std::ios::binary | std::ios::in);
+        if (!in.good())
+        {
+            throw MidiFileImportError("Source MIDI file will not open.");
+        }
 
-    // OK, this is relatively evil, we're reading a char stream into
-    // an unsigned char buffer. However, we opened the file binary and now
-    // cross our fingers. We can't easily use a ifstream<unsigned char>
-    // since it's not instantiated by default in existing standard C++
-    in.read(reinterpret_cast<char*>(file), fileSize);
-    if (in.gcount() != fileSize)
-        throw MidiFileImportError("Error loading MIDI file.");
+        in.seekg(0, std::ios::end);
+        fileSize = in.tellg();
+        in.seekg(0, std::ios::beg);
+
+        unsigned char *buffer;
+        try
+        {
+            buffer = new unsigned char[fileSize];
+        }
+        catch (std::bad_alloc)
+        {
+            throw MidiFileImportError("Out of memory loading MIDI file.");
+        }
+        file = buffer;
+
+        // OK, this is relatively evil, we're reading a char stream into
+        // an unsigned char buffer. However, we opened the file binary and now
+        // cross our fingers. We can't easily use a ifstream<unsigned char>
+        // since it's not instantiated by default in existing standard C++
+        in.read(reinterpret_cast<char*>(buffer), fileSize);
+        if (in.gcount() != fileSize)
+        {
+            releaseFile();
+            throw MidiFileImportError("Error loading MIDI file.");
+        }
+    }
 
     if (verbose >= 1)
-          out << "Loaded source MIDI file into memory.\n"
+          out << (fileMapped ? "Mapped source MIDI file into memory.\n"
+                             : "Loaded source MIDI file into memory.\n")
               << "  Filename: " << filename << "\n"
               << "  File size: " << fileSize << "\n"
               << "Reading header information\n";
 
     // Read the MIDI file header
-    loadHeader();
+    try
+    {
+        loadHeader();
+    }
+    catch (...)
+    {
+        releaseFile();
+        throw;
+    }
 }
 
 
 MidiFileImport::~MidiFileImport()
 {
-    delete [] file;
+    releaseFile();
 }
 
 
-Song *MidiFileImport::load(Progress *progress)
+void MidiFileImport::releaseFile()
 {
-    Song *song = new Song(0);
+#if !defined(_WIN32)
+    if (fileMapped)
+    {
+        munmap(const_cast<unsigned char*>(file), size_t(fileSize));
+        file = 0;
+    }
+#endif
+    delete [] file;
+    file = 0;
+}
 
-    if (verbose >= 1) out << "Importing MIDI file...\n\n";
 
-    // Read the MIDI file header
-    loadHeader();
+/**
+ * An MTrk decoded by @ref MidiFileImport::decodeMTrk, waiting to be placed
+ * into the @ref Song.
+ */
+struct MidiFileImport::MTrk
+{
+    /**
+     * A meta event that applies to the @ref Song or @ref Track. Its time
+     * is in the file's PPQN.
+     */
+    struct Meta
+    {
+        int         type;
+        Clock       time;
+        int         data1, data2;
+        std::string text;
+    };
 
-    size_t pos = fileHeaderSize;
+    size_t                 mtrkNo;
+    std::vector<MidiEvent> events;  // in file order, times in Clock::PPQN
+    std::vector<Meta>      metas;
+    Clock             end;           // in the file's PPQN
+};
 
-    size_t mtrkNo  = 0;
 
-    // Set the Tempo and TimeSig to the defaults
-    // (already done in their constructors)
+Song *MidiFileImport::load(Progress *progress, int threads)
+{
+    if (verbose >= 1) out << "Importing MIDI file...\n\n";
 
-    // Read the chunks
-    const size_t PROGRESS_OFFSET = 10;
-    if (progress)
-    {
-        // We add PROGRESS_OFFSET to display the fact that the file
-        // has already been loaded into memory, and this may have taken quite
-        // a while already.
+    // Read the MIDI file header
+    loadHeader();
 
-        progress->progressRange(0, size_t(fileSize) + PROGRESS_OFFSET);
-    }
-    while (pos < size_t(fileSize))
+    // Find the chunks
+    std::vector<size_t> mtrkPos;
+    size_t              pos = fileHeaderSize;
+    while (pos + 8 <= size_t(fileSize))
     {
-        if (progress)
+        if (!strncmp((const char *) file+pos, "MTrk", 4))
         {
-            progress->progress(pos + PROGRESS_OFFSET);
-        }
-
-        if (!strncmp((char *) file+pos, "MTrk", 4))
-        {
-            if (mtrkNo >= fileNoMTrks)
+            if (mtrkPos.size() >= fileNoMTrks)
             {
                 static int message = 0;
                 if (verbose >= 1 && !message)
@@ -532,8 +620,15 @@ Song *MidiFileImport::load(Progress *progress)
                     message = 1;
                 }
             }
-            loadMTrk(pos, song, mtrkNo);
-            ++mtrkNo;
+            mtrkPos.push_back(pos);
+
+            pos += 4;
+            size_t length = readFixed(pos, 4);
+            if (length > size_t(fileSize) - pos)
+            {
+                throw MidiFileImportError("MTrk has invalid size.");
+            }
+            pos += length;
         }
         else
         {
@@ -559,7 +654,7 @@ Song *MidiFileImport::load(Progress *progress)
             const unsigned char szEOT[] = { 0xff, 0x2f, 0x00 };
             while(pos + 2 < (size_t)fileSize)
             {
-                unsigned char* pChar = file + pos;
+                const unsigned char* pChar = file + pos;
                 if(pChar[0] == szEOT[0] && pChar[1] == szEOT[1] && pChar[2] == szEOT[2]) { pos += 3; break; }
                 if(pChar[0] == szTrk[0] && pChar[1] == szTrk[1] && pChar[2] == szTrk[2]) { break ;}
                 pos ++;
@@ -567,12 +662,111 @@ Song *MidiFileImport::load(Progress *progress)
         }
     }
 
+    const size_t      noMTrks = mtrkPos.size();
+    std::vector<MTrk> mtrks(noMTrks);
+    for (size_t n = 0; n < noMTrks; ++n)
+    {
+        mtrks[n].mtrkNo = n;
+    }
+
+    std::unique_ptr<Song> song(new Song(0));
+
+    // Set the Tempo and TimeSig to the defaults
+    // (already done in their constructors)
+
+    // Read the chunks
+    const size_t PROGRESS_OFFSET = 10;
+    if (progress)
+    {
+        // We add PROGRESS_OFFSET to display the fact that the file
+        // has already been loaded into memory, and this may have taken quite
+        // a while already.
+
+        progress->progressRange(0, size_t(fileSize) + PROGRESS_OFFSET);
+    }
+
+    if (verbose >= 1)
+    {
+        threads = 1;
+    }
+    else if (threads <= 0)
+    {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (size_t(threads) > noMTrks) threads = int(noMTrks);
+
+    if (threads <= 1)
+    {
+        // Decode and place each MTrk in turn, so that only one is held
+        // in memory at a time
+        for (size_t n = 0; n < noMTrks; ++n)
+        {
+            if (progress)
+            {
+                progress->progress(mtrkPos[n] + PROGRESS_OFFSET);
+            }
+            decodeMTrk(mtrkPos[n], mtrks[n]);
+            placeMTrk(song.get(), mtrks[n]);
+            std::vector<MidiEvent>().swap(mtrks[n].events);
+        }
+    }
+    else
+    {
+        // The MTrks do not depend on each other or on the Song, so we
+        // decode them all at once (this thread helps out too). Decoding
+        // only fills the MTrk objects, so it takes no lock. Building the
+        // Phrases and placing them into the Song is done in order on this
+        // thread.
+        std::atomic<size_t> next(0);
+        std::exception_ptr  error;
+        std::mutex          errorMutex;
+        auto decodeProc = [&]()
+        {
+            for (size_t n = next++; n < noMTrks; n = next++)
+            {
+                try
+                {
+                    decodeMTrk(mtrkPos[n], mtrks[n]);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error) error = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (int t = 1; t < threads; ++t)
+        {
+            workers.push_back(std::thread(decodeProc));
+        }
+        decodeProc();
+        for (size_t t = 0; t < workers.size(); ++t)
+        {
+            workers[t].join();
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+
+        for (size_t n = 0; n < noMTrks; ++n)
+        {
+            if (progress)
+            {
+                progress->progress(mtrkPos[n] + PROGRESS_OFFSET);
+            }
+            placeMTrk(song.get(), mtrks[n]);
+        }
+    }
+
     if (verbose >= 1)
         out << "\nImported MIDI file successfully."
-            << "  Projected " << fileNoMTrks << " MTrks, got " << mtrkNo
+            << "  Projected " << fileNoMTrks << " MTrks, got " << noMTrks
             << ".\n\n";
 
-    return song;
+    return song.release();
 }
 
 
@@ -580,6 +774,10 @@ void MidiFileImport::loadHeader()
 {
     size_t pos = 0;
 
+    // Too short to hold even the MThd chunk
+    if (size_t(fileSize) < 14)
+        throw MidiFileImportError("No MThd chunk header (not a MIDI file)");
+
     // Read the first 4 byte ID, and if RIFF, skip the extra header prelimaries
     if (strncmp((char *) file+pos, "RIFF", 4) == 0)
     {
@@ -621,7 +819,7 @@ void MidiFileImport::loadHeader()
 }
 
 
-void MidiFileImport::loadMTrk(size_t &pos, Song *song, int mtrkNo)
+void MidiFileImport::decodeMTrk(size_t pos, MTrk &mtrk)
 {
     // We are assured that the chunk is correct: Skip 'MTrk'
     pos += 4;
@@ -630,25 +828,19 @@ void MidiFileImport::loadMTrk(size_t &pos, Song *song, int mtrkNo)
     int length = readFixed(pos, 4);
     if (verbose >= 1) out << "Reading MTrk, length " << length << "\n";
     size_t maxPos = pos+length;
-    if (maxPos > size_t(fileSize))
-    {
-        throw MidiFileImportError("MTrk has invalid size.");
-    }
 
     // Set up and get ready to parse the MIDI data
-    PhraseEdit   phraseEdit;
-    Track       *track      = new Track();
     Clock        time       = 0;                  // Times held in file's PPQN
-    Clock        end        = 0;
     unsigned int status     = MidiCommand_NoteOn; // Running status byte
     int          channel    = 0;                  // Running status channel
     int          port       = 0;
+    mtrk.end                = 0;
 
     while (pos < maxPos)
     {
         Clock deltaTime = readVariable(pos);
         time += deltaTime;
-        end = (time > end) ? time : end;
+        mtrk.end = (time > mtrk.end) ? time : mtrk.end;
         // Get first byte of event, and deal with possible running status
         if (file[pos] & 0x80)
         {
@@ -667,7 +859,7 @@ void MidiFileImport::loadMTrk(size_t &pos, Song *song, int mtrkNo)
         else if (status == MidiCommand_System && channel == 0xf)
         {
             // Meta events
-            loadMeta(pos, song, track, mtrkNo, time, port, end);
+            decodeMeta(pos, mtrk, time, port);
         }
         else
         {
@@ -695,12 +887,81 @@ void MidiFileImport::loadMTrk(size_t &pos, Song *song, int mtrkNo)
                     << "),0x" << data1
                     << ",0x" << data2 << std::dec
                     << " at " << time << "\n";
-            phraseEdit.insert(MidiEvent(MidiCommand(status, channel, port,
-                                                     data1, data2),
-                                        Clock::convert(time, filePPQN)));
+            mtrk.events.push_back(MidiEvent(MidiCommand(status, channel, port,
+                                                        data1, data2),
+                                            Clock::convert(time, filePPQN)));
+        }
+    }
+}
+
+
+void MidiFileImport::placeMTrk(Song *song, MTrk &mtrk)
+{
+    Track *track = new Track();
+
+    // Apply the meta events in the order they appeared
+    for (size_t n = 0; n < mtrk.metas.size(); ++n)
+    {
+        const MTrk::Meta &meta = mtrk.metas[n];
+        switch (meta.type)
+        {
+            case 0x51: // Tempo
+            {
+                if (meta.time == 0)
+                    song->tempoTrack()->erase((*song->tempoTrack())[0]);
+                song->tempoTrack()->insert(Event<Tempo>(Tempo(meta.data1),
+                                           Clock::convert(meta.time,
+                                                          filePPQN)));
+                break;
+            }
+            case 0x58: // Time signature
+            {
+                if (meta.time == 0)
+                    song->timeSigTrack()->erase((*song->timeSigTrack())[0]);
+                song->timeSigTrack()->insert
+                    (Event<TimeSig>(TimeSig(meta.data1, meta.data2),
+                                    Clock::convert(meta.time, filePPQN)));
+                break;
+            }
+            case 0x59: // Key signature
+            {
+                if (meta.time == 0)
+                    song->keySigTrack()->erase((*song->keySigTrack())[0]);
+                song->keySigTrack()->insert
+                    (Event<KeySig>(KeySig(meta.data1, meta.data2),
+                                   Clock::convert(meta.time, filePPQN)));
+                break;
+            }
+            case 0x03: // Sequence/Track name
+            {
+                if ((mtrk.mtrkNo == 0 && fileFormat == 1) || fileFormat == 0)
+                {
+                    song->setTitle(meta.text);
+                }
+                else
+                {
+                    track->setTitle(meta.text);
+                }
+                break;
+            }
+            case 0x02: // Copyright notice
+            {
+                song->setCopyright(meta.text);
+                break;
+            }
         }
     }
 
+    // The PhraseEdit is built here rather than in decodeMTrk, since it
+    // takes the TSE3 Mutex. The events are in time order already, so
+    // recording them is a plain append.
+    PhraseEdit phraseEdit;
+    if (!mtrk.events.empty())
+    {
+        phraseEdit.record(&mtrk.events[0], mtrk.events.size());
+        phraseEdit.mergeRecorded();
+        phraseEdit.tidy();
+    }
     if (phraseEdit.size() == 0)
     {
         if (verbose >= 1) out << "  No MIDI data in this MTrk\n";
@@ -711,7 +972,6 @@ void MidiFileImport::loadMTrk(size_t &pos, Song *song, int mtrkNo)
     if (verbose >= 1) out << "  Placing Phrase, Part, and Track into Song.\n";
 
     // Create a Phrase from this data
-    phraseEdit.tidy();
     Phrase *phrase = phraseEdit.createPhrase(song->phraseList(),
         song->phraseList()->newPhraseTitle(PhraseList::importedString));
     if (verbose >= 2) out << "    Phrase title: " << phrase->title() << "\n";
@@ -719,7 +979,7 @@ void MidiFileImport::loadMTrk(size_t &pos, Song *song, int mtrkNo)
     // Create a Part for this Phrase and place it in th Track
     Part *part = new Part();
     part->setStart(0);
-    part->setEnd(Clock::convert(end, filePPQN));
+    part->setEnd(Clock::convert(mtrk.end, filePPQN));
     part->setPhrase(phrase);
     track->insert(part);
     if (verbose >= 2) out << "    Part between: 0 and " << part->end() << "\n";
@@ -731,9 +991,8 @@ void MidiFileImport::loadMTrk(size_t &pos, Song *song, int mtrkNo)
 }
 
 
-void MidiFileImport::loadMeta(size_t &pos, Song *song, Track *track,
-                              int mtrkNo, Clock time, int &port,
-                              Clock &end)
+void MidiFileImport::decodeMeta(size_t &pos, MTrk &mtrk, Clock time,
+                                int &port)
 {
     if (verbose >= 2) out << "  Meta event: ";
 
@@ -744,6 +1003,12 @@ void MidiFileImport::loadMeta(size_t &pos, Song *song, Track *track,
         out << "(type: 0x" << std::hex << metaType << std::dec
             << ", length:" << length << ") ";
 
+    // Events for the Song are kept until the MTrk is placed
+    MTrk::Meta meta;
+    meta.type  = metaType;
+    meta.time  = time;
+    meta.data1 = meta.data2 = 0;
+
     switch (metaType)
     {
         case 0x21: // MIDI port
@@ -755,7 +1020,7 @@ void MidiFileImport::loadMeta(size_t &pos, Song *song, Track *track,
         case 0x2f: // End of track
         {
             if (verbose >= 2) out << "end track marker at time " << time;
-            end = time;
+            mtrk.end = time;
             break;
         }
         case 0x51: // Tempo
@@ -765,10 +1030,8 @@ void MidiFileImport::loadMeta(size_t &pos, Song *song, Track *track,
             length -= 3;
             tempo = 60000000/tempo; // convert to BPM
             if (verbose >= 2) out << "tempo event (" << tempo << ")";
-            if (time == 0)
-                song->tempoTrack()->erase((*song->tempoTrack())[0]);
-            song->tempoTrack()->insert(Event<Tempo>(Tempo(tempo),
-                                       Clock::convert(time, filePPQN)));
+            meta.data1 = tempo;
+            mtrk.metas.push_back(meta);
             break;
         }
         case 0x58: // Time signature
@@ -781,10 +1044,9 @@ void MidiFileImport::loadMeta(size_t &pos, Song *song, Track *track,
             dd = (int) pow((float)2, dd);
             if (verbose >= 2)
                 out << "timesig event (" << nn << "/" << dd << ")";
-            if (time == 0)
-                song->timeSigTrack()->erase((*song->timeSigTrack())[0]);
-            song->timeSigTrack()->insert(Event<TimeSig>(TimeSig(nn, dd),
-                                         Clock::convert(time, filePPQN)));
+            meta.data1 = nn;
+            meta.data2 = dd;
+            mtrk.metas.push_back(meta);
             break;
         }
         case 0x59: // Key signature
@@ -795,10 +1057,9 @@ void MidiFileImport::loadMeta(size_t &pos, Song *song, Track *track,
             length -= 2;
             if (verbose >= 2)
                 out << "keysig event (" << sf << "-" << mi << ")";
-            if (time == 0)
-                song->keySigTrack()->erase((*song->keySigTrack())[0]);
-            song->keySigTrack()->insert(Event<KeySig>(KeySig(sf, mi),
-                                        Clock::convert(time, filePPQN)));
+            meta.data1 = sf;
+            meta.data2 = mi;
+            mtrk.metas.push_back(meta);
             break;
         }
         case 0x00: // Sequence number
@@ -823,23 +1084,24 @@ void MidiFileImport::loadMeta(size_t &pos, Song *song, Track *track,
                 }
                 if (verbose >= 2)
                     out << "sequence/track name: (" << title << ")";
-                if ((mtrkNo == 0 && fileFormat == 1) || fileFormat == 0)
+                if ((mtrk.mtrkNo == 0 && fileFormat == 1) || fileFormat == 0)
                 {
                     if (verbose >= 2) out << " (sequence name)";
-                    song->setTitle(title);
                 }
                 else
                 {
                     if (verbose >= 2) out << " (track name)";
-                    track->setTitle(title);
                 }
+                meta.text = title;
+                mtrk.metas.push_back(meta);
             }
             break;
         }
         case 0x02: // Copyright notice
         {
             if (verbose >= 2) out << "copyright notice";
-            song->setCopyright((char *) file+pos);
+            meta.text.assign((const char *) file+pos, length);
+            mtrk.metas.push_back(meta);
             break;
         }
         case 0x04: // Instrument name
@@ -886,7 +1148,7 @@ void MidiFileImport::loadMeta(size_t &pos, Song *song, Track *track,
 }
 
 
-int MidiFileImport::readFixed(size_t &pos, int length)
+int MidiFileImport::readFixed(size_t &pos, int length) const
 {
     int value = 0;
     while (length-- > 0 && pos < size_t(fileSize))
@@ -895,7 +1157,7 @@ int MidiFileImport::readFixed(size_t &pos, int length)
 }
 
 
-int MidiFileImport::readVariable(size_t &pos)
+int MidiFileImport::readVariable(size_t &pos) const
 {
     char c;
     int value = 0;
@@ -913,7 +1175,8 @@ int MidiFileImport::readVariable(size_t &pos)
 
 PlayableIterator *MidiFileImport::iterator(Clock index)
 {
-    return new MidiFileImportIterator(this, index, true);
+    // Playback does not need the last clock, so don't scan the whole file
+    return new MidiFileImportIterator(this, index);
 }
 
 
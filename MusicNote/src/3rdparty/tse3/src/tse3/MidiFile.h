@@ -70,6 +70,11 @@ namespace TSE3
              * If the file fails to open, then a @ref MidiFileImportError
              * exception is thrown.
              *
+             * The file is mapped into memory read-only where the platform
+             * allows, rather than copied. Only the header is read here: the
+             * MTrks are decoded as they are played through the
+             * @ref Playable interface, or by @ref load().
+             *
              * @param  filename Filename of MIDI file to import.
              * @param  verbose  Level of diagnostic output to produce
              *                  0: none,
@@ -91,12 +96,22 @@ namespace TSE3
              * This Song object has been newed by the MidiFileImport object;
              * it is your responsability to delete it.
              *
+             * By default the MTrks are decoded and placed into the
+             * @ref Song one at a time on the calling thread. Given more
+             * @p threads, the MTrks are decoded in parallel into plain
+             * event lists (which takes no lock), then made into Phrases
+             * and placed into the @ref Song in file order. Verbose
+             * diagnostic output makes the decoding happen one MTrk at a
+             * time, so that the report stays readable.
+             *
              * @param  progress Object to call back to, or zero for no
              *                  progress information
+             * @param  threads  Number of threads to decode MTrks with,
+             *                  zero for one per hardware thread
              * @return New imported @ref Song - you must delete it
              * @throws MidiFileImportError
              */
-            Song *load(Progress *progress = 0);
+            Song *load(Progress *progress = 0, int threads = 1);
 
             /**
              * @reimplemented
@@ -120,25 +135,38 @@ namespace TSE3
 
         private:
 
+            struct MTrk;
+
             /**
              * Loads the MIDI file header.
              */
             void loadHeader();
 
             /**
-             * Loads an MTrk chunk.
+             * Unmaps (or deletes) the file data.
+             */
+            void releaseFile();
+
+            /**
+             * Decodes an MTrk chunk into @p mtrk. This does not touch any
+             * @ref Song or take any lock, so many MTrks can be decoded at
+             * once.
              *
-             * @param mtrkNo The MTrk's number, only used by the meta event
-             *               loader.
+             * @param pos  Position of the MTrk chunk in the file
+             * @param mtrk Holds the MTrk's number, filled with the decoded
+             *             data
+             */
+            void decodeMTrk(size_t pos, MTrk &mtrk);
+
+            /**
+             * Decodes a meta event in an MTrk chunk.
              */
-            void loadMTrk(size_t &pos, Song *song, int mtrkNo);
+            void decodeMeta(size_t &pos, MTrk &mtrk, Clock time, int &port);
 
             /**
-             * Loads a meta event in an MTrk chunk.
+             * Places a decoded MTrk into the @ref Song.
              */
-            void loadMeta(size_t &pos, Song *song, Track *track,
-                          int mtrkNo, Clock time, int &port,
-                          Clock &end);
+            void placeMTrk(Song *song, MTrk &mtrk);
 
             /**
              * Reads a fixed length big endian value from position pos in
@@ -148,7 +176,7 @@ namespace TSE3
              * @param pos    Position in file to read from.
              * @param length No bytes to read.
              */
-            int readFixed(size_t &pos, int length);
+            int readFixed(size_t &pos, int length) const;
 
             /**
              * Reads a variable size value as defined by the MIDI file standard.
@@ -157,14 +185,15 @@ namespace TSE3
              *
              * @param pos Position in file to read from.
              */
-            int readVariable(size_t &pos);
+            int readVariable(size_t &pos) const;
 
             std::string   filename;
             int           verbose;
             std::ostream &out;
 
-            unsigned char  *file;
-            std::streampos  fileSize;
+            const unsigned char *file;
+            std::streampos       fileSize;
+            bool                 fileMapped;    // file is mmapped, not newed
 
             int            filePPQN, fileFormat;        // set up by
             size_t         fileNoMTrks, fileHeaderSize; // loadHeader
@@ -19,6 +19,8 @@
 #include "tse3/FileBlockParser.h"
 #include "tse3/Mutex.h"
 
+#include <algorithm>
+
 using namespace TSE3;
 
 /******************************************************************************
@@ -36,6 +38,45 @@ namespace
     compile_assertion<sizeof(unsigned int)*8 >= 16> uint_size_test;
 }
 
+/******************************************************************************
+ * MidiFilterTable class
+ *****************************************************************************/
+
+/**
+ * The compiled form of a MidiFilter's parameters. Once published it is never
+ * altered, so MidiFilter::filter can read it without a lock.
+ */
+class TSE3::Impl::MidiFilterTable
+{
+    public:
+
+        unsigned int  passChannels;  // bit set for each channel let through
+        int           channel;
+        int           port;
+        Clock         offset;
+        int           timeScale;
+        Clock         quantise;
+        Clock         minLength;
+        Clock         maxLength;
+        signed char   note[256];     // transposed note, or -1 if out of range
+        unsigned char velocity[256]; // scaled and clipped velocity
+
+        bool operator==(const MidiFilterTable &t) const
+        {
+            return passChannels == t.passChannels
+                && channel      == t.channel
+                && port         == t.port
+                && offset       == t.offset
+                && timeScale    == t.timeScale
+                && quantise     == t.quantise
+                && minLength    == t.minLength
+                && maxLength    == t.maxLength
+                && std::equal(note, note+256, t.note)
+                && std::equal(velocity, velocity+256, t.velocity);
+        }
+};
+
+
 /******************************************************************************
  * MidiFilter class
  *****************************************************************************/
@@ -47,8 +88,10 @@ MidiFilter::MidiFilter()
   _offset(0), _timeScale(100), _quantise(0),
   _minLength(0), _maxLength(-1),
   _transpose(0),
-  _minVelocity(0), _maxVelocity(127), _velocityScale(100)
+  _minVelocity(0), _maxVelocity(127), _velocityScale(100),
+  table(0)
 {
+    compile();
 }
 
 
@@ -61,8 +104,10 @@ MidiFilter:: MidiFilter(const MidiFilter &s)
   _minLength(s._minLength), _maxLength(s._maxLength),
   _transpose(s._transpose),
   _minVelocity(s._minVelocity), _maxVelocity(s._maxVelocity),
-  _velocityScale(s._velocityScale)
+  _velocityScale(s._velocityScale),
+  table(0)
 {
+    compile();
 }
 
 
@@ -83,6 +128,7 @@ MidiFilter &MidiFilter::operator=(const MidiFilter &s)
     _minVelocity   = s._minVelocity;
     _maxVelocity   = s._maxVelocity;
     _velocityScale = s._velocityScale;
+    compile();
 
     notify(&MidiFilterListener::MidiFilter_Altered,
            MidiFilterListener::StatusChanged);
@@ -95,11 +141,54 @@ MidiFilter::~MidiFilter()
 }
 
 
+void MidiFilter::setChannelFilter(int c)
+{
+    Impl::CritSec cs;
+
+    _channelFilter = c;
+    compile();
+}
+
+
+void MidiFilter::compile()
+{
+    Impl::MidiFilterTable *t = new Impl::MidiFilterTable;
+
+    t->passChannels = _status ? (_channelFilter & 0xffff) : 0;
+    t->channel      = _channel;
+    t->port         = _port;
+    t->offset       = _offset;
+    t->timeScale    = _timeScale;
+    t->quantise     = _quantise;
+    t->minLength    = _minLength;
+    t->maxLength    = _maxLength;
+
+    for (int n = 0; n < 256; ++n)
+    {
+        int note = n + _transpose;
+        t->note[n] = (note >= 0 && note <= 127) ? note : -1;
+
+        int velocity = n;
+        if (_velocityScale != 100)
+        {
+            velocity *= _velocityScale;
+            velocity /= 100;
+        }
+        if (velocity < _minVelocity) velocity = _minVelocity;
+        if (velocity > _maxVelocity) velocity = _maxVelocity;
+        t->velocity[n] = velocity;
+    }
+
+    table.publish(t);
+}
+
+
 void MidiFilter::setStatus(bool s)
 {
     Impl::CritSec cs;
 
     _status = s;
+    compile();
     notify(&MidiFilterListener::MidiFilter_Altered,
            MidiFilterListener::StatusChanged);
 }
@@ -112,6 +201,7 @@ void MidiFilter::setChannelFilter(int c, bool val)
     if (c < 0 || c > 15) return;
     _channelFilter &= ~(1<<c);
     if (val) _channelFilter |= 1<<c;
+    compile();
     notify(&MidiFilterListener::MidiFilter_Altered,
            MidiFilterListener::ChannelFilterChanged);
 }
@@ -122,6 +212,7 @@ void MidiFilter::setChannel(int c)
     Impl::CritSec cs;
 
     _channel = c;
+    compile();
     notify(&MidiFilterListener::MidiFilter_Altered,
            MidiFilterListener::ChannelChanged);
 }
@@ -132,6 +223,7 @@ void MidiFilter::setPort(int p)
     Impl::CritSec cs;
 
     _port = p;
+    compile();
     notify(&MidiFilterListener::MidiFilter_Altered,
            MidiFilterListener::PortChanged);
 }
@@ -142,6 +234,7 @@ void MidiFilter::setOffset(Clock o)
     Impl::CritSec cs;
 
     _offset = o;
+    compile();
     notify(&MidiFilterListener::MidiFilter_Altered,
            MidiFilterListener::OffsetChanged);
 }
@@ -151,6 +244,7 @@ void MidiFilter::setTimeScale(int t)
     Impl::CritSec cs;
 
     if (t >= 1 && t <= 500) _timeScale = t;
+    compile();
     notify(&MidiFilterListener::MidiFilter_Altered,
            MidiFilterListener::TimeScaleChanged);
 }
@@ -161,6 +255,7 @@ void MidiFilter::setQuantise(Clock q)
     Impl::CritSec cs;
 
     if (q >= 0) _quantise = q;
+    compile();
     notify(&MidiFilterListener::MidiFilter_Altered,
            MidiFilterListener::QuantiseChanged);
 }
@@ -171,6 +266,7 @@ void MidiFilter::setMinLength(Clock m)
     Impl::CritSec cs;
 
     if (m >= 0) _minLength = m;
+    compile();
     notify(&MidiFilterListener::MidiFilter_Altered,
            MidiFilterListener::MinLengthChanged);
 }
@@ -181,6 +277,7 @@ void MidiFilter::setMaxLength(Clock m)
     Impl::CritSec cs;
 
     if (m >=-10) _maxLength = m;
+    compile();
     notify(&MidiFilterListener::MidiFilter_Altered,
            MidiFilterListener::MaxLengthChanged);
 }
@@ -191,6 +288,7 @@ void MidiFilter::setTranspose(int t)
     Impl::CritSec cs;
 
     if (t >= -127 && t <= 127) _transpose = t;
+    compile();
     notify(&MidiFilterListener::MidiFilter_Altered,
            MidiFilterListener::TransposeChanged);
 }
@@ -201,6 +299,7 @@ void MidiFilter::setMinVelocity(int v)
     Impl::CritSec cs;
 
     if (v >= 0 && v <= 127) _minVelocity = v;
+    compile();
     notify(&MidiFilterListener::MidiFilter_Altered,
            MidiFilterListener::MinVelocityChanged);
 }
@@ -211,6 +310,7 @@ void MidiFilter::setMaxVelocity(int v)
     Impl::CritSec cs;
 
     if (v >= 0 && v <= 127) _maxVelocity = v;
+    compile();
     notify(&MidiFilterListener::MidiFilter_Altered,
            MidiFilterListener::MaxVelocityChanged);
 }
@@ -221,6 +321,7 @@ void MidiFilter::setVelocityScale(int v)
     Impl::CritSec cs;
 
     if (v >= 1 && v <= 200) _velocityScale = v;
+    compile();
     notify(&MidiFilterListener::MidiFilter_Altered,
            MidiFilterListener::VelocityScaleChanged);
 }
@@ -228,10 +329,11 @@ void MidiFilter::setVelocityScale(int v)
 
 MidiEvent MidiFilter::filter(const MidiEvent &event) const
 {
-    Impl::CritSec cs;
+    Impl::SnapshotReader reader;
+    const Impl::MidiFilterTable *t = table.get();
 
-    if (!_status
-        || !(_channelFilter & (1<<event.data.channel)))
+    unsigned int c = event.data.channel;
+    if (c > 15 || !(t->passChannels & (1<<c)))
     {
         return MidiEvent();
     }
@@ -242,49 +344,49 @@ MidiEvent MidiFilter::filter(const MidiEvent &event) const
     // It wouldn't be hard to check with MidiCommand::isChannel()
 
     // Channel
-    if (_channel != MidiCommand::SameChannel)
+    if (t->channel != MidiCommand::SameChannel)
     {
-        e.data.channel    = _channel;
-        e.offData.channel = _channel;
+        e.data.channel    = t->channel;
+        e.offData.channel = t->channel;
     }
 
     // Port
-    if (_port != MidiCommand::SamePort)
+    if (t->port != MidiCommand::SamePort)
     {
-        e.data.port    = _port;
-        e.offData.port = _port;
+        e.data.port    = t->port;
+        e.offData.port = t->port;
     }
 
     // Offset
-    e.time -= _offset;
+    e.time -= t->offset;
     if (e.data.status == MidiCommand_NoteOn)
     {
-        e.offTime -= _offset;
+        e.offTime -= t->offset;
     }
 
     // Time scale
-    if (_timeScale != 100)
+    if (t->timeScale != 100)
     {
-        e.time *= _timeScale;
+        e.time *= t->timeScale;
         e.time /= 100;
-    }
-    if (e.data.status == MidiCommand_NoteOn && _timeScale != 100)
-    {
-        e.offTime *= _timeScale;
-        e.offTime /= 100;
+        if (e.data.status == MidiCommand_NoteOn)
+        {
+            e.offTime *= t->timeScale;
+            e.offTime /= 100;
+        }
     }
 
     // Quantise
-    if (_quantise != 0)
+    if (t->quantise != 0)
     {
-        e.time += _quantise/2;
-        e.time /= _quantise;
-        e.time *= _quantise;
+        e.time += t->quantise/2;
+        e.time /= t->quantise;
+        e.time *= t->quantise;
         if (e.data.status == MidiCommand_NoteOn)
         {
-            e.offTime += _quantise/2;
-            e.offTime /= _quantise;
-            e.offTime *= _quantise;
+            e.offTime += t->quantise/2;
+            e.offTime /= t->quantise;
+            e.offTime *= t->quantise;
         }
     }
 
@@ -292,49 +394,34 @@ MidiEvent MidiFilter::filter(const MidiEvent &event) const
         || e.data.status == MidiCommand_KeyPressure)
     {
         // Transpose
+        int note = t->note[e.data.data1];
+        if (note >= 0)
         {
-            int note = e.data.data1 + _transpose;
-            if (note >= 0 && note <= 127)
-            {
-                e.data.data1    = note;
-                e.offData.data1 = note;
-            } else
-            {
-                e.data.status = MidiCommand_Invalid;
-            }
+            e.data.data1    = note;
+            e.offData.data1 = note;
+        }
+        else
+        {
+            e.data.status = MidiCommand_Invalid;
         }
-
     }
 
     if (e.data.status == MidiCommand_NoteOn)
     {
         // Min length
-        if (e.offTime - e.time < _minLength)
+        if (e.offTime - e.time < t->minLength)
         {
-            e.offTime = e.time + _minLength;
+            e.offTime = e.time + t->minLength;
         }
 
         // Max Length
-        if (_maxLength >= 0 && e.offTime - e.time > _maxLength)
+        if (t->maxLength >= 0 && e.offTime - e.time > t->maxLength)
         {
-            e.offTime = e.time + _maxLength;
-        }
-
-        // Velocity things
-        {
-            int velocity = e.data.data2;
-
-            if (_velocityScale != 100)
-            {
-                velocity *= _velocityScale;
-                velocity /= 100;
-            }
-            if (velocity < _minVelocity) velocity = _minVelocity;
-            if (velocity > _maxVelocity) velocity = _maxVelocity;
-
-            e.data.data2 = velocity;
+            e.offTime = e.time + t->maxLength;
         }
 
+        // Velocity window and scale
+        e.data.data2 = t->velocity[e.data.data2];
     }
 
     return e;
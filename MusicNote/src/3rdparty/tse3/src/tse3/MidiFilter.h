@@ -23,9 +23,15 @@
 #include "tse3/Serializable.h"
 #include "tse3/Midi.h"
 #include "tse3/Notifier.h"
+#include "tse3/Snapshot.h"
 
 namespace TSE3
 {
+    namespace Impl
+    {
+        class MidiFilterTable;
+    }
+
     /**
      * This the a standard (and comprehensive) @ref Filter object type that is
      * used by the TSE3 library.
@@ -41,6 +47,11 @@ namespace TSE3
      *     @li velocity window clipping
      *     @li velocity scaling
      *
+     * Whenever a parameter changes, the filter is compiled into lookup
+     * tables indexed by channel, note and velocity. The @ref filter method
+     * reads these without taking a lock, so it is cheap to call from the
+     * playback thread.
+     *
      * @sect Command classes
      *
      * Use the following command classes to manipute this object in a undo/redo
@@ -339,7 +350,13 @@ namespace TSE3
 
         private:
 
-            void setChannelFilter(int c) { _channelFilter = c; }
+            void setChannelFilter(int c);
+
+            /**
+             * Builds the lookup tables from the current parameters and
+             * publishes them for @ref filter. Call with the lock held.
+             */
+            void compile();
 
             bool         _status;
             unsigned int _channelFilter;
@@ -354,6 +371,8 @@ namespace TSE3
             int          _minVelocity;
             int          _maxVelocity;
             int          _velocityScale;
+
+            Impl::Snapshot<Impl::MidiFilterTable> table;
     };
 }
 
@@ -18,6 +18,8 @@
 
 #include "tse3/MidiScheduler.h"
 #include "tse3/Midi.h"
+#include "tse3/Mutex.h"
+#include "tse3/Snapshot.h"
 
 #include <vector>
 
@@ -32,7 +34,26 @@ class TSE3::MidiMapperImpl
 {
     public:
 
-        std::vector<int> map;
+        MidiMapperImpl() : table(0) {}
+
+        /**
+         * Publishes the current map for MidiMapper::filter.
+         */
+        void compile()
+        {
+            table.publish(new std::vector<int>(map));
+        }
+
+        /**
+         * Returns the mapping for @p port in the published table @p t.
+         */
+        static int lookup(const std::vector<int> &t, int port)
+        {
+            return (port >= 0 && port < (int)t.size()) ? t[port] : port;
+        }
+
+        std::vector<int>                  map;
+        Impl::Snapshot<std::vector<int> > table;
 };
 
 
@@ -55,19 +76,15 @@ MidiMapper::~MidiMapper()
 
 const int MidiMapper::map(int fromPort) const
 {
-    if (fromPort >= (int)pimpl->map.size())
-    {
-        return fromPort;
-    }
-    else
-    {
-        return pimpl->map[fromPort];
-    }
+    Impl::SnapshotReader reader;
+    return MidiMapperImpl::lookup(*pimpl->table.get(), fromPort);
 }
 
 
 void MidiMapper::setMap(int fromPort, int toPort)
 {
+    Impl::CritSec cs;
+
     if (fromPort == MidiCommand::NoPort
         || fromPort == MidiCommand::AllPorts)
     {
@@ -84,25 +101,29 @@ void MidiMapper::setMap(int fromPort, int toPort)
         }
     }
     pimpl->map[fromPort] = toPort;
+    pimpl->compile();
     notify(&MidiMapperListener::MidiMapper_Altered, fromPort);
 }
 
 
 int MidiMapper::maximumMap() const
 {
+    Impl::CritSecRead cs;
+
     return pimpl->map.size()-1;
 }
 
 
 MidiEvent MidiMapper::filter(const MidiEvent &m) const
 {
+    Impl::SnapshotReader reader;
+    const std::vector<int> *t = pimpl->table.get();
+
     MidiEvent me = m;
-    int       p  = me.data.port;
-    me.data.port = map(p);
+    me.data.port = MidiMapperImpl::lookup(*t, me.data.port);
     if (me.data.status == MidiCommand_NoteOn)
     {
-        int p = me.offData.port;
-        me.offData.port = map(p);
+        me.offData.port = MidiMapperImpl::lookup(*t, me.offData.port);
     }
     return me;
 }
@@ -110,8 +131,11 @@ MidiEvent MidiMapper::filter(const MidiEvent &m) const
 
 void MidiMapper::reset()
 {
+    Impl::CritSec cs;
+
     pimpl->map.clear();
     pimpl->map.push_back(0); // MidiCommand::NoPort
     pimpl->map.push_back(1); // MidiCommand::AllPorts
+    pimpl->compile();
     notify(&MidiMapperListener::MidiMapper_Altered, 0);
 }
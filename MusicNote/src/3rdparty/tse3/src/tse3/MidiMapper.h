@@ -15,7 +15,7 @@
  */
 
 #ifndef TSE3_MIDIMAPPER_H
-#define TSE3_MIDIMAPPER_h
+#define TSE3_MIDIMAPPER_H
 
 #include "tse3/listen/MidiMapper.h"
 
@@ -37,6 +37,9 @@ namespace TSE3
      * ports that aren't mapped, the mapper will let the event
      * through unchanged.
      *
+     * Each change to the mappings publishes a new port lookup table, so
+     * @ref filter never takes a lock.
+     *
      * @short   MidiEvent port destination mapper
      * @author  Pete Goodliffe
      * @version 3.00
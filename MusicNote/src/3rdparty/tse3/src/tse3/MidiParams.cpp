@@ -362,7 +362,7 @@ void MidiParams::setVolume(int v)
 
 MidiEvent MidiParams::filter(const MidiEvent &e) const
 {
-    Impl::CritSec cs;
+    Impl::CritSecRead cs;
 
     if (_bankLSB == forceNone
         && e.data.status == MidiCommand_ControlChange
@@ -19,6 +19,8 @@
 
 #include "tse3/MidiScheduler.h"
 
+#include <thread>
+
 using namespace TSE3;
 
 namespace
@@ -231,6 +233,58 @@ void MidiScheduler::tx(MidiEvent me)
 }
 
 
+void MidiScheduler::tx(const MidiEvent *events, size_t count)
+{
+    _txBatch.clear();
+    for (size_t n = 0; n < count; ++n)
+    {
+        MidiEvent me = events[n];
+        if (me.data.port != MidiCommand::AllPorts)
+        {
+            if (lookUpPortNumber(me.data) && validChannel(me.data))
+            {
+                _txBatch.push_back(me);
+            }
+        }
+        else
+        {
+            for (size_t port = 0; port < _portNumbers.size(); ++port)
+            {
+                me.data.port = _portNumbers[port].second.index;
+                _txBatch.push_back(me);
+            }
+        }
+    }
+    if (!_txBatch.empty())
+    {
+        impl_tx(&_txBatch[0], _txBatch.size());
+    }
+}
+
+
+void MidiScheduler::impl_tx(const MidiEvent *events, size_t count)
+{
+    for (size_t n = 0; n < count; ++n)
+    {
+        impl_tx(events[n]);
+    }
+}
+
+
+void MidiScheduler::impl_waitForInput
+    (std::chrono::steady_clock::time_point until)
+{
+    std::chrono::steady_clock::time_point check
+        = std::chrono::steady_clock::now() + std::chrono::milliseconds(1);
+    std::this_thread::sleep_until(check < until ? check : until);
+}
+
+
+void MidiScheduler::impl_wakeInputWait()
+{
+}
+
+
 void MidiScheduler::txSysEx(int port, const unsigned char *data, size_t size)
 {
     if (port != MidiCommand::AllPorts)
@@ -27,6 +27,7 @@
 #include <cstddef>
 #include <vector>
 #include <cstring>
+#include <chrono>
 
 namespace TSE3
 {
@@ -471,6 +472,35 @@ namespace TSE3
              */
             bool eventWaiting() { return this->impl_eventWaiting(); }
 
+            /**
+             * Waits until there may be input to read (see
+             * @ref eventWaiting), until the time @p until or until
+             * @ref wakeInputWait is called, whichever comes first. It does
+             * not read any input itself, so it is safe to call whilst
+             * another thread uses the scheduler.
+             *
+             * Schedulers that can be told of arriving input sleep until
+             * then. The others return at least once a millisecond so that
+             * the caller can look.
+             *
+             * The @ref Transport engine thread waits here whilst it is
+             * interested in input.
+             *
+             * @param until Time to give up waiting at
+             * @see   wakeInputWait
+             */
+            void waitForInput(std::chrono::steady_clock::time_point until)
+            {
+                this->impl_waitForInput(until);
+            }
+
+            /**
+             * Makes a @ref waitForInput call on another thread return
+             * early. If no thread is waiting the next call may return at
+             * once, which is harmless.
+             */
+            void wakeInputWait() { this->impl_wakeInputWait(); }
+
             /**
              * Return and remove a @ref MidiEvent from scheduler receive
              * buffer.
@@ -516,6 +546,20 @@ namespace TSE3
              */
             void tx(MidiEvent event);
 
+            /**
+             * Adds a batch of events to the scheduler transmit buffer, as if
+             * each was given to @ref tx(MidiEvent) in turn.
+             *
+             * The events must be <b>in time order</b>, as with the single
+             * event version. Implementations may hand the whole batch to the
+             * hardware in one go, which is cheaper than event by event
+             * (the @ref Transport schedules each look ahead window this way).
+             *
+             * @param events @ref MidiEvents to schedule for transmission
+             * @param count  The number of events in @p events
+             */
+            void tx(const MidiEvent *events, size_t count);
+
             /*
              * Transmit a MIDI "system exclusive" data section immeditately.
              * The data is prepended by a MidiSystem_SysExStart status byte,
@@ -672,6 +716,21 @@ namespace TSE3
              */
             virtual void impl_setTempo(int tempo, Clock changeTime) = 0;
             virtual bool impl_eventWaiting() = 0;
+            /**
+             * Wait for input as described in @ref waitForInput. Don't
+             * read any input here.
+             *
+             * The default implementation sleeps for a millisecond at most.
+             * Override it (and @ref impl_wakeInputWait) if the platform can
+             * wait for input without polling.
+             */
+            virtual void impl_waitForInput
+                (std::chrono::steady_clock::time_point until);
+            /**
+             * Make a waiting impl_waitForInput return. The default
+             * implementation does nothing, since its wait is short anyway.
+             */
+            virtual void impl_wakeInputWait();
             /**
              * You'll buffer all MidiEvents recieved. Returns the top
              * buffered MidiEvent (or MidiEvent() if none are buffered).
@@ -694,6 +753,18 @@ namespace TSE3
              * Timer may be running or not.
              */
             virtual void impl_tx(MidiEvent mc) = 0;
+            /**
+             * Puts a batch of MidiEvents, in time order, on the queue ready
+             * for transmission. The events have had their ports looked up
+             * already, as for the single event impl_tx.
+             *
+             * The default implementation calls the single event impl_tx for
+             * each of them; override it if the platform can take the events
+             * in one go.
+             *
+             * Timer may be running or not.
+             */
+            virtual void impl_tx(const MidiEvent *events, size_t count);
             /**
              * Send a sysex package now, bypassing the transsion queue.
              */
@@ -840,6 +911,12 @@ namespace TSE3
 
             port_vector    _portNumbers;
 
+            /**
+             * The events of a batch tx after the port look up, kept to
+             * reuse its storage.
+             */
+            std::vector<MidiEvent> _txBatch;
+
             int            _tempo;
             bool           _remote;
             bool           _consumeRemote;
@@ -22,6 +22,8 @@ using namespace TSE3::Impl;
 
 MutexImpl *Mutex::globalImpl = 0;
 
+thread_local int Mutex::locksHeld = 0;
+
 
 Mutex::~Mutex()
 {
@@ -49,7 +51,7 @@ void Mutex::setImpl(MutexImpl *impl)
         // This is not really very likely, though, so we ignore it.
     }
 
-#ifndef TSE3_WITHOUT_MUTEX
+#ifdef TSE3_WITHOUT_MUTEX
     std::cerr << "TSE3: *Warning* MutexImpl supplied to a TSE3 library which\n"
               << "      has been built without multi-thread support.\n"
               << "      The MutexImpl will not be used, and you may\n"
@@ -72,3 +74,111 @@ Mutex *Mutex::mutex()
     return mutex;
 }
 
+
+/******************************************************************************
+ * RWMutexImpl class
+ *****************************************************************************/
+
+RWMutexImpl::RWMutexImpl()
+: writerDepth(0), writersWaiting(0)
+{
+}
+
+
+void RWMutexImpl::lock()
+{
+    std::unique_lock<std::mutex> l(m);
+    std::thread::id self = std::this_thread::get_id();
+
+    if (writerDepth && writer == self)
+    {
+        ++writerDepth;
+        return;
+    }
+
+    ++writersWaiting;
+    while (writerDepth || !readers.empty())
+    {
+        cv.wait(l);
+    }
+    --writersWaiting;
+
+    writer      = self;
+    writerDepth = 1;
+}
+
+
+void RWMutexImpl::unlock()
+{
+    std::lock_guard<std::mutex> l(m);
+
+    if (writerDepth && writer == std::this_thread::get_id())
+    {
+        if (--writerDepth == 0)
+        {
+            cv.notify_all();
+        }
+    }
+}
+
+
+bool RWMutexImpl::locked()
+{
+    std::lock_guard<std::mutex> l(m);
+    return writerDepth || !readers.empty();
+}
+
+
+void RWMutexImpl::lockShared()
+{
+    std::unique_lock<std::mutex> l(m);
+    std::thread::id self = std::this_thread::get_id();
+
+    // A writer reading its own data just nests its write lock
+    if (writerDepth && writer == self)
+    {
+        ++writerDepth;
+        return;
+    }
+
+    // A thread already reading goes straight in: making it wait for a
+    // waiting writer would have the two wait on each other
+    std::map<std::thread::id, int>::iterator i = readers.find(self);
+    if (i != readers.end())
+    {
+        ++i->second;
+        return;
+    }
+
+    while (writerDepth || writersWaiting)
+    {
+        cv.wait(l);
+    }
+    readers[self] = 1;
+}
+
+
+void RWMutexImpl::unlockShared()
+{
+    std::lock_guard<std::mutex> l(m);
+    std::thread::id self = std::this_thread::get_id();
+
+    if (writerDepth && writer == self)
+    {
+        if (--writerDepth == 0)
+        {
+            cv.notify_all();
+        }
+        return;
+    }
+
+    std::map<std::thread::id, int>::iterator i = readers.find(self);
+    if (i != readers.end() && --i->second == 0)
+    {
+        readers.erase(i);
+        if (readers.empty())
+        {
+            cv.notify_all();
+        }
+    }
+}
@@ -17,6 +17,11 @@
 #ifndef TSE3_MUTEX_H
 #define TSE3_MUTEX_H
 
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
 namespace TSE3
 {
     namespace Impl
@@ -82,6 +87,34 @@ namespace TSE3
                  * @see unlock
                  */
                 virtual bool locked() = 0;
+
+                /**
+                 * Locks the mutex for reading only.
+                 *
+                 * Any number of threads may hold the mutex for reading at
+                 * the same time; a thread that calls @ref lock waits until
+                 * they have all unlocked it. A thread that holds the mutex
+                 * (either way) may lock it for reading again.
+                 *
+                 * A thread that holds the mutex for reading must not call
+                 * @ref lock until it has released its read locks.
+                 *
+                 * The default implementation calls @ref lock, so that a
+                 * MutexImpl without a notion of readers still works, if
+                 * with no concurrency between the readers.
+                 *
+                 * @see unlockShared
+                 */
+                virtual void lockShared() { lock(); }
+
+                /**
+                 * Unlocks a read lock taken with @ref lockShared.
+                 *
+                 * The default implementation calls @ref unlock.
+                 *
+                 * @see lockShared
+                 */
+                virtual void unlockShared() { unlock(); }
         };
 
         /**
@@ -124,6 +157,77 @@ namespace TSE3
                 int _locked;
         };
 
+        /**
+         * A @ref MutexImpl class based on the standard C++ thread library
+         * that lets many readers in at once.
+         *
+         * Writers (@ref lock) have the mutex to themselves, whilst any
+         * number of readers (@ref lockShared) may share it. Both kinds of
+         * lock are recursive, and a writer may take read locks too.
+         * Waiting writers are let in before new readers, so a stream of
+         * readers (such as the @ref Transport playback) does not keep an
+         * edit waiting forever.
+         *
+         * Since the TSE3 methods that only look at the data take read
+         * locks, the playback thread no longer waits on other threads
+         * reading the @ref Song, only on the ones editing it.
+         *
+         * To use it, call
+         * <pre>
+         *     TSE3::Impl::Mutex::setImpl(new TSE3::Impl::RWMutexImpl());
+         * </pre>
+         * before using any other TSE3 API.
+         *
+         * This class was added to this copy of TSE3; it is not part of the
+         * upstream release.
+         *
+         * @short   Reader/writer @ref MutexImpl class
+         * @version 3.00
+         * @see     MutexImpl
+         */
+        class RWMutexImpl : public MutexImpl
+        {
+            public:
+
+                RWMutexImpl();
+
+                virtual ~RWMutexImpl() {}
+
+                /**
+                 * @reimplemented
+                 */
+                virtual void lock();
+
+                /**
+                 * @reimplemented
+                 */
+                virtual void unlock();
+
+                /**
+                 * @reimplemented
+                 */
+                virtual bool locked();
+
+                /**
+                 * @reimplemented
+                 */
+                virtual void lockShared();
+
+                /**
+                 * @reimplemented
+                 */
+                virtual void unlockShared();
+
+            private:
+
+                std::mutex                      m;
+                std::condition_variable         cv;
+                std::thread::id                 writer;
+                int                             writerDepth;
+                int                             writersWaiting;
+                std::map<std::thread::id, int>  readers; // read locks held by each thread
+        };
+
         /**
          * The Mutex class is used by TSE3 to ensure thread safety. All
          * potentially contenious TSE3 methods claim a Mutex to prevent TSE3
@@ -237,6 +341,7 @@ namespace TSE3
                 {
 #ifndef TSE3_WITHOUT_MUTEX
                     impl->lock();
+                    ++locksHeld;
 #endif
                 }
 
@@ -251,15 +356,56 @@ namespace TSE3
                 void unlock()
                 {
 #ifndef TSE3_WITHOUT_MUTEX
+                    if (locksHeld > 0) --locksHeld;
                     impl->unlock();
 #endif
                 }
 
+                /**
+                 * Locks the Mutex for reading only. Other readers may hold
+                 * the Mutex at the same time, but no writer (see
+                 * @ref MutexImpl::lockShared).
+                 *
+                 * @see unlockShared
+                 */
+                void lockShared()
+                {
+#ifndef TSE3_WITHOUT_MUTEX
+                    impl->lockShared();
+                    ++locksHeld;
+#endif
+                }
+
+                /**
+                 * Unlocks a read lock taken with @ref lockShared.
+                 *
+                 * @see lockShared
+                 */
+                void unlockShared()
+                {
+#ifndef TSE3_WITHOUT_MUTEX
+                    if (locksHeld > 0) --locksHeld;
+                    impl->unlockShared();
+#endif
+                }
+
+                /**
+                 * Returns whether the calling thread holds a Mutex, for
+                 * reading or for writing. The @ref Transport uses this to
+                 * check its lock order.
+                 */
+                static bool lockedByThisThread() { return locksHeld > 0; }
+
             private:
 
                 MutexImpl        *impl;
 
                 static MutexImpl *globalImpl;
+
+                /**
+                 * The number of Mutex locks the calling thread holds.
+                 */
+                static thread_local int locksHeld;
         };
 
         /**
@@ -312,6 +458,38 @@ namespace TSE3
                 {
 #ifndef TSE3_WITHOUT_MUTEX
                     Mutex::mutex()->unlock();
+#endif
+                }
+        };
+
+        /**
+         * The read only counterpart of the @ref CritSec class. A CritSecRead
+         * object locks the global @ref Mutex for reading upon creation and
+         * unlocks it on destruction.
+         *
+         * Use it in the methods that only look at the data. Any number of
+         * them can run at once, but not at the same time as a @ref CritSec.
+         *
+         * This class was added to this copy of TSE3; it is not part of the
+         * upstream release.
+         *
+         * @short   Convenient API for read locking the @ref Mutex class
+         * @version 3.00
+         * @see     CritSec
+         */
+        class CritSecRead
+        {
+            public:
+                CritSecRead()
+                {
+#ifndef TSE3_WITHOUT_MUTEX
+                    Mutex::mutex()->lockShared();
+#endif
+                }
+                ~CritSecRead()
+                {
+#ifndef TSE3_WITHOUT_MUTEX
+                    Mutex::mutex()->unlockShared();
 #endif
                 }
         };
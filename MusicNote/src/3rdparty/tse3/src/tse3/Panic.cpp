@@ -467,7 +467,7 @@ void Panic::setXgReset(bool s)
 
 bool Panic::gsIDMask(size_t device) const
 {
-    Impl::CritSec cs;
+    Impl::CritSecRead cs;
 
     return (gsMask >> device) & 1;
 }
@@ -489,7 +489,7 @@ void Panic::setGsIDMask(size_t device, bool s)
 
 bool Panic::xgIDMask(size_t device) const
 {
-    Impl::CritSec cs;
+    Impl::CritSecRead cs;
 
     return (xgMask >> device) & 1;
 }
@@ -0,0 +1,70 @@
+/*
+ * @(#)Parallel.h
+ *
+ * This file was added to this copy of TSE3 - the Trax Sequencer Engine
+ * version 3.00. It is not part of the upstream TSE3 release.
+ *
+ * This library is modifiable/redistributable under the terms of the GNU
+ * General Public License.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef TSE3_PARALLEL_H
+#define TSE3_PARALLEL_H
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace TSE3
+{
+    namespace Impl
+    {
+        /**
+         * Ranges smaller than this are not worth starting threads for.
+         */
+        const size_t parallelGrain = 32768;
+
+        /**
+         * Calls @p f(begin, end) over disjoint ranges that together cover
+         * [0, size), using as many threads as the hardware offers. The
+         * calling thread does a share of the work. Small ranges are done
+         * in a single call on the calling thread.
+         *
+         * The function must only touch data that it owns for the duration
+         * of the call - in particular it must not take the TSE3 lock,
+         * which the caller may hold.
+         */
+        template <class Function>
+        void parallelFor(size_t size, Function f)
+        {
+            size_t threads = std::thread::hardware_concurrency();
+            if (threads > size / parallelGrain) threads = size / parallelGrain;
+            if (threads <= 1)
+            {
+                f(size_t(0), size);
+                return;
+            }
+
+            std::vector<std::thread> workers;
+            size_t                   step = size / threads;
+            for (size_t t = 1; t < threads; ++t)
+            {
+                size_t begin = t * step;
+                size_t end   = (t == threads-1) ? size : begin + step;
+                workers.push_back(std::thread(f, begin, end));
+            }
+            f(size_t(0), step);
+            for (size_t t = 0; t < workers.size(); ++t)
+            {
+                workers[t].join();
+            }
+        }
+    }
+}
+
+#endif
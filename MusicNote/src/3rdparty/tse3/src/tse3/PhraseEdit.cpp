@@ -20,9 +20,11 @@
 #include "tse3/PhraseList.h"
 #include "tse3/Error.h"
 #include "tse3/Mutex.h"
+#include "tse3/Parallel.h"
 
 #include <functional>
 #include <algorithm>
+#include <deque>
 #include <iterator>
 using namespace TSE3;
 
@@ -31,7 +33,7 @@ using namespace TSE3;
  *****************************************************************************/
 
 PhraseEdit::PhraseEdit(int noEvents)
-: MidiData(noEvents), hint(0), _selection(false)
+: MidiData(noEvents), hint(0), _selection(false), _generation(0)
 {
 }
 
@@ -46,7 +48,9 @@ void PhraseEdit::reset(const MidiData *source)
     Impl::CritSec cs;
 
     data.clear();
+    recorded.clear();
     hint = 0;
+    ++_generation;
 
     if (source)
     {
@@ -59,139 +63,213 @@ void PhraseEdit::reset(const MidiData *source)
 }
 
 
-void PhraseEdit::tidy(Clock endTime)
+namespace
 {
-    Impl::CritSec cs;
-
-    // Events are not necessarily already in time order: we do need to
-    // reshuffle them just in case
-    sort(data.begin(), data.end());
-
-    // Find the last time in the data, we'll use it later
-    if (endTime == -1) endTime = data[size()-1].time;
-
-    // Deal with all events with a minus time
-    while (size() && data[0].time < -tollerance)
+    /**
+     * Does the work of PhraseEdit::tidy on a detached vector of events.
+     *
+     * Events that are to go are marked and removed in a single pass at
+     * the end rather than erased one by one.
+     */
+    void tidyEvents(std::vector<MidiEvent> &events, Clock endTime)
     {
-        data.erase(data.begin());
-    }
-    for (size_t n = 0; n < size() && data[n].time < 0; ++n)
-    {
-        data[0].time = 0;
-        if (data[0].offTime < 0) data[0].offTime = 0;
-    }
-
-    // Convert all MidiCommand_NoteOns with velocity 0 to MidiCommand_NoteOffs
-    bool altered = false;
-    for (size_t n = 0; n < size(); ++n)
-    {
-        if (data[n].data.status == MidiCommand_NoteOn
-            && data[n].data.data2 == 0)
+        // Events are not necessarily already in time order: we do need to
+        // reshuffle them just in case
+        std::sort(events.begin(), events.end());
+        if (events.empty()) return;
+
+        // Find the last time in the data, we'll use it later
+        if (endTime == -1) endTime = events.back().time;
+
+        // Deal with all events with a minus time
+        MidiEvent earliest;
+        earliest.time = -PhraseEdit::tollerance;
+        events.erase(events.begin(),
+                     std::lower_bound(events.begin(), events.end(),
+                                      earliest));
+        for (size_t n = 0; n < events.size() && events[n].time < 0; ++n)
         {
-            data[n].data.status = MidiCommand_NoteOff;
+            events[n].time = 0;
+            if (events[n].offTime < 0) events[n].offTime = 0;
         }
-    }
 
-    // Deal with the sustain pedal: strip it out and elongate notes accordingly
-    for (int pos = size()-1; pos >= 0; --pos)
-    {
-        if (data[pos].data.status == MidiCommand_ControlChange
-            && data[pos].data.data1 == MidiControl_SustainPedal
-            && data[pos].data.data2 >= 0x40)
+        // Convert all MidiCommand_NoteOns with velocity 0 to
+        // MidiCommand_NoteOffs
+        Impl::parallelFor(events.size(), [&events](size_t begin, size_t end)
         {
-            int susChannel = data[pos].data.channel;
-            // We've found a sustain pedal down controller,
-            // now find the related sustain pedal up controller
-            size_t offPos = pos+1;
-            while (offPos < size()
-                   && !(data[offPos].data.status == MidiCommand_ControlChange
-                       && data[offPos].data.data1 == MidiControl_SustainPedal
-                       && data[offPos].data.data2 < 0x40))
+            for (size_t n = begin; n < end; ++n)
+            {
+                if (events[n].data.status == MidiCommand_NoteOn
+                    && events[n].data.data2 == 0)
+                {
+                    events[n].data.status = MidiCommand_NoteOff;
+                }
+            }
+        });
+
+        // Deal with the sustain pedal: strip it out and elongate notes
+        // accordingly. Working backwards, each sustain pedal down pairs with
+        // the nearest pedal up after it that no later pedal down has taken.
+        std::vector<char>   gone(events.size(), 0);
+        std::vector<size_t> ups;
+        bool                altered = false;
+        for (size_t pos = events.size(); pos-- > 0; )
+        {
+            const MidiCommand &mc = events[pos].data;
+            if (mc.status != MidiCommand_ControlChange
+                || mc.data1 != MidiControl_SustainPedal)
+            {
+                continue;
+            }
+            if (mc.data2 < 0x40)
             {
-                ++offPos;
+                ups.push_back(pos);
+                continue;
             }
-            Clock susOffTime = (offPos < size()) ? data[offPos].time : endTime;
-            if(offPos < size()) data.erase(data.begin()+offPos); // Fix: Gopalakrishna Palem
-            data.erase(data.begin()+pos);
-            --offPos;
-            for (size_t n = pos; n < offPos; ++n)
+
+            int    susChannel = mc.channel;
+            size_t offPos     = events.size();
+            Clock  susOffTime = endTime;
+            if (!ups.empty())
             {
-                if (data[n].data.status == MidiCommand_NoteOff
-                    && data[n].data.channel == susChannel)
+                offPos     = ups.back();
+                susOffTime = events[offPos].time;
+                gone[offPos] = 1;
+                ups.pop_back();
+            }
+            gone[pos] = 1;
+            for (size_t n = pos+1; n < offPos; ++n)
+            {
+                if (events[n].data.status == MidiCommand_NoteOff
+                    && events[n].data.channel == susChannel)
                 {
-                    data[n].time = susOffTime;
+                    events[n].time = susOffTime;
                     altered = true;
                 }
             }
         }
-    }
-    if (altered) sort(data.begin(), data.end());
-
-    // Remove any sustain pedal up events still hanging around
-    for (int n = size()-1; n >= 0; --n)
-    {
-        if (data[n].data.status == MidiCommand_ControlChange
-            && data[n].data.data1 == MidiControl_SustainPedal
-            && data[n].data.data2 <  0x40)
+        size_t kept = 0;
+        for (size_t n = 0; n < events.size(); ++n)
         {
-            data.erase(data.begin()+n);
+            if (!gone[n]) events[kept++] = events[n];
         }
-    }
-
-    // Pull all MidiCommand_NoteOffs into their MidiCommand_NoteOn's MidiEvent
-    for (size_t pos = 0; pos < size(); ++pos)
-    {
-        if (data[pos].data.status == MidiCommand_NoteOn
-            && data[pos].offData.status == MidiCommand_Invalid)
+        events.resize(kept);
+        if (altered) std::sort(events.begin(), events.end());
+
+        // Pull all MidiCommand_NoteOffs into their MidiCommand_NoteOn's
+        // MidiEvent. Each MidiCommand_NoteOff goes to the earliest
+        // unmatched MidiCommand_NoteOn of the same note before it.
+        std::vector<std::deque<size_t> > waiting(256);
+        for (size_t pos = 0; pos < events.size(); ++pos)
         {
-            size_t subPos = pos+1;
-            while (subPos < size()
-                   && !(data[subPos].data.status == MidiCommand_NoteOff
-                        && data[subPos].data.data1 == data[pos].data.data1))
+            MidiEvent &e = events[pos];
+            if (e.data.status == MidiCommand_NoteOn
+                && e.offData.status == MidiCommand_Invalid)
             {
-                ++subPos;
+                waiting[e.data.data1].push_back(pos);
             }
-            if (subPos < size())
+            else if (e.data.status == MidiCommand_NoteOff
+                     && !waiting[e.data.data1].empty())
             {
-                // There was a matching MidiCommand_NoteOff. Move it in.
-                data[pos].offData = data[subPos].data;
-                data[pos].offTime = data[subPos].time;
-                data.erase(data.begin()+subPos);
+                MidiEvent &on = events[waiting[e.data.data1].front()];
+                waiting[e.data.data1].pop_front();
+                on.offData = e.data;
+                on.offTime = e.time;
             }
-            else
+        }
+        for (size_t note = 0; note < waiting.size(); ++note)
+        {
+            // There was no matching MidiCommand_NoteOff. Make one up.
+            for (size_t n = 0; n < waiting[note].size(); ++n)
             {
-                // There was no matching MidiCommand_NoteOff. Make one up.
-                data[pos].offData        = data[pos].data;
-                data[pos].offData.status = MidiCommand_NoteOff;
-                data[pos].offTime        = endTime;
+                MidiEvent &on = events[waiting[note][n]];
+                on.offData        = on.data;
+                on.offData.status = MidiCommand_NoteOff;
+                on.offTime        = endTime;
             }
         }
+
+        // The MidiCommand_NoteOffs have all been pulled in or are unmatched,
+        // so remove them, along with any sustain pedal up events still
+        // hanging around
+        kept = 0;
+        for (size_t n = 0; n < events.size(); ++n)
+        {
+            const MidiCommand &mc = events[n].data;
+            if (mc.status != MidiCommand_NoteOff
+                && !(mc.status == MidiCommand_ControlChange
+                     && mc.data1 == MidiControl_SustainPedal
+                     && mc.data2 <  0x40))
+            {
+                events[kept++] = events[n];
+            }
+        }
+        events.resize(kept);
     }
+}
+
 
-    // If there are unmatched MidiCommand_NoteOffs, remove them
-    for (int n = size()-1; n >= 0; --n)
+void PhraseEdit::tidy(Clock endTime)
+{
+    std::vector<MidiEvent> events;
+    for (int attempt = 0; attempt < detachedAttempts; ++attempt)
     {
-        if (data[n].data.status == MidiCommand_NoteOff)
+        size_t generation;
         {
-            data.erase(data.begin()+n);
+            Impl::CritSec cs;
+
+            mergeRecorded();
+            events     = data;
+            generation = _generation;
         }
+
+        if (tidy(events, endTime, generation)) return;
     }
 
+    // Someone keeps editing under our feet, so hold the lock throughout
+    Impl::CritSec cs;
+
+    mergeRecorded();
+    events = data;
+    tidy(events, endTime, _generation);
+}
+
+
+bool PhraseEdit::tidy(std::vector<MidiEvent> &events, Clock endTime,
+                      size_t generation)
+{
+    tidyEvents(events, endTime);
+
+    Impl::CritSec cs;
+
+    if (generation != _generation) return false;
+
+    data.swap(events);
+    hint = 0;
+    ++_generation;
+
     updateSelectionInfo();
     Notifier<PhraseEditListener>::notify
         (&PhraseEditListener::PhraseEdit_Tidied);
 
     setModified(true);
+    return true;
 }
 
 
 void PhraseEdit::timeShift(Clock delta)
 {
-    for (size_t pos = 0; pos < size(); ++pos)
+    Impl::CritSec cs;
+
+    Impl::parallelFor(data.size(), [this, delta](size_t begin, size_t end)
     {
-        data[pos].time    += delta;
-        data[pos].offTime += delta;
-    }
+        for (size_t pos = begin; pos < end; ++pos)
+        {
+            data[pos].time    += delta;
+            data[pos].offTime += delta;
+        }
+    });
+    ++_generation;
     setModified(true);
 }
 
@@ -229,22 +307,21 @@ void PhraseEdit::insert(MidiEvent event)
 
     if (event.data.status == MidiCommand_Invalid) return;
 
-    // Find position to insert at (attempting to use cached position)
-    if (hint < data.size())
-    {
-        if (data[hint].time > event.time) hint = 0;
-    }
-    else
+    // Find position to insert at, after any events at the same time. Most
+    // inserts are in time order so try the end first, then binary search
+    // from the cached position.
+    typedef std::vector<MidiEvent>::iterator DI;
+    DI i = data.end();
+    if (!data.empty() && event.time < data.back().time)
     {
-        hint = 0;
+        if (hint >= data.size() || data[hint].time > event.time) hint = 0;
+        i = std::upper_bound(data.begin()+hint, data.end(), event);
     }
-    typedef std::vector<MidiEvent>::iterator DI;
-    DI i = std::find_if(data.begin()+hint, data.end(),
-                        std::bind2nd(std::greater<MidiEvent>(), event));
     hint = i - data.begin();
 
     // Insert event at this position
     data.insert(i, event);
+    ++_generation;
     Notifier<PhraseEditListener>::notify
         (&PhraseEditListener::PhraseEdit_Inserted, hint);
 
@@ -260,6 +337,78 @@ void PhraseEdit::insert(MidiEvent event)
 }
 
 
+void PhraseEdit::record(MidiEvent event)
+{
+    Impl::CritSec cs;
+
+    if (event.data.status == MidiCommand_Invalid) return;
+
+    recorded.push_back(event);
+}
+
+
+void PhraseEdit::record(const MidiEvent *events, size_t count)
+{
+    Impl::CritSec cs;
+
+    recorded.reserve(recorded.size() + count);
+    for (size_t n = 0; n < count; ++n)
+    {
+        if (events[n].data.status != MidiCommand_Invalid)
+        {
+            recorded.push_back(events[n]);
+        }
+    }
+}
+
+
+void PhraseEdit::mergeRecorded()
+{
+    Impl::CritSec cs;
+
+    if (recorded.empty()) return;
+
+    // The scheduler hands us events in time order, so this rarely has any
+    // work to do. It is stable so simultaneous events keep arrival order.
+    if (!std::is_sorted(recorded.begin(), recorded.end()))
+    {
+        std::stable_sort(recorded.begin(), recorded.end());
+    }
+
+    const size_t oldSize = data.size();
+    const bool   append  = data.empty()
+                           || !(recorded.front().time < data.back().time);
+    data.insert(data.end(), recorded.begin(), recorded.end());
+    recorded.clear();
+    ++_generation;
+
+    if (append)
+    {
+        for (size_t n = oldSize; n < data.size(); ++n)
+        {
+            Notifier<PhraseEditListener>::notify
+                (&PhraseEditListener::PhraseEdit_Inserted, n);
+            if (data[n].data.selected)
+            {
+                selected(n, true);
+            }
+        }
+    }
+    else
+    {
+        // Existing events come before recorded ones at the same time, as
+        // they would with insert()
+        std::inplace_merge(data.begin(), data.begin()+oldSize, data.end());
+        updateSelectionInfo();
+        Notifier<PhraseEditListener>::notify
+            (&PhraseEditListener::PhraseEdit_Reset);
+    }
+    hint = 0;
+
+    setModified(true);
+}
+
+
 void PhraseEdit::erase(size_t n)
 {
     Impl::CritSec cs;
@@ -272,6 +421,7 @@ void PhraseEdit::erase(size_t n)
 
     data.erase(data.begin() + n);
     hint = 0;
+    ++_generation;
     if (n <= _firstSelectionIndex) --_firstSelectionIndex;
     if (n <= _lastSelectionIndex)  --_lastSelectionIndex;
     Notifier<PhraseEditListener>::notify
@@ -299,6 +449,7 @@ void PhraseEdit::erase(MidiEvent event)
 
         data.erase(i);
         hint = 0;
+        ++_generation;
         if (index <= _firstSelectionIndex) --_firstSelectionIndex;
         if (index <= _lastSelectionIndex)  --_lastSelectionIndex;
         Notifier<PhraseEditListener>::notify
@@ -313,11 +464,27 @@ void PhraseEdit::erase(MidiEvent event)
  * Accessing the selection
  *****************************************************************************/
 
+namespace
+{
+    /**
+     * Predicate for finding selected MidiEvents.
+     */
+    struct IsSelected
+    {
+        bool operator()(const MidiEvent &e) const
+        {
+            return e.data.selected;
+        }
+    };
+}
+
+
 void PhraseEdit::select(size_t index)
 {
     if (!data[index].data.selected && index < size())
     {
         data[index].data.selected = true;
+        ++_generation;
         selected(index, true);
     }
 }
@@ -325,9 +492,24 @@ void PhraseEdit::select(size_t index)
 
 void PhraseEdit::selectRange(size_t from, size_t to)
 {
+    Impl::CritSec cs;
+
+    if (to > size()) to = size();
+    bool changed = false;
     for (size_t n = from; n < to; ++n)
     {
-        select(n);
+        if (!data[n].data.selected)
+        {
+            data[n].data.selected = true;
+            changed = true;
+        }
+    }
+    if (changed)
+    {
+        ++_generation;
+        updateSelectionInfo();
+        Notifier<PhraseEditListener>::notify
+            (&PhraseEditListener::PhraseEdit_Reset);
     }
 }
 
@@ -337,6 +519,7 @@ void PhraseEdit::deselect(size_t index)
     if (data[index].data.selected && index < size())
     {
         data[index].data.selected = false;
+        ++_generation;
         selected(index, false);
     }
 }
@@ -344,37 +527,60 @@ void PhraseEdit::deselect(size_t index)
 
 void PhraseEdit::clearSelection()
 {
-    for (size_t n = 0; n < size(); ++n)
+    Impl::CritSec cs;
+
+    Impl::parallelFor(size(), [this](size_t begin, size_t end)
     {
-        deselect(n);
+        for (size_t n = begin; n < end; ++n)
+        {
+            data[n].data.selected = false;
+        }
+    });
+    ++_generation;
+    if (_selection)
+    {
+        _selection = false;
+        Notifier<PhraseEditListener>::notify
+            (&PhraseEditListener::PhraseEdit_Reset);
     }
 }
 
 
 void PhraseEdit::invertSelection()
 {
-    for (size_t n = 0; n < size(); ++n)
+    Impl::CritSec cs;
+
+    Impl::parallelFor(size(), [this](size_t begin, size_t end)
     {
-        if (data[n].data.selected)
+        for (size_t n = begin; n < end; ++n)
         {
-            data[n].data.selected = false;
-            selected(n, false);
+            data[n].data.selected = !data[n].data.selected;
         }
-        else
-        {
-            data[n].data.selected = true;
-            selected(n, true);
-        }
-    }
+    });
+    ++_generation;
+    updateSelectionInfo();
+    Notifier<PhraseEditListener>::notify
+        (&PhraseEditListener::PhraseEdit_Reset);
 }
 
 
 void PhraseEdit::eraseSelection()
 {
-    while (_selection)
-    {
-        erase(_firstSelectionIndex);
-    }
+    Impl::CritSec cs;
+
+    if (!_selection) return;
+    std::vector<MidiEvent>::iterator i
+        = std::remove_if(data.begin() + _firstSelectionIndex,
+                         data.begin() + _lastSelectionIndex + 1,
+                         IsSelected());
+    data.erase(i, data.begin() + _lastSelectionIndex + 1);
+    hint       = 0;
+    _selection = false;
+    ++_generation;
+    Notifier<PhraseEditListener>::notify
+        (&PhraseEditListener::PhraseEdit_Reset);
+
+    setModified(true);
 }
 
 
@@ -23,6 +23,7 @@
 #include "tse3/MidiData.h"
 
 #include <string>
+#include <vector>
 #include <cstddef>
 
 namespace TSE3
@@ -165,6 +166,13 @@ namespace TSE3
              *
              * Prior to using tidy, you may need to apply @ref timeShift().
              *
+             * The work is done on a copy of the events, and the TSE3 lock is
+             * only held while the copy is taken and when the result is put
+             * back. If another thread edits the PhraseEdit in the meantime
+             * (see @ref generation()) the tidy is started again from the new
+             * contents, and after a few tries it is done with the lock held
+             * throughout. A single PhraseEdit_Tidied event is raised.
+             *
              * This may cause the modified event to be raised.
              *
              * @param stopTime The time of the end of this MidiData (e.g. the
@@ -175,6 +183,43 @@ namespace TSE3
              */
             void tidy(Clock stopTime = -1);
 
+            /**
+             * As @ref tidy() above, but the contents of the PhraseEdit are
+             * first replaced with @p events. On return @p events holds the
+             * old contents.
+             *
+             * This lets a bulk edit (like @ref Util::PowerQuantise) work on
+             * a detached copy of the events and then put the result back
+             * with a single notification.
+             *
+             * @p events are only put back if the PhraseEdit has not been
+             * edited since the copy was taken, i.e. if @ref generation()
+             * still returns @p generation. Otherwise nothing is changed and
+             * false is returned; the caller should take a new copy and try
+             * again. Holding the @ref Impl::CritSec lock from taking the
+             * copy to calling this guarantees success.
+             *
+             * @param  events     The new (possibly untidy) events
+             * @param  stopTime   As for @ref tidy() above
+             * @param  generation The @ref generation() when the copy was
+             *                    taken
+             * @return Whether @p events were put back
+             */
+            bool tidy(std::vector<MidiEvent> &events, Clock stopTime,
+                      size_t generation);
+
+            /**
+             * Returns a count that changes every time the events in the
+             * PhraseEdit are edited (including changes of selection).
+             * Compare it before and after working on a copy of the events
+             * to tell whether the copy has gone stale.
+             *
+             * Changes made directly through @ref operator[] are not counted.
+             *
+             * @return The edit generation
+             */
+            size_t generation() const { return _generation; }
+
             /**
              * Shift the time of every event in the PhraseEdit by @p delta
              * (the new event times are originalTime + @p delta).
@@ -206,6 +251,8 @@ namespace TSE3
              *
              * Note that this operation can leave data untidy.
              *
+             * Large PhraseEdits are shifted using several threads.
+             *
              * This will cause the modified event to be raised.
              *
              * @param delta @ref Clock value to add to every event
@@ -256,7 +303,7 @@ namespace TSE3
              *
              * Any data manipulation performed via this operator will not
              * affect the modified status, and so no modified event will
-             * be raised.
+             * be raised. Nor will it change the @ref generation().
              *
              * In simple terms, use this method at your own risk!
              *
@@ -293,6 +340,47 @@ namespace TSE3
              */
             void insert(MidiEvent event);
 
+            /**
+             * Adds a @ref MidiEvent to the recording buffer. This is the
+             * cheap way of collecting a stream of events that mostly
+             * arrive in time order, as the @ref Transport does when it
+             * records: each event is just appended to the buffer.
+             *
+             * The events do not appear in the @ref MidiData until
+             * @ref mergeRecorded() is called (@ref tidy() does this
+             * for you). The same 'tidiness' rules as @ref insert() apply.
+             *
+             * @param event MidiEvent to record
+             * @see   mergeRecorded
+             */
+            void record(MidiEvent event);
+
+            /**
+             * Adds @p count MidiEvents to the recording buffer at once.
+             * This is the quickest way of filling a PhraseEdit with
+             * data that is already in time order (a loader, for example).
+             *
+             * @param events MidiEvents to record
+             * @param count  Number of MidiEvents
+             * @see   record
+             */
+            void record(const MidiEvent *events, size_t count);
+
+            /**
+             * Merges the events buffered with @ref record() into the
+             * @ref MidiData in time order, in one pass.
+             *
+             * If every recorded event is at or after the last event already
+             * held, a PhraseEdit_Inserted event is raised for each of them.
+             * Otherwise the events are merged in place and a
+             * PhraseEdit_Reset event is raised instead.
+             *
+             * This may cause the modified event to be raised.
+             *
+             * @see record
+             */
+            void mergeRecorded();
+
             /**
              * Remove a @ref MidiEvent from the @ref MidiData. The result
              * is undefined if the index @p n is invalid.
@@ -328,6 +416,9 @@ namespace TSE3
             /**
              * Selects every @ref MidiEvent between the specified indexes.
              *
+             * Rather than a PhraseEdit_Selection event per @ref MidiEvent,
+             * a single PhraseEdit_Reset event is raised if anything changed.
+             *
              * @see select
              * @see deselect
              */
@@ -342,11 +433,17 @@ namespace TSE3
 
             /**
              * Clears any selection.
+             *
+             * Rather than a PhraseEdit_Selection event per @ref MidiEvent,
+             * a single PhraseEdit_Reset event is raised if anything changed.
              */
             void clearSelection();
 
             /**
              * Inverts the selection status of every @ref MidiEvent.
+             *
+             * Rather than a PhraseEdit_Selection event per @ref MidiEvent,
+             * a single PhraseEdit_Reset event is raised.
              */
             void invertSelection();
 
@@ -384,6 +481,9 @@ namespace TSE3
             /**
              * Erases any @ref MidiEvent that has been selected.
              *
+             * Rather than a PhraseEdit_Erased event per @ref MidiEvent,
+             * a single PhraseEdit_Reset event is raised if anything changed.
+             *
              * This may cause the modified event to be raised.
              */
             void eraseSelection();
@@ -427,6 +527,14 @@ namespace TSE3
              */
             static const int tollerance = Clock::PPQN/2;
 
+            /**
+             * The number of times an edit that works on a detached copy of
+             * the events (see @ref tidy()) is started again when the
+             * PhraseEdit changes underneath it, before it falls back to
+             * holding the lock throughout.
+             */
+            static const int detachedAttempts = 3;
+
         private:
 
             PhraseEdit &operator=(const PhraseEdit &);
@@ -465,6 +573,11 @@ namespace TSE3
              */
             size_t hint;
 
+            /**
+             * Events buffered by @ref record(), waiting to be merged.
+             */
+            std::vector<MidiEvent> recorded;
+
             /*
              * Selection information
              */
@@ -474,6 +587,11 @@ namespace TSE3
 
             bool   _modified;
 
+            /**
+             * Bumped by every edit, see @ref generation().
+             */
+            size_t _generation;
+
     };
 }
 
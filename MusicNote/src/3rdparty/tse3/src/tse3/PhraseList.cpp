@@ -55,7 +55,7 @@ PhraseList::~PhraseList()
 
 Phrase *PhraseList::phrase(const std::string &title) const
 {
-    Impl::CritSec cs;
+    Impl::CritSecRead cs;
 
     std::vector<Phrase*>::const_iterator i = list.begin();
     while (i != list.end() && (*i)->title() != title)
@@ -68,7 +68,7 @@ Phrase *PhraseList::phrase(const std::string &title) const
 
 size_t PhraseList::index(const Phrase *phrase) const
 {
-    Impl::CritSec cs;
+    Impl::CritSecRead cs;
 
     std::vector<Phrase*>::const_iterator i = list.begin();
     while (i != list.end() && *i != phrase)
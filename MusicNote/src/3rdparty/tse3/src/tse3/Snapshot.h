@@ -0,0 +1,313 @@
+/*
+ * @(#)Snapshot.h
+ *
+ * This file was added to this copy of TSE3 - the Trax Sequencer Engine
+ * version 3.00. It is not part of the upstream TSE3 release.
+ *
+ * This library is modifiable/redistributable under the terms of the GNU
+ * General Public License.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef TSE3_SNAPSHOT_H
+#define TSE3_SNAPSHOT_H
+
+#include <atomic>
+#include <climits>
+#include <vector>
+
+namespace TSE3
+{
+    namespace Impl
+    {
+        /**
+         * The bookkeeping behind @ref SnapshotReader.
+         *
+         * There is one global epoch, which goes up every time a
+         * @ref Snapshot replaces an object. Each thread that reads
+         * Snapshots has a slot that holds the epoch it saw when it
+         * entered its outermost @ref SnapshotReader, or 0 when it is not
+         * reading. An object replaced at epoch R can no longer be seen
+         * once every slot is either 0 or greater than R.
+         *
+         * Slots are allocated the first time a thread reads, handed on to
+         * another thread when it exits, and never freed.
+         *
+         * @short   Epoch tracking for Snapshot readers
+         * @version 3.00
+         * @see     Snapshot
+         */
+        class SnapshotEpoch
+        {
+            public:
+
+                /**
+                 * Marks the calling thread as reading.
+                 */
+                static void enter()
+                {
+                    Slot *s = slot();
+                    if (s->depth++ == 0)
+                    {
+                        s->epoch.store(global().load(std::memory_order_relaxed),
+                                       std::memory_order_relaxed);
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+                    }
+                }
+
+                /**
+                 * Undoes a call to @ref enter().
+                 */
+                static void leave()
+                {
+                    Slot *s = slot();
+                    if (--s->depth == 0)
+                    {
+                        s->epoch.store(0, std::memory_order_release);
+                    }
+                }
+
+                /**
+                 * Called after an object has been replaced. Returns the
+                 * epoch it was replaced at and starts a new one.
+                 */
+                static unsigned long advance()
+                {
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    return global().fetch_add(1, std::memory_order_seq_cst);
+                }
+
+                /**
+                 * Returns the oldest epoch that a thread is still reading
+                 * in, or ULONG_MAX if no thread is reading.
+                 */
+                static unsigned long oldest()
+                {
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    unsigned long o = ULONG_MAX;
+                    for (Slot *s = slots().load(std::memory_order_acquire);
+                         s; s = s->next)
+                    {
+                        unsigned long e
+                            = s->epoch.load(std::memory_order_acquire);
+                        if (e && e < o) o = e;
+                    }
+                    return o;
+                }
+
+            private:
+
+                struct Slot
+                {
+                    std::atomic<unsigned long> epoch;
+                    std::atomic<bool>          inUse;
+                    int                        depth;
+                    Slot                      *next;
+                };
+
+                /**
+                 * Gives a thread's slot back when the thread exits.
+                 */
+                struct Owner
+                {
+                    Slot *slot;
+                    Owner() : slot(0) {}
+                    ~Owner()
+                    {
+                        if (slot) slot->inUse.store(false,
+                                                    std::memory_order_release);
+                    }
+                };
+
+                static std::atomic<unsigned long> &global()
+                {
+                    static std::atomic<unsigned long> epoch(1);
+                    return epoch;
+                }
+
+                static std::atomic<Slot*> &slots()
+                {
+                    static std::atomic<Slot*> head(0);
+                    return head;
+                }
+
+                static Slot *slot()
+                {
+                    static thread_local Slot *mine = 0;
+                    if (!mine)
+                    {
+                        static thread_local Owner owner;
+                        mine = owner.slot = acquire();
+                    }
+                    return mine;
+                }
+
+                static Slot *acquire()
+                {
+                    for (Slot *s = slots().load(std::memory_order_acquire);
+                         s; s = s->next)
+                    {
+                        bool free = false;
+                        if (s->inUse.compare_exchange_strong(free, true))
+                        {
+                            return s;
+                        }
+                    }
+                    Slot *s  = new Slot;
+                    s->epoch = 0;
+                    s->inUse = true;
+                    s->depth = 0;
+                    s->next  = slots().load(std::memory_order_relaxed);
+                    while (!slots().compare_exchange_weak(s->next, s)) {}
+                    return s;
+                }
+        };
+
+        /**
+         * Any object returned by @ref Snapshot::get stays valid while the
+         * calling thread holds a SnapshotReader.
+         *
+         * Read sections nest, and only the outermost one costs more than
+         * a thread local increment. Code that reads a lot of Snapshots in
+         * a row (like @ref Transport::poll) should hold one around the
+         * lot.
+         *
+         * Don't hold one while waiting for something: while it is held,
+         * objects replaced in any Snapshot are kept rather than freed.
+         *
+         * @short   Read section for Snapshot objects
+         * @version 3.00
+         * @see     Snapshot
+         */
+        class SnapshotReader
+        {
+            public:
+                SnapshotReader()  { SnapshotEpoch::enter(); }
+                ~SnapshotReader() { SnapshotEpoch::leave(); }
+            private:
+                SnapshotReader &operator=(const SnapshotReader &);
+                SnapshotReader(const SnapshotReader &);
+        };
+
+        /**
+         * Holds the current version of an immutable object of type @p T
+         * so that it can be read from the playback thread without taking
+         * a lock.
+         *
+         * A writer builds a complete new object and hands it over with
+         * @ref publish. A reader holds a @ref SnapshotReader and calls
+         * @ref get, which is a single atomic load, and sees either the old
+         * object or the new one, never a mixture.
+         *
+         * A replaced object is only kept while some read section that
+         * was open when it was replaced is still open. It is freed by the
+         * next @ref publish after that (or when the Snapshot is deleted),
+         * and if no thread is reading when it is replaced it is freed at
+         * once. So besides the current object a Snapshot holds at most
+         * the objects replaced during the oldest read section that was
+         * open at its last @ref publish. For the poll long sections the
+         * @ref Transport uses that is normally none or one, however many
+         * different values are published over time.
+         *
+         * Publishing an object equal to the current one (@p T must
+         * provide operator==) does nothing.
+         *
+         * Writers must be serialised by the caller (normally by holding
+         * the @ref CritSec lock). They never wait for readers.
+         *
+         * @short   Lock free publication of immutable data
+         * @version 3.00
+         * @see     SnapshotReader
+         */
+        template <class T>
+        class Snapshot
+        {
+            public:
+
+                /**
+                 * The Snapshot takes ownership of @p t.
+                 */
+                Snapshot(T *t) : current(t) {}
+
+                ~Snapshot()
+                {
+                    delete current.load();
+                    for (size_t n = 0; n < retired.size(); ++n)
+                    {
+                        delete retired[n].object;
+                    }
+                }
+
+                /**
+                 * Returns the current object. It stays valid until the
+                 * calling thread's @ref SnapshotReader goes out of scope.
+                 */
+                const T *get() const
+                {
+                    return current.load(std::memory_order_acquire);
+                }
+
+                /**
+                 * Makes @p t the current object. The Snapshot takes
+                 * ownership of it.
+                 *
+                 * Any replaced objects that no reader can still see are
+                 * freed.
+                 */
+                void publish(T *t)
+                {
+                    T *old = current.load(std::memory_order_relaxed);
+                    if (old && *old == *t)
+                    {
+                        delete t;
+                        return;
+                    }
+                    current.store(t, std::memory_order_release);
+                    if (old)
+                    {
+                        retired.push_back(Retired(old,
+                                                  SnapshotEpoch::advance()));
+                    }
+
+                    const unsigned long oldest = SnapshotEpoch::oldest();
+                    size_t kept = 0;
+                    for (size_t n = 0; n < retired.size(); ++n)
+                    {
+                        if (retired[n].epoch < oldest)
+                        {
+                            delete retired[n].object;
+                        }
+                        else
+                        {
+                            retired[kept++] = retired[n];
+                        }
+                    }
+                    retired.erase(retired.begin() + kept, retired.end());
+                }
+
+            private:
+
+                Snapshot &operator=(const Snapshot &);
+                Snapshot(const Snapshot &);
+
+                /**
+                 * A replaced object, and the epoch it was replaced at.
+                 */
+                struct Retired
+                {
+                    Retired(T *o, unsigned long e) : object(o), epoch(e) {}
+                    T             *object;
+                    unsigned long  epoch;
+                };
+
+                std::atomic<T*>      current;
+                std::vector<Retired> retired;
+        };
+    }
+}
+
+#endif
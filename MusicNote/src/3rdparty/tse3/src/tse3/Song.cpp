@@ -26,6 +26,8 @@
 #include "tse3/Error.h"
 #include "tse3/Mutex.h"
 
+#include <algorithm>
+
 using namespace TSE3;
 
 /******************************************************************************
@@ -168,6 +170,39 @@ namespace
             virtual void getNextEvent();
             void         updateIterators(Clock c);
 
+            /**
+             * Returns the iterator for an @ref IteratorSource or a
+             * track number.
+             */
+            PlayableIterator *iterator(int source);
+
+            /**
+             * Queues the source's next event, if it has one.
+             */
+            void push(int source);
+
+            /**
+             * A source and the time of the event it will produce next.
+             */
+            struct Pending
+            {
+                Clock time;
+                int   source;
+            };
+
+            /**
+             * Orders the heap so the earliest event (and for equal times
+             * the lowest source) is on top.
+             */
+            struct PendingAfter
+            {
+                bool operator()(const Pending &a, const Pending &b) const
+                {
+                    return (a.time != b.time) ? (a.time > b.time)
+                                              : (a.source > b.source);
+                }
+            };
+
             Song                           *_song;
             std::vector<PlayableIterator*>  _ti;      // TrackIterators
             PlayableIterator               *_tti;     // TempoTrackIterator
@@ -175,17 +210,19 @@ namespace
             PlayableIterator               *_ksti;    // KeySigTrackIterator
             PlayableIterator               *_rti;     // RepeatIterator
             int                             _source;  // where _next came from
+            std::vector<Pending>            _heap;    // sources, by next event
 
             /**
              * An enum type that describes where the current event came
-             * from.
+             * from. Non-negative values are track numbers. Events at the
+             * same time come out in ascending source order.
              */
             enum IteratorSource
             {
-                TempoTrack   = -1,
-                TimeSigTrack = -2,
-                KeySigTrack  = -3,
-                RepeatEvent  = -4,
+                TempoTrack   = -4,
+                TimeSigTrack = -3,
+                KeySigTrack  = -2,
+                RepeatEvent  = -1,
                 None         = -5
             };
 
@@ -250,46 +287,50 @@ void SongIterator::moveTo(Clock c)
         (*i)->moveTo(c);
         ++i;
     }
+    _heap.clear();
+    for (int source = TempoTrack; source < static_cast<int>(_ti.size());
+         ++source)
+    {
+        push(source);
+    }
     _more   = true;
     _source = None;
     getNextEvent();
 }
 
 
-void SongIterator::getNextEvent()
+PlayableIterator *SongIterator::iterator(int source)
 {
-    // Consume the last event
-    if (_source == TempoTrack)
+    switch (source)
     {
-        if (_tti)
-        {
-            ++(*_tti);
-        }
-    }
-    else if (_source == TimeSigTrack)
-    {
-        if (_tsti)
-        {
-            ++(*_tsti);
-        }
+        case TempoTrack:   return _tti;
+        case TimeSigTrack: return _tsti;
+        case KeySigTrack:  return _ksti;
+        case RepeatEvent:  return _rti;
+        default:           return _ti[source];
     }
-    else if (_source == KeySigTrack)
-    {
-        if (_ksti)
-        {
-            ++(*_ksti);
-        }
-    }
-    else if (_source == RepeatEvent)
+}
+
+
+void SongIterator::push(int source)
+{
+    PlayableIterator *pi = iterator(source);
+    if (pi && pi->more())
     {
-        if (_rti)
-        {
-            ++(*_rti);
-        }
+        Pending pending = { (*(*pi)).time, source };
+        _heap.push_back(pending);
+        std::push_heap(_heap.begin(), _heap.end(), PendingAfter());
     }
-    else if (_source != None)
+}
+
+
+void SongIterator::getNextEvent()
+{
+    // Consume the last event, and queue up its source's next one
+    if (_source != None)
     {
-        ++(*(_ti[_source]));
+        ++(*iterator(_source));
+        push(_source);
     }
 
     // Get the next event
@@ -297,67 +338,32 @@ void SongIterator::getNextEvent()
     _source = None;
     _next   = MidiEvent();
 
-    if (_tti && _tti->more())
-    {
-        _more   = true;
-        _next   = *(*_tti);
-        _source = TempoTrack;
-    }
-
-    if (_tsti && _tsti->more())
-    {
-        MidiEvent tmp = *(*_tsti);
-        if (_more == false || tmp.time < _next.time)
-        {
-            _next   = tmp;
-            _source = TimeSigTrack;
-        }
-        _more = true;
-    }
-
-    if (_ksti && _ksti->more())
+    while (!_heap.empty())
     {
-        MidiEvent tmp = *(*_ksti);
-        if (_more == false || tmp.time < _next.time)
-        {
-            _next   = tmp;
-            _source = KeySigTrack;
-        }
-        _more = true;
-    }
+        std::pop_heap(_heap.begin(), _heap.end(), PendingAfter());
+        Pending pending = _heap.back();
+        _heap.pop_back();
 
-    if (_rti && _rti->more())
-    {
-        MidiEvent tmp = *(*_rti);
-        if (_more == false || tmp.time < _next.time)
+        // The source may have been edited since it was queued
+        PlayableIterator *pi = iterator(pending.source);
+        if (!pi->more()) continue;
+        MidiEvent tmp = *(*pi);
+        if (tmp.time != pending.time)
         {
-            _next   = tmp;
-            _source = RepeatEvent;
+            push(pending.source);
+            continue;
         }
-        _more = true;
-    }
 
-    std::vector<PlayableIterator*>::iterator i = _ti.begin();
-    int trackNo = 0;
-    while (i != _ti.end())
-    {
-        if ((*i)->more())
+        if (pending.source >= 0
+            && _song->soloTrack() != -1
+            && _song->soloTrack() != pending.source)
         {
-            MidiEvent tmp = *(*(*i));
-            if (_song->soloTrack() != -1
-                && _song->soloTrack() != trackNo)
-            {
-                tmp.data.status = MidiCommand_Invalid;
-            }
-            if (_more == false || tmp.time < _next.time)
-            {
-                _next   = tmp;
-                _source = i - _ti.begin();
-            }
-            _more = true;
+            tmp.data.status = MidiCommand_Invalid;
         }
-        ++i;
-        ++trackNo;
+        _next   = tmp;
+        _source = pending.source;
+        _more   = true;
+        break;
     }
 }
 
@@ -551,7 +557,7 @@ Track *Song::operator[](size_t n) const
 
 size_t Song::index(Track *track) const
 {
-    Impl::CritSec cs;
+    Impl::CritSecRead cs;
 
     std::vector<Track*>::const_iterator i
         = std::find(pimpl->tracks.begin(), pimpl->tracks.end(), track);
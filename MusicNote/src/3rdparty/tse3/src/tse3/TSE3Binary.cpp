@@ -0,0 +1,721 @@
+/*
+ * @(#)TSE3Binary.cpp
+ *
+ * This file was added to this copy of TSE3 - the Trax Sequencer Engine
+ * version 3.00. It is not part of the upstream TSE3 release.
+ *
+ * This library is modifiable/redistributable under the terms of the GNU
+ * General Public License.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "tse3/TSE3Binary.h"
+
+#include "tse3/Song.h"
+#include "tse3/Track.h"
+#include "tse3/Part.h"
+#include "tse3/Phrase.h"
+#include "tse3/PhraseList.h"
+#include "tse3/PhraseEdit.h"
+#include "tse3/TempoTrack.h"
+#include "tse3/TimeSigTrack.h"
+#include "tse3/KeySigTrack.h"
+#include "tse3/FlagTrack.h"
+#include "tse3/MidiFilter.h"
+#include "tse3/MidiParams.h"
+#include "tse3/DisplayParams.h"
+#include "tse3/Error.h"
+#include "tse3/Progress.h"
+
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace TSE3;
+
+namespace
+{
+    const char   signature[]   = "TSE3BIN\x1a";
+    const size_t signatureSize = 8;
+    const size_t eventSize     = 24;
+
+    bool chunkIs(const unsigned char *id, const char *name)
+    {
+        return memcmp(id, name, 4) == 0;
+    }
+
+    /**
+     * Writes the file one chunk at a time. Each chunk is built in memory
+     * so that its length is known before it goes out.
+     */
+    class ChunkWriter
+    {
+        public:
+            ChunkWriter(std::ostream &out) : out(out) {}
+
+            void begin(const char *id)
+            {
+                chunkId = id;
+                buffer.clear();
+            }
+
+            void end()
+            {
+                unsigned char length[4];
+                size_t        size = buffer.size();
+                for (int n = 0; n < 4; ++n)
+                {
+                    length[n] = (size >> (n*8)) & 0xff;
+                }
+                out.write(chunkId, 4);
+                out.write(reinterpret_cast<const char*>(length), 4);
+                if (size)
+                {
+                    out.write(reinterpret_cast<const char*>(&buffer[0]),
+                              size);
+                }
+            }
+
+            void u8(int value)
+            {
+                buffer.push_back(value & 0xff);
+            }
+
+            void i32(int value)
+            {
+                unsigned int u = value;
+                buffer.push_back(u & 0xff);
+                buffer.push_back((u >> 8) & 0xff);
+                buffer.push_back((u >> 16) & 0xff);
+                buffer.push_back((u >> 24) & 0xff);
+            }
+
+            void str(const std::string &s)
+            {
+                i32(s.size());
+                buffer.insert(buffer.end(), s.begin(), s.end());
+            }
+
+            void reserve(size_t size)
+            {
+                buffer.reserve(buffer.size() + size);
+            }
+
+        private:
+            std::ostream               &out;
+            const char                 *chunkId;
+            std::vector<unsigned char>  buffer;
+    };
+
+    /**
+     * Reads values from a single chunk, throwing if they would run past
+     * its end.
+     */
+    class ChunkReader
+    {
+        public:
+            ChunkReader(const unsigned char *pos, const unsigned char *end)
+                : pos(pos), end(end) {}
+
+            const unsigned char *take(size_t size)
+            {
+                if (size_t(end - pos) < size)
+                {
+                    throw SerializableError(FileFormatErr);
+                }
+                const unsigned char *data = pos;
+                pos += size;
+                return data;
+            }
+
+            int u8()
+            {
+                return *take(1);
+            }
+
+            int i32()
+            {
+                const unsigned char *p = take(4);
+                return int(p[0] | (p[1] << 8) | (p[2] << 16)
+                           | (unsigned(p[3]) << 24));
+            }
+
+            std::string str()
+            {
+                size_t size = unsigned(i32());
+                const char *p = reinterpret_cast<const char*>(take(size));
+                return std::string(p, size);
+            }
+
+        private:
+            const unsigned char *pos;
+            const unsigned char *end;
+    };
+
+    /**
+     * A file image, mapped into memory where possible.
+     */
+    class FileImage
+    {
+        public:
+            FileImage(const std::string &filename)
+                : data(0), size(0), mapped(false)
+            {
+#if !defined(_WIN32)
+                int fd = open(filename.c_str(), O_RDONLY);
+                if (fd == -1)
+                {
+                    throw SerializableError(CouldntOpenFileErr);
+                }
+                struct stat st;
+                if (fstat(fd, &st) == 0 && st.st_size > 0)
+                {
+                    void *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
+                                     fd, 0);
+                    if (map != MAP_FAILED)
+                    {
+                        data   = static_cast<const unsigned char*>(map);
+                        size   = st.st_size;
+                        mapped = true;
+                    }
+                }
+                close(fd);
+#endif
+                if (!mapped)
+                {
+                    std::ifstream in(filename.c_str(),
+                                     std::ios::binary | std::ios::in);
+                    if (!in)
+                    {
+                        throw SerializableError(CouldntOpenFileErr);
+                    }
+                    in.seekg(0, std::ios::end);
+                    size = in.tellg();
+                    in.seekg(0, std::ios::beg);
+                    unsigned char *buffer = new unsigned char[size];
+                    data = buffer;
+                    in.read(reinterpret_cast<char*>(buffer), size);
+                    if (size_t(in.gcount()) != size)
+                    {
+                        delete [] buffer;
+                        throw SerializableError(FileFormatErr);
+                    }
+                }
+            }
+
+            ~FileImage()
+            {
+#if !defined(_WIN32)
+                if (mapped)
+                {
+                    munmap(const_cast<unsigned char*>(data), size);
+                    return;
+                }
+#endif
+                delete [] data;
+            }
+
+            const unsigned char *data;
+            size_t               size;
+            bool                 mapped;
+
+        private:
+            FileImage(const FileImage &);
+            FileImage &operator=(const FileImage &);
+    };
+
+    void writeFilter(ChunkWriter &w, const MidiFilter *filter)
+    {
+        int channels = 0;
+        for (int c = 0; c < 16; ++c)
+        {
+            if (filter->channelFilter(c)) channels |= 1 << c;
+        }
+        w.u8(filter->status());
+        w.i32(channels);
+        w.i32(filter->channel());
+        w.i32(filter->port());
+        w.i32(filter->offset());
+        w.i32(filter->timeScale());
+        w.i32(filter->quantise());
+        w.i32(filter->transpose());
+        w.i32(filter->minVelocity());
+        w.i32(filter->maxVelocity());
+        w.i32(filter->velocityScale());
+        w.i32(filter->minLength());
+        w.i32(filter->maxLength());
+    }
+
+    void readFilter(ChunkReader &r, MidiFilter *filter, int PPQN)
+    {
+        filter->setStatus(r.u8());
+        int channels = r.i32();
+        for (int c = 0; c < 16; ++c)
+        {
+            filter->setChannelFilter(c, channels & (1 << c));
+        }
+        filter->setChannel(r.i32());
+        filter->setPort(r.i32());
+        filter->setOffset(Clock::convert(r.i32(), PPQN));
+        filter->setTimeScale(r.i32());
+        filter->setQuantise(Clock::convert(r.i32(), PPQN));
+        filter->setTranspose(r.i32());
+        filter->setMinVelocity(r.i32());
+        filter->setMaxVelocity(r.i32());
+        filter->setVelocityScale(r.i32());
+        filter->setMinLength(Clock::convert(r.i32(), PPQN));
+        filter->setMaxLength(Clock::convert(r.i32(), PPQN));
+    }
+
+    void writeParams(ChunkWriter &w, const MidiParams *params)
+    {
+        w.i32(params->bankLSB());
+        w.i32(params->bankMSB());
+        w.i32(params->program());
+        w.i32(params->pan());
+        w.i32(params->reverb());
+        w.i32(params->chorus());
+        w.i32(params->volume());
+    }
+
+    void readParams(ChunkReader &r, MidiParams *params)
+    {
+        params->setBankLSB(r.i32());
+        params->setBankMSB(r.i32());
+        params->setProgram(r.i32());
+        params->setPan(r.i32());
+        params->setReverb(r.i32());
+        params->setChorus(r.i32());
+        params->setVolume(r.i32());
+    }
+
+    void writeDisplay(ChunkWriter &w, DisplayParams *display)
+    {
+        int red, green, blue;
+        display->colour(red, green, blue);
+        w.u8(display->style());
+        w.u8(red);
+        w.u8(green);
+        w.u8(blue);
+        w.u8(display->presetColour());
+    }
+
+    void readDisplay(ChunkReader &r, DisplayParams *display)
+    {
+        display->setStyle(r.u8());
+        int red   = r.u8();
+        int green = r.u8();
+        int blue  = r.u8();
+        display->setColour(red, green, blue);
+        display->setPresetColour(r.u8());
+    }
+
+    /**
+     * Packs a MidiCommand into four bytes. The status takes the low four
+     * bits of the first byte and the selected flag rides in bit 4.
+     */
+    void writeCommand(ChunkWriter &w, const MidiCommand &mc)
+    {
+        w.u8(mc.status | (mc.selected << 4));
+        w.u8(mc.channel);
+        w.u8(mc.data1);
+        w.u8(mc.data2);
+    }
+
+    MidiCommand readCommand(const unsigned char *p, int port)
+    {
+        MidiCommand mc(p[0] & 0x0f, static_cast<signed char>(p[1]), port,
+                       p[2], p[3]);
+        mc.selected = (p[0] >> 4) & 1;
+        return mc;
+    }
+
+    int readInt(const unsigned char *p)
+    {
+        return int(p[0] | (p[1] << 8) | (p[2] << 16) | (unsigned(p[3]) << 24));
+    }
+}
+
+
+/******************************************************************************
+ * TSE3Binary class
+ *****************************************************************************/
+
+TSE3Binary::TSE3Binary(const std::string &appname, int verbose,
+                       std::ostream &diag)
+: originator(appname), verbose(verbose), diag(diag)
+{
+}
+
+
+void TSE3Binary::save(const std::string &filename, const Song *song)
+{
+    std::ofstream out(filename.c_str(), std::ios::binary | std::ios::out);
+    if (!out)
+    {
+        throw SerializableError(CouldntOpenFileErr);
+    }
+
+    save(out, song);
+
+    out.close();
+}
+
+
+void TSE3Binary::save(std::ostream &out, const Song *constSong)
+{
+    // The Song accessors we need are not const, but nothing is altered here
+    Song *song = const_cast<Song*>(constSong);
+
+    ChunkWriter w(out);
+    out.write(signature, signatureSize);
+
+    w.begin("HEAD");
+    w.i32(MajorVersion | (MinorVersion << 16));
+    w.i32(Clock::PPQN);
+    w.str(originator);
+    w.end();
+
+    w.begin("SONG");
+    w.str(song->title());
+    w.str(song->author());
+    w.str(song->copyright());
+    w.str(song->date());
+    w.i32(song->soloTrack());
+    w.u8(song->repeat());
+    w.i32(song->from());
+    w.i32(song->to());
+    w.end();
+
+    TempoTrack *tempoTrack = song->tempoTrack();
+    w.begin("TMPO");
+    w.u8(tempoTrack->status());
+    w.i32(tempoTrack->size());
+    for (size_t n = 0; n < tempoTrack->size(); ++n)
+    {
+        w.i32((*tempoTrack)[n].time);
+        w.i32((*tempoTrack)[n].data.tempo);
+    }
+    w.end();
+
+    TimeSigTrack *timeSigTrack = song->timeSigTrack();
+    w.begin("TSIG");
+    w.u8(timeSigTrack->status());
+    w.i32(timeSigTrack->size());
+    for (size_t n = 0; n < timeSigTrack->size(); ++n)
+    {
+        w.i32((*timeSigTrack)[n].time);
+        w.i32((*timeSigTrack)[n].data.top);
+        w.i32((*timeSigTrack)[n].data.bottom);
+    }
+    w.end();
+
+    KeySigTrack *keySigTrack = song->keySigTrack();
+    w.begin("KSIG");
+    w.u8(keySigTrack->status());
+    w.i32(keySigTrack->size());
+    for (size_t n = 0; n < keySigTrack->size(); ++n)
+    {
+        w.i32((*keySigTrack)[n].time);
+        w.i32((*keySigTrack)[n].data.incidentals);
+        w.i32((*keySigTrack)[n].data.type);
+    }
+    w.end();
+
+    FlagTrack *flagTrack = song->flagTrack();
+    w.begin("FLAG");
+    w.i32(flagTrack->size());
+    for (size_t n = 0; n < flagTrack->size(); ++n)
+    {
+        w.i32((*flagTrack)[n].time);
+        w.str((*flagTrack)[n].data.title());
+    }
+    w.end();
+
+    PhraseList *phraseList = song->phraseList();
+    for (size_t p = 0; p < phraseList->size(); ++p)
+    {
+        Phrase *phrase = (*phraseList)[p];
+        w.begin("PHRS");
+        w.str(phrase->title());
+        writeDisplay(w, phrase->displayParams());
+        w.i32(phrase->size());
+        w.reserve(phrase->size() * eventSize);
+        for (size_t n = 0; n < phrase->size(); ++n)
+        {
+            const MidiEvent &e = (*phrase)[n];
+            w.i32(e.time);
+            writeCommand(w, e.data);
+            w.i32(e.data.port);
+            w.i32(e.offTime);
+            writeCommand(w, e.offData);
+            w.i32(e.offData.port);
+        }
+        w.end();
+    }
+
+    for (size_t t = 0; t < song->size(); ++t)
+    {
+        Track *track = (*song)[t];
+        w.begin("TRCK");
+        w.str(track->title());
+        writeFilter(w, track->filter());
+        writeParams(w, track->params());
+        writeDisplay(w, track->displayParams());
+        w.i32(track->size());
+        for (size_t n = 0; n < track->size(); ++n)
+        {
+            Part *part = (*track)[n];
+            int   index = -1;
+            if (part->phrase())
+            {
+                index = phraseList->index(part->phrase());
+            }
+            w.i32(index);
+            w.i32(part->start());
+            w.i32(part->end());
+            w.i32(part->repeat());
+            writeFilter(w, part->filter());
+            writeParams(w, part->params());
+            writeDisplay(w, part->displayParams());
+        }
+        w.end();
+    }
+}
+
+
+Song *TSE3Binary::load(const std::string &filename, Progress *progress)
+{
+    FileImage image(filename);
+
+    if (verbose >= 1)
+    {
+        diag << (image.mapped ? "Mapped" : "Loaded")
+             << " TSE3 binary file " << filename
+             << " (" << image.size << " bytes)\n";
+    }
+
+    return load(image.data, image.size, progress);
+}
+
+
+Song *TSE3Binary::load(const unsigned char *data, size_t size,
+                       Progress *progress)
+{
+    if (size < signatureSize || memcmp(data, signature, signatureSize))
+    {
+        throw Error(InvalidFileTypeErr);
+    }
+
+    if (progress)
+    {
+        progress->progressRange(0, size);
+    }
+
+    std::unique_ptr<Song> song(new Song(0));
+    std::vector<Phrase*> phrases;
+    int                  PPQN      = Clock::PPQN;
+    int                  soloTrack = -1;
+    bool                 gotHeader = false;
+
+    const unsigned char *pos = data + signatureSize;
+    const unsigned char *end = data + size;
+    while (pos != end)
+    {
+        if (end - pos < 8)
+        {
+            throw SerializableError(FileFormatErr);
+        }
+        const unsigned char *id     = pos;
+        size_t               length = unsigned(readInt(pos + 4));
+        pos += 8;
+        if (size_t(end - pos) < length)
+        {
+            throw SerializableError(FileFormatErr);
+        }
+        ChunkReader r(pos, pos + length);
+
+        if (progress)
+        {
+            progress->progress(pos - data);
+        }
+
+        if (!gotHeader && !chunkIs(id, "HEAD"))
+        {
+            throw SerializableError(FileFormatErr);
+        }
+
+        if (chunkIs(id, "HEAD"))
+        {
+            int version = r.i32();
+            int major   = version & 0xffff;
+            int minor   = (version >> 16) & 0xffff;
+            PPQN        = r.i32();
+            std::string fileOriginator = r.str();
+            if (verbose >= 1)
+            {
+                diag << "TSE3 binary version " << major << "." << minor
+                     << ", PPQN " << PPQN
+                     << ", originator \"" << fileOriginator << "\"\n";
+            }
+            if (major != MajorVersion || PPQN <= 0)
+            {
+                throw SerializableError(FileFormatErr);
+            }
+            gotHeader = true;
+        }
+        else if (chunkIs(id, "SONG"))
+        {
+            song->setTitle(r.str());
+            song->setAuthor(r.str());
+            song->setCopyright(r.str());
+            song->setDate(r.str());
+            soloTrack = r.i32();
+            song->setRepeat(r.u8());
+            song->setFrom(Clock::convert(r.i32(), PPQN));
+            song->setTo(Clock::convert(r.i32(), PPQN));
+        }
+        else if (chunkIs(id, "TMPO"))
+        {
+            TempoTrack *tempoTrack = song->tempoTrack();
+            tempoTrack->setStatus(r.u8());
+            int count = r.i32();
+            for (int n = 0; n < count; ++n)
+            {
+                Clock time  = Clock::convert(r.i32(), PPQN);
+                int   tempo = r.i32();
+                tempoTrack->insert(Event<Tempo>(Tempo(tempo), time));
+            }
+        }
+        else if (chunkIs(id, "TSIG"))
+        {
+            TimeSigTrack *timeSigTrack = song->timeSigTrack();
+            timeSigTrack->setStatus(r.u8());
+            int count = r.i32();
+            for (int n = 0; n < count; ++n)
+            {
+                Clock time   = Clock::convert(r.i32(), PPQN);
+                int   top    = r.i32();
+                int   bottom = r.i32();
+                timeSigTrack->insert
+                    (Event<TimeSig>(TimeSig(top, bottom), time));
+            }
+        }
+        else if (chunkIs(id, "KSIG"))
+        {
+            KeySigTrack *keySigTrack = song->keySigTrack();
+            keySigTrack->setStatus(r.u8());
+            int count = r.i32();
+            for (int n = 0; n < count; ++n)
+            {
+                Clock time        = Clock::convert(r.i32(), PPQN);
+                int   incidentals = r.i32();
+                int   type        = r.i32();
+                keySigTrack->insert
+                    (Event<KeySig>(KeySig(incidentals, type), time));
+            }
+        }
+        else if (chunkIs(id, "FLAG"))
+        {
+            FlagTrack *flagTrack = song->flagTrack();
+            int count = r.i32();
+            for (int n = 0; n < count; ++n)
+            {
+                Clock time = Clock::convert(r.i32(), PPQN);
+                flagTrack->insert(Event<Flag>(Flag(r.str()), time));
+            }
+        }
+        else if (chunkIs(id, "PHRS"))
+        {
+            std::string   title = r.str();
+            DisplayParams display;
+            readDisplay(r, &display);
+            size_t count = unsigned(r.i32());
+            if (count > length / eventSize)
+            {
+                throw SerializableError(FileFormatErr);
+            }
+            const unsigned char *p = r.take(count * eventSize);
+
+            // The events were saved in order, so this is a straight copy
+            std::vector<MidiEvent> events;
+            events.reserve(count);
+            for (size_t n = 0; n < count; ++n, p += eventSize)
+            {
+                events.push_back
+                    (MidiEvent(readCommand(p + 4, readInt(p + 8)),
+                               Clock::convert(readInt(p), PPQN),
+                               readCommand(p + 16, readInt(p + 20)),
+                               Clock::convert(readInt(p + 12), PPQN)));
+            }
+
+            PhraseEdit pe;
+            if (count)
+            {
+                pe.record(&events[0], count);
+                pe.mergeRecorded();
+            }
+            Phrase *phrase = pe.createPhrase(song->phraseList(), title);
+            *(phrase->displayParams()) = display;
+            phrases.push_back(phrase);
+        }
+        else if (chunkIs(id, "TRCK"))
+        {
+            Track *track = new Track();
+            song->insert(track);
+            track->setTitle(r.str());
+            readFilter(r, track->filter(), PPQN);
+            readParams(r, track->params());
+            readDisplay(r, track->displayParams());
+            int count = r.i32();
+            for (int n = 0; n < count; ++n)
+            {
+                int   index = r.i32();
+                Clock start = Clock::convert(r.i32(), PPQN);
+                Clock pend  = Clock::convert(r.i32(), PPQN);
+                std::unique_ptr<Part> part(new Part(start, pend));
+                part->setRepeat(Clock::convert(r.i32(), PPQN));
+                readFilter(r, part->filter(), PPQN);
+                readParams(r, part->params());
+                readDisplay(r, part->displayParams());
+                if (index >= 0 && size_t(index) < phrases.size())
+                {
+                    part->setPhrase(phrases[index]);
+                }
+                track->insert(part.get());
+                part.release();
+            }
+        }
+        else if (verbose >= 2)
+        {
+            diag << "Skipping unknown chunk \""
+                 << std::string(reinterpret_cast<const char*>(id), 4)
+                 << "\"\n";
+        }
+
+        // Anything left in the chunk was added by a later minor version
+        pos += length;
+    }
+
+    // Set last: the Tracks it refers to did not exist when SONG was read
+    song->setSoloTrack(soloTrack);
+
+    if (progress)
+    {
+        progress->progress(size);
+    }
+
+    return song.release();
+}
@@ -0,0 +1,134 @@
+/*
+ * @(#)TSE3Binary.h
+ *
+ * This file was added to this copy of TSE3 - the Trax Sequencer Engine
+ * version 3.00. It is not part of the upstream TSE3 release.
+ *
+ * This library is modifiable/redistributable under the terms of the GNU
+ * General Public License.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef TSE3_TSE3BINARY_H
+#define TSE3_TSE3BINARY_H
+
+#include <string>
+#include <cstddef>
+#include <iostream>
+
+namespace TSE3
+{
+    class Song;
+    class Progress;
+
+    /**
+     * The TSE3Binary object saves and loads @ref Song objects in the
+     * TSE3 binary file format. It holds exactly the same information as a
+     * @ref TSE3MDL file, so a @ref Song can be converted between the two
+     * without loss, but it is far quicker to load and far smaller for
+     * big songs.
+     *
+     * The file starts with the 8 byte signature "TSE3BIN\x1a" followed by a
+     * series of chunks. Each chunk is a four character identifier and a 32
+     * bit length, followed by that many bytes of data. All values are little
+     * endian. The chunks are:
+     *
+     * @li HEAD - Version numbers, PPQN and originator. Always first
+     * @li SONG - The @ref Song's title, author, copyright, date and
+     *            repeat settings
+     * @li TMPO, TSIG, KSIG, FLAG - The @ref TempoTrack, @ref TimeSigTrack,
+     *            @ref KeySigTrack and @ref FlagTrack events as arrays of
+     *            fixed size records
+     * @li PHRS - One per @ref Phrase, in @ref PhraseList order. The
+     *            @ref MidiEvent data is a packed array of 24 byte records
+     * @li TRCK - One per @ref Track, with its @ref Part objects as fixed
+     *            records that refer to their @ref Phrase by index
+     *
+     * A file is readable if its major version matches @ref MajorVersion.
+     * Newer minor versions may add chunks or append fields to the end of a
+     * chunk; readers skip anything they do not know about.
+     *
+     * On platforms that support it, the file is mapped into memory when
+     * loaded rather than read through a stream.
+     *
+     * @short   Object used to load/save TSE3 binary song files
+     * @version 1.00
+     * @see     TSE3MDL
+     * @see     FileRecogniser
+     */
+    class TSE3Binary
+    {
+        public:
+
+            /**
+             * Create a TSE3Binary file operations object.
+             *
+             * @param appname Name of the application using TSE3.
+             *                This is saved into the file header
+             * @param verbose Diagnostic level, normally you want to ignore
+             *                this and accept the default value
+             * @param diag    Where to send any diagnostic output
+             */
+            TSE3Binary(const std::string &appname = "",
+                       int                verbose = 0,
+                       std::ostream      &diag    = std::cout);
+
+            /**
+             * Save the given @ref Song to the file specified. If the file
+             * already exists it will be overwritten.
+             *
+             * @param  filename Filename to save to
+             * @param  song     Song object to save
+             * @throws SerializableError
+             */
+            void save(const std::string &filename, const Song *song);
+
+            /**
+             * As @ref save above, but you specify the ostream. It should
+             * have been opened in binary mode.
+             */
+            void save(std::ostream &out, const Song *song);
+
+            /**
+             * Load a @ref Song from the file specified. The returned @ref Song
+             * will have been newed from the free store, and so when you have
+             * finished with it it is your responsibility to delete it.
+             *
+             * @param  filename Filename to load from
+             * @param  progress The progress callback to keep informed of
+             *                  progress, or zero for no callback
+             * @return The loaded @ref Song - you must delete it
+             * @throws SerializableError
+             */
+            Song *load(const std::string &filename, Progress *progress = 0);
+
+            /**
+             * As @ref load above, but loads from a file image already in
+             * memory.
+             *
+             * @param  data     The file data
+             * @param  size     Size of the file data in bytes
+             * @param  progress The progress callback to keep informed of
+             *                  progress, or zero for no callback
+             * @return The loaded @ref Song - you must delete it
+             * @throws SerializableError
+             */
+            Song *load(const unsigned char *data, size_t size,
+                       Progress *progress = 0);
+
+            static const int MajorVersion = 1;
+            static const int MinorVersion = 0;
+
+        private:
+
+            std::string   originator;
+            int           verbose;
+            std::ostream &diag;
+    };
+}
+
+#endif
@@ -22,6 +22,7 @@
 #include "tse3/Progress.h"
 #include "tse3/MidiFile.h"
 #include "tse3/TSE2MDL.h"
+#include "tse3/TSE3Binary.h"
 
 #include <sstream>
 #include <fstream>
@@ -183,6 +184,7 @@ FileRecogniser::FileRecogniser(const std::string &f)
         _type = (header == "TSE3MDL") ? Type_TSE3MDL
               : (header == "TSEMDL")  ? Type_TSE2MDL
               : (header == "MThd")    ? Type_Midi
+              : (header == "TSE3BIN") ? Type_TSE3Binary
               : Type_Unknown;
     }
     else
@@ -215,6 +217,12 @@ Song *FileRecogniser::load(Progress *progress)
             song = mfi.load(progress);
             break;
         }
+        case Type_TSE3Binary:
+        {
+            TSE3Binary tse3binary;
+            song = tse3binary.load(filename, progress);
+            break;
+        }
     }
     return song;
 }
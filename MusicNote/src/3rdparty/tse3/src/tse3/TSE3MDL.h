@@ -126,6 +126,7 @@ namespace TSE3
      * @li Native TSE3MDL files
      * @li TSE2MDL (the file format of TSE2)
      * @li Standard MIDI files
+     * @li TSE3 binary files
      *
      * @short   Object used to work out a file's type
      * @author  Pete Goodliffe
@@ -148,7 +149,8 @@ namespace TSE3
                 Type_Unknown, // file type not recognised
                 Type_TSE3MDL, // TSE3MDL file
                 Type_TSE2MDL, // TSEMDL (TSE2) file
-                Type_Midi     // MIDI file
+                Type_Midi,    // MIDI file
+                Type_TSE3Binary // TSE3 binary file
             };
 
             /**
@@ -158,6 +160,7 @@ namespace TSE3
              * @li Type_TSE3MDL - A TSE3MDL file
              * @li Type_TSE2MDL - A TSEMDL file (from TSE2)
              * @li Type_Midi    - A standard MIDI file
+             * @li Type_TSE3Binary - A @ref TSE3Binary file
              *
              * @return The type of the specified file
              */
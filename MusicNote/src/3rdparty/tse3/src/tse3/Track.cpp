@@ -211,6 +211,47 @@ class TSE3::TrackImpl
  * Track class
  *****************************************************************************/
 
+namespace
+{
+    /**
+     * Orders a @ref Part by its start time against a @ref Clock for
+     * std::lower_bound.
+     */
+    struct PartStartsBefore
+    {
+        bool operator()(const Part *p, Clock c) const
+        {
+            return p->start() < c;
+        }
+    };
+
+    /**
+     * Orders two @ref Part objects by start time, and then by end time so
+     * that empty Parts sit before a Part starting at the same time. This
+     * keeps the end times in order as well.
+     */
+    struct PartBefore
+    {
+        bool operator()(const Part *a, const Part *b) const
+        {
+            return a->start() < b->start()
+                || (a->start() == b->start() && a->end() < b->end());
+        }
+    };
+
+    /**
+     * Orders a @ref Clock against a @ref Part's end time for
+     * std::upper_bound.
+     */
+    struct EndsAfter
+    {
+        bool operator()(Clock c, const Part *p) const
+        {
+            return c < p->end();
+        }
+    };
+}
+
 Track::Track()
 : pimpl(new TrackImpl())
 {
@@ -329,12 +370,9 @@ void Track::prvInsertPart(Part *part)
     part->setParentTrack(this);
     Listener<PartListener>::attachTo(part);
 
-    std::vector<Part*>::iterator i = pimpl->parts.begin();
-
-    while (i != pimpl->parts.end() && (*i)->start() < part->start())
-    {
-        ++i;
-    }
+    std::vector<Part*>::iterator i
+        = std::lower_bound(pimpl->parts.begin(), pimpl->parts.end(),
+                           part, PartBefore());
 
     pimpl->parts.insert(i, part);
 }
@@ -372,23 +410,34 @@ void Track::remove(size_t index)
 
 size_t Track::index(Clock c) const
 {
-    Impl::CritSec cs;
+    Impl::CritSecRead cs;
 
-    std::vector<Part*>::const_iterator i = pimpl->parts.begin();
-    while (i != pimpl->parts.end() && c >= (*i)->end())
-    {
-        ++i;
-    }
-    return (i == pimpl->parts.end()) ? size() : i - pimpl->parts.begin();
+    // Parts are held in time order and never overlap, so their end times
+    // are in order too
+    std::vector<Part*>::const_iterator i
+        = std::upper_bound(pimpl->parts.begin(), pimpl->parts.end(),
+                           c, EndsAfter());
+    return i - pimpl->parts.begin();
 }
 
 
 size_t Track::index(Part *part) const
 {
-    Impl::CritSec cs;
+    Impl::CritSecRead cs;
+
+    if (!part) return pimpl->parts.size();
 
     std::vector<Part*>::const_iterator i
-        = find(pimpl->parts.begin(), pimpl->parts.end(), part);
+        = std::lower_bound(pimpl->parts.begin(), pimpl->parts.end(),
+                           part->start(), PartStartsBefore());
+    while (i != pimpl->parts.end() && (*i)->start() == part->start())
+    {
+        if (*i == part) return i - pimpl->parts.begin();
+        ++i;
+    }
+
+    // Not where its start time says it should be
+    i = find(pimpl->parts.begin(), pimpl->parts.end(), part);
     return i - pimpl->parts.begin();
 }
 
@@ -423,7 +472,7 @@ PlayableIterator *Track::iterator(Clock index)
 
 Clock Track::lastClock() const
 {
-    Impl::CritSec cs;
+    Impl::CritSecRead cs;
 
     return (!pimpl->parts.empty())
                ? pimpl->parts[size()-1]->lastClock()
@@ -442,16 +491,13 @@ void Track::setParentSong(Song *parent)
 
 size_t Track::numPartsBetween(Clock start, Clock end)
 {
-    Impl::CritSec cs;
+    Impl::CritSecRead cs;
 
-    size_t count = 0;
-    size_t pos   = index(start);
-    while (pos != pimpl->parts.size() && pimpl->parts[pos]->start() < end)
-    {
-        ++count;
-        ++pos;
-    }
-    return count;
+    std::vector<Part*>::iterator first = pimpl->parts.begin() + index(start);
+    std::vector<Part*>::iterator last
+        = std::lower_bound(first, pimpl->parts.end(), end,
+                           PartStartsBefore());
+    return last - first;
 }
 
 
@@ -20,10 +20,68 @@
 #include "tse3/MidiScheduler.h"
 #include "tse3/FlagTrack.h"
 #include "tse3/PhraseEdit.h"
+#include "tse3/Snapshot.h"
 #include "tse3/FlagTrack.h"
+#include "tse3/util/MulDiv.h"
+#include "tse3/Error.h"
+#include "tse3/Mutex.h"
 
 using namespace TSE3;
 
+namespace
+{
+    /**
+     * The number of Transport locks the calling thread holds. A thread
+     * that has one already can't deadlock with the engine thread by taking
+     * it again.
+     */
+    thread_local int engineLocksHeld = 0;
+}
+
+/**
+ * Holds the Transport's lock. The engine thread takes the TSE3 Mutex
+ * whilst holding it, so a thread holding the TSE3 Mutex mustn't wait for
+ * it (see the lock order in the Transport class documentation).
+ */
+class TSE3::Transport::EngineLock
+{
+    public:
+        EngineLock(Transport *t) : t(t)
+        {
+            if (engineLocksHeld == 0 && t->engineOn
+                && Impl::Mutex::lockedByThisThread())
+            {
+                std::cerr << "TSE3: Transport called whilst holding the "
+                          << "TSE3 mutex\n";
+                throw Error(TransportLockOrderErr);
+            }
+            t->engineMutex.lock();
+            ++engineLocksHeld;
+        }
+        ~EngineLock()
+        {
+            --engineLocksHeld;
+            t->engineMutex.unlock();
+        }
+    protected:
+        Transport *t;
+};
+
+/**
+ * Serialises a Transport command with the engine thread, and wakes the
+ * engine thread once the command is done so that it sees the new state.
+ */
+class TSE3::Transport::CommandLock : public TSE3::Transport::EngineLock
+{
+    public:
+        CommandLock(Transport *t) : EngineLock(t) {}
+        ~CommandLock()
+        {
+            t->engineWake.notify_one();
+            t->_scheduler->wakeInputWait();
+        }
+};
+
 /******************************************************************************
  * TransportCallback class
  *****************************************************************************/
@@ -48,7 +106,8 @@ Transport::Transport(Metronome *m, MidiScheduler *s)
   _adaptiveLookAhead(true), _lookAhead(Clock::PPQN),
   _breakUps(0), injectedMidiCommand(),
   _playLeadIn(0), _recLeadIn(Clock::PPQN*4),
-  transportLeadIn(Clock::PPQN/4)
+  transportLeadIn(Clock::PPQN/4),
+  engineOn(false), _engineMargin(Clock::PPQN/4)
 {
     metronomeIterator = metronome->iterator(0);
     Listener<MidiSchedulerListener>::attachTo(_scheduler);
@@ -57,6 +116,7 @@ Transport::Transport(Metronome *m, MidiScheduler *s)
 
 Transport::~Transport()
 {
+    stopEngine();
     if (_status != Resting) stop();
     delete metronomeIterator;
 }
@@ -64,18 +124,21 @@ Transport::~Transport()
 
 void Transport::attachCallback(TransportCallback *c)
 {
+    CommandLock lock(this);
     callbacks.push_back(c);
 }
 
 
 void Transport::detachCallback(TransportCallback *c)
 {
+    CommandLock lock(this);
     callbacks.remove(c);
 }
 
 
 void Transport::setLookAhead(Clock c)
 {
+    CommandLock lock(this);
     if (c >= 0 && c != _lookAhead)
     {
         _lookAhead = (c > _minimumLookAhead) ? c : _minimumLookAhead;
@@ -87,6 +150,7 @@ void Transport::setLookAhead(Clock c)
 
 void Transport::setSynchro(bool s)
 {
+    CommandLock lock(this);
     _synchro = s;
     notify(&TransportListener::Transport_Altered,
            TransportListener::SynchroChanged);
@@ -95,6 +159,7 @@ void Transport::setSynchro(bool s)
 
 void Transport::setPunchIn(bool p)
 {
+    CommandLock lock(this);
     _punchIn = p;
     notify(&TransportListener::Transport_Altered,
            TransportListener::PunchInChanged);
@@ -103,6 +168,7 @@ void Transport::setPunchIn(bool p)
 
 void Transport::setAutoStop(bool s)
 {
+    CommandLock lock(this);
     _autoStop = s;
     notify(&TransportListener::Transport_Altered,
            TransportListener::AutoStopChanged);
@@ -111,6 +177,7 @@ void Transport::setAutoStop(bool s)
 
 void Transport::setPlayLeadIn(Clock c)
 {
+    CommandLock lock(this);
     if (c >= 0) _playLeadIn = c;
     notify(&TransportListener::Transport_Altered,
            TransportListener::PlayLeadInChanged);
@@ -119,6 +186,7 @@ void Transport::setPlayLeadIn(Clock c)
 
 void Transport::setRecordLeadIn(Clock c)
 {
+    CommandLock lock(this);
     if (c >= 0) _recLeadIn = c;
     notify(&TransportListener::Transport_Altered,
            TransportListener::RecordLeadInChanged);
@@ -127,12 +195,120 @@ void Transport::setRecordLeadIn(Clock c)
 
 void Transport::setAdaptiveLookAhead(bool ala)
 {
+    CommandLock lock(this);
     _adaptiveLookAhead = ala;
 }
 
 
+void Transport::setEngineMargin(Clock m)
+{
+    CommandLock lock(this);
+    if (m >= 0) _engineMargin = m;
+}
+
+
+void Transport::startEngine()
+{
+    EngineLock lock(this);
+    if (engineOn) return;
+
+    engineOn = true;
+    if (engineThread.joinable())
+    {
+        // Stopped from one of its own callbacks. If this is that callback,
+        // the thread just carries on. Otherwise it has left engineProc,
+        // since we have the lock.
+        if (engineThread.get_id() == std::this_thread::get_id()) return;
+        engineThread.join();
+    }
+    engineThread = std::thread(&Transport::engineProc, this);
+}
+
+
+void Transport::stopEngine()
+{
+    {
+        EngineLock lock(this);
+        engineOn = false;
+    }
+    engineWake.notify_one();
+    _scheduler->wakeInputWait();
+
+    // A callback on the engine thread can't join its own thread; the thread
+    // leaves engineProc once the callback returns.
+    if (engineThread.joinable()
+        && engineThread.get_id() != std::this_thread::get_id())
+    {
+        engineThread.join();
+    }
+}
+
+
+void Transport::engineProc()
+{
+    std::unique_lock<std::recursive_mutex> lock(engineMutex);
+
+    while (engineOn)
+    {
+        poll();
+        if (!engineOn) break;
+
+        std::chrono::steady_clock::time_point deadline = engineDeadline();
+        if (engineWantsInput())
+        {
+            // Wait for input without the lock, so that commands can get in
+            // (they wake the wait) and input arrives with no polling delay.
+            // The scheduler is only read by poll, under the lock.
+            lock.unlock();
+            _scheduler->waitForInput(deadline);
+            lock.lock();
+        }
+        else
+        {
+            engineWake.wait_until(lock, deadline);
+        }
+    }
+}
+
+
+std::chrono::steady_clock::time_point Transport::engineDeadline()
+{
+    typedef std::chrono::steady_clock steady_clock;
+
+    steady_clock::time_point now      = steady_clock::now();
+    steady_clock::time_point deadline = now + std::chrono::hours(1);
+
+    if (_status == Playing || _status == Recording)
+    {
+        // Wake up when the playback gets within the margin of the end of
+        // the scheduled data
+        Clock clock = _scheduler->clock();
+        Clock wake  = lastScheduledClock - _engineMargin;
+        int   ms    = 0;
+        if (wake > clock)
+        {
+            ms = Util::muldiv(wake - clock, 60000/Clock::PPQN,
+                              _scheduler->tempo());
+        }
+        deadline = now + std::chrono::milliseconds(ms);
+    }
+
+    return deadline;
+}
+
+
+bool Transport::engineWantsInput()
+{
+    return _status == Recording
+           || _status == SynchroPlaying
+           || _status == SynchroRecording
+           || _midiEcho.filter()->status();
+}
+
+
 void Transport::play(Playable *p, Clock start)
 {
+    CommandLock lock(this);
     if (_status == Playing || _status == SynchroPlaying)
     {
         stop();
@@ -195,6 +371,7 @@ void Transport::play(Playable *p, Clock start)
 void Transport::record(Playable *p, Clock start, PhraseEdit *pe,
                        MidiFilter *filter)
 {
+    CommandLock lock(this);
     if (_status == Recording)
     {
         stop();
@@ -270,6 +447,7 @@ void Transport::record(Playable *p, Clock start, PhraseEdit *pe,
 
 void Transport::stop()
 {
+    CommandLock lock(this);
     if (_status == Resting)
     {
         if (_scheduler->clock() > 0) _scheduler->moveTo(0);
@@ -297,6 +475,7 @@ void Transport::stop()
 
 void Transport::ff(bool strong)
 {
+    CommandLock lock(this);
     // We add 0.5 * PPQN to the shiftBy time since it will be rounded down.
     Clock shift = strong ? Clock::PPQN * 9/2/*4.5*/ : Clock::PPQN * 3/2/*1.5*/;
 
@@ -306,6 +485,7 @@ void Transport::ff(bool strong)
 
 void Transport::ffFlag()
 {
+    CommandLock lock(this);
     if (!flagTrack) return;
     Clock now = _scheduler->clock();
     size_t index = flagTrack->index(now);
@@ -318,6 +498,7 @@ void Transport::ffFlag()
 
 void Transport::rew(bool strong)
 {
+    CommandLock lock(this);
     Clock shift = strong ? Clock::PPQN * -4 : Clock::PPQN * -1;
 
     shiftBy(shift);
@@ -326,6 +507,7 @@ void Transport::rew(bool strong)
 
 void Transport::rewFlag()
 {
+    CommandLock lock(this);
     if (!flagTrack) return;
     Clock now = _scheduler->clock();
     int index = flagTrack->index(now);
@@ -384,6 +566,11 @@ void Transport::shiftBy(Clock shiftBy)
 
 void Transport::poll()
 {
+    EngineLock lock(this);
+
+    // One read section for every filter the events pass through
+    Impl::SnapshotReader reader;
+
     // MIDI input
     while (_scheduler->eventWaiting() || injectedMidiCommand.status)
     {
@@ -422,10 +609,16 @@ void Transport::poll()
                 punchInFilter->setStatus(false);
                 punchedInYet = true;
             }
-            recPE->insert(e);
+            recPE->record(e);
         }
     }
 
+    // Recorded events reach the PhraseEdit in one merge per poll
+    if (_status == Recording && recPE)
+    {
+        recPE->mergeRecorded();
+    }
+
     // MIDI output
     if (_status == Playing || _status == Recording) pollPlayback();
 }
@@ -441,7 +634,7 @@ void Transport::pollPlayback()
      */
 
     Clock now = _scheduler->clock();
-    if (_adaptiveLookAhead)
+    if (_adaptiveLookAhead && !engineOn)
     {
         _lookAhead = (now - lastPollPlaybackClock)*4 + (_lookAhead/2);
         if (_lookAhead < _minimumLookAhead) _lookAhead = _minimumLookAhead;
@@ -452,9 +645,26 @@ void Transport::pollPlayback()
         ++_breakUps;
     }
 
-    if (now + _lookAhead > lastScheduledClock)
+    /*
+     * The engine thread schedules one look ahead window on from the end of
+     * the previous one whenever it wakes up near that end. Otherwise we
+     * top up the window to the look ahead from now.
+     */
+    bool due = engineOn ? (now + _engineMargin >= lastScheduledClock)
+                        : (now + _lookAhead > lastScheduledClock);
+
+    if (due)
     {
-        lastScheduledClock = now + _lookAhead;
+        if (engineOn)
+        {
+            lastScheduledClock
+                = ((now > lastScheduledClock) ? now : lastScheduledClock)
+                + _lookAhead;
+        }
+        else
+        {
+            lastScheduledClock = now + _lookAhead;
+        }
 
         bool cont = true;  // whether to keep scheduling
 
@@ -516,14 +726,15 @@ void Transport::pollPlayback()
                 if (e.data.status >= MidiCommand_NoteOff)
                 {
                     /*
-                     * We have a MidiEvent to send to the scheduler. We do
-                     * this and then consume it from whichever source it came.
+                     * We have a MidiEvent to send to the scheduler. We add
+                     * it to the batch for this window (see flushTx) and
+                     * then consume it from whichever source it came.
                      *
                      * If it is a MidiCommand_NoteOn, we put the
                      * MidiCommand_NoteOff in a buffer to be sent later.
                      */
                     e = _filter.filter(e);
-                    _scheduler->tx(e);
+                    txBatch.push_back(e);
                     callback_MidiOut(e.data);
                     if (e.data.status == MidiCommand_NoteOn)
                     {
@@ -541,6 +752,8 @@ void Transport::pollPlayback()
                     {
                         case MidiCommand_TSE_Meta_MoveTo:
                         {
+                            flushTx();
+
                             /*
                              * We're about to move, so we schedule all the
                              * note off events to happen now.
@@ -563,6 +776,9 @@ void Transport::pollPlayback()
                         }
                         case MidiCommand_TSE_Meta_Tempo:
                         {
+                            // The scheduler times the events with the
+                            // tempo at the time they are given to it
+                            flushTx();
                             _scheduler->setTempo(e.data.data2, e.time);
                             break;
                         }
@@ -597,6 +813,8 @@ void Transport::pollPlayback()
 
         } while (cont);
 
+        flushTx();
+
         // Handle automatic stop
         if ((!iterator || !iterator->more())
             && _autoStop
@@ -609,8 +827,19 @@ void Transport::pollPlayback()
 }
 
 
+void Transport::flushTx()
+{
+    if (!txBatch.empty())
+    {
+        _scheduler->tx(&txBatch[0], txBatch.size());
+        txBatch.clear();
+    }
+}
+
+
 void Transport::stopPlayback(Clock stopTime)
 {
+    const bool wasRecording = _status == Recording;
     _status = Resting;
     _scheduler->stop(stopTime);
 
@@ -624,8 +853,9 @@ void Transport::stopPlayback(Clock stopTime)
     delete iterator;
     iterator = 0;
 
-    if (_status == Recording)
+    if (wasRecording && recPE)
     {
+        recPE->mergeRecorded();
         Listener<PhraseEditListener>::detachFrom(recPE);
         recPE = 0;
     }
@@ -638,6 +868,7 @@ void Transport::stopPlayback(Clock stopTime)
 
 void Transport::inject(MidiCommand c)
 {
+    CommandLock lock(this);
     injectedMidiCommand = c;
     poll();
 }
@@ -745,8 +976,9 @@ void Transport::Notifier_Deleted(PhraseEdit *pe)
 {
     if (pe == recPE)
     {
-        stop();
+        // Too late to merge any recorded events into it
         recPE = 0;
+        stop();
     }
 }
 
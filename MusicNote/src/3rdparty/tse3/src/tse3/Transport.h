@@ -31,6 +31,11 @@
 
 #include <queue>
 #include <list>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace TSE3
 {
@@ -46,6 +51,20 @@ namespace TSE3
      * to do this polling in a background thread (see @ref Impl::Mutex for
      * information on threading issues).
      *
+     * Alternatively, @ref startEngine starts a thread of the Transport's own
+     * that calls @ref poll only when there is work to do, so that the
+     * application needs no polling loop at all.
+     *
+     * The Transport has a lock of its own, which its methods and the thread
+     * calling @ref poll hold whilst they work. Polling takes the global
+     * @ref Impl::Mutex inside that lock, so the lock order is always the
+     * Transport's lock first and the TSE3 Mutex second. Hence you must not
+     * call Transport methods whilst holding the TSE3 Mutex (a
+     * @ref Impl::CritSec or @ref Impl::CritSecRead). If you do whilst the
+     * engine runs they throw an @ref Error with the TransportLockOrderErr
+     * code, rather than risk deadlocking with the engine thread. Callbacks
+     * the Transport makes from inside its own methods may call it again.
+     *
      * Facilities provided by the Transport class include:
      * @li Play
      * @li Record into @ref PhraseEdit
@@ -370,6 +389,80 @@ namespace TSE3
              */
             void poll();
 
+            /**
+             * Starts the built in engine thread, which does the work of
+             * @ref poll so that the application need not.
+             *
+             * Rather than poll at a fixed rate, the engine thread sleeps until
+             * the scheduled playback data is about to run out (see
+             * @ref engineMargin) and then schedules one more @ref lookAhead
+             * window of data. Transport commands (such as @ref play, @ref stop
+             * or @ref inject) wake it up at once. Whilst MIDI input is of
+             * interest (when recording, in synchro modes or with the MIDI
+             * echo enabled) it also waits for input with
+             * @ref MidiScheduler::waitForInput, which sleeps until input
+             * arrives on schedulers that support it and polls every
+             * millisecond on the others. Callbacks alone do not make input
+             * of interest: otherwise their Transport_MidiIn calls come
+             * whenever the engine next wakes.
+             *
+             * The adaptive look ahead has no effect whilst the engine runs:
+             * the @ref lookAhead window is fixed.
+             *
+             * Whilst the engine runs, the Transport methods may be called from
+             * any thread; they are serialised with the engine thread. They
+             * must not be called whilst holding the TSE3 Mutex (see the
+             * lock order above).
+             *
+             * Does nothing if the engine is already running.
+             *
+             * @see stopEngine
+             * @see engineRunning
+             */
+            void startEngine();
+
+            /**
+             * Stops the engine thread started by @ref startEngine, waiting
+             * for it to finish. The transport state is left as it is; call
+             * @ref stop first to stop any playback.
+             *
+             * This may be called from a callback on the engine thread itself
+             * (for example a @ref TransportListener). It then returns at once,
+             * and the thread finishes when the callback returns. It must not
+             * be called from a callback that another thread makes from
+             * inside a Transport method, since that thread holds the lock
+             * the engine thread needs in order to finish.
+             *
+             * Does nothing if the engine is not running.
+             */
+            void stopEngine();
+
+            /**
+             * Returns whether the engine thread is running.
+             *
+             * @see startEngine
+             */
+            bool engineRunning() const { return engineOn; }
+
+            /**
+             * Returns the engine margin. The engine thread schedules the next
+             * @ref lookAhead window when the playback is this close to the
+             * end of the data already scheduled. It gives the engine thread
+             * time to wake up. The default is a quarter of a beat.
+             *
+             * @return Engine margin
+             * @see    setEngineMargin
+             */
+            Clock engineMargin() const { return _engineMargin; }
+
+            /**
+             * Sets the engine margin.
+             *
+             * @param m New engine margin
+             * @see   engineMargin
+             */
+            void setEngineMargin(Clock m);
+
             /**
              * Returns the current state of the Transport object
              *
@@ -548,6 +641,12 @@ namespace TSE3
              */
             void stopPlayback(Clock stopTime);
 
+            /**
+             * Sends the events collected in txBatch by @ref pollPlayback
+             * to the scheduler in one go.
+             */
+            void flushTx();
+
             /**
              * Used by ff/rew methods.
              *
@@ -556,6 +655,30 @@ namespace TSE3
              */
             void shiftBy(Clock c);
 
+            /**
+             * The engine thread procedure.
+             */
+            void engineProc();
+
+            /**
+             * Returns when the engine thread should next wake up to
+             * schedule playback.
+             */
+            std::chrono::steady_clock::time_point engineDeadline();
+
+            /**
+             * Returns whether the engine thread should wait for MIDI input.
+             */
+            bool engineWantsInput();
+
+            /**
+             * Takes the Transport's lock, checking the lock order (see
+             * the class documentation). CommandLock also wakes the engine
+             * thread when it is released.
+             */
+            class EngineLock;
+            class CommandLock;
+
             /**
              * Sends Transport_MidiOut to all attached callbacks.
              */
@@ -581,6 +704,7 @@ namespace TSE3
                                 std::vector<MidiEvent>,
                                 std::greater<MidiEvent> >
                                             noteOffBuffer;
+            std::vector<MidiEvent>          txBatch;
             Metronome                      *metronome;
             PlayableIterator               *metronomeIterator;
             MidiScheduler                  *_scheduler;
@@ -614,6 +738,17 @@ namespace TSE3
              * get some MidiEvents into the scheduler.
              */
             Clock transportLeadIn;
+
+            /**
+             * The engine thread and its lock. The lock is held by the engine
+             * thread whilst it polls, and by the Transport commands. It is
+             * released whilst the engine thread waits for input.
+             */
+            std::thread                     engineThread;
+            std::recursive_mutex            engineMutex;
+            std::condition_variable_any     engineWake;
+            std::atomic<bool>               engineOn;
+            Clock                           _engineMargin;
     };
 }
 
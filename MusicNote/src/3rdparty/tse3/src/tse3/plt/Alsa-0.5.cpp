@@ -650,6 +650,20 @@ bool AlsaMidiScheduler::impl_eventWaiting()
 }
 
 
+void AlsaMidiScheduler::impl_waitForInput
+    (std::chrono::steady_clock::time_point until)
+{
+    // This version of the driver doesn't wait on the sequencer
+    MidiScheduler::impl_waitForInput(until);
+}
+
+
+void AlsaMidiScheduler::impl_wakeInputWait()
+{
+    MidiScheduler::impl_wakeInputWait();
+}
+
+
 TSE3::MidiEvent AlsaMidiScheduler::impl_rx()
 {
     if (!impl_eventWaiting()) return MidiEvent();
@@ -741,6 +755,16 @@ void AlsaMidiScheduler::impl_tx(MidiEvent e)
 }
 
 
+void AlsaMidiScheduler::impl_tx(const MidiEvent *events, size_t count)
+{
+    // The 0.5.x output path drains per event; just forward them in turn.
+    for (size_t n = 0; n < count; ++n)
+    {
+        impl_tx(events[n]);
+    }
+}
+
+
 void AlsaMidiScheduler::impl_txSysEx(int port,
                                      const unsigned char *data, size_t size)
 {
@@ -29,6 +29,9 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <alloca.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 #if HAVE_ALSA_ASOUNDLIB_H
 #include <sys/asoundlib.h>
 #elif HAVE_SYS_ASOUNDLIB_H
@@ -38,6 +41,7 @@
 #include <vector>
 #include <utility>
 #include <cstdio>
+#include <cstring>
 
 using namespace TSE3;
 using namespace TSE3::Plt;
@@ -76,6 +80,7 @@ class TSE3::Plt::AlsaImpl
         snd_seq_port_info_t   *port_info;   // info about our port
         int my_port;
         int                    queue;       // the id of the queue we create
+        int                    wakePipe[2]; // wakes impl_waitForInput
 
         // Alsa destinations are client/port pairs. Whilst the MidiScheduler
         // API supports ports numbered 0-X, in Alsa these numbers are
@@ -101,17 +106,22 @@ class TSE3::Plt::AlsaImpl
          * In this version of the driver we only support timing in msecs.
          * Later on we'll hook into Alsa's ticks and then be able to sync
          * to external timing sources.
+         *
+         * If drain is false the event is left in the output buffer, to be
+         * sent with the next snd_seq_drain_output.
          */
         void tx(MidiCommand         mc,
                 int                 queue = SND_SEQ_QUEUE_DIRECT,
                 long int            sec   = 0,
-                long int            nsec  = 0);
+                long int            nsec  = 0,
+                bool                drain = true);
 };
 
 
 TSE3::Plt::AlsaImpl::AlsaImpl()
 : handle(0), client_info(0), port_info(0)
 {
+    wakePipe[0] = wakePipe[1] = -1;
 
     // Check for ALSA support on machine
     struct stat buf;
@@ -170,6 +180,18 @@ TSE3::Plt::AlsaImpl::AlsaImpl()
         snd_seq_close(handle);
         throw TSE3::MidiSchedulerError(MidiSchedulerCreateErr);
     }
+
+    // A pipe to interrupt impl_waitForInput with. Without it we fall back
+    // on the MidiScheduler's millisecond polling.
+    if (pipe(wakePipe) == 0)
+    {
+        fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+    }
+    else
+    {
+        wakePipe[0] = wakePipe[1] = -1;
+    }
 }
 
 
@@ -178,6 +200,11 @@ TSE3::Plt::AlsaImpl::~AlsaImpl()
     if (handle)      snd_seq_close(handle);
     if (client_info) snd_seq_client_info_free(client_info);
     if (port_info)   snd_seq_port_info_free(port_info);
+    if (wakePipe[0] >= 0)
+    {
+        close(wakePipe[0]);
+        close(wakePipe[1]);
+    }
 }
 
 
@@ -273,7 +300,7 @@ void TSE3::Plt::AlsaMidiScheduler::getSystemInfo()
 
 
 void TSE3::Plt::AlsaImpl::tx(MidiCommand mc, int queue,
-                             long int sec, long int nsec)
+                             long int sec, long int nsec, bool drain)
 {
     snd_seq_event_t ev;
     if (mc.port > (int)dest.size()-1)
@@ -358,7 +385,10 @@ void TSE3::Plt::AlsaImpl::tx(MidiCommand mc, int queue,
         }
     }
     snd_seq_event_output(handle, &ev);
-    snd_seq_drain_output(handle);
+    if (drain)
+    {
+        snd_seq_drain_output(handle);
+    }
 
     running[mc.port] = (mc.status<<4) + mc.channel;
 }
@@ -607,6 +637,63 @@ bool AlsaMidiScheduler::impl_eventWaiting()
 }
 
 
+void AlsaMidiScheduler::impl_waitForInput
+    (std::chrono::steady_clock::time_point until)
+{
+    if (pimpl->wakePipe[0] < 0)
+    {
+        MidiScheduler::impl_waitForInput(until);
+        return;
+    }
+
+    // Sleep on the sequencer's input descriptors and the wake up pipe.
+    // Only the descriptors are looked at here, not the handle's buffers,
+    // so another thread can carry on transmitting.
+    int count = snd_seq_poll_descriptors_count(pimpl->handle, POLLIN);
+    struct pollfd *fds
+        = (struct pollfd*)alloca((count+1) * sizeof(struct pollfd));
+    count = snd_seq_poll_descriptors(pimpl->handle, fds, count, POLLIN);
+    fds[count].fd      = pimpl->wakePipe[0];
+    fds[count].events  = POLLIN;
+    fds[count].revents = 0;
+
+    // Round up, so that we don't wake just before the time and spin
+    std::chrono::steady_clock::duration left
+        = until - std::chrono::steady_clock::now();
+    long ms = std::chrono::duration_cast<std::chrono::milliseconds>
+        (left + std::chrono::milliseconds(1)
+         - std::chrono::steady_clock::duration(1)).count();
+    if (ms < 0) ms = 0;
+    if (ms > 60000) ms = 60000;
+
+    int r = poll(fds, count+1, (int)ms);
+    if (r < 0 && errno != EINTR)
+    {
+        std::cerr << "TSE3: Alsa scheduler error waiting for input\n"
+                  << "      (" << strerror(errno) << ")\n";
+        MidiScheduler::impl_waitForInput(until);
+    }
+
+    char buffer[16];
+    while (read(pimpl->wakePipe[0], buffer, sizeof(buffer)) > 0)
+    {
+    }
+}
+
+
+void AlsaMidiScheduler::impl_wakeInputWait()
+{
+    if (pimpl->wakePipe[1] >= 0)
+    {
+        // The pipe is non-blocking: if it is full, a wake up is pending
+        // anyway
+        char c = 0;
+        ssize_t r = write(pimpl->wakePipe[1], &c, 1);
+        (void)r;
+    }
+}
+
+
 TSE3::MidiEvent AlsaMidiScheduler::impl_rx()
 {
     if (!impl_eventWaiting()) return MidiEvent();
@@ -698,6 +785,20 @@ void AlsaMidiScheduler::impl_tx(MidiEvent e)
 }
 
 
+void AlsaMidiScheduler::impl_tx(const MidiEvent *events, size_t count)
+{
+    // The events collect in the output buffer (which is drained on its own
+    // should it fill up) and go to the sequencer with one drain.
+    for (size_t n = 0; n < count; ++n)
+    {
+        int ms = clockToMs(events[n].time);
+        pimpl->tx(events[n].data, pimpl->queue,
+                  ms/1000, (ms%1000)*1000000, false);
+    }
+    snd_seq_drain_output(pimpl->handle);
+}
+
+
 void AlsaMidiScheduler::impl_txSysEx(int port,
                                      const unsigned char *data, size_t size)
 {
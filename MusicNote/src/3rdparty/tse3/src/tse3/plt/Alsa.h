@@ -92,6 +92,15 @@ namespace TSE3
                  * @reimplemented
                  */
                 virtual bool impl_eventWaiting();
+                /**
+                 * @reimplemented
+                 */
+                virtual void impl_waitForInput
+                    (std::chrono::steady_clock::time_point until);
+                /**
+                 * @reimplemented
+                 */
+                virtual void impl_wakeInputWait();
                 /**
                  * @reimplemented
                  */
@@ -104,6 +113,10 @@ namespace TSE3
                  * @reimplemented
                  */
                 virtual void impl_tx(MidiEvent mc);
+                /**
+                 * @reimplemented
+                 */
+                virtual void impl_tx(const MidiEvent *events, size_t count);
                 /**
                  * @reimplemented
                  */
@@ -210,6 +210,7 @@ void StreamMidiScheduler::outMidiCommand(MidiCommand mc)
  *****************************************************************************/
 
 NullMidiScheduler::NullMidiScheduler()
+: clock(0), _noEventsTx(0)
 {
     addPort(0, 0);
 }
@@ -252,6 +253,7 @@ bool NullMidiScheduler::impl_portWriteable(int /*port*/) const
 
 void NullMidiScheduler::impl_tx(MidiCommand /*c*/)
 {
+    ++_noEventsTx;
 }
 
 
@@ -307,6 +309,13 @@ MidiEvent NullMidiScheduler::impl_rx()
 
 void NullMidiScheduler::impl_tx(MidiEvent /*e*/)
 {
+    ++_noEventsTx;
+}
+
+
+void NullMidiScheduler::impl_tx(const MidiEvent * /*events*/, size_t count)
+{
+    _noEventsTx += count;
 }
 
 
@@ -129,6 +129,10 @@ namespace TSE3
          * If a MidiScheduler cannot be made for a given platform then this is
          * a placeholder 'null' implementation that does absolutely nothing.
          *
+         * Its clock does not move by itself. A program with no MIDI hardware
+         * (a test or benchmark, say) can drive a @ref Transport in a virtual
+         * time of its own by calling @ref setClock between polls.
+         *
          * @short   Null MidiScheduler implementation (does nothing!)
          * @author  Pete Goodliffe
          * @version 3.00
@@ -142,6 +146,21 @@ namespace TSE3
                 NullMidiScheduler();
                 virtual ~NullMidiScheduler();
 
+                /**
+                 * Sets the current time of the (stopped) clock.
+                 *
+                 * @param c New time
+                 */
+                void setClock(Clock c) { clock = c; }
+
+                /**
+                 * Returns the number of @ref MidiEvent and @ref MidiCommand
+                 * objects transmitted so far.
+                 *
+                 * @return Number of events transmitted
+                 */
+                size_t noEventsTx() const { return _noEventsTx; }
+
             protected:
 
                 /**
@@ -204,6 +223,10 @@ namespace TSE3
                  * @reimplemented
                  */
                 virtual void impl_tx(MidiEvent mc);
+                /**
+                 * @reimplemented
+                 */
+                virtual void impl_tx(const MidiEvent *events, size_t count);
                 /**
                  * @reimplemented
                  */
@@ -216,7 +239,8 @@ namespace TSE3
                 NullMidiScheduler &operator=(const NullMidiScheduler &);
                 NullMidiScheduler(const NullMidiScheduler &);
 
-                Clock clock;
+                Clock  clock;
+                size_t _noEventsTx;
         };
     }
 }
@@ -16,6 +16,8 @@
 
 #include "tse3/util/PowerQuantise.h"
 #include "tse3/PhraseEdit.h"
+#include "tse3/Mutex.h"
+#include "tse3/Parallel.h"
 
 #include <algorithm>
 #include <cstdlib>
@@ -147,15 +149,89 @@ void PowerQuantise::setLengthHumanise(Clock h)
 }
 
 
+namespace
+{
+    /**
+     * Copies the events out of @p phraseEdit and returns the
+     * PhraseEdit::generation they were taken at.
+     */
+    size_t copyEvents(PhraseEdit *phraseEdit, std::vector<MidiEvent> &events)
+    {
+        Impl::CritSec cs;
+
+        events.clear();
+        events.reserve(phraseEdit->size());
+        for (size_t pos = 0; pos < phraseEdit->size(); ++pos)
+        {
+            events.push_back((*phraseEdit)[pos]);
+        }
+        return phraseEdit->generation();
+    }
+}
+
+
 void PowerQuantise::go(PhraseEdit *phraseEdit)
 {
+    // Quantise a detached copy of the events, so that the TSE3 lock is only
+    // held while taking it and putting the result back. If the PhraseEdit
+    // changed in between, the result is stale and we start again.
+    std::vector<MidiEvent> events;
+    for (int attempt = 0; attempt < PhraseEdit::detachedAttempts; ++attempt)
+    {
+        size_t generation = copyEvents(phraseEdit, events);
+        Clock  lastClock  = quantiseEvents(events);
+        if (phraseEdit->tidy(events, lastClock, generation)) return;
+    }
+
+    // Someone keeps editing under our feet, so hold the lock throughout
+    Impl::CritSec cs;
+
+    size_t generation = copyEvents(phraseEdit, events);
+    Clock  lastClock  = quantiseEvents(events);
+    phraseEdit->tidy(events, lastClock, generation);
+}
+
+
+Clock PowerQuantise::quantiseEvents(std::vector<MidiEvent> &events)
+{
+    const size_t size = events.size();
+
+    // Snapping each event to the pattern does not depend on any other
+    // event, so do it in parallel. Humanising uses rand(), so it is left
+    // to the pass below to keep the same sequence of random numbers.
+    std::vector<Clock> snapped(size);
+    std::vector<Clock> offSnapped(size);
+    Impl::parallelFor(size, [&](size_t begin, size_t end)
+    {
+        for (size_t pos = begin; pos < end; ++pos)
+        {
+            const MidiEvent &e = events[pos];
+            snapped[pos] = quantise(e.time, _by);
+            if (e.data.status == MidiCommand_NoteOn)
+            {
+                offSnapped[pos] = (_length == quantiseLength)
+                                ? quantise(e.offTime - e.time, _lengthBy)
+                                : quantise(e.offTime, _lengthBy);
+            }
+        }
+    });
+
+    // The next non-continuous event after each one, to spread continuous
+    // events towards
+    std::vector<size_t> nextNonCont(size);
+    for (size_t pos = size, next = size; pos-- > 0; )
+    {
+        nextNonCont[pos] = next;
+        if (!isContinuous(events[pos])) next = pos;
+    }
+
     Clock lastClock             = 0; // time of last event in PhraseEdit
     Clock lastNonCont_Original  = 0; // time of last non continuous event
     Clock lastNonCont_Quantised = 0; // quantised time of last non cont ev
 
-    for (size_t pos = 0; pos < phraseEdit->size(); ++pos)
+    for (size_t pos = 0; pos < size; ++pos)
     {
-        MidiEvent e = (*phraseEdit)[pos];
+        MidiEvent e = events[pos];
         if (e.time > lastClock) lastClock = e.time;
         if (!isContinuous(e))
         {
@@ -164,8 +240,7 @@ void PowerQuantise::go(PhraseEdit *phraseEdit)
         if (shouldBeQuantised(e))
         {
             MidiEvent qe = e; // qe: quantised event
-            qe.time = quantise(e.time, _by);
-            qe.time = humanise(qe.time, _humanise);
+            qe.time = humanise(snapped[pos], _humanise);
             if (!isContinuous(qe))   lastNonCont_Quantised = qe.time;
             if (qe.time > lastClock) lastClock = qe.time;
             if (qe.data.status == MidiCommand_NoteOn)
@@ -174,29 +249,43 @@ void PowerQuantise::go(PhraseEdit *phraseEdit)
                 if (qe.offTime > lastClock) lastClock = qe.offTime;
                 if (_length == quantiseLength)
                 {
-                    qe.offTime = qe.time
-                               + quantise(qe.offTime - e.time, _lengthBy);
+                    qe.offTime = qe.time + offSnapped[pos];
                 }
                 else
                 {
-                    qe.offTime = quantise(qe.offTime, _lengthBy);
+                    qe.offTime = offSnapped[pos];
                 }
                 qe.offTime = humanise(qe.offTime, _lengthHumanise);
                 if (qe.offTime > lastClock) lastClock = qe.offTime;
             }
-            (*phraseEdit)[pos] = qe;
+            events[pos] = qe;
         }
         else if (shouldBeSpread(e))
         {
-            Clock c = spreadContinuous(phraseEdit, pos,
+            // Later events have not been touched yet, so still hold their
+            // original times
+            size_t next = nextNonCont[pos];
+            if (next < size)
+            {
+                events[pos].time
+                    = spreadContinuous(e.time,
+                                       lastNonCont_Original,
+                                       lastNonCont_Quantised,
+                                       events[next].time, snapped[next]);
+            }
+            else
+            {
+                events[pos].time
+                    = spreadContinuous(e.time,
+                                       lastNonCont_Original,
+                                       lastNonCont_Quantised,
                                        lastNonCont_Original,
                                        lastNonCont_Quantised);
-            e.time = c;
-            (*phraseEdit)[pos] = e;
+            }
         }
     }
 
-    phraseEdit->tidy(lastClock);
+    return lastClock;
 }
 
 
@@ -278,34 +367,21 @@ Clock PowerQuantise::humanise(Clock time, Clock maxVal)
 }
 
 
-Clock PowerQuantise::spreadContinuous(PhraseEdit *phraseEdit, size_t pos,
+Clock PowerQuantise::spreadContinuous(Clock time,
                                       Clock lastNonCont_Original,
-                                      Clock lastNonCont_Quantised)
+                                      Clock lastNonCont_Quantised,
+                                      Clock nextNonCont_Original,
+                                      Clock nextNonCont_Quantised)
 {
-    MidiEvent e = (*phraseEdit)[pos];
-
-    // Find the time of the next non-continuous event
-    Clock nextNonCont_Original = e.time;
-    MidiEvent e2 = e;
-    size_t pos2 = pos;
-    do
+    if (nextNonCont_Original == lastNonCont_Original)
     {
-        ++pos2;
-        if (pos2 <= phraseEdit->size())
-        {
-            e2 = (*phraseEdit)[pos2];
-            nextNonCont_Original = e2.time;
-        }
+        // Nothing to spread between: just move along with the last one
+        return time - lastNonCont_Original + lastNonCont_Quantised;
     }
-    while (isContinuous(e2) && pos2 < phraseEdit->size());
-
-    // Now work out when the next note on time will be quantised
-    Clock nextNonCont_Quantised = quantise(nextNonCont_Original, _by);
 
     Clock newTime = (nextNonCont_Quantised-lastNonCont_Quantised)
-                  * (e.time - lastNonCont_Original)
+                  * (time - lastNonCont_Original)
                   / (nextNonCont_Original - lastNonCont_Original)
                   + lastNonCont_Quantised;
     return newTime;
 }
-
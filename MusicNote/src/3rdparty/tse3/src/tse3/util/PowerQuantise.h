@@ -343,11 +343,24 @@ namespace TSE3
 
                 /**
                  * Do the PowerQuantise on the given PhraseEdit.
+                 *
+                 * The events are quantised in a detached copy, using several
+                 * threads for large @ref PhraseEdit objects, and put back
+                 * with @ref PhraseEdit::tidy() in one go. If the
+                 * @ref PhraseEdit is edited while this is going on the
+                 * quantise is started again from its new contents.
                  */
                 void go(TSE3::PhraseEdit *phraseEdit);
 
             private:
 
+                /**
+                 * Does the work of @ref go() on a detached copy of the
+                 * events. Returns the time of the last event.
+                 */
+                TSE3::Clock quantiseEvents(
+                    std::vector<TSE3::MidiEvent> &events);
+
                 /**
                  * Returns whether or not the given @ref MidiEvent should be
                  * quantised or not.
@@ -403,18 +416,20 @@ namespace TSE3
                                      TSE3::Clock maxVal);
 
                 /**
-                 * Calculates the 'spread' time of the specified event in the
-                 * PhraseEdit (a continuous controller). The events up to pos
-                 * will have been quantised, and lastNonCont_Original contains
-                 * the time of the last non-continuous event (prior to
-                 * quantisation) and lastNonCont_Quantised conatins the
-                 * quantised value of this event.
+                 * Calculates the 'spread' time of an event at the given
+                 * time (a continuous controller). lastNonCont_Original
+                 * contains the time of the last non-continuous event
+                 * (prior to quantisation) and lastNonCont_Quantised
+                 * conatins the quantised value of this event. Similarly,
+                 * nextNonCont_Original and nextNonCont_Quantised describe
+                 * the next non-continuous event.
                  */
                 TSE3::Clock spreadContinuous(
-                    TSE3::PhraseEdit *phraseEdit,
-                    size_t pos,
+                    TSE3::Clock time,
                     TSE3::Clock lastNonCont_Original,
-                    TSE3::Clock lastNonCont_Quantised);
+                    TSE3::Clock lastNonCont_Quantised,
+                    TSE3::Clock nextNonCont_Original,
+                    TSE3::Clock nextNonCont_Quantised);
 
                 Pattern         _pattern;
                 int             _by;
@@ -23,6 +23,7 @@
 #include "tse3/plt/Factory.h"
 #include "tse3/util/MidiScheduler.h"
 #include "tse3/TSE3MDL.h"
+#include "tse3/TSE3Binary.h"
 #include "tse3/TSE2MDL.h"
 #include "tse3/MidiFile.h"
 #include "tse3/Transport.h"
@@ -124,6 +125,10 @@ TSE3Play::TSE3Play(int argc, char *argv[])
                               "convert file to tse3mdl\n"
                               "(filename follows switch)",
                               &TSE3Play::handle_outtse3mdl));
+    switches.push_back(Switch("out-tse3bin", "otse3bin", 1,
+                              "convert file to TSE3 binary\n"
+                              "(filename follows switch)",
+                              &TSE3Play::handle_outtse3bin));
     switches.push_back(Switch("map-channel", "map", 2,
                               "<f> <t>: map channel f to t",
                               &TSE3Play::handle_mapchannel));
@@ -391,7 +396,8 @@ int TSE3Play::go()
     // Draw the on screen presence
 
     bool dovisual_nodeferedframe
-        = dovisual && !verbose && outmidi != "-" && outtse3mdl != "-";
+        = dovisual && !verbose && outmidi != "-" && outtse3mdl != "-"
+          && outtse3bin != "-";
 
     TSE3PlayVisual visual(transport, sch);
     if (dovisual_nodeferedframe) visual.drawFrame();
@@ -432,6 +438,16 @@ int TSE3Play::go()
                 playable = song;
                 break;
             }
+            case FileRecogniser::Type_TSE3Binary:
+            {
+                if (dovisual_nodeferedframe)
+                    visual.message("Loading TSE3 binary file");
+                if (verbose) cout << "TSE3 binary\n";
+                TSE3Binary tse3binary(_name, verbose);
+                song     = tse3binary.load(filename);
+                playable = song;
+                break;
+            }
             case FileRecogniser::Type_TSE2MDL:
             {
                 if (dovisual_nodeferedframe)
@@ -449,7 +465,8 @@ int TSE3Play::go()
                 if (verbose) cout << "MIDI\n";
                 MidiFileImport *mfi = new MidiFileImport(filename, verbose);
                 if (fastMidi && outmidi == std::string()
-                    && outtse3mdl == std::string())
+                    && outtse3mdl == std::string()
+                    && outtse3bin == std::string())
                 {
                     playable = mfi;
                 }
@@ -514,6 +531,20 @@ int TSE3Play::go()
             tse3mdl.save(outtse3mdl, song);
         }
     }
+    if (outtse3bin != std::string() && song)
+    {
+        if (dovisual_nodeferedframe)
+            visual.message("Performing TSE3 binary output");
+        TSE3Binary tse3binary(_name);
+        if (outtse3bin == "-")
+        {
+            tse3binary.save(std::cout, song);
+        }
+        else
+        {
+            tse3binary.save(outtse3bin, song);
+        }
+    }
 
     // Now do playback
 
@@ -608,7 +639,7 @@ int TSE3Play::go()
 void TSE3Play::handle_help(int, char*[])
 {
     cout << "Usage: " << _name << " [OPTION]... [FILE]\n"
-         << "Plays and converts TSE3MDL and MIDI files.\n\n"
+         << "Plays and converts TSE3MDL, TSE3 binary and MIDI files.\n\n"
          << "OPTIONs are:\n\n";
 
     // Work out column widths for the nicely formatted output
@@ -711,6 +742,14 @@ void TSE3Play::handle_outtse3mdl(int argpos, char *argv[])
 }
 
 
+void TSE3Play::handle_outtse3bin(int argpos, char *argv[])
+{
+    outtse3bin = argv[argpos+1];
+    if (verbose) cout << "Producing TSE3 binary output in: " << outtse3bin
+                      << "\n";
+}
+
+
 void TSE3Play::handle_mapchannel(int argpos, char *argv[])
 {
     int from = atoi(argv[argpos+1]);
@@ -191,6 +191,7 @@ namespace TSE3_Utilities_Play
             void handle_outmidiformat0(int argpos, char *argv[]);
             void handle_outmidicompact(int argpos, char *argv[]);
             void handle_outtse3mdl(int argpos, char *argv[]);
+            void handle_outtse3bin(int argpos, char *argv[]);
             void handle_mapchannel(int argpos, char *argv[]);
             void handle_metronome(int argpos, char *argv[]);
             void handle_reset_midi(int argpos, char *argv[]);
@@ -228,6 +229,7 @@ namespace TSE3_Utilities_Play
             int               outmidiformat;
             bool              outmidicompact;
             std::string       outtse3mdl;
+            std::string       outtse3bin;
             bool              dometronome;
             bool              midi, gm, gs, xg;
             TSE3::Clock       startClock;
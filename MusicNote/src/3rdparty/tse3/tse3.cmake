@@ -44,6 +44,7 @@ Set(tse3_ClInclude_Files
 	${ProjDir}/src/tse3/Mutex.h
 	${ProjDir}/src/tse3/Notifier.h
 	${ProjDir}/src/tse3/Panic.h
+	${ProjDir}/src/tse3/Parallel.h
 	${ProjDir}/src/tse3/Part.h
 	${ProjDir}/src/tse3/Phrase.h
 	${ProjDir}/src/tse3/PhraseEdit.h
@@ -52,6 +53,7 @@ Set(tse3_ClInclude_Files
 	${ProjDir}/src/tse3/Progress.h
 	${ProjDir}/src/tse3/RepeatTrack.h
 	${ProjDir}/src/tse3/Serializable.h
+	${ProjDir}/src/tse3/Snapshot.h
 	${ProjDir}/src/tse3/Song.h
 	${ProjDir}/src/tse3/TempoTrack.h
 	${ProjDir}/src/tse3/TimeSigTrack.h
@@ -60,6 +62,7 @@ Set(tse3_ClInclude_Files
 	${ProjDir}/src/tse3/TSE2MDL.h
 	${ProjDir}/src/tse3/TSE3.h
 	${ProjDir}/src/tse3/TSE3MDL.h
+	${ProjDir}/src/tse3/TSE3Binary.h
 	${ProjDir}/src/tse3/plt/Factory.h
 	${ProjDir}/src/tse3/plt/midiswis.h
 	${ProjDir}/src/tse3/util/Demidify.h
@@ -115,6 +118,7 @@ Set(tse3_ClCompile_Files
 	${ProjDir}/src/tse3/TSE2MDL.cpp
 	${ProjDir}/src/tse3/TSE3.cpp
 	${ProjDir}/src/tse3/TSE3MDL.cpp
+	${ProjDir}/src/tse3/TSE3Binary.cpp
 	${ProjDir}/src/tse3/util/Demidify.cpp
 	${ProjDir}/src/tse3/util/MidiScheduler.cpp
 	${ProjDir}/src/tse3/util/MulDiv.cpp
@@ -0,0 +1,35 @@
+###################################################
+###  Written by hand after the other TSE3 example
+###  projects. It has no Visual Studio project.
+###################################################
+
+cmake_minimum_required(VERSION 2.8)
+
+Project(tse3benchmark)
+
+Set(ProjDir ${CMAKE_CURRENT_SOURCE_DIR})
+
+include_directories(
+	${ProjDir}/src/   )
+link_directories(
+	${ProjDir}/lib/   )
+
+Set(tse3benchmark_ClInclude_Files   )
+Set(tse3benchmark_ClCompile_Files
+	${ProjDir}/src/examples/benchmark/benchmark.cpp   )
+Set(tse3benchmark_ResourceCompile_Files   )
+Set(tse3benchmark_Manifest_Files   )
+Set(tse3benchmark_Midl_Files   )
+Set(tse3benchmark_CustomBuild_Files   )
+
+Set(RUNTIME_OUTPUT_DIRECTORY ${ProjDir}/bin)
+
+Add_Executable(tse3benchmark ${tse3benchmark_ClInclude_Files} ${tse3benchmark_ClCompile_Files} ${tse3benchmark_ResourceCompile_Files} ${tse3benchmark_Manifest_Files} ${tse3benchmark_Midl_Files} ${tse3benchmark_CustomBuild_Files})
+
+set_target_properties(tse3benchmark PROPERTIES 
+	COMPILE_DEFINITIONS "${TARGET_COMPILE_DEFS}"
+	COMPILE_FLAGS "${TARGET_COMPILE_FLAGS}")
+
+Set(tse3benchmark_Dependencies  tse3)
+target_link_libraries(tse3benchmark ${tse3benchmark_Dependencies})
+
@@ -0,0 +1,199 @@
+/*
+	This is part of CFugue, a C++ Runtime for MIDI Score Programming
+	Copyright (C) 2009 Gopalakrishna Palem
+
+	For links to further information, or to contact the author,
+	see <http://cfugue.sourceforge.net/>.
+*/
+
+#include "stdafx.h"
+#include "BatchRenderer.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace CFugue
+{
+	// Job ranges are packed into one word, so that the owner and the thieves can
+	// update them with a single compare-and-swap: begin in the high half, end in the low.
+	static inline unsigned long long PackRange(size_t nBegin, size_t nEnd)
+	{
+		return ((unsigned long long)nBegin << 32) | (unsigned long long)nEnd;
+	}
+
+	static inline size_t RangeBegin(unsigned long long range) { return (size_t)(range >> 32); }
+	static inline size_t RangeEnd(unsigned long long range) { return (size_t)(range & 0xFFFFFFFF); }
+
+	// A parser and renderer pair, reused for all the jobs of one worker thread
+	struct MIDIBatchRenderer::Worker
+	{
+		MIDIRenderer					renderer;
+		MusicStringParser				parser;
+		JobResult*						pResult;	// Result of the job being parsed, for the error handler
+		std::atomic<unsigned long long>	range;		// Jobs left with this worker
+		size_t							nStolen;	// Jobs this worker took from the others
+
+		Worker() : pResult(NULL), range(0), nStolen(0)
+		{
+			parser.AddListener(&renderer);
+			parser.SetUserData(this);
+			parser.evError.Subscribe(&OnParseError);
+		}
+
+		static void OnParseError(const CParser* pParser, CParser::ErrorEventHandlerArgs* pEvArgs)
+		{
+			Worker* pWorker = (Worker*) pParser->GetUserData();
+			if(pWorker->pResult == NULL) return;
+
+			JobError error;
+			error.lErrCode = pEvArgs->errCode;
+			error.strErrMsg = pEvArgs->szErrMsg != NULL ? pEvArgs->szErrMsg : _T("");
+			error.strToken = pEvArgs->szToken != NULL ? pEvArgs->szToken : _T("");
+			pWorker->pResult->errors.push_back(error);
+		}
+	};
+
+	MIDIBatchRenderer::MIDIBatchRenderer(unsigned int nWorkers /*= 0*/)
+		: m_nWorkers(nWorkers), m_pChords(NULL)
+	{
+		if(m_nWorkers == 0) m_nWorkers = std::thread::hardware_concurrency();
+		if(m_nWorkers == 0) m_nWorkers = 1;
+	}
+
+	MIDIBatchRenderer::~MIDIBatchRenderer()
+	{
+	}
+
+	MIDIBatchRenderer::Throughput MIDIBatchRenderer::Run(const std::vector<Job>& vecJobs, std::vector<JobResult>& vecResults)
+	{
+		const std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+
+		const size_t nJobs = std::min(vecJobs.size(), (size_t)0xFFFFFFFF); // Ranges hold 32-bit indices
+
+		vecResults.clear();
+		vecResults.resize(nJobs);
+
+		unsigned int nThreads = m_nWorkers;
+		if(nThreads > nJobs) nThreads = nJobs > 0 ? (unsigned int)nJobs : 1;
+
+		while(m_Workers.size() < nThreads)
+			m_Workers.push_back(std::unique_ptr<Worker>(new Worker()));
+
+		// Spread the jobs evenly upfront. Stealing evens out the rest.
+		for(size_t i = 0; i < m_Workers.size(); ++i)
+		{
+			Worker& worker = *m_Workers[i];
+			size_t nBegin = i < nThreads ? i * nJobs / nThreads : 0;
+			size_t nEnd = i < nThreads ? (i + 1) * nJobs / nThreads : 0;
+			worker.range.store(PackRange(nBegin, nEnd));
+			worker.nStolen = 0;
+
+			worker.parser.ResetDefinitions(); // Drops the definitions and the chords of any earlier Run
+			if(m_pChords != NULL)
+				worker.parser.LoadChords(*m_pChords);
+		}
+
+		std::vector<std::thread> vecThreads;
+		for(unsigned int i = 1; i < nThreads; ++i)
+			vecThreads.push_back(std::thread(&MIDIBatchRenderer::WorkerProc, this, (size_t)i, std::cref(vecJobs), std::ref(vecResults)));
+
+		WorkerProc(0, vecJobs, vecResults); // this thread works too
+
+		for(size_t i = 0; i < vecThreads.size(); ++i)
+			vecThreads[i].join();
+
+		Throughput stats;
+		stats.nJobs = nJobs;
+		stats.nWorkers = nThreads;
+
+		for(size_t i = 0; i < nJobs; ++i)
+		{
+			if(vecResults[i].bSuccess) stats.nSucceeded++;
+			stats.nErrors += vecResults[i].errors.size();
+		}
+
+		for(unsigned int i = 0; i < nThreads; ++i)
+			stats.nStolen += m_Workers[i]->nStolen;
+
+		stats.dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+		return stats;
+	}
+
+	void MIDIBatchRenderer::WorkerProc(size_t nWorker, const std::vector<Job>& vecJobs, std::vector<JobResult>& vecResults)
+	{
+		Worker& worker = *m_Workers[nWorker];
+
+		size_t nJob;
+		while(PopJob(worker, nJob) || (StealJobs(nWorker) && PopJob(worker, nJob)))
+		{
+			const Job& job = vecJobs[nJob];
+			JobResult& result = vecResults[nJob];
+
+			worker.renderer.Clear();	// Reset, rather than rebuild, the pair
+			worker.parser.Reset();
+
+			worker.pResult = &result;
+			bool bParsed = worker.parser.Parse(job.strMusicNotes);
+			worker.pResult = NULL;
+
+			bool bSaved = false;
+			if(job.pOutBuffer != NULL)
+				bSaved = worker.renderer.SaveToBuffer(*job.pOutBuffer);
+			else if(job.pOutStream != NULL)
+				bSaved = worker.renderer.SaveToStream(*job.pOutStream);
+			else
+				bSaved = worker.renderer.SaveToFile(job.strOutputFilePath.c_str());
+
+			result.bSuccess = bParsed && bSaved;
+		}
+	}
+
+	bool MIDIBatchRenderer::PopJob(Worker& worker, size_t& nJob)
+	{
+		unsigned long long range = worker.range.load();
+
+		while(RangeBegin(range) < RangeEnd(range))
+		{
+			if(worker.range.compare_exchange_weak(range, PackRange(RangeBegin(range) + 1, RangeEnd(range))))
+			{
+				nJob = RangeBegin(range);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool MIDIBatchRenderer::StealJobs(size_t nThief)
+	{
+		const size_t nThreads = std::min((size_t)m_nWorkers, m_Workers.size());
+
+		Worker& thief = *m_Workers[nThief];
+
+		for(size_t i = 1; i < nThreads; ++i)
+		{
+			Worker& victim = *m_Workers[(nThief + i) % nThreads];
+
+			unsigned long long range = victim.range.load();
+
+			while(RangeBegin(range) < RangeEnd(range))
+			{
+				size_t nBegin = RangeBegin(range), nEnd = RangeEnd(range);
+				size_t nTake = (nEnd - nBegin + 1) / 2; // Takes the later half, the victim keeps on from the front
+
+				if(victim.range.compare_exchange_weak(range, PackRange(nBegin, nEnd - nTake)))
+				{
+					// Our range is empty, so no one else updates it now
+					thief.range.store(PackRange(nEnd - nTake, nEnd));
+					thief.nStolen += nTake;
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+} // namespace CFugue
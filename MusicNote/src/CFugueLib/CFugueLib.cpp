@@ -13,6 +13,8 @@
 #endif
 #include "CFugueLib.h"
 
+#include <new>
+
 namespace CFugue
 {
     struct PARSETRACEARGS
@@ -25,13 +27,48 @@ namespace CFugue
     static void OnParseTrace(const CFugue::CParser* pParser, CFugue::CParser::TraceEventHandlerArgs* pEvArgs)
     {
         const PARSETRACEARGS* pCallbackData = (const PARSETRACEARGS*) pParser->GetUserData();
-        pCallbackData->lpfnTraceProc(pCallbackData->lpUserData, pEvArgs->szTraceMsg);
+        if(pCallbackData->lpfnTraceProc != NULL)
+            pCallbackData->lpfnTraceProc(pCallbackData->lpUserData, pEvArgs->szTraceMsg);
     }
 
 	static void OnParseError(const CFugue::CParser* pParser, CFugue::CParser::ErrorEventHandlerArgs* pEvArgs)
     {
         const PARSETRACEARGS* pCallbackData = (const PARSETRACEARGS*) pParser->GetUserData();
-		pCallbackData->lpfnErrorProc(pCallbackData->lpUserData, pEvArgs->errCode, pEvArgs->szErrMsg, pEvArgs->szToken);
+        if(pCallbackData->lpfnErrorProc != NULL)
+            pCallbackData->lpfnErrorProc(pCallbackData->lpUserData, pEvArgs->errCode, pEvArgs->szErrMsg, pEvArgs->szToken);
+    }
+
+    // The object behind an MStringPlayer handle
+    struct PLAYERHANDLE
+    {
+        Player          playerObj;
+        PARSETRACEARGS  callbackArgs;
+
+        PLAYERHANDLE(unsigned int nMidiOutPortID, unsigned int nTimerResMS) : playerObj(nMidiOutPortID, nTimerResMS)
+        {
+            callbackArgs.lpfnTraceProc = NULL;
+            callbackArgs.lpfnErrorProc = NULL;
+            callbackArgs.lpUserData = NULL;
+
+            playerObj.Parser().SetUserData(&callbackArgs);
+            playerObj.Parser().evTrace.Subscribe(OnParseTrace);
+            playerObj.Parser().evError.Subscribe(OnParseError);
+        }
+    };
+
+    // Copies the MIDI content into a buffer that the caller releases with FreeMidiBuffer()
+    static bool CopyToMidiBuffer(const std::vector<uint8_t>& buffer, unsigned char** ppBuffer, unsigned long* pnSize)
+    {
+        // Allocated here and released in FreeMidiBuffer(), so the caller's runtime never frees our memory
+        unsigned char* pBuffer = new(std::nothrow) unsigned char[buffer.size()];
+        if(pBuffer == NULL) return false;
+
+        memcpy(pBuffer, buffer.data(), buffer.size());
+
+        *ppBuffer = pBuffer;
+        *pnSize = (unsigned long)buffer.size();
+
+        return true;
     }
 
 extern "C"
@@ -45,7 +82,89 @@ extern "C"
 
 	MUSICNOTELIB_API MStringPlayer* CreateMusicStringPlayer()
 	{
-		return NULL;
+		return new(std::nothrow) PLAYERHANDLE(MIDI_MAPPER, 20);
+	}
+
+	MUSICNOTELIB_API MStringPlayer* CreateMusicStringPlayerWithOpts(int nMidiOutPortID, unsigned int nTimerResMS)
+	{
+		return new(std::nothrow) PLAYERHANDLE(nMidiOutPortID, nTimerResMS);
+	}
+
+	MUSICNOTELIB_API void DestroyMusicStringPlayer(MStringPlayer* pPlayer)
+	{
+		PLAYERHANDLE* pHandle = (PLAYERHANDLE*) pPlayer;
+		if(pHandle == NULL) return;
+
+		pHandle->playerObj.StopPlay();
+
+		delete pHandle;
+	}
+
+	MUSICNOTELIB_API void PlayerSetCallbacks(MStringPlayer* pPlayer,
+											LPFNTRACEPROC traceCallbackProc,
+											LPFNERRORPROC errorCallbackProc,
+											void* pCallbackData)
+	{
+		PLAYERHANDLE* pHandle = (PLAYERHANDLE*) pPlayer;
+		if(pHandle == NULL) return;
+
+		pHandle->playerObj.StopPlay(); // A pipelined parse might still be raising the events
+
+		pHandle->callbackArgs.lpfnTraceProc = traceCallbackProc;
+		pHandle->callbackArgs.lpfnErrorProc = errorCallbackProc;
+		pHandle->callbackArgs.lpUserData = pCallbackData;
+	}
+
+	MUSICNOTELIB_API bool PlayerParse(MStringPlayer* pPlayer, const TCHAR* szMusicNotes)
+	{
+		PLAYERHANDLE* pHandle = (PLAYERHANDLE*) pPlayer;
+		if(pHandle == NULL || szMusicNotes == NULL) return false;
+
+		return pHandle->playerObj.Render(szMusicNotes);
+	}
+
+	MUSICNOTELIB_API bool PlayerPlayAsync(MStringPlayer* pPlayer, const TCHAR* szMusicNotes)
+	{
+		PLAYERHANDLE* pHandle = (PLAYERHANDLE*) pPlayer;
+		if(pHandle == NULL || szMusicNotes == NULL) return false;
+
+		pHandle->playerObj.StopPlay(); // Release the timer of any earlier play
+
+		return pHandle->playerObj.PlayAsync(szMusicNotes);
+	}
+
+	MUSICNOTELIB_API void PlayerWaitTillDone(MStringPlayer* pPlayer)
+	{
+		PLAYERHANDLE* pHandle = (PLAYERHANDLE*) pPlayer;
+		if(pHandle != NULL)
+			pHandle->playerObj.WaitTillDone();
+	}
+
+	MUSICNOTELIB_API void PlayerStop(MStringPlayer* pPlayer)
+	{
+		PLAYERHANDLE* pHandle = (PLAYERHANDLE*) pPlayer;
+		if(pHandle != NULL)
+			pHandle->playerObj.StopPlay();
+	}
+
+	MUSICNOTELIB_API bool PlayerIsPlaying(MStringPlayer* pPlayer)
+	{
+		PLAYERHANDLE* pHandle = (PLAYERHANDLE*) pPlayer;
+		return pHandle != NULL && pHandle->playerObj.IsPlaying();
+	}
+
+	MUSICNOTELIB_API bool PlayerSaveToBuffer(MStringPlayer* pPlayer, unsigned char** ppBuffer, unsigned long* pnSize)
+	{
+		PLAYERHANDLE* pHandle = (PLAYERHANDLE*) pPlayer;
+		if(pHandle == NULL || ppBuffer == NULL || pnSize == NULL) return false;
+
+		*ppBuffer = NULL;
+		*pnSize = 0;
+
+		std::vector<uint8_t> buffer;
+		if(pHandle->playerObj.SaveToMidiFile(buffer) == false) return false;
+
+		return CopyToMidiBuffer(buffer, ppBuffer, pnSize);
 	}
 
     MUSICNOTELIB_API bool SaveAsMidiFile(const TCHAR* szMusicNotes, const char* szOutputFilePath)
@@ -54,6 +173,26 @@ extern "C"
         return playerObj.SaveAsMidiFile(szMusicNotes, szOutputFilePath);
     }
 
+    MUSICNOTELIB_API bool SaveAsMidiBuffer(const TCHAR* szMusicNotes, unsigned char** ppBuffer, unsigned long* pnSize)
+    {
+        if(ppBuffer == NULL || pnSize == NULL) return false;
+
+        *ppBuffer = NULL;
+        *pnSize = 0;
+
+        std::vector<uint8_t> buffer;
+
+        Player playerObj;
+        if(playerObj.SaveAsMidiFile(szMusicNotes, buffer) == false) return false;
+
+        return CopyToMidiBuffer(buffer, ppBuffer, pnSize);
+    }
+
+    MUSICNOTELIB_API void FreeMidiBuffer(unsigned char* pBuffer)
+    {
+        delete[] pBuffer;
+    }
+
     //static void OnParseError(const CFugue::CParser* pParser, CFugue::CParser::ErrorEventHandlerArgs* pEvArgs)
     //{
 	   // OutputDebugString(_T("\nError --> "));
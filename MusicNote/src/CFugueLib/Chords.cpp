@@ -3,6 +3,8 @@
 
 #include "Chords.h"
 #include <algorithm>
+#include <functional>
+#include <string>
 
 namespace CFugue
 {
@@ -165,10 +167,75 @@ namespace CFugue
         return ExtractMatchingObject(this->m_Definitions, szToken, retVal);
     }
 
+	const Chords& Chords::GetDefaultChords()
+	{
+		static const Chords staticObj; // Loads the default chord definitions. Initialization is thread-safe
+		return staticObj;
+	}
+
 	unsigned int Chords::GetDefaultMatchingChord(const TCHAR* szToken, ChordDef* retVal)
 	{
-		static Chords staticObj; // Loads the default chord definitions
-		return staticObj.ExtractMatchingChord(szToken, retVal);
+		return GetDefaultChords().ExtractMatchingChord(szToken, retVal);
 	}
 
+    bool Chords::FindChordByIntervals(const ChordDef::HALFSTEP* pIntervals, unsigned short nIntervalCount, ChordDef* retVal) const
+    {
+        const ChordDef* pBest = NULL;
+
+        for(auto iter = m_Definitions.begin(); iter != m_Definitions.end(); ++iter)
+        {
+            const std::vector<const ChordDef*>& vecChords = iter->second;
+
+            for(size_t i=0, nMax = vecChords.size(); i < nMax; ++i)
+            {
+                const ChordDef* pChord = vecChords[i];
+
+                if(pChord->nIntervalCount != nIntervalCount) continue;
+
+                // Definitions are not required to list their intervals in order
+                ChordDef::HALFSTEP sorted[ChordDef::MAX_INTERVALS];
+                std::copy(pChord->Intervals, pChord->Intervals + nIntervalCount, sorted);
+                std::sort(sorted, sorted + nIntervalCount);
+
+                if(std::equal(sorted, sorted + nIntervalCount, pIntervals) == false) continue;
+
+                if(pBest == NULL) { pBest = pChord; continue; }
+
+                size_t nLen = _tcslen(pChord->szChordName), nBestLen = _tcslen(pBest->szChordName);
+                if(nLen < nBestLen || (nLen == nBestLen && _tcscmp(pChord->szChordName, pBest->szChordName) < 0))
+                    pBest = pChord;
+            }
+        }
+
+        if(pBest == NULL) return false;
+
+        *retVal = *pBest;
+
+        return true;
+    }
+
+    size_t Chords::GetHash() const
+    {
+        std::hash<std::basic_string<TCHAR> > hashString;
+
+        size_t nHash = m_Definitions.size();
+
+        for(auto iter = m_Definitions.begin(); iter != m_Definitions.end(); ++iter)
+        {
+            const std::vector<const ChordDef*>& vecChords = iter->second;
+
+            for(size_t i=0, nMax = vecChords.size(); i < nMax; ++i)
+            {
+                const ChordDef* pChord = vecChords[i];
+
+                nHash ^= hashString(pChord->szChordName) + 0x9e3779b9 + (nHash << 6) + (nHash >> 2);
+
+                for(unsigned short j=0; j < pChord->nIntervalCount; ++j)
+                    nHash ^= (size_t)(unsigned short)pChord->Intervals[j] + 0x9e3779b9 + (nHash << 6) + (nHash >> 2);
+            }
+        }
+
+        return nHash;
+    }
+
 } // namespace CFugue
\ No newline at end of file
@@ -11,6 +11,8 @@
 
 #include "AlsaDriver.h"
 #include "MidiTimer.h"
+#include "PlaybackEngine.h"
+#include "MidiPortPool.h"
 
 using namespace jdkmidi;
 
@@ -23,6 +25,12 @@ namespace CFugue
 		m_pMidiOut ( 0 ),
 		m_pThread ( NULL )
 	{
+		m_MsgBuffer.reserve(4);
+
+		// Make sure the shared engine and port pool are constructed before (and
+		// hence destroyed after) any driver, including the static ones.
+		MIDIPlaybackEngine::Instance();
+		MIDIOutPortPool::Instance();
 	}
 
 	MIDIDriverAlsa::~MIDIDriverAlsa()
@@ -67,55 +75,58 @@ namespace CFugue
 	}
 
 
-	bool MIDIDriverAlsa::OpenMIDIOutPort ( int id )
-	{
-		if(m_pMidiOut != NULL) // close any open port
-		{
-			delete m_pMidiOut;
-			m_pMidiOut = NULL;
-		}
-		if(m_pMidiOut == NULL)
-		{
-			try
-			{
-				m_pMidiOut = new RtMidiOut("MIDIDriverAlsa Client");
-			}
-			catch(RtError &error)
-			{
-				error.printMessage();
-				return false;
-			}
-		}
-		if(m_pMidiOut != NULL)
-		{
-			try
-			{
-				m_pMidiOut->openPort(id);
-			}
-			catch(RtError &error)
-			{
-				error.printMessage();
-				return false;
-			}
-		}
-		return true;
+	bool MIDIDriverAlsa::OpenMIDIOutPort ( int id, unsigned char nOutPort /*= 0*/ )
+	{
+		if(nOutPort == 0)
+		{
+			CloseMIDIOutPort(); // release any open ports
+
+			// Ports are shared and kept open across plays by the pool,
+			// so this is only a lookup once the port has been opened before.
+			m_pMidiOut = MIDIOutPortPool::Instance().Acquire(id);
+
+			return m_pMidiOut != NULL;
+		}
+
+		if(m_ExtraMidiOuts.size() < nOutPort)
+			m_ExtraMidiOuts.resize(nOutPort, NULL); // Sized upfront - the playback thread only looks up
+
+		RtMidiOut*& pMidiOut = m_ExtraMidiOuts[nOutPort - 1];
+		if(pMidiOut != NULL)
+			MIDIOutPortPool::Instance().Release(pMidiOut);
+
+		pMidiOut = MIDIOutPortPool::Instance().Acquire(id);
+
+		return pMidiOut != NULL;
 	}
 
     bool MIDIDriverAlsa::HardwareMsgOut ( const jdkmidi::MIDITimedBigMessage &msg )
     {
         if(m_pMidiOut != NULL)
         {
+            RtMidiOut* pMidiOut = m_pMidiOut;
+
+            if(msg.GetOutPort() != 0)
+            {
+                if(msg.GetOutPort() > m_ExtraMidiOuts.size() || m_ExtraMidiOuts[msg.GetOutPort() - 1] == NULL)
+                    return true; // No device for the port. Drop the message, so the other ports keep going
+
+                pMidiOut = m_ExtraMidiOuts[msg.GetOutPort() - 1];
+            }
+
             unsigned char status = msg.GetStatus();
 
             // dont send sysex or meta-events
 
             if ( status <0xff && status !=0xf0 )
             {
-                unsigned char msgBytes[] = {status, msg.GetByte1(), msg.GetByte2(), msg.GetByte3()};
-
-                std::vector<unsigned char> vec(msgBytes, msgBytes+3);
+                // Reuse the buffer reserved upfront - no allocations on the playback thread
+                m_MsgBuffer.clear();
+                m_MsgBuffer.push_back(status);
+                m_MsgBuffer.push_back(msg.GetByte1());
+                m_MsgBuffer.push_back(msg.GetByte2());
 
-                m_pMidiOut->sendMessage(&vec);
+                pMidiOut->sendMessage(&m_MsgBuffer);
             }
 
             return true;
@@ -123,37 +134,12 @@ namespace CFugue
         return false;
     }
 
-    // This is thread procedure to pump MIDI events
-    // We maintain the supplied Timer Resolution by adjusting the sleep duration
-	bool AlsaDriverThreadProc(MIDIDriverAlsa* pAlsaDriver, int nTimerResMS)
-	{
-		MidiTimer::TimePoint tBefore, tAfter;
-	    unsigned long nElapsed, nTimeToSleep;
-
-	    while(true)
-	    {
-            tBefore = MidiTimer::Now();
-
-            if(pAlsaDriver->TimeTick(tBefore) == false) break;
-
-            tAfter = MidiTimer::Now();
-
-			nElapsed = std::chrono::duration_cast<MidiTimer::Duration>(tAfter - tBefore).count();
-
-            nTimeToSleep = (nElapsed > nTimerResMS ? 0 : nTimerResMS - nElapsed);
-
-            MidiTimer::Sleep(nTimeToSleep);
-	    }
-
-        return true;
-	}
-
 	bool MIDIDriverAlsa::StartTimer ( int res )
 	{
 	    if(m_bgTaskResult.valid()) // Already running
             return false;
 
-        m_bgTaskResult = std::async(std::launch::async, &AlsaDriverThreadProc, this, res);
+        m_bgTaskResult = MIDIPlaybackEngine::Instance().Register(this, res);
 
         return m_bgTaskResult.valid();
 	}
@@ -176,7 +162,12 @@ namespace CFugue
 	    // valid() keeps returning true till get() is called. And get() can be
 	    // called only once. Once it is called valid() becomes false again.
 	    if(m_bgTaskResult.valid())
-            m_bgTaskResult.get();
+        {
+            // Take us off the engine first. A sequence stopped mid-way keeps
+            // on ticking in stop mode and would never complete on its own.
+            MIDIPlaybackEngine::Instance().Unregister(this);
+            m_bgTaskResult.get();
+        }
 	}
 
 	void MIDIDriverAlsa::CloseMIDIInPort()
@@ -193,9 +184,17 @@ namespace CFugue
 	{
 	    if(m_pMidiOut != NULL)
 	    {
-	        m_pMidiOut->closePort();
-	        delete m_pMidiOut;
+	        MIDIOutPortPool::Instance().Release(m_pMidiOut); // stays open in the pool for the next play
 	        m_pMidiOut = NULL;
+	    }
+
+	    for(size_t i = 0; i < m_ExtraMidiOuts.size(); ++i)
+	    {
+	        if(m_ExtraMidiOuts[i] != NULL)
+	        {
+	            MIDIOutPortPool::Instance().Release(m_ExtraMidiOuts[i]);
+	            m_ExtraMidiOuts[i] = NULL;
+	        }
 	    }
 	}
 
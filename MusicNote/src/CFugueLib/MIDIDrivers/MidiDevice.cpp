@@ -9,50 +9,319 @@
 #include "MidiDevice.h"
 #include "rtmidi/RtMidi.h"
 
+#include <sstream>
+
+#if defined(__LINUX_ALSASEQ__)
+#include <alsa/asoundlib.h>
+#endif
+
 namespace CFugue
 {
-	unsigned int GetMidiOutPortCount()
-	{
-		static RtMidiOut midiOutObj;
-		return midiOutObj.getPortCount();		
-	}
-
-	unsigned int GetMidiInPortCount()
-	{
-		static RtMidiIn midiInObj;
-		return midiInObj.getPortCount();
-	}
-
-	std::string GetMidiInPortName(unsigned int nPortIndex)
-	{
-		static RtMidiIn midiInObj;
-		return midiInObj.getPortName(nPortIndex);
-	}
-
-	std::string GetMidiOutPortName(unsigned int nPortIndex)
-	{
-		static RtMidiOut midiOutObj;
-		return midiOutObj.getPortName(nPortIndex);
-	}
-
-	StringList GetMidiInPortNames()
-	{
-		StringList strRetList;
-
-		for(int i=0, nMax = GetMidiInPortCount(); i < nMax; ++i)
-			strRetList.push_back(GetMidiInPortName(i));
-
-		return strRetList;
-	}
-
+#if defined(__LINUX_ALSASEQ__)
+
+	///<Summary>
+	/// Lists the ALSA sequencer ports with a single walk over the clients, instead of
+	/// RtMidi's walk per port index. Listens on the system announce port to know
+	/// when clients or ports come and go.
+	///</Summary>
+	class MIDIPortEnumeratorAlsa : public MIDIPortEnumerator
+	{
+		snd_seq_t*	m_pSeq;
+		int			m_nAnnouncePort;
+	public:
+		MIDIPortEnumeratorAlsa() : m_pSeq(NULL), m_nAnnouncePort(-1)
+		{
+			if(snd_seq_open(&m_pSeq, "default", SND_SEQ_OPEN_DUPLEX, SND_SEQ_NONBLOCK) < 0)
+			{
+				m_pSeq = NULL;
+				return;
+			}
+
+			snd_seq_set_client_name(m_pSeq, "CFugue Port Registry");
+
+			m_nAnnouncePort = snd_seq_create_simple_port(m_pSeq, "Announce Listener",
+										SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_NO_EXPORT,
+										SND_SEQ_PORT_TYPE_APPLICATION);
+			if(m_nAnnouncePort >= 0)
+				snd_seq_connect_from(m_pSeq, m_nAnnouncePort, SND_SEQ_CLIENT_SYSTEM, SND_SEQ_PORT_SYSTEM_ANNOUNCE);
+		}
+
+		~MIDIPortEnumeratorAlsa()
+		{
+			if(m_pSeq != NULL)
+				snd_seq_close(m_pSeq);
+		}
+
+		// The port filters and the naming here should match those of RtMidi's portInfo(),
+		// so that our indices are the same as RtMidi's
+		void EnumeratePorts(MIDIPortInfoList& inPorts, MIDIPortInfoList& outPorts)
+		{
+			inPorts.clear();
+			outPorts.clear();
+
+			if(m_pSeq == NULL) return;
+
+			const unsigned int nReadCaps = SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ;
+			const unsigned int nWriteCaps = SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE;
+
+			snd_seq_client_info_t* cinfo;
+			snd_seq_port_info_t* pinfo;
+			snd_seq_client_info_alloca(&cinfo);
+			snd_seq_port_info_alloca(&pinfo);
+
+			snd_seq_client_info_set_client(cinfo, -1);
+			while(snd_seq_query_next_client(m_pSeq, cinfo) >= 0)
+			{
+				int nClient = snd_seq_client_info_get_client(cinfo);
+				if(nClient == 0) continue;
+
+				snd_seq_port_info_set_client(pinfo, nClient);
+				snd_seq_port_info_set_port(pinfo, -1);
+				while(snd_seq_query_next_port(m_pSeq, pinfo) >= 0)
+				{
+					if((snd_seq_port_info_get_type(pinfo) & SND_SEQ_PORT_TYPE_MIDI_GENERIC) == 0) continue;
+
+					int nPort = snd_seq_port_info_get_port(pinfo);
+
+					std::ostringstream strName, strID;
+					strName << snd_seq_client_info_get_name(cinfo) << ":" << nPort;
+					strID << nClient << ":" << nPort;
+
+					MIDIPortInfo portInfo;
+					portInfo.strName = strName.str();
+					portInfo.strID = strID.str();
+
+					unsigned int nCaps = snd_seq_port_info_get_capability(pinfo);
+					if((nCaps & nReadCaps) == nReadCaps) inPorts.push_back(portInfo);
+					if((nCaps & nWriteCaps) == nWriteCaps) outPorts.push_back(portInfo);
+				}
+			}
+		}
+
+		bool PollForChanges()
+		{
+			if(m_pSeq == NULL || m_nAnnouncePort < 0) return false;
+
+			bool bChanged = false;
+			snd_seq_event_t* pEvent = NULL;
+			int nResult;
+			while((nResult = snd_seq_event_input(m_pSeq, &pEvent)) >= 0 || nResult == -ENOSPC)
+			{
+				if(nResult == -ENOSPC) { bChanged = true; continue; } // input overrun - we might have missed some
+				switch(pEvent->type)
+				{
+				case SND_SEQ_EVENT_CLIENT_START:
+				case SND_SEQ_EVENT_CLIENT_EXIT:
+				case SND_SEQ_EVENT_CLIENT_CHANGE:
+				case SND_SEQ_EVENT_PORT_START:
+				case SND_SEQ_EVENT_PORT_EXIT:
+				case SND_SEQ_EVENT_PORT_CHANGE:
+					bChanged = true;
+					break;
+				default:
+					break;
+				}
+			}
+			return bChanged;
+		}
+	};
+
+	typedef MIDIPortEnumeratorAlsa MIDIPortEnumeratorDefault;
+
+#else
+
+	///<Summary>Lists the ports through RtMidi, for the APIs that have no native enumerator</Summary>
+	class MIDIPortEnumeratorRtMidi : public MIDIPortEnumerator
+	{
+		RtMidiIn	m_MidiIn;
+		RtMidiOut	m_MidiOut;
+
+		static void Enumerate(RtMidi& midiObj, MIDIPortInfoList& ports)
+		{
+			ports.clear();
+			for(unsigned int i=0, nMax = midiObj.getPortCount(); i < nMax; ++i)
+			{
+				MIDIPortInfo portInfo;
+				portInfo.strName = midiObj.getPortName(i);
+				portInfo.strID = portInfo.strName; // Names are the best IDs we have here
+
+				// Tell apart the ports that share a name by their order among them
+				int nSameName = 0;
+				for(size_t j=0; j < ports.size(); ++j)
+					if(ports[j].strName == portInfo.strName) nSameName++;
+				if(nSameName > 0)
+				{
+					std::ostringstream strID;
+					strID << portInfo.strName << "#" << (nSameName + 1);
+					portInfo.strID = strID.str();
+				}
+
+				ports.push_back(portInfo);
+			}
+		}
+	public:
+		void EnumeratePorts(MIDIPortInfoList& inPorts, MIDIPortInfoList& outPorts)
+		{
+			try
+			{
+				Enumerate(m_MidiIn, inPorts);
+				Enumerate(m_MidiOut, outPorts);
+			}
+			catch(RtError& error)
+			{
+				error.printMessage();
+			}
+		}
+	};
+
+	typedef MIDIPortEnumeratorRtMidi MIDIPortEnumeratorDefault;
+
+#endif // __LINUX_ALSASEQ__
+
+	MIDIPortRegistry::MIDIPortRegistry(MIDIPortEnumerator* pEnumerator)
+		: m_pEnumerator(pEnumerator), m_bScanned(false)
+	{
+	}
+
+	MIDIPortRegistry& MIDIPortRegistry::Instance()
+	{
+		static MIDIPortEnumeratorDefault enumeratorObj;
+		static MIDIPortRegistry registryObj(&enumeratorObj);
+		return registryObj;
+	}
+
+	void MIDIPortRegistry::Rescan()
+	{
+		bool bChanged = false;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			MIDIPortInfoList inPorts, outPorts;
+			m_pEnumerator->PollForChanges(); // we are rescanning anyway - drop the pending notifications
+			m_pEnumerator->EnumeratePorts(inPorts, outPorts);
+
+			bChanged = m_bScanned && (inPorts != m_InPorts || outPorts != m_OutPorts);
+
+			m_InPorts.swap(inPorts);
+			m_OutPorts.swap(outPorts);
+			m_bScanned = true;
+		}
+		if(bChanged)	// Raise outside the lock, so handlers can query the registry
+		{
+			OIL::CEventHandlerArgs args;
+			RaiseEvent(&evPortsChanged, &args);
+		}
+	}
+
+	void MIDIPortRegistry::Refresh()
+	{
+		bool bNeedsScan;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			bNeedsScan = (m_bScanned == false) || m_pEnumerator->PollForChanges();
+		}
+		if(bNeedsScan) Rescan();
+	}
+
+	MIDIPortInfoList MIDIPortRegistry::GetInPorts()
+	{
+		Refresh();
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_InPorts;
+	}
+
+	MIDIPortInfoList MIDIPortRegistry::GetOutPorts()
+	{
+		Refresh();
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_OutPorts;
+	}
+
+	int MIDIPortRegistry::FindPort(const MIDIPortInfoList& ports, const std::string& strPortIDOrName)
+	{
+		for(int i=0, nMax = (int)ports.size(); i < nMax; ++i)
+			if(ports[i].strID == strPortIDOrName) return i;
+
+		for(int i=0, nMax = (int)ports.size(); i < nMax; ++i)
+			if(ports[i].strName == strPortIDOrName) return i;
+
+		return -1;
+	}
+
+	int MIDIPortRegistry::FindInPort(const std::string& strPortIDOrName)
+	{
+		return FindPort(GetInPorts(), strPortIDOrName);
+	}
+
+	int MIDIPortRegistry::FindOutPort(const std::string& strPortIDOrName)
+	{
+		return FindPort(GetOutPorts(), strPortIDOrName);
+	}
+
+	std::string MIDIPortRegistry::GetInPortID(unsigned int nPortIndex)
+	{
+		MIDIPortInfoList ports = GetInPorts();
+		return nPortIndex < ports.size() ? ports[nPortIndex].strID : std::string();
+	}
+
+	std::string MIDIPortRegistry::GetOutPortID(unsigned int nPortIndex)
+	{
+		MIDIPortInfoList ports = GetOutPorts();
+		return nPortIndex < ports.size() ? ports[nPortIndex].strID : std::string();
+	}
+
+	unsigned int GetMidiOutPortCount()
+	{
+		return (unsigned int) MIDIPortRegistry::Instance().GetOutPorts().size();
+	}
+
+	unsigned int GetMidiInPortCount()
+	{
+		return (unsigned int) MIDIPortRegistry::Instance().GetInPorts().size();
+	}
+
+	std::string GetMidiInPortName(unsigned int nPortIndex)
+	{
+		MIDIPortInfoList ports = MIDIPortRegistry::Instance().GetInPorts();
+		return nPortIndex < ports.size() ? ports[nPortIndex].strName : std::string();
+	}
+
+	std::string GetMidiOutPortName(unsigned int nPortIndex)
+	{
+		MIDIPortInfoList ports = MIDIPortRegistry::Instance().GetOutPorts();
+		return nPortIndex < ports.size() ? ports[nPortIndex].strName : std::string();
+	}
+
+	StringList GetMidiInPortNames()
+	{
+		StringList strRetList;
+
+		MIDIPortInfoList ports = MIDIPortRegistry::Instance().GetInPorts();
+		for(size_t i=0, nMax = ports.size(); i < nMax; ++i)
+			strRetList.push_back(ports[i].strName);
+
+		return strRetList;
+	}
+
 	StringList GetMidiOutPortNames()
 	{
 		StringList strRetList;
 
-		for(int i=0, nMax = GetMidiOutPortCount(); i < nMax; ++i)
-			strRetList.push_back(GetMidiOutPortName(i));
+		MIDIPortInfoList ports = MIDIPortRegistry::Instance().GetOutPorts();
+		for(size_t i=0, nMax = ports.size(); i < nMax; ++i)
+			strRetList.push_back(ports[i].strName);
 
 		return strRetList;
 	}
 
-} // namespace CFugue 
\ No newline at end of file
+	int GetMidiInPortIndex(const std::string& strPortIDOrName)
+	{
+		return MIDIPortRegistry::Instance().FindInPort(strPortIDOrName);
+	}
+
+	int GetMidiOutPortIndex(const std::string& strPortIDOrName)
+	{
+		return MIDIPortRegistry::Instance().FindOutPort(strPortIDOrName);
+	}
+
+} // namespace CFugue
@@ -0,0 +1,117 @@
+/*
+	This is part of CFugue, a C++ Runtime for MIDI Score Programming
+	Copyright (C) 2009 Gopalakrishna Palem
+
+	For links to further information, or to contact the author,
+	see <http://cfugue.sourceforge.net/>.
+*/
+
+#include "MidiPortPool.h"
+#include "MidiDevice.h"
+
+namespace CFugue
+{
+	MIDIOutPortPool& MIDIOutPortPool::Instance()
+	{
+		static MIDIOutPortPool poolObj;
+		return poolObj;
+	}
+
+	MIDIOutPortPool::MIDIOutPortPool()
+	{
+	}
+
+	MIDIOutPortPool::~MIDIOutPortPool()
+	{
+		for(PortMap::iterator iter = m_Ports.begin(); iter != m_Ports.end(); ++iter)
+		{
+			iter->second.pMidiOut->closePort();
+			delete iter->second.pMidiOut;
+		}
+	}
+
+	RtMidiOut* MIDIOutPortPool::Acquire(int nPortIndex)
+	{
+		if(nPortIndex < 0) return NULL;
+
+		return Acquire(MIDIPortRegistry::Instance().GetOutPortID(nPortIndex));
+	}
+
+	RtMidiOut* MIDIOutPortPool::Acquire(const std::string& strPortID)
+	{
+		if(strPortID.empty()) return NULL;
+
+		// Resolve the current index before locking - the registry may rescan
+		// and raise evPortsChanged, whose handlers could come back to us.
+		int nPortIndex = MIDIPortRegistry::Instance().FindOutPort(strPortID);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		PortMap::iterator iter = m_Ports.find(strPortID);
+		if(iter != m_Ports.end()) // Already open - just share it
+		{
+			iter->second.nRefCount++;
+			return iter->second.pMidiOut;
+		}
+
+		if(nPortIndex < 0) return NULL; // Not plugged in
+
+		RtMidiOut* pMidiOut = NULL;
+		try
+		{
+			pMidiOut = new RtMidiOut("MIDIDriverAlsa Client");
+			pMidiOut->openPort(nPortIndex);
+		}
+		catch(RtError &error)
+		{
+			error.printMessage();
+			delete pMidiOut;
+			return NULL;
+		}
+
+		PortEntry entry = { pMidiOut, 1 };
+		m_Ports[strPortID] = entry;
+
+		return pMidiOut;
+	}
+
+	void MIDIOutPortPool::Release(RtMidiOut* pMidiOut)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		for(PortMap::iterator iter = m_Ports.begin(); iter != m_Ports.end(); ++iter)
+		{
+			if(iter->second.pMidiOut == pMidiOut)
+			{
+				if(iter->second.nRefCount > 0)
+					iter->second.nRefCount--;
+				return; // Keep it open, even if unused now
+			}
+		}
+	}
+
+	void MIDIOutPortPool::CloseIdlePorts()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		PortMap::iterator iter = m_Ports.begin();
+		while(iter != m_Ports.end())
+		{
+			if(iter->second.nRefCount == 0)
+			{
+				iter->second.pMidiOut->closePort();
+				delete iter->second.pMidiOut;
+				m_Ports.erase(iter++);
+			}
+			else
+				++iter;
+		}
+	}
+
+	size_t MIDIOutPortPool::GetOpenPortCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Ports.size();
+	}
+
+} // namespace CFugue
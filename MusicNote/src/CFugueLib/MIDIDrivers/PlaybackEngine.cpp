@@ -0,0 +1,283 @@
+/*
+	This is part of CFugue, a C++ Runtime for MIDI Score Programming
+	Copyright (C) 2009 Gopalakrishna Palem
+
+	For links to further information, or to contact the author,
+	see <http://cfugue.sourceforge.net/>.
+*/
+
+#include "PlaybackEngine.h"
+
+#include <string.h>	// memset
+
+#if defined _WIN32 || defined WIN32
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+#if defined(_MSC_VER)
+#define CFUGUE_NOINLINE __declspec(noinline)
+#else
+#define CFUGUE_NOINLINE __attribute__((noinline))
+#endif
+
+namespace CFugue
+{
+	// Number of bytes of the engine thread stack to touch upfront, so that the
+	// ticks do not take page faults while descending into the driver.
+	static const size_t PREFAULT_STACK_SIZE = 64 * 1024;
+
+	// Not inlined, so that the array gets a frame of its own below the caller's
+	// and is popped again on return, instead of staying in the engine loop's frame
+	static CFUGUE_NOINLINE void PrefaultStack()
+	{
+		volatile unsigned char stackBytes[PREFAULT_STACK_SIZE];
+		for(size_t i = 0; i < PREFAULT_STACK_SIZE; i += 1024)
+			stackBytes[i] = 0;
+		(void) stackBytes[0]; // volatile read, so the writes count as used
+	}
+
+	MIDIPlaybackEngine& MIDIPlaybackEngine::Instance()
+	{
+		static MIDIPlaybackEngine engineObj;
+		return engineObj;
+	}
+
+	MIDIPlaybackEngine::MIDIPlaybackEngine()
+		: m_pActive(NULL), m_nNextSerial(0), m_bShutdown(false),
+		m_bPrefaultStack(false), m_bMemoryLocked(false)
+	{
+	}
+
+	MIDIPlaybackEngine::~MIDIPlaybackEngine()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_bShutdown = true;
+		}
+		m_cvWake.notify_all();
+
+		if(m_Thread.joinable())
+			m_Thread.join();
+
+		// Release anyone still waiting on a procedure that never finished
+		for(ClientMap::iterator iter = m_Clients.begin(); iter != m_Clients.end(); ++iter)
+			iter->second.done.set_value(false);
+	}
+
+	std::future<bool> MIDIPlaybackEngine::Register(jdkmidi::MIDITick* pTickProc, unsigned int nResolutionMS)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if(pTickProc == NULL || m_Clients.find(pTickProc) != m_Clients.end())
+			return std::future<bool>();
+
+		Client& client = m_Clients[pTickProc];
+		client.resolution = MidiTimer::Duration(nResolutionMS > 0 ? nResolutionMS : 1);
+		client.nSerial = ++m_nNextSerial;
+
+		Deadline first = { MidiTimer::Now(), pTickProc, client.nSerial }; // First tick is due right away
+		m_Deadlines.push(first);
+
+		StartThread(); // Any failures of the config were reported to whoever set it
+
+		m_cvWake.notify_one();
+
+		return client.done.get_future();
+	}
+
+	unsigned int MIDIPlaybackEngine::StartThread()
+	{
+		if(m_Thread.joinable()) return RealtimeConfig::FAILED_NONE;
+
+		m_Thread = std::thread(&MIDIPlaybackEngine::ThreadProc, this);
+
+		return ApplyRealtimeConfig();
+	}
+
+	void MIDIPlaybackEngine::Unregister(jdkmidi::MIDITick* pTickProc)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+
+		// Wait for any in-progress tick of this procedure to complete.
+		// Unregistering from within the TimeTick itself must not wait on itself.
+		if(std::this_thread::get_id() != m_Thread.get_id())
+		{
+			while(m_pActive == pTickProc)
+				m_cvTickDone.wait(lock);
+		}
+
+		ClientMap::iterator iter = m_Clients.find(pTickProc);
+		if(iter == m_Clients.end()) return;
+
+		iter->second.done.set_value(false);
+		m_Clients.erase(iter); // Its queued deadline gets discarded by the engine thread
+	}
+
+	size_t MIDIPlaybackEngine::GetClientCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Clients.size();
+	}
+
+	unsigned int MIDIPlaybackEngine::SetRealtimeConfig(const RealtimeConfig& config)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		m_RealtimeConfig = config;
+
+		if(m_Thread.joinable() == false)
+			return StartThread();
+
+		unsigned int nFailures = ApplyRealtimeConfig();
+
+		m_cvWake.notify_one(); // let the thread pick up the stack prefault request
+
+		return nFailures;
+	}
+
+	RealtimeConfig MIDIPlaybackEngine::GetRealtimeConfig() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_RealtimeConfig;
+	}
+
+	unsigned int MIDIPlaybackEngine::ApplyRealtimeConfig()
+	{
+		const RealtimeConfig& config = m_RealtimeConfig;
+
+		unsigned int nFailures = RealtimeConfig::FAILED_NONE;
+
+		m_bPrefaultStack = config.bLockMemory;
+
+#if defined _WIN32 || defined WIN32
+		// The Win32 driver is driven by the multimedia timer, not by this thread.
+		if(config.policy != RealtimeConfig::SCHEDULE_DEFAULT) nFailures |= RealtimeConfig::FAILED_SCHEDULING;
+		if(config.cpus.empty() == false) nFailures |= RealtimeConfig::FAILED_AFFINITY;
+		if(config.bLockMemory) nFailures |= RealtimeConfig::FAILED_MEMORY_LOCK;
+#else
+		pthread_t hThread = m_Thread.native_handle();
+
+		sched_param param;
+		memset(&param, 0, sizeof(param));
+
+		int nPolicy = SCHED_OTHER;
+		if(config.policy == RealtimeConfig::SCHEDULE_FIFO) nPolicy = SCHED_FIFO;
+		else if(config.policy == RealtimeConfig::SCHEDULE_RR) nPolicy = SCHED_RR;
+
+		if(nPolicy != SCHED_OTHER)
+			param.sched_priority = config.nPriority;
+
+		if(pthread_setschedparam(hThread, nPolicy, &param) != 0)
+			nFailures |= RealtimeConfig::FAILED_SCHEDULING;
+
+	#if defined(__linux__)
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		if(config.cpus.empty()) // No pinning - allow all the CPUs
+		{
+			for(int nCPU = 0; nCPU < CPU_SETSIZE; ++nCPU)
+				CPU_SET(nCPU, &cpuSet);
+		}
+		else
+		{
+			for(size_t i = 0; i < config.cpus.size(); ++i)
+				if(config.cpus[i] >= 0 && config.cpus[i] < CPU_SETSIZE)
+					CPU_SET(config.cpus[i], &cpuSet);
+		}
+		if(pthread_setaffinity_np(hThread, sizeof(cpuSet), &cpuSet) != 0 && config.cpus.empty() == false)
+			nFailures |= RealtimeConfig::FAILED_AFFINITY;
+	#else
+		if(config.cpus.empty() == false) nFailures |= RealtimeConfig::FAILED_AFFINITY;
+	#endif
+
+		if(config.bLockMemory && m_bMemoryLocked == false)
+		{
+			if(mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+				m_bMemoryLocked = true;
+			else
+				nFailures |= RealtimeConfig::FAILED_MEMORY_LOCK;
+		}
+		else if(config.bLockMemory == false && m_bMemoryLocked)
+		{
+			munlockall();
+			m_bMemoryLocked = false;
+		}
+#endif
+
+		return nFailures;
+	}
+
+	// We keep each procedure on its own fixed-rate schedule. Ticks are
+	// done outside the lock so that registrations and other clients never
+	// wait on the MIDI output of a procedure.
+	void MIDIPlaybackEngine::ThreadProc()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+
+		while(m_bShutdown == false)
+		{
+			if(m_bPrefaultStack)
+			{
+				m_bPrefaultStack = false;
+				PrefaultStack();
+			}
+
+			if(m_Deadlines.empty())
+			{
+				m_cvWake.wait(lock);
+				continue;
+			}
+
+			const Deadline next = m_Deadlines.top();
+
+			ClientMap::iterator iter = m_Clients.find(next.pTickProc);
+			if(iter == m_Clients.end() || iter->second.nSerial != next.nSerial)
+			{
+				m_Deadlines.pop(); // stale entry of an unregistered procedure
+				continue;
+			}
+
+			if(MidiTimer::Now() < next.when)
+			{
+				m_cvWake.wait_until(lock, next.when); // the earliest deadline might change while we wait
+				continue;
+			}
+
+			m_Deadlines.pop();
+			m_pActive = next.pTickProc;
+
+			lock.unlock();
+
+			MidiTimer::TimePoint tNow = MidiTimer::Now();
+
+			bool bHasMoreEvents = next.pTickProc->TimeTick(tNow);
+
+			lock.lock();
+
+			m_pActive = NULL;
+
+			iter = m_Clients.find(next.pTickProc);
+			if(iter != m_Clients.end() && iter->second.nSerial == next.nSerial) // still registered
+			{
+				if(bHasMoreEvents)
+				{
+					Deadline following = { next.when + iter->second.resolution, next.pTickProc, next.nSerial };
+					if(following.when < tNow) // we fell behind - no point in ticking in a burst
+						following.when = tNow + iter->second.resolution;
+					m_Deadlines.push(following);
+				}
+				else
+				{
+					iter->second.done.set_value(true);
+					m_Clients.erase(iter);
+				}
+			}
+
+			m_cvTickDone.notify_all();
+		}
+	}
+
+} // namespace CFugue
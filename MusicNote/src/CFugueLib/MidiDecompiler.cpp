@@ -0,0 +1,491 @@
+/*
+	This is part of CFugue, a C++ Runtime for MIDI Score Programming
+	Copyright (C) 2009 Gopalakrishna Palem
+
+	For links to further information, or to contact the author,
+	see <http://cfugue.sourceforge.net/>.
+*/
+
+#include "stdafx.h"
+
+#include "MidiDecompiler.h"
+#include "Note.h"
+#include "jdkmidi/filereadmemory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace CFugue
+{
+	// MusicString time units in a whole note (a Note duration of 1.0 renders to 128)
+	static const unsigned long WHOLE_NOTE_UNITS = 128;
+
+	// Letter durations longer than this many characters are written in the /decimal form
+	static const size_t MAX_LETTER_DURATION_LEN = 4;
+
+	// Items a channel may hold back for a sounding note before the note gets cut short
+	static const size_t MAX_PENDING_ITEMS = 4096;
+
+	// Tokens per output line, to keep the MusicString readable
+	static const size_t MAX_LINE_TOKENS = 16;
+
+	template<typename T>
+	static std::basic_string<TCHAR> ToTString(T value)
+	{
+		std::basic_ostringstream<TCHAR> strStream;
+		strStream << value;
+		return strStream.str();
+	}
+
+	MIDIDecompiler::MIDIDecompiler(OutStream& outStream, const Chords* pChords /*= NULL*/)
+		: m_OutStream(outStream),
+		m_pChords(pChords != NULL ? pChords : &m_DefaultChords),
+		m_nGridSteps((unsigned short)WHOLE_NOTE_UNITS),
+		m_bError(false),
+		m_nFormat(1),
+		m_nDivision(96),
+		m_nTrack(0),
+		m_lTrackTicks(0),
+		m_nOutVoice(-1),
+		m_nOutLayer(-1),
+		m_nLineTokens(0)
+	{
+		for(int nChannel = 0; nChannel < 16; ++nChannel)
+		{
+			Lane& lane = m_Lanes[nChannel];
+			std::fill(lane.bNoteOn, lane.bNoteOn + 128, false);
+			lane.nNotesOn = 0;
+
+			std::fill(m_lCursor[nChannel], m_lCursor[nChannel] + 16, 0UL);
+		}
+	}
+
+	MIDIDecompiler::~MIDIDecompiler()
+	{
+	}
+
+	void MIDIDecompiler::SetQuantization(unsigned short nStepsPerWholeNote)
+	{
+		// Round down to a power of two in [1, 128], so that the grid falls on whole time units
+		unsigned short nSteps = 1;
+		while(nSteps * 2 <= nStepsPerWholeNote && nSteps * 2 <= WHOLE_NOTE_UNITS)
+			nSteps *= 2;
+
+		m_nGridSteps = nSteps;
+	}
+
+	unsigned long MIDIDecompiler::Quantize(unsigned long lTicks) const
+	{
+		const unsigned long long nTicksPerWholeNote = 4ULL * (unsigned long long)m_nDivision;
+
+		// Nearest grid step, then the step in MusicString units
+		unsigned long long nSteps = ((unsigned long long)lTicks * m_nGridSteps + nTicksPerWholeNote / 2) / nTicksPerWholeNote;
+
+		return (unsigned long)(nSteps * (WHOLE_NOTE_UNITS / m_nGridSteps));
+	}
+
+	void MIDIDecompiler::mf_header(int nFormat, int nTracks, int nDivision)
+	{
+		m_nFormat = nFormat;
+
+		if(nDivision & 0x8000) // SMPTE based time. Take it as 120 beats per minute
+		{
+			int nFramesPerSecond = -(signed char)(nDivision >> 8);
+			int nTicksPerFrame = nDivision & 0xFF;
+			nDivision = (nFramesPerSecond * nTicksPerFrame) / 2;
+		}
+
+		m_nDivision = nDivision > 0 ? nDivision : 96;
+	}
+
+	void MIDIDecompiler::mf_starttrack(int nTrack)
+	{
+		m_nTrack = nTrack;
+		m_lTrackTicks = 0;
+	}
+
+	void MIDIDecompiler::mf_endtrack(int nTrack)
+	{
+		// Close the notes left sounding at the end of the track and write out everything
+		for(unsigned short nChannel = 0; nChannel < 16; ++nChannel)
+		{
+			Lane& lane = m_Lanes[nChannel];
+
+			for(unsigned char nNote = 0; nNote < 128 && lane.nNotesOn > 0; ++nNote)
+				if(lane.bNoteOn[nNote])
+					NoteOff(lane, nNote, Note::DEFAULT_DECAY_VELOCITY, m_lTrackTicks);
+
+			Flush(nChannel, (unsigned long)-1);
+		}
+
+		m_OutStream.flush();
+	}
+
+	void MIDIDecompiler::mf_error(const char* szError)
+	{
+		m_bError = true;
+	}
+
+	void MIDIDecompiler::mf_tempo(jdkmidi::MIDITickMS time, unsigned long lTempo)
+	{
+		if(lTempo == 0) return;
+
+		Item item = { ITEM_TEMPO, 0, (unsigned short)((60000000UL + lTempo / 2) / lTempo), 0, 0 }; // BPM from micro seconds per beat
+
+		AddItem(0, (unsigned long)time.count(), item); // Tempo is not tied to any channel. Voice 0 carries it
+	}
+
+	void MIDIDecompiler::mf_keysig(jdkmidi::MIDITickMS time, int nSharpFlats, int nMinor)
+	{
+		if(nSharpFlats < -7 || nSharpFlats > 7) return;
+
+		// Inverse of MusicStringParser::ParseKeySignatureToken: [0, 7] are sharps,
+		// [8, 14] are flats, and major scales are 64 higher.
+		unsigned short nValue = (unsigned short)(nSharpFlats >= 0 ? nSharpFlats : 7 - nSharpFlats);
+		if(nMinor == 0) nValue += 64;
+
+		Item item = { ITEM_KEYSIGNATURE, 0, nValue, 0, 0 };
+
+		AddItem(0, (unsigned long)time.count(), item);
+	}
+
+	void MIDIDecompiler::ChanMessage(const jdkmidi::MIDITimedMessage& msg)
+	{
+		unsigned short nChannel = msg.GetChannel();
+		unsigned long lTicks = (unsigned long)msg.GetTime().count();
+
+		Lane& lane = m_Lanes[nChannel];
+
+		if(msg.IsNoteOn())
+		{
+			NoteOn(lane, msg.GetNote(), msg.GetVelocity(), lTicks);
+		}
+		else if(msg.IsNoteOff())
+		{
+			// A Note On with zero velocity is an off without any release velocity of its own
+			unsigned char nVelocity = (msg.GetStatus() & 0xF0) == jdkmidi::NOTE_ON ? (unsigned char)Note::DEFAULT_DECAY_VELOCITY : msg.GetVelocity();
+			NoteOff(lane, msg.GetNote(), nVelocity, lTicks);
+		}
+		else if(msg.IsProgramChange())
+		{
+			Item item = { ITEM_INSTRUMENT, 0, msg.GetPGValue(), 0, 0 };
+			AddItem(nChannel, lTicks, item);
+		}
+		else if(msg.IsControlChange() && msg.GetController() < jdkmidi::C_RESET)
+		{
+			Item item = { ITEM_CONTROLLER, 0, msg.GetController(), msg.GetControllerValue(), 0 };
+			AddItem(nChannel, lTicks, item);
+		}
+		// Pressure and Pitch bend messages are not decompiled
+
+		if(lTicks > m_lTrackTicks) m_lTrackTicks = lTicks;
+
+		// A note held for very long keeps everything after it waiting. Past a
+		// limit, cut the earliest sounding note short, to bound the memory use.
+		if(lane.items.size() > MAX_PENDING_ITEMS)
+		{
+			unsigned char nEarliest = 0;
+			for(unsigned char nNote = 0; nNote < 128; ++nNote)
+				if(lane.bNoteOn[nNote] && (lane.bNoteOn[nEarliest] == false || lane.lNoteOnTick[nNote] < lane.lNoteOnTick[nEarliest]))
+					nEarliest = nNote;
+			NoteOff(lane, nEarliest, Note::DEFAULT_DECAY_VELOCITY, lTicks);
+		}
+
+		// Nothing can come before the earliest sounding note or before now anymore
+		unsigned long lLimit = Quantize(lTicks);
+		for(unsigned char nNote = 0; nNote < 128 && lane.nNotesOn > 0; ++nNote)
+			if(lane.bNoteOn[nNote])
+				lLimit = std::min(lLimit, Quantize(lane.lNoteOnTick[nNote]));
+
+		Flush(nChannel, lLimit);
+	}
+
+	void MIDIDecompiler::NoteOn(Lane& lane, unsigned char nNote, unsigned char nVelocity, unsigned long lTicks)
+	{
+		if(lane.bNoteOn[nNote]) // Retriggered without an off. Close the earlier one here
+			NoteOff(lane, nNote, Note::DEFAULT_DECAY_VELOCITY, lTicks);
+
+		lane.bNoteOn[nNote] = true;
+		lane.lNoteOnTick[nNote] = lTicks;
+		lane.nNoteOnVelocity[nNote] = nVelocity;
+		lane.nNotesOn++;
+	}
+
+	void MIDIDecompiler::NoteOff(Lane& lane, unsigned char nNote, unsigned char nVelocity, unsigned long lTicks)
+	{
+		if(lane.bNoteOn[nNote] == false) return; // Off without an On
+
+		lane.bNoteOn[nNote] = false;
+		lane.nNotesOn--;
+
+		unsigned long lStart = Quantize(lane.lNoteOnTick[nNote]);
+		unsigned long lEnd = Quantize(lTicks);
+		unsigned long lMinDuration = WHOLE_NOTE_UNITS / m_nGridSteps;
+
+		Item item = { ITEM_NOTE, std::max(lEnd > lStart ? lEnd - lStart : 0UL, lMinDuration), nNote, lane.nNoteOnVelocity[nNote], nVelocity };
+
+		lane.items.insert(ItemQueue::value_type(lStart, item));
+	}
+
+	void MIDIDecompiler::AddItem(unsigned short nChannel, unsigned long lTicks, const Item& item)
+	{
+		m_Lanes[nChannel].items.insert(ItemQueue::value_type(Quantize(lTicks), item));
+
+		if(lTicks > m_lTrackTicks) m_lTrackTicks = lTicks;
+	}
+
+	void MIDIDecompiler::Flush(unsigned short nChannel, unsigned long lLimit)
+	{
+		ItemQueue& items = m_Lanes[nChannel].items;
+
+		std::vector<Item> vecGroup;
+
+		while(items.empty() == false && items.begin()->first < lLimit)
+		{
+			unsigned long lStart = items.begin()->first;
+
+			vecGroup.clear();
+
+			ItemQueue::iterator iterEnd = items.upper_bound(lStart);
+			for(ItemQueue::iterator iter = items.begin(); iter != iterEnd; ++iter)
+				vecGroup.push_back(iter->second);
+
+			items.erase(items.begin(), iterEnd);
+
+			WriteGroup(nChannel, lStart, vecGroup);
+		}
+	}
+
+	void MIDIDecompiler::WriteGroup(unsigned short nChannel, unsigned long lStart, std::vector<Item>& vecItems)
+	{
+		MoveTo(nChannel, lStart);
+
+		std::vector<std::pair<unsigned long, unsigned short> > vecNotes; // (duration, index into vecItems)
+
+		for(size_t i = 0; i < vecItems.size(); ++i)
+		{
+			const Item& item = vecItems[i];
+
+			switch(item.type)
+			{
+			case ITEM_INSTRUMENT: WriteToken(_T("I") + ToTString(item.nValue1)); break;
+			case ITEM_CONTROLLER: WriteToken(_T("X") + ToTString(item.nValue1) + _T("=") + ToTString(item.nValue2)); break;
+			case ITEM_TEMPO: WriteToken(_T("T") + ToTString(item.nValue1)); break;
+			case ITEM_KEYSIGNATURE: WriteToken(_T("K") + ToTString(item.nValue1)); break;
+			case ITEM_NOTE: vecNotes.push_back(std::make_pair(item.lDuration, (unsigned short)i)); break;
+			}
+		}
+
+		if(vecNotes.empty()) return;
+
+		// A chord needs all its notes to start and end alike. The parser gives the notes
+		// of a chord above the root the default velocities, so they must all have those;
+		// notes at other velocities are written out one by one.
+		bool bChord = vecNotes.size() > 1 && vecNotes.size() <= ChordDef::MAX_INTERVALS;
+		for(size_t i = 0; i < vecNotes.size() && bChord; ++i)
+		{
+			const Item& first = vecItems[vecNotes[0].second];
+			const Item& note = vecItems[vecNotes[i].second];
+			bChord = note.lDuration == first.lDuration
+				&& note.nValue2 == Note::DEFAULT_ATTACK_VELOCITY && note.nValue3 == Note::DEFAULT_DECAY_VELOCITY;
+		}
+
+		std::sort(vecNotes.begin(), vecNotes.end(), [&vecItems](const std::pair<unsigned long, unsigned short>& lhs, const std::pair<unsigned long, unsigned short>& rhs)
+		{
+			if(lhs.first != rhs.first) return lhs.first > rhs.first;
+			return vecItems[lhs.second].nValue1 < vecItems[rhs.second].nValue1;
+		});
+
+		if(bChord)
+		{
+			ChordDef::HALFSTEP intervals[ChordDef::MAX_INTERVALS];
+			unsigned short nRoot = vecItems[vecNotes[0].second].nValue1;
+
+			for(size_t i = 1; i < vecNotes.size(); ++i)
+				intervals[i-1] = (ChordDef::HALFSTEP)(vecItems[vecNotes[i].second].nValue1 - nRoot);
+
+			ChordDef chord;
+			if(m_pChords->FindChordByIntervals(intervals, (unsigned short)(vecNotes.size() - 1), &chord))
+			{
+				WriteToken(FormatNote(vecItems[vecNotes[0].second], &chord));
+				m_lCursor[nChannel][m_nOutLayer] = lStart + vecNotes[0].first;
+				return;
+			}
+		}
+
+		// Parallel notes, the shortest last: the parser leaves the
+		// Layer time at the end of the last note of the group
+		std::basic_string<TCHAR> strToken;
+		for(size_t i = 0; i < vecNotes.size(); ++i)
+		{
+			if(i > 0) strToken += _T('+');
+			strToken += FormatNote(vecItems[vecNotes[i].second], NULL);
+		}
+
+		WriteToken(strToken);
+
+		m_lCursor[nChannel][m_nOutLayer] = lStart + vecNotes.back().first;
+	}
+
+	void MIDIDecompiler::MoveTo(unsigned short nChannel, unsigned long lTime)
+	{
+		int nLayer = m_nTrack % 16;
+
+		if(m_nOutVoice != nChannel || m_nOutLayer != nLayer)
+		{
+			if(m_nLineTokens > 0) m_OutStream << std::endl;
+			m_nLineTokens = 0;
+
+			WriteToken(_T("V") + ToTString(nChannel));
+			WriteToken(_T("L") + ToTString(nLayer));
+
+			m_nOutVoice = nChannel;
+			m_nOutLayer = nLayer;
+		}
+
+		unsigned long& lCursor = m_lCursor[nChannel][nLayer];
+
+		if(lTime > lCursor)
+		{
+			WriteToken(_T("R") + FormatDuration(lTime - lCursor));
+		}
+		else if(lTime < lCursor) // An overlap with what was written on this Layer before
+		{
+			WriteToken(_T("@") + ToTString(lTime));
+		}
+
+		lCursor = lTime;
+	}
+
+	std::basic_string<TCHAR> MIDIDecompiler::FormatNote(const Item& note, const ChordDef* pChord) const
+	{
+		// Numeric notes are not altered by the Key Signature
+		std::basic_string<TCHAR> strNote = _T("[") + ToTString(note.nValue1) + _T("]");
+
+		if(pChord != NULL) strNote += pChord->szChordName;
+
+		strNote += FormatDuration(note.lDuration);
+
+		if(note.nValue2 != Note::DEFAULT_ATTACK_VELOCITY || note.nValue3 != Note::DEFAULT_DECAY_VELOCITY)
+		{
+			strNote += _T("V") + ToTString(note.nValue2);
+			if(note.nValue3 != Note::DEFAULT_DECAY_VELOCITY)
+				strNote += _T("V") + ToTString(note.nValue3);
+		}
+
+		return strNote;
+	}
+
+	std::basic_string<TCHAR> MIDIDecompiler::FormatDuration(unsigned long lDuration) const
+	{
+		static const TCHAR szLetters[] = _T("HQISTXO"); // half through 1/128th, after the wholes
+
+		std::basic_string<TCHAR> strLetters(lDuration / WHOLE_NOTE_UNITS, _T('W'));
+
+		unsigned long lRemainder = lDuration % WHOLE_NOTE_UNITS;
+		for(int nBit = 6; nBit >= 0 && strLetters.size() <= MAX_LETTER_DURATION_LEN; --nBit)
+		{
+			if((lRemainder & (1UL << nBit)) == 0) continue;
+
+			strLetters += szLetters[6 - nBit];
+
+			if(nBit > 0 && (lRemainder & (1UL << (nBit - 1)))) // Its half too - dot it
+			{
+				strLetters += _T('.');
+				--nBit;
+			}
+		}
+
+		if(strLetters.size() <= MAX_LETTER_DURATION_LEN)
+			return strLetters;
+
+		// Exact decimal form. Fractions of 128 always terminate
+		std::basic_string<TCHAR> strDecimal = _T("/") + ToTString(lDuration / WHOLE_NOTE_UNITS);
+		if(lRemainder != 0)
+		{
+			strDecimal += _T('.');
+			while(lRemainder != 0)
+			{
+				lRemainder *= 10;
+				strDecimal += (TCHAR)(_T('0') + lRemainder / WHOLE_NOTE_UNITS);
+				lRemainder %= WHOLE_NOTE_UNITS;
+			}
+		}
+
+		return strDecimal;
+	}
+
+	void MIDIDecompiler::WriteToken(const std::basic_string<TCHAR>& strToken)
+	{
+		if(m_nLineTokens >= MAX_LINE_TOKENS)
+		{
+			m_OutStream << std::endl;
+			m_nLineTokens = 0;
+		}
+		else if(m_nLineTokens > 0)
+			m_OutStream << _T(' ');
+
+		m_OutStream << strToken;
+		m_nLineTokens++;
+	}
+
+	bool MIDIDecompiler::DecompileFile(const char* szMidiFilePath, OutStream& outStream, unsigned short nStepsPerWholeNote /*= 128*/)
+	{
+		jdkmidi::MIDIFileMemoryMap fileMap(szMidiFilePath);
+		if(fileMap.IsValid() == false) return false;
+
+		MIDIDecompiler decompiler(outStream);
+		decompiler.SetQuantization(nStepsPerWholeNote);
+
+		jdkmidi::MIDIFileReadMemory reader(fileMap.GetData(), fileMap.GetSize(), &decompiler);
+
+		bool bResult = reader.Parse() && decompiler.HasErrors() == false;
+
+		outStream << std::endl;
+
+		return bResult && outStream.good();
+	}
+
+	size_t MIDIDecompiler::DecompileFiles(const std::vector<std::string>& vecMidiFiles,
+										const std::vector<std::string>& vecOutputFiles,
+										unsigned int nWorkers /*= 0*/,
+										unsigned short nStepsPerWholeNote /*= 128*/)
+	{
+		const size_t nFiles = std::min(vecMidiFiles.size(), vecOutputFiles.size());
+
+		if(nWorkers == 0) nWorkers = std::thread::hardware_concurrency();
+		if(nWorkers == 0) nWorkers = 1;
+		if(nWorkers > nFiles) nWorkers = (unsigned int)nFiles;
+
+		std::atomic<size_t> nNextFile(0);
+		std::atomic<size_t> nSucceeded(0);
+
+		// Each worker picks the next file till none are left. Decompilers share nothing.
+		auto workerProc = [&]()
+		{
+			for(size_t i = nNextFile++; i < nFiles; i = nNextFile++)
+			{
+				std::basic_ofstream<TCHAR> outFile(vecOutputFiles[i].c_str());
+				if(outFile.is_open() == false) continue;
+
+				if(DecompileFile(vecMidiFiles[i].c_str(), outFile, nStepsPerWholeNote))
+					nSucceeded++;
+			}
+		};
+
+		std::vector<std::thread> vecThreads;
+		for(unsigned int i = 1; i < nWorkers; ++i)
+			vecThreads.push_back(std::thread(workerProc));
+
+		workerProc(); // this thread works too
+
+		for(size_t i = 0; i < vecThreads.size(); ++i)
+			vecThreads[i].join();
+
+		return nSucceeded;
+	}
+
+} // namespace CFugue
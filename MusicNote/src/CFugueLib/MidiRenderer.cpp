@@ -12,6 +12,7 @@
 
 #include "stdafx.h"
 #include "jdkmidi/filewritemultitrack.h"
+#include "jdkmidi/multitrackcache.h"
 #include "Note.h"
 #include "ChannelPressure.h"
 #include "ControllerEvent.h"
@@ -33,11 +34,40 @@
 #endif
 #include "MidiRenderer.h"
 
+#include <algorithm>
+
 namespace CFugue
 {
+    /// <Summary>
+    /// Serializes a parser event against the playback thread while the tracks are
+    /// being streamed, and moves the horizon past the event once it is rendered.
+    /// </Summary>
+    class MIDIRenderer::StreamScope
+    {
+        MIDIRenderer* m_pRenderer;
+        std::unique_lock<std::mutex> m_Lock;
+    public:
+        inline StreamScope(MIDIRenderer* pRenderer) : m_pRenderer(pRenderer)
+        {
+            if(m_pRenderer->m_bStreaming) // Only the parsing thread changes this while streaming
+                m_Lock = std::unique_lock<std::mutex>(m_pRenderer->m_StreamMutex);
+        }
+        inline ~StreamScope()
+        {
+            if(m_Lock.owns_lock()) m_pRenderer->UpdateHorizon();
+        }
+        /// Returns true if the event should be ignored
+        inline bool IsDiscarded() const { return m_Lock.owns_lock() && m_pRenderer->m_bDiscardEvents; }
+    };
+
+    /// Declares the StreamScope object of a parser event handler
+    #define STREAM_EVENT_SCOPE(scope)  StreamScope scope(this)
+
     MIDIRenderer::MIDIRenderer(void) :
-        m_pMIDIDriver(new CFugueMIDIDriver(128)), m_MIDIManager(m_pMIDIDriver)
+        m_pMIDIDriver(new CFugueMIDIDriver(128)), m_MIDIManager(m_pMIDIDriver),
+        m_lFirstNoteTime(0), m_bStreaming(false), m_bDiscardEvents(false), m_lHorizon(0)
     {
+        m_pMIDIDriver->SetTickProc(this); // We come in between the driver and the manager
     }
 
     MIDIRenderer::~MIDIRenderer(void)
@@ -49,14 +79,25 @@ namespace CFugue
     {
         EndPlayAsync(); // Stop any current Play in progress
         m_lFirstNoteTime = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_StreamMutex);
+            m_bDiscardEvents = false; // A cancelled stream does not outlive its tracks
+        }
         MIDIEventManager::Clear(); // Clear the Track content
     }
 
     bool MIDIRenderer::BeginPlayAsync(int nMIDIOutPortID, unsigned int nTimerResolutionMS)
     {
-        m_Sequencer.GoToZero();
-        m_MIDIManager.SetSeq(&m_Sequencer);
-        if(m_pMIDIDriver->OpenMIDIOutPort(nMIDIOutPortID))
+        {
+            std::lock_guard<std::mutex> lock(m_StreamMutex); // Tracks might still be getting events
+            m_Sequencer.GoToZero();
+            m_MIDIManager.SetSeq(&m_Sequencer);
+        }
+        bool bPortsOpen = m_pMIDIDriver->OpenMIDIOutPort(nMIDIOutPortID);
+        for(size_t i = 0; bPortsOpen && i < m_ExtraOutPorts.size() && i + 1 < MAX_PORTS; ++i)
+            bPortsOpen = m_pMIDIDriver->OpenMIDIOutPort(m_ExtraOutPorts[i], (unsigned char)(i + 1));
+
+        if(bPortsOpen)
         {
             m_MIDIManager.SeqPlay(); // Set into Play mode
             m_MIDIManager.SetTimeOffset(MidiTimer::Now()); // Set the initial time offset
@@ -76,6 +117,95 @@ namespace CFugue
         m_pMIDIDriver->StopTimer();	// Stop the Timer
         m_pMIDIDriver->CloseMIDIOutPort();
     }
+
+    void MIDIRenderer::SetOutProcessor(jdkmidi::MIDIProcessor* pProcessor)
+    {
+        m_pMIDIDriver->SetOutProcessor(pProcessor);
+    }
+
+    unsigned int MIDIRenderer::SetRealtimeConfig(const RealtimeConfig& config)
+    {
+#if defined(_WIN32) // MIDIDriverWin32 is pumped by the multimedia timer, not by the engine
+        unsigned int nFailures = RealtimeConfig::FAILED_NONE;
+        if(config.policy != RealtimeConfig::SCHEDULE_DEFAULT) nFailures |= RealtimeConfig::FAILED_SCHEDULING;
+        if(config.cpus.empty() == false) nFailures |= RealtimeConfig::FAILED_AFFINITY;
+        if(config.bLockMemory) nFailures |= RealtimeConfig::FAILED_MEMORY_LOCK;
+        return nFailures;
+#else
+        return MIDIPlaybackEngine::Instance().SetRealtimeConfig(config);
+#endif
+    }
+
+    void MIDIRenderer::BeginStreaming(const unsigned short pUsedLayers[16])
+    {
+        std::lock_guard<std::mutex> lock(m_StreamMutex);
+
+        m_StreamLayers.clear();
+        for(unsigned short nVoice = 0; nVoice < MAX_CHANNELS; ++nVoice)
+            for(unsigned short nLayer = 0; nLayer < MAX_LAYERS; ++nLayer)
+                if(pUsedLayers[nVoice] & (1 << nLayer))
+                    m_StreamLayers.push_back(std::make_pair(nVoice, nLayer));
+
+        m_lFirstNoteTime = 0;
+        m_lHorizon = 0;
+        m_bDiscardEvents = false;
+        m_MIDIManager.SetSeqHorizon(jdkmidi::MIDITickMS::zero());
+        m_bStreaming = true;
+    }
+
+    void MIDIRenderer::EndStreaming()
+    {
+        std::lock_guard<std::mutex> lock(m_StreamMutex);
+
+        if(m_bStreaming == false) return;
+
+        m_Sequencer.GetState()->iterator.Resume(); // Ticks do not look for new events once we are done
+        m_MIDIManager.SetSeqHorizon(jdkmidi::MIDITickMS::max());
+        m_bStreaming = false;
+
+        m_cvHorizon.notify_all();
+    }
+
+    void MIDIRenderer::CancelStreaming()
+    {
+        std::lock_guard<std::mutex> lock(m_StreamMutex);
+        m_bDiscardEvents = true;
+    }
+
+    void MIDIRenderer::WaitForHorizon(unsigned long lTime)
+    {
+        std::unique_lock<std::mutex> lock(m_StreamMutex);
+
+        while(m_bStreaming && m_bDiscardEvents == false && m_lHorizon < lTime)
+            m_cvHorizon.wait(lock);
+    }
+
+    void MIDIRenderer::UpdateHorizon()
+    {
+        unsigned long lHorizon = (unsigned long)m_lFirstNoteTime;
+
+        for(VoiceLayerList::const_iterator iter = m_StreamLayers.begin(); iter != m_StreamLayers.end(); ++iter)
+            lHorizon = std::min(lHorizon, m_Time[iter->first][iter->second]);
+
+        if(lHorizon != m_lHorizon)
+        {
+            m_lHorizon = lHorizon;
+            m_MIDIManager.SetSeqHorizon(jdkmidi::MIDITickMS(lHorizon));
+            m_cvHorizon.notify_all();
+        }
+    }
+
+    bool MIDIRenderer::TimeTick(jdkmidi::MIDITick::time_point tNow)
+    {
+        if(m_bStreaming == false) // All the events are in place
+            return m_MIDIManager.TimeTick(tNow);
+
+        std::lock_guard<std::mutex> lock(m_StreamMutex);
+
+        m_Sequencer.GetState()->iterator.Resume(); // Pick up the events rendered since the last tick
+
+        return m_MIDIManager.TimeTick(tNow);
+    }
 
     void MIDIRenderer::WaitTillDone()
     {
@@ -97,23 +227,88 @@ namespace CFugue
 		return WriterObj.Write();
 	}
 
+    bool MIDIRenderer::SaveToBuffer(std::vector<uint8_t>& outBuffer)
+	{
+		jdkmidi::MIDIFileWriteStreamMemory outMemory(outBuffer);
+
+		jdkmidi::MIDIFileWriteMultiTrack WriterObj(&m_Tracks, &outMemory);
+
+		return WriterObj.Write();
+	}
+
+    bool MIDIRenderer::SaveToStream(std::ostream& outStream)
+	{
+		// The track lengths get patched in after each track is written,
+		// so the file is put together in memory before it goes out.
+		std::vector<uint8_t> buffer;
+
+		if(SaveToBuffer(buffer) == false) return false;
+
+		outStream.write((const char*)buffer.data(), (std::streamsize)buffer.size());
+
+		return outStream.good();
+	}
+
+    bool MIDIRenderer::SaveToCache(const char* szCacheFilePath)
+	{
+		std::lock_guard<std::mutex> lock(m_StreamMutex); // Tracks might still be getting events
+
+		return jdkmidi::MIDIMultiTrackCache::Write(&m_Tracks, szCacheFilePath);
+	}
+
+    bool MIDIRenderer::LoadFromCache(const char* szCacheFilePath)
+	{
+		jdkmidi::MIDIMultiTrackCache cache(szCacheFilePath);
+
+		return LoadFromCache(cache);
+	}
+
+    bool MIDIRenderer::LoadFromCache(const jdkmidi::MIDIMultiTrackCache& cache)
+	{
+		if(cache.IsValid() == false) return false;
+
+		Clear();
+
+		if(cache.Load(&m_Tracks) == false)
+		{
+			MIDIEventManager::Clear(); // Do not leave the tracks half loaded
+			return false;
+		}
+
+		m_Sequencer.ResetAllTracks();
+
+		return true;
+	}
+
 	void MIDIRenderer::OnChannelPressureEvent(const CParser* pParser, const ChannelPressure* pCP)
 	{
+		STREAM_EVENT_SCOPE(streamScope);
+		if(streamScope.IsDiscarded()) return;
+
 		AddChannelPressureEvent(pCP->GetPressure());
 	}
 
 	void MIDIRenderer::OnControllerEvent(const CParser* pParser, const ControllerEvent* pConEvent)
 	{
+		STREAM_EVENT_SCOPE(streamScope);
+		if(streamScope.IsDiscarded()) return;
+
 		AddControllerEvent(pConEvent->GetControl(), pConEvent->GetValue());
 	}
 
     void MIDIRenderer::OnInstrumentEvent(const CParser* pParser, const Instrument* pInstrument)
     {
+        STREAM_EVENT_SCOPE(streamScope);
+        if(streamScope.IsDiscarded()) return;
+
         AddProgramChangeEvent(pInstrument->GetInstrumentID());
     }
 
     void MIDIRenderer::OnKeySignatureEvent(const CParser* pParser, const KeySignature* pKeySig)
     {
+        STREAM_EVENT_SCOPE(streamScope);
+        if(streamScope.IsDiscarded()) return;
+
         AddKeySignatureEvent(pKeySig->GetKey(), pKeySig->GetMajMin());
     }
 
@@ -124,21 +319,33 @@ namespace CFugue
 
 	void MIDIRenderer::OnPitchBendEvent(const CParser* pParser, const PitchBend* pPB)
 	{
+		STREAM_EVENT_SCOPE(streamScope);
+		if(streamScope.IsDiscarded()) return;
+
 		AddPitchBendEvent(pPB->GetLowByte(), pPB->GetHighByte());
 	}
 
 	void MIDIRenderer::OnPolyphonicPressureEvent(const CParser* pParser, const PolyphonicPressure* pPressure)
 	{
+		STREAM_EVENT_SCOPE(streamScope);
+		if(streamScope.IsDiscarded()) return;
+
 		AddPolyphonicPressureEvent(pPressure->GetKey(), pPressure->GetPressure());
 	}
 
     void MIDIRenderer::OnTempoEvent(const CParser* pParser, const Tempo* pTempo)
     {
+        STREAM_EVENT_SCOPE(streamScope);
+        if(streamScope.IsDiscarded()) return;
+
         AddTempoEvent(pTempo->GetTempo());
     }
 
     void MIDIRenderer::OnTimeEvent(const CParser* pParser, const Time* pTime)
     {
+        STREAM_EVENT_SCOPE(streamScope);
+        if(streamScope.IsDiscarded()) return;
+
         SetTrackTime(pTime->GetTime());
     }
 
@@ -151,6 +358,9 @@ namespace CFugue
     {
         if(pNote->duration == 0) return;
 
+        STREAM_EVENT_SCOPE(streamScope);
+        if(streamScope.IsDiscarded()) return;
+
         if(pNote->isRest)	// if this is a rest note, simply advance the track timer
         {
             AdvanceTrackTime(pNote->duration); return;
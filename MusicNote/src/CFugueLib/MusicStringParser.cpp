@@ -25,6 +25,9 @@
 
 #include "math.h"
 
+#include <functional>
+#include <string>
+
 //TODO: Use C++0x Futures as asynchronous constructs for the Parsing.
 //		No point in parsing in a blocking call. Use external ParserPreference
 //		object to control 'exit on first error', 'Synch/Asynch' behaviors
@@ -185,6 +188,29 @@ namespace CFugue
         return NULL;
     }
 
+    // mixes the value into the running hash
+    inline size_t HashCombine(size_t nHash, size_t nValue)
+    {
+        return nHash ^ (nValue + 0x9e3779b9 + (nHash << 6) + (nHash >> 2));
+    }
+
+	size_t MusicStringParser::GetRenderStateHash() const
+	{
+		KeySignature keySig(m_KeySig); // Speed() is not const
+
+		size_t nHash = m_nDefinitionsHash;
+		nHash = HashCombine(nHash, (size_t)keySig.GetMode());
+		nHash = HashCombine(nHash, (size_t)(unsigned short)keySig.GetKey());
+		nHash = HashCombine(nHash, (size_t)keySig.GetMajMin());
+		nHash = HashCombine(nHash, (size_t)(unsigned short)keySig.GetTalam());
+		nHash = HashCombine(nHash, (size_t)keySig.Speed());
+		nHash = HashCombine(nHash, (size_t)m_nDefNoteOctave);
+		nHash = HashCombine(nHash, (size_t)m_nDefChordOctave);
+		nHash = HashCombine(nHash, m_pChords != NULL ? m_pChords->GetHash() : 0); // NULL uses the built-in definitions
+
+		return nHash;
+	}
+
 	bool MusicStringParser::Parse(const TCHAR* szTokens)
 	{
         if(szTokens == NULL) return true;
@@ -224,6 +250,54 @@ namespace CFugue
 		return !bNonContinuableErrorOccured;
 	}
 
+	// Walks the tokens just like Parse() does, but only looks at their first characters
+	bool MusicStringParser::FindVoiceLayers(const TCHAR* szTokens, unsigned short pUsedLayers[16])
+	{
+		memset(pUsedLayers, 0, sizeof(unsigned short) * 16);
+
+		if(szTokens == NULL) return true;
+
+		unsigned short nVoice = 0;
+		unsigned short nLayers[16] = {0}; // Layers are remembered per voice
+
+		const TCHAR* psz = szTokens;
+		do
+		{
+			EatWhiteSpace(psz);
+
+			EatComments(psz);
+
+			const TCHAR* pszToken = psz;
+			while(*psz && !IsOneOf(*psz, _T(" \t\n\r"))) psz++;
+
+			if(psz == pszToken) break;
+
+			TCHAR chToken = pszToken[0];
+			if(chToken >= _T('a') && chToken <= _T('z')) chToken = chToken - _T('a') + _T('A');
+
+			if(chToken == TOKEN_START_VOICE || chToken == TOKEN_START_LAYER)
+			{
+				unsigned short nVal = 0;
+				const TCHAR* pszVal = pszToken + 1;
+				if(*pszVal < _T('0') || *pszVal > _T('9')) return false; // Dictionary value or bad token
+				for(; *pszVal >= _T('0') && *pszVal <= _T('9'); ++pszVal)
+				{
+					nVal = nVal * 10 + (*pszVal - _T('0'));
+					if(nVal > 15) return false;
+				}
+
+				if(chToken == TOKEN_START_VOICE) nVoice = nVal; else nLayers[nVoice] = nVal;
+			}
+			else if(chToken == TOKEN_START_TIME)
+				return false;
+			else if(chToken != TOKEN_START_MEASURE && chToken != TOKEN_START_DICTIONARY && chToken != TOKEN_SEPERATOR)
+				pUsedLayers[nVoice] |= (1 << nLayers[nVoice]); // Anything else could add events to the current layer
+
+		}while(*psz);
+
+		return true;
+	}
+
 	int MusicStringParser::ParseToken(TCHAR* szToken, bool* pbNonContinuableErrorOccured/* = NULL*/)
 	{
 		bool bNonContinuableErrorOccured = false; int nLen = 0;
@@ -332,12 +406,12 @@ namespace CFugue
 		{
 			Verbose(_T("MusicStringParser::ParseVoiceToken: Voice = ") << nVoice);
 
-			if(nVoice > 15)
+			if(nVoice >= Voice::MAX_VOICES)
 			{
 				MString str;
-				str << _T("Voice ") << nVoice << _T(" is beyond the range [0, 15]");
+				str << _T("Voice ") << nVoice << _T(" is beyond the range [0, ") << (Voice::MAX_VOICES - 1) << _T("]");
                 if(Error(PARSE_ERROR_VOICE_MAXLIMIT, str, szToken)) { *pbNonContinuableErrorOccured = true; return -1;}; // if we should stop processing any further
-				nVoice = 15; // if we need to continue despite the error, ceil the value
+				nVoice = Voice::MAX_VOICES - 1; // if we need to continue despite the error, ceil the value
 			}
 
 			Voice voiceObj((unsigned char) nVoice);
@@ -723,6 +797,10 @@ namespace CFugue
 
 		m_Dictionary[pszKey] = pszValue; // Create or Update the value
 
+		std::hash<std::basic_string<TCHAR> > hashString;
+		m_nDefinitionsHash = HashCombine(m_nDefinitionsHash, hashString(pszKey));
+		m_nDefinitionsHash = HashCombine(m_nDefinitionsHash, hashString(pszValue));
+
 		Verbose(_T("MusicStringParser::ParseDictionaryToken: Defined [") << pszKey << _T("]=") << pszValue);
 
 		return (int) (_tcslen(pszKey) + _tcslen(pszValue) + 1);
@@ -1057,9 +1135,7 @@ namespace CFugue
             return 0;    // No Chords for Rest Notes
         }
 
-        unsigned int nChordNameLen = m_pChords != NULL ?
-									 m_pChords->ExtractMatchingChord(szToken, &ctx.chord) :
-									 Chords::GetDefaultMatchingChord(szToken, &ctx.chord) ;
+        unsigned int nChordNameLen = (m_pChords != NULL ? m_pChords : m_pDefaultChords)->ExtractMatchingChord(szToken, &ctx.chord);
         if(nChordNameLen > 0)
         {
             ctx.isChord = true;
@@ -20,7 +20,8 @@
 namespace CFugue
 {
 	Player::Player(unsigned int nMIDIOutPortID /*= MIDI_MAPPER*/, unsigned int nMIDITimerResMS /*= 20*/)
-		: m_nOutPort(nMIDIOutPortID), m_nTimerRes(nMIDITimerResMS)
+		: m_nOutPort(nMIDIOutPortID), m_nTimerRes(nMIDITimerResMS), m_bPipelinedPlay(false), m_lLookahead(512),
+		m_pRenderCache(NULL)
 	{
 		m_Parser.AddListener(&m_Renderer);
 	}
@@ -39,10 +40,42 @@ namespace CFugue
 
     bool Player::PlayAsync(const MString& strMusicNotes)
     {
+        CancelPipelinedParse(); // Finish off any previous parsing
+
+        MIDIRenderCache* pCache = m_pRenderCache;
+        MIDIRenderCache::Key key;
+        if(pCache != NULL)
+        {
+            key = MIDIRenderCache::MakeKey(strMusicNotes, m_Parser);
+            if(pCache->Restore(key, m_Renderer, m_Parser)) // Rendered earlier - no parsing needed
+                return m_Renderer.BeginPlayAsync(m_nOutPort, m_nTimerRes);
+        }
+
         m_Renderer.Clear(); // Clear any previous Notes
 
-        if(false == m_Parser.Parse(strMusicNotes))	// Parse and Load the Notes into MIDI MultiTrack
+        unsigned short usedLayers[16];
+        if(m_bPipelinedPlay && MusicStringParser::FindVoiceLayers(strMusicNotes, usedLayers))
+        {
+            m_Renderer.BeginStreaming(usedLayers);
+
+            m_ParseResult = std::async(std::launch::async, [this, strMusicNotes, pCache, key]() -> bool
+            {
+                bool bResult = m_Parser.Parse(strMusicNotes);	// Parse and Load the Notes into MIDI MultiTrack
+                m_Renderer.EndStreaming();
+                if(bResult && pCache != NULL)
+                    pCache->Store(key, m_Renderer, m_Parser); // Skipped if the streaming got cancelled
+                return bResult;
+            });
+
+            m_Renderer.WaitForHorizon(m_lLookahead); // Let the parser get ahead by the lookahead window
+
+            if(m_ParseResult.wait_for(std::chrono::seconds(0)) == std::future_status::ready && m_ParseResult.get() == false)
+                return false; // Parsing failed before the play could begin
+        }
+        else if(false == m_Parser.Parse(strMusicNotes))	// Parse and Load the Notes into MIDI MultiTrack
             return false;
+        else if(pCache != NULL)
+            pCache->Store(key, m_Renderer, m_Parser);
 
         return m_Renderer.BeginPlayAsync(m_nOutPort, m_nTimerRes); // Start Playing on the given MIDIport with supplied resolution
     }
@@ -50,6 +83,17 @@ namespace CFugue
 	void Player::StopPlay()
 	{
 		m_Renderer.EndPlayAsync();
+
+		CancelPipelinedParse();
+	}
+
+	void Player::CancelPipelinedParse()
+	{
+		if(m_ParseResult.valid() == false) return;
+
+		m_Renderer.CancelStreaming();
+
+		m_ParseResult.get();
 	}
 
 	void Player::WaitTillDone()
@@ -57,18 +101,71 @@ namespace CFugue
 		m_Renderer.WaitTillDone();
 	}
 
-	bool Player::SaveAsMidiFile(const MString& strMusicNotes, const char* szOutputFilePath)
+	bool Player::Render(const MString& strMusicNotes)
 	{
+		CancelPipelinedParse(); // Finish off any parsing in progress
+
+		MIDIRenderCache::Key key;
+		if(m_pRenderCache != NULL)
+		{
+			key = MIDIRenderCache::MakeKey(strMusicNotes, m_Parser);
+			if(m_pRenderCache->Restore(key, m_Renderer, m_Parser))
+				return true;
+		}
+
 		m_Renderer.Clear(); // Clear any previous Notes
 
-		m_Parser.Parse(strMusicNotes);	// Parse the Notes and Load the Midi Events into MIDI MultiTrack
+		bool bResult = m_Parser.Parse(strMusicNotes);	// Parse the Notes and Load the Midi Events into MIDI MultiTrack
+
+		if(bResult && m_pRenderCache != NULL)
+			m_pRenderCache->Store(key, m_Renderer, m_Parser);
+
+		return bResult;
+	}
+
+	bool Player::SaveAsMidiFile(const MString& strMusicNotes, const char* szOutputFilePath)
+	{
+		Render(strMusicNotes);
 
 		return m_Renderer.SaveToFile(szOutputFilePath);
 	}
 
+	bool Player::SaveAsMidiFile(const MString& strMusicNotes, std::vector<uint8_t>& outBuffer)
+	{
+		Render(strMusicNotes);
+
+		return m_Renderer.SaveToBuffer(outBuffer);
+	}
+
+	bool Player::SaveAsMidiFile(const MString& strMusicNotes, std::ostream& outStream)
+	{
+		Render(strMusicNotes);
+
+		return m_Renderer.SaveToStream(outStream);
+	}
+
 	bool Player::SaveToMidiFile(const char* szOutputFilePath)
 	{
+		if(m_ParseResult.valid()) // Pipelined play might still be rendering the notes
+			m_ParseResult.wait();
+
 		return m_Renderer.SaveToFile(szOutputFilePath);
 	}
 
+	bool Player::SaveToMidiFile(std::vector<uint8_t>& outBuffer)
+	{
+		if(m_ParseResult.valid()) // Pipelined play might still be rendering the notes
+			m_ParseResult.wait();
+
+		return m_Renderer.SaveToBuffer(outBuffer);
+	}
+
+	bool Player::SaveToMidiFile(std::ostream& outStream)
+	{
+		if(m_ParseResult.valid()) // Pipelined play might still be rendering the notes
+			m_ParseResult.wait();
+
+		return m_Renderer.SaveToStream(outStream);
+	}
+
 } // namespace CFugue
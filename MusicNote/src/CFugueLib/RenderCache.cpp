@@ -0,0 +1,255 @@
+/*
+	This is part of CFugue, a C++ Runtime for MIDI Score Programming
+	Copyright (C) 2009 Gopalakrishna Palem
+
+	For links to further information, or to contact the author,
+	see <http://cfugue.sourceforge.net/>.
+*/
+
+#include "stdafx.h"
+#include "RenderCache.h"
+
+#include <functional>
+
+namespace CFugue
+{
+	bool MIDIRenderCache::Key::operator == (const Key& other) const
+	{
+		return nStringHash == other.nStringHash
+			&& nStateHash == other.nStateHash
+			&& nDefinitionsHash == other.nDefinitionsHash
+			&& strMusicNotes == other.strMusicNotes;
+	}
+
+	MIDIRenderCache::MIDIRenderCache(size_t nMaxBytes /*= 32 * 1024 * 1024*/)
+		: m_nMaxBytes(nMaxBytes), m_nBytes(0), m_nHits(0), m_nMisses(0)
+	{
+	}
+
+	MIDIRenderCache::~MIDIRenderCache()
+	{
+	}
+
+	MIDIRenderCache::Key MIDIRenderCache::MakeKey(const MString& strMusicNotes, const MusicStringParser& parser)
+	{
+		Key key;
+		key.strMusicNotes = (const TCHAR*)strMusicNotes;
+		key.nStringHash = std::hash<std::basic_string<TCHAR> >()(key.strMusicNotes);
+		key.nStateHash = parser.GetRenderStateHash();
+		key.nDefinitionsHash = parser.GetDefinitionsHash();
+		return key;
+	}
+
+	size_t MIDIRenderCache::HashOf(const Key& key)
+	{
+		return key.nStringHash ^ (key.nStateHash + 0x9e3779b9 + (key.nStringHash << 6) + (key.nStringHash >> 2));
+	}
+
+	bool MIDIRenderCache::Restore(const Key& key, MIDIRenderer& renderer, MusicStringParser& parser)
+	{
+		EntryPtr pEntry;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			std::pair<EntryMap::iterator, EntryMap::iterator> range = m_Index.equal_range(HashOf(key));
+			for(EntryMap::iterator iter = range.first; iter != range.second; ++iter)
+			{
+				if((*iter->second)->key == key)
+				{
+					m_Entries.splice(m_Entries.begin(), m_Entries, iter->second); // Now the most recently used
+					pEntry = *iter->second;
+					break;
+				}
+			}
+
+			if(pEntry == NULL)
+			{
+				m_nMisses++;
+				return false;
+			}
+
+			m_nHits++;
+		}
+
+		// The entry stays valid even if it gets dropped from the cache meanwhile
+		renderer.Clear();
+
+		renderer.m_Tracks.SetClksPerBeat(pEntry->nClksPerBeat);
+
+		for(size_t i = 0; i < pEntry->tracks.size(); ++i)
+		{
+			const TrackEvents& track = pEntry->tracks[i];
+			jdkmidi::MIDITrack* pTrack = renderer.m_Tracks.GetTrack(track.nTrack);
+
+			for(size_t j = 0; j < track.events.size(); ++j)
+				pTrack->AppendEvent(track.events[j]); // already in the track order
+		}
+
+		renderer.m_Sequencer.ResetAllTracks();
+
+		parser.SetKeySignature(pEntry->finalKeySig);
+
+		return true;
+	}
+
+	bool MIDIRenderCache::Store(const Key& key, MIDIRenderer& renderer, const MusicStringParser& parser)
+	{
+		if(parser.GetDefinitionsHash() != key.nDefinitionsHash) return false; // The Music String defined macros
+
+		{
+			std::lock_guard<std::mutex> lock(renderer.m_StreamMutex);
+			if(renderer.m_bDiscardEvents) return false; // Pipelined parse was cancelled. Tracks are incomplete
+		}
+
+		std::shared_ptr<Entry> pEntry(new Entry);
+		pEntry->key = key;
+		pEntry->finalKeySig = parser.GetKeySignature();
+		pEntry->nClksPerBeat = renderer.m_Tracks.GetClksPerBeat();
+		pEntry->nBytes = sizeof(Entry) + key.strMusicNotes.size() * sizeof(TCHAR);
+
+		for(int nTrack = 0; nTrack < renderer.m_Tracks.GetNumTracks(); ++nTrack)
+		{
+			const jdkmidi::MIDITrack* pTrack = renderer.m_Tracks.GetTrack(nTrack);
+			int nEvents = pTrack->GetNumEvents();
+			if(nEvents == 0) continue;
+
+			pEntry->tracks.push_back(TrackEvents());
+			TrackEvents& track = pEntry->tracks.back();
+			track.nTrack = nTrack;
+			track.events.reserve(nEvents);
+
+			for(int i = 0; i < nEvents; ++i)
+			{
+				const jdkmidi::MIDITimedBigMessage* pMsg = pTrack->GetEventAddress(i);
+				track.events.push_back(*pMsg);
+				if(pMsg->GetSysEx() != NULL)
+					pEntry->nBytes += sizeof(jdkmidi::MIDISystemExclusive) + pMsg->GetSysEx()->GetLength();
+			}
+
+			pEntry->nBytes += sizeof(TrackEvents) + nEvents * sizeof(jdkmidi::MIDITimedBigMessage);
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if(pEntry->nBytes > m_nMaxBytes) return false;
+
+		// Replace any earlier entry of the same key (another player might have stored it meanwhile)
+		std::pair<EntryMap::iterator, EntryMap::iterator> range = m_Index.equal_range(HashOf(key));
+		for(EntryMap::iterator iter = range.first; iter != range.second; ++iter)
+		{
+			if((*iter->second)->key == key)
+			{
+				Remove(iter);
+				break;
+			}
+		}
+
+		m_Entries.push_front(pEntry);
+		m_Index.insert(EntryMap::value_type(HashOf(key), m_Entries.begin()));
+		m_nBytes += pEntry->nBytes;
+
+		Trim();
+
+		return true;
+	}
+
+	void MIDIRenderCache::Remove(EntryMap::iterator iter)
+	{
+		m_nBytes -= (*iter->second)->nBytes;
+		m_Entries.erase(iter->second);
+		m_Index.erase(iter);
+	}
+
+	void MIDIRenderCache::Trim()
+	{
+		while(m_nBytes > m_nMaxBytes && m_Entries.empty() == false)
+		{
+			EntryList::iterator iterOldest = --m_Entries.end();
+
+			std::pair<EntryMap::iterator, EntryMap::iterator> range = m_Index.equal_range(HashOf((*iterOldest)->key));
+			for(EntryMap::iterator iter = range.first; iter != range.second; ++iter)
+			{
+				if(iter->second == iterOldest)
+				{
+					Remove(iter);
+					break;
+				}
+			}
+		}
+	}
+
+	void MIDIRenderCache::Invalidate()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		m_Index.clear();
+		m_Entries.clear();
+		m_nBytes = 0;
+	}
+
+	size_t MIDIRenderCache::Invalidate(const MString& strMusicNotes)
+	{
+		std::basic_string<TCHAR> str((const TCHAR*)strMusicNotes);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		size_t nDropped = 0;
+
+		for(EntryMap::iterator iter = m_Index.begin(); iter != m_Index.end(); )
+		{
+			EntryMap::iterator iterCur = iter++;
+			if((*iterCur->second)->key.strMusicNotes == str)
+			{
+				Remove(iterCur);
+				nDropped++;
+			}
+		}
+
+		return nDropped;
+	}
+
+	void MIDIRenderCache::SetMaxBytes(size_t nMaxBytes)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_nMaxBytes = nMaxBytes;
+		Trim();
+	}
+
+	size_t MIDIRenderCache::GetMaxBytes() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_nMaxBytes;
+	}
+
+	size_t MIDIRenderCache::GetSizeInBytes() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_nBytes;
+	}
+
+	size_t MIDIRenderCache::GetEntryCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Entries.size();
+	}
+
+	unsigned long long MIDIRenderCache::GetHitCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_nHits;
+	}
+
+	unsigned long long MIDIRenderCache::GetMissCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_nMisses;
+	}
+
+	void MIDIRenderCache::ResetCounters()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_nHits = 0;
+		m_nMisses = 0;
+	}
+
+} // namespace CFugue
@@ -0,0 +1,195 @@
+/*
+	This is part of CFugue, a C++ Runtime for MIDI Score Programming
+	Copyright (C) 2009 Gopalakrishna Palem
+
+	For links to further information, or to contact the author,
+	see <http://cfugue.sourceforge.net/>.
+*/
+
+// PortRegistryTest.cpp
+//
+// Checks the MIDIPortRegistry against a fake port backend: that the port list is
+// served from the cache till the backend reports a change, and that port IDs stay
+// with their devices as ports are plugged in and out.
+//
+// Returns the number of failed checks.
+
+#include <stdio.h>
+#include <string>
+
+#include "MidiDevice.h"
+
+using namespace CFugue;
+
+static int nFailures = 0;
+
+#define CHECK(cond) \
+	do { if(!(cond)) { nFailures++; fprintf(stderr, "%s(%d): CHECK failed: %s\n", __FILE__, __LINE__, #cond); } } while(0)
+
+///<Summary>A port backend that tests can plug ports in and out of</Summary>
+class MIDIPortEnumeratorFake : public MIDIPortEnumerator
+{
+public:
+	MIDIPortInfoList	m_InPorts;
+	MIDIPortInfoList	m_OutPorts;
+	bool				m_bCanNotify;	// false to behave like a backend that cannot detect changes
+	bool				m_bChanged;
+	int					m_nEnumerations;
+
+	MIDIPortEnumeratorFake() : m_bCanNotify(true), m_bChanged(false), m_nEnumerations(0) { }
+
+	void EnumeratePorts(MIDIPortInfoList& inPorts, MIDIPortInfoList& outPorts)
+	{
+		m_nEnumerations++;
+		inPorts = m_InPorts;
+		outPorts = m_OutPorts;
+	}
+
+	bool PollForChanges()
+	{
+		bool bChanged = m_bChanged && m_bCanNotify;
+		m_bChanged = false;
+		return bChanged;
+	}
+
+	/// Plugs in an output port at the given enumeration position
+	void PlugOut(size_t nPos, const std::string& strName, const std::string& strID)
+	{
+		MIDIPortInfo portInfo;
+		portInfo.strName = strName;
+		portInfo.strID = strID;
+		m_OutPorts.insert(m_OutPorts.begin() + nPos, portInfo);
+		m_bChanged = true;
+	}
+
+	/// Unplugs the output port with the given ID
+	void UnplugOut(const std::string& strID)
+	{
+		for(size_t i=0; i < m_OutPorts.size(); ++i)
+			if(m_OutPorts[i].strID == strID)
+			{
+				m_OutPorts.erase(m_OutPorts.begin() + i);
+				m_bChanged = true;
+				return;
+			}
+	}
+};
+
+static int nPortsChangedEvents = 0;
+
+static void OnPortsChanged(const MIDIPortRegistry*, OIL::CEventHandlerArgs*)
+{
+	nPortsChangedEvents++;
+}
+
+static void TestCache()
+{
+	MIDIPortEnumeratorFake fake;
+	fake.PlugOut(0, "Synth:0", "20:0");
+	fake.PlugOut(1, "Synth:1", "20:1");
+
+	MIDIPortRegistry registry(&fake);
+	registry.evPortsChanged.Subscribe(&OnPortsChanged);
+	nPortsChangedEvents = 0;
+
+	CHECK(fake.m_nEnumerations == 0); // nothing is enumerated till asked for
+	CHECK(registry.GetOutPorts().size() == 2);
+	CHECK(fake.m_nEnumerations == 1);
+
+	// Served from the cache while the backend reports nothing
+	registry.GetOutPorts();
+	registry.GetInPorts();
+	registry.FindOutPort("20:1");
+	CHECK(fake.m_nEnumerations == 1);
+	CHECK(nPortsChangedEvents == 0);	// the first scan is not a change
+
+	// A change notification invalidates the cache
+	fake.PlugOut(2, "Keyboard:0", "24:0");
+	CHECK(registry.GetOutPorts().size() == 3);
+	CHECK(fake.m_nEnumerations == 2);
+	CHECK(nPortsChangedEvents == 1);
+
+	// An explicit rescan always enumerates, but only raises the event for a change
+	registry.Rescan();
+	CHECK(fake.m_nEnumerations == 3);
+	CHECK(nPortsChangedEvents == 1);
+
+	registry.evPortsChanged.UnSubscribe(&OnPortsChanged);
+}
+
+static void TestCacheWithoutNotifications()
+{
+	MIDIPortEnumeratorFake fake;
+	fake.m_bCanNotify = false;
+	fake.PlugOut(0, "Synth:0", "20:0");
+
+	MIDIPortRegistry registry(&fake);
+	CHECK(registry.GetOutPorts().size() == 1);
+
+	// Without notifications the cache goes stale till Rescan() is called
+	fake.PlugOut(1, "Keyboard:0", "24:0");
+	CHECK(registry.GetOutPorts().size() == 1);
+	CHECK(registry.FindOutPort("24:0") == -1);
+
+	registry.Rescan();
+	CHECK(registry.GetOutPorts().size() == 2);
+	CHECK(registry.FindOutPort("24:0") == 1);
+}
+
+static void TestStableIDs()
+{
+	MIDIPortEnumeratorFake fake;
+	fake.PlugOut(0, "Synth:0", "20:0");
+	fake.PlugOut(1, "Keyboard:0", "24:0");
+	fake.PlugOut(2, "Expander:0", "28:0");
+
+	MIDIPortRegistry registry(&fake);
+	CHECK(registry.FindOutPort("24:0") == 1);
+	CHECK(registry.GetOutPortID(1) == "24:0");
+
+	// Unplugging a port before it moves the index, not the ID
+	fake.UnplugOut("20:0");
+	CHECK(registry.FindOutPort("24:0") == 0);
+	CHECK(registry.GetOutPortID(0) == "24:0");
+	CHECK(registry.FindOutPort("28:0") == 1);
+	CHECK(registry.FindOutPort("20:0") == -1);
+
+	// So does plugging one in before it
+	fake.PlugOut(0, "Drums:0", "32:0");
+	CHECK(registry.FindOutPort("24:0") == 1);
+	CHECK(registry.FindOutPort("28:0") == 2);
+	CHECK(registry.GetOutPortID(0) == "32:0");
+
+	// The index that held a device now names another one. Its ID tells them apart.
+	CHECK(registry.GetOutPortID(1) != "20:0");
+
+	// Rescans that find the same ports keep the same IDs at the same indices
+	registry.Rescan();
+	registry.Rescan();
+	CHECK(registry.GetOutPortID(0) == "32:0");
+	CHECK(registry.GetOutPortID(1) == "24:0");
+	CHECK(registry.GetOutPortID(2) == "28:0");
+	CHECK(registry.GetOutPortID(3).empty());
+
+	// A device plugged back in is found under its old ID again
+	fake.PlugOut(3, "Synth:0", "20:0");
+	CHECK(registry.FindOutPort("20:0") == 3);
+
+	// Names still work as a fall back
+	CHECK(registry.FindOutPort("Keyboard:0") == 1);
+	CHECK(registry.FindOutPort("No Such Port") == -1);
+}
+
+int main(int argc, char* argv[])
+{
+	TestCache();
+	TestCacheWithoutNotifications();
+	TestStableIDs();
+
+	if(nFailures == 0)
+		printf("PortRegistryTest: all checks passed\n");
+	else
+		fprintf(stderr, "PortRegistryTest: %d check(s) failed\n", nFailures);
+
+	return nFailures;
+}
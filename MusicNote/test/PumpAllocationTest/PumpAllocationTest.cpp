@@ -0,0 +1,123 @@
+/*
+	This is part of CFugue, a C++ Runtime for MIDI Score Programming
+	Copyright (C) 2009 Gopalakrishna Palem
+
+	For links to further information, or to contact the author,
+	see <http://cfugue.sourceforge.net/>.
+*/
+
+// PumpAllocationTest.cpp
+//
+// Checks that the MIDIPlaybackEngine pump path does not allocate. A sequence is
+// played through a driver that discards its output, while this program's own
+// operator new counts the allocations made inside the ticks.
+//
+// Returns the number of failed checks.
+
+#include <stdio.h>
+#include <stdlib.h>	// malloc, free
+#include <atomic>
+#include <chrono>
+#include <new>
+
+#include "PlaybackEngine.h"
+#include "MidiTimer.h"
+#include "jdkmidi/driver.h"
+#include "jdkmidi/manager.h"
+#include "jdkmidi/multitrack.h"
+#include "jdkmidi/sequencer.h"
+
+using namespace CFugue;
+
+static int nFailures = 0;
+
+#define CHECK(cond) \
+	do { if(!(cond)) { nFailures++; fprintf(stderr, "%s(%d): CHECK failed: %s\n", __FILE__, __LINE__, #cond); } } while(0)
+
+// Set by the engine thread while it is inside a tick
+static thread_local bool bInTimeTick = false;
+static std::atomic<unsigned long> nTickAllocations(0);
+
+void* operator new(std::size_t nSize)
+{
+	if(bInTimeTick) ++nTickAllocations;
+	void* p = malloc(nSize ? nSize : 1);
+	if(p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	free(p);
+}
+
+///<Summary>A driver that counts its output instead of sending it anywhere</Summary>
+class MIDIDriverCounting : public jdkmidi::MIDIDriver
+{
+public:
+	std::atomic<unsigned long> m_nMessagesOut;
+
+	MIDIDriverCounting() : jdkmidi::MIDIDriver(128), m_nMessagesOut(0) { }
+
+	virtual bool HardwareMsgOut(const jdkmidi::MIDITimedBigMessage&)
+	{
+		++m_nMessagesOut;
+		return true;
+	}
+
+	virtual bool TimeTick(jdkmidi::MIDIClockTime sysTime)
+	{
+		bInTimeTick = true;
+		bool bHasMoreEvents = jdkmidi::MIDIDriver::TimeTick(sysTime);
+		bInTimeTick = false;
+		return bHasMoreEvents;
+	}
+};
+
+int main()
+{
+	const int nNotes = 64;	// one note per clock, about 1.5 seconds at the default tempo
+
+	jdkmidi::MIDIMultiTrack tracks(1);
+	tracks.SetClksPerBeat(24);
+	for(int i = 0; i < nNotes; ++i)
+	{
+		jdkmidi::MIDITimedBigMessage msg;
+		msg.SetNoteOn(0, (unsigned char)(60 + i % 12), 100);
+		msg.SetTime(i);
+		tracks.GetTrack(0)->PutEvent(msg);
+		msg.SetNoteOff(0, (unsigned char)(60 + i % 12), 0);
+		msg.SetTime(i + 1);
+		tracks.GetTrack(0)->PutEvent(msg);
+	}
+
+	MIDIDriverCounting driver;
+	jdkmidi::MIDISequencer sequencer(&tracks);
+	jdkmidi::MIDIManager manager(&driver);
+	sequencer.GoToZero();
+	manager.SetSeq(&sequencer);
+	manager.SeqPlay();
+	manager.SetTimeOffset(MidiTimer::Now());
+
+	std::future<bool> done = MIDIPlaybackEngine::Instance().Register(&driver, 1);
+	CHECK(done.valid());
+	if(done.valid())
+	{
+		CHECK(done.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+		MIDIPlaybackEngine::Instance().Unregister(&driver);
+		CHECK(done.get());
+	}
+
+	CHECK(driver.m_nMessagesOut >= 2 * nNotes);	// the notes, and whatever the sequencer adds at the end
+	CHECK(nTickAllocations == 0);
+
+	if(nTickAllocations != 0)
+		fprintf(stderr, "%lu allocations on the pump path\n", (unsigned long)nTickAllocations);
+
+	return nFailures;
+}